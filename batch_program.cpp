@@ -0,0 +1,670 @@
+#include "batch_program.h"
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include "string_functions.h"
+
+namespace Renaissance
+{
+namespace
+{
+const uint64_t AllRows = ~uint64_t(0);
+
+// index of the lowest set bit, the mask must not be zero
+inline size_t LowestBit(const uint64_t mask)
+{
+#if defined(__GNUC__)
+   return static_cast<size_t>(__builtin_ctzll(mask));
+#else
+   size_t bit = 0;
+   while (((mask >> bit) & 1) == 0)
+      bit++;
+   return bit;
+#endif
+}
+
+// number of set bits of the mask
+inline size_t BitsNumber(const uint64_t mask)
+{
+#if defined(__GNUC__)
+   return static_cast<size_t>(__builtin_popcountll(mask));
+#else
+   size_t bits = 0;
+   for (uint64_t rest = mask; rest != 0; rest &= rest - 1)
+      bits++;
+   return bits;
+#endif
+}
+
+// value of the row in the column of the variable, returns false if the value is missing
+inline bool GetColumnValue(const RecordBatch& batch, const uint32_t slot, const size_t row, StringView& value)
+{
+   if (slot >= batch._columns.size())
+      return false;
+   const RecordBatch::Column& column = batch._columns[slot];
+   if (!column._offsets || (column._validity && ((column._validity[row / 64] >> (row % 64)) & 1) == 0))
+      return false;
+
+   value = StringView(column._data + column._offsets[row], column._offsets[row + 1] - column._offsets[row]);
+   return true;
+}
+
+// 8 bytes from the position 8 - N make the mask of N first bytes of a word regardless of the byte order
+const unsigned char PrefixMaskBytes[16] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0, 0, 0, 0, 0, 0, 0, 0};
+
+// up to 8 first chars of a value packed into an integer, so short values are compared as integers
+// a whole word is loaded, so there must be at least 8 chars from the beginning of the value to the end of the data
+inline uint64_t LoadPackedKey(const char* begin, const uint32_t length)
+{
+   uint64_t key;
+   uint64_t mask;
+   std::memcpy(&key, begin, 8);
+   std::memcpy(&mask, PrefixMaskBytes + 8 - std::min<uint32_t>(length, 8), 8);
+   return key & mask;
+}
+
+// the same for a value close to the end of the data
+inline uint64_t PackedKey(const char* begin, const uint32_t length, const char* end)
+{
+   if (end - begin >= 8)
+      return LoadPackedKey(begin, length);
+
+   uint64_t key = 0;
+   if (length != 0)
+      std::memcpy(&key, begin, std::min<uint32_t>(length, 8));
+   return key;
+}
+
+// provides values of a string operand by words of 64 rows of the batch
+class OperandColumn
+{
+public:
+   OperandColumn(const RecordBatch& batch, const uint32_t slot, const bool is_constant, const StringView& constant, const bool is_substr, const uint32_t from, const uint32_t length)
+      : _is_constant(is_constant), _constant(constant), _from(is_substr ? from : 0), _length(is_substr ? length : std::numeric_limits<uint32_t>::max())
+   {
+      if (!is_constant && slot < batch._columns.size())
+      {
+         _data = batch._columns[slot]._data;
+         _offsets = batch._columns[slot]._offsets;
+         _validity = batch._columns[slot]._validity;
+         if (_offsets)
+            _end = _data + _offsets[batch._rows_number];
+      }
+   }
+
+   // mask of rows of the word where the value is present
+   inline uint64_t ValidRows(const size_t word) const
+   {
+      if (_is_constant)
+         return AllRows;
+      if (!_offsets)
+         return 0;
+      return _validity ? _validity[word] : AllRows;
+   }
+
+   // beginnings, lengths and packed keys of values of 'rows_number' rows from the 'first_row', the column must be present
+   // a value is the whole string unless it's a substring, which is taken the same way as by Substring, so the loop has no branches
+   inline void Load(const size_t first_row, const size_t rows_number, const char** begins, uint32_t* lengths, uint64_t* keys) const
+   {
+      if (_is_constant)
+      {
+         const uint32_t length = static_cast<uint32_t>(_constant.size());
+         std::fill(begins, begins + rows_number, _constant.data());
+         std::fill(lengths, lengths + rows_number, length);
+         std::fill(keys, keys + rows_number, PackedKey(_constant.data(), length, _constant.data() + length));
+         return;
+      }
+
+      const uint32_t* offsets = _offsets + first_row;
+      for (size_t i = 0; i < rows_number; i++)
+      {
+         const uint32_t size = offsets[i + 1] - offsets[i];
+         const uint32_t from = std::min(_from, size);
+         begins[i] = _data + offsets[i] + from;
+         lengths[i] = std::min(_length, size - from);
+      }
+      // values start before the end of the last one, so whole words of all values are loaded if they don't cross the end of the data
+      if (_end - (_data + offsets[rows_number]) >= 8)
+      {
+         for (size_t i = 0; i < rows_number; i++)
+            keys[i] = LoadPackedKey(begins[i], lengths[i]);
+      }
+      else
+      {
+         for (size_t i = 0; i < rows_number; i++)
+            keys[i] = PackedKey(begins[i], lengths[i], _end);
+      }
+   }
+
+   // the same for the rows of the word set in the 'rows' mask only, values of other rows are left undefined
+   inline void LoadRows(const size_t first_row, const uint64_t rows, const char** begins, uint32_t* lengths, uint64_t* keys) const
+   {
+      if (_is_constant)
+      {
+         Load(first_row, 64, begins, lengths, keys);
+         return;
+      }
+
+      for (uint64_t rest = rows; rest != 0; rest &= rest - 1)
+      {
+         const size_t i = LowestBit(rest);
+         const uint32_t* offsets = _offsets + first_row + i;
+         const uint32_t size = offsets[1] - offsets[0];
+         const uint32_t from = std::min(_from, size);
+         begins[i] = _data + offsets[0] + from;
+         lengths[i] = std::min(_length, size - from);
+         keys[i] = PackedKey(begins[i], lengths[i], _end);
+      }
+   }
+
+private:
+   bool _is_constant;
+   StringView _constant;
+   uint32_t _from;
+   uint32_t _length;
+   const char* _data = nullptr;
+   const char* _end = nullptr;
+   const uint32_t* _offsets = nullptr;
+   const uint64_t* _validity = nullptr;
+};
+}
+
+// evaluate the expression for all rows of the batch
+// rows where the expression is true are set in 'selection', rows where it couldn't be evaluated are set in 'failures'
+// returns true if successful
+bool BatchProgram::Execute(const RecordBatch& batch, SelectionMask& selection, SelectionMask& failures) const
+{
+   const size_t words_number = (batch._rows_number + 63) / 64;
+   selection.assign(words_number, 0);
+   failures.assign(words_number, 0);
+   if (_nodes.empty())
+      return false;
+   if (words_number == 0)
+      return true;
+
+   // rows beyond the batch are neither selected nor failed
+   const size_t tail = batch._rows_number % 64;
+   const uint64_t last_word_mask = (tail == 0 ? AllRows : (uint64_t(1) << tail) - 1);
+
+   // masks of all nodes, the node N has words from N * words_number, the result of the root is needed for all rows
+   const size_t root = (_nodes.size() - 1) * words_number;
+   std::vector<uint64_t> values(_nodes.size() * words_number);
+   std::vector<uint64_t> valid(_nodes.size() * words_number);
+   std::vector<uint64_t> needed(_nodes.size() * words_number);
+   std::fill(needed.begin() + root, needed.end(), AllRows);
+   needed.back() = last_word_mask;
+   ExecuteNode(_nodes.size() - 1, batch, words_number, values, valid, needed);
+
+   for (size_t word = 0; word < words_number; word++)
+   {
+      const uint64_t mask = (word == words_number - 1 ? last_word_mask : AllRows);
+      selection[word] = values[root + word] & valid[root + word] & mask;
+      failures[word] = ~valid[root + word] & mask;
+   }
+   return true;
+}
+
+// evaluate the node for the rows set in its 'needed' mask, children are evaluated first, so the operands of && and || short-circuit
+// the same way as in the row by row execution: the second operand is evaluated only for the rows where the first one doesn't decide the result
+// masks of the rows which are not needed are left undefined, they never affect results of the needed rows
+void BatchProgram::ExecuteNode(const size_t node_index, const RecordBatch& batch, const size_t words_number,
+                               std::vector<uint64_t>& values, std::vector<uint64_t>& valid, std::vector<uint64_t>& needed) const
+{
+   const Node& node = _nodes[node_index];
+   uint64_t* node_values = &values[node_index * words_number];
+   uint64_t* node_valid = &valid[node_index * words_number];
+   const uint64_t* node_needed = &needed[node_index * words_number];
+   const uint64_t* values1 = &values[node._child1 * words_number];
+   const uint64_t* valid1 = &valid[node._child1 * words_number];
+   const uint64_t* values2 = &values[node._child2 * words_number];
+   const uint64_t* valid2 = &valid[node._child2 * words_number];
+   uint64_t* needed1 = &needed[node._child1 * words_number];
+   uint64_t* needed2 = &needed[node._child2 * words_number];
+
+   switch (node._type)
+   {
+      case NodeType::Constant:
+         std::fill(node_values, node_values + words_number, node._value ? AllRows : 0);
+         std::fill(node_valid, node_valid + words_number, AllRows);
+         break;
+      case NodeType::And:
+         // the second operand matters only where the first one is true
+         std::copy(node_needed, node_needed + words_number, needed1);
+         ExecuteNode(node._child1, batch, words_number, values, valid, needed);
+         for (size_t word = 0; word < words_number; word++)
+            needed2[word] = node_needed[word] & valid1[word] & values1[word];
+         ExecuteNode(node._child2, batch, words_number, values, valid, needed);
+
+         for (size_t word = 0; word < words_number; word++)
+         {
+            node_valid[word] = valid1[word] & (~values1[word] | valid2[word]);
+            node_values[word] = values1[word] & values2[word] & node_valid[word];
+         }
+         break;
+      case NodeType::Or:
+         // the second operand matters only where the first one is false
+         std::copy(node_needed, node_needed + words_number, needed1);
+         ExecuteNode(node._child1, batch, words_number, values, valid, needed);
+         for (size_t word = 0; word < words_number; word++)
+            needed2[word] = node_needed[word] & valid1[word] & ~values1[word];
+         ExecuteNode(node._child2, batch, words_number, values, valid, needed);
+
+         for (size_t word = 0; word < words_number; word++)
+         {
+            node_valid[word] = valid1[word] & (values1[word] | valid2[word]);
+            node_values[word] = (values1[word] | (valid1[word] & values2[word])) & node_valid[word];
+         }
+         break;
+      case NodeType::CompareBooleans:
+         std::copy(node_needed, node_needed + words_number, needed1);
+         std::copy(node_needed, node_needed + words_number, needed2);
+         ExecuteNode(node._child1, batch, words_number, values, valid, needed);
+         ExecuteNode(node._child2, batch, words_number, values, valid, needed);
+
+         for (size_t word = 0; word < words_number; word++)
+         {
+            const uint64_t a = values1[word];
+            const uint64_t b = values2[word];
+            uint64_t result;
+            switch (node._operator)
+            {
+               case TokenType::OperatorEqual:
+                  result = ~(a ^ b);
+                  break;
+               case TokenType::OperatorNotEqual:
+                  result = a ^ b;
+                  break;
+               case TokenType::OperatorLess:
+                  result = ~a & b;
+                  break;
+               case TokenType::OperatorLessOrEqual:
+                  result = ~a | b;
+                  break;
+               case TokenType::OperatorMore:
+                  result = a & ~b;
+                  break;
+               default:
+                  result = a | ~b;
+                  break;
+            }
+            node_valid[word] = valid1[word] & valid2[word];
+            node_values[word] = result & node_valid[word];
+         }
+         break;
+      case NodeType::CompareStrings:
+      case NodeType::InSet:
+         ExecuteStrings(node, batch, words_number, node_needed, node_values, node_valid);
+         break;
+      case NodeType::Rows:
+         ExecuteRows(node, batch, words_number, node_needed, node_values, node_valid);
+         break;
+   }
+}
+
+// the kernel of string comparisons and set lookups, it takes 64 rows at once: values are compared by their lengths and packed keys
+// of up to 8 first chars in branchless loops, only the rest of longer values is compared by memcmp,
+// values are looked up in large sets only if there are items of the same length
+void BatchProgram::ExecuteStrings(const Node& node, const RecordBatch& batch, const size_t words_number, const uint64_t* needed, uint64_t* node_values, uint64_t* node_valid) const
+{
+   const StringOperand& operand1 = node._operand1;
+   const StringOperand& operand2 = node._operand2;
+   const OperandColumn column1(batch, operand1._slot, operand1._type == OperandType::Constant,
+                               operand1._type == OperandType::Constant ? StringView(_constants[operand1._constant]) : StringView(),
+                               operand1._type == OperandType::Substr, operand1._from, operand1._length);
+   const OperandColumn column2(batch, operand2._slot, operand2._type == OperandType::Constant,
+                               operand2._type == OperandType::Constant ? StringView(_constants[operand2._constant]) : StringView(),
+                               operand2._type == OperandType::Substr, operand2._from, operand2._length);
+   const StringSet* set = (node._type == NodeType::InSet ? &_sets[node._set] : nullptr);
+   const uint64_t lengths_mask = (set ? set->LengthsMask() : 0);
+
+   // items of small sets of short strings are matched by their keys, the same way as a literal
+   // words with a few rows to evaluate are not worth the loops over all 64 rows
+   const size_t MaxPackedItems = 8;
+   const size_t SparseRowsNumber = 16;
+   uint32_t item_lengths[MaxPackedItems];
+   uint64_t item_keys[MaxPackedItems];
+   size_t packed_items = 0;
+   bool is_packed = (set && set->Size() <= MaxPackedItems);
+   for (size_t i = 0; is_packed && i < set->Size(); i++)
+   {
+      const std::string& item = set->Items()[i];
+      is_packed = (item.size() <= 8);
+      item_lengths[i] = static_cast<uint32_t>(item.size());
+      item_keys[i] = PackedKey(item.data(), item_lengths[i], item.data() + item.size());
+      packed_items++;
+   }
+
+   const char* begins1[64];
+   const char* begins2[64];
+   uint32_t lengths1[64];
+   uint32_t lengths2[64];
+   uint64_t keys1[64];
+   uint64_t keys2[64];
+   // a literal is loaded once for all words
+   const bool is_constant2 = (operand2._type == OperandType::Constant);
+   if (is_constant2)
+      column2.Load(0, 64, begins2, lengths2, keys2);
+
+   // a row matches the literal or a small set if the lengths and the packed keys are equal and the rest of a long value is the same
+   const auto matches_row = [&](const size_t i) -> bool
+   {
+      if (is_packed)
+      {
+         bool is_found = false;
+         for (size_t item = 0; item < packed_items; item++)
+            is_found |= (lengths1[i] == item_lengths[item]) & (keys1[i] == item_keys[item]);
+         return is_found;
+      }
+      if (set)
+         return set->Contains(StringView(begins1[i], lengths1[i]));
+      return lengths1[i] == lengths2[i] && keys1[i] == keys2[i] && (lengths1[i] <= 8 || std::memcmp(begins1[i] + 8, begins2[i] + 8, lengths1[i] - 8) == 0);
+   };
+
+   for (size_t word = 0; word < words_number; word++)
+   {
+      const size_t first_row = word * 64;
+      const size_t rows_number = std::min<size_t>(64, batch._rows_number - first_row);
+      // the needed rows are within the batch, so the valid rows are among the loaded ones
+      const uint64_t word_valid = column1.ValidRows(word) & (set ? AllRows : column2.ValidRows(word)) & needed[word];
+
+      uint64_t word_values = 0;
+      if (BitsNumber(word_valid) <= SparseRowsNumber)
+      {
+         // a few rows left by short-circuiting are matched one by one
+         column1.LoadRows(first_row, word_valid, begins1, lengths1, keys1);
+         if (!set && !is_constant2)
+            column2.LoadRows(first_row, word_valid, begins2, lengths2, keys2);
+         for (uint64_t rows = word_valid; rows != 0; rows &= rows - 1)
+         {
+            const size_t i = LowestBit(rows);
+            word_values |= uint64_t(matches_row(i)) << i;
+         }
+      }
+      else
+      {
+         column1.Load(first_row, rows_number, begins1, lengths1, keys1);
+         if (is_packed)
+         {
+            for (size_t item = 0; item < packed_items; item++)
+            {
+               for (size_t i = 0; i < rows_number; i++)
+                  word_values |= uint64_t((lengths1[i] == item_lengths[item]) & (keys1[i] == item_keys[item])) << i;
+            }
+         }
+         else if (set)
+         {
+            // the last bit of the lengths mask stands for all long values
+            uint64_t candidates = 0;
+            for (size_t i = 0; i < rows_number; i++)
+               candidates |= ((lengths_mask >> std::min<uint32_t>(lengths1[i], 63)) & 1) << i;
+            for (candidates &= word_valid; candidates != 0; candidates &= candidates - 1)
+            {
+               const size_t i = LowestBit(candidates);
+               word_values |= uint64_t(matches_row(i)) << i;
+            }
+         }
+         else
+         {
+            if (!is_constant2)
+               column2.Load(first_row, rows_number, begins2, lengths2, keys2);
+            uint64_t long_values = 0;
+            for (size_t i = 0; i < rows_number; i++)
+            {
+               word_values |= uint64_t((lengths1[i] == lengths2[i]) & (keys1[i] == keys2[i])) << i;
+               long_values |= uint64_t(lengths1[i] > 8) << i;
+            }
+            for (uint64_t rows = word_values & long_values & word_valid; rows != 0; rows &= rows - 1)
+            {
+               const size_t i = LowestBit(rows);
+               if (std::memcmp(begins1[i] + 8, begins2[i] + 8, lengths1[i] - 8) != 0)
+                  word_values &= ~(uint64_t(1) << i);
+            }
+         }
+      }
+
+      node_valid[word] = word_valid;
+      node_values[word] = (node._negate ? ~word_values : word_values) & word_valid;
+   }
+}
+
+// execute the program of a subexpression without kernels for every needed row of the batch and pack its results into the masks
+void BatchProgram::ExecuteRows(const Node& node, const RecordBatch& batch, const size_t words_number, const uint64_t* needed, uint64_t* node_values, uint64_t* node_valid) const
+{
+   const RowProgram& row_program = _row_programs[node._row_program];
+   VariableRecord record(_slots_number);
+   for (size_t word = 0; word < words_number; word++)
+   {
+      const size_t first_row = word * 64;
+      uint64_t word_values = 0;
+      uint64_t word_valid = 0;
+      for (uint64_t rows = needed[word]; rows != 0; rows &= rows - 1)
+      {
+         const size_t bit = LowestBit(rows);
+         for (const uint32_t slot : row_program._slots)
+         {
+            if (!GetColumnValue(batch, slot, first_row + bit, record[slot]))
+               record[slot] = StringView();
+         }
+
+         bool result = false;
+         if (row_program._program->Execute(record, result))
+         {
+            word_valid |= uint64_t(1) << bit;
+            word_values |= uint64_t(result) << bit;
+         }
+      }
+      node_values[word] = word_values;
+      node_valid[word] = word_valid;
+   }
+}
+
+
+// compile the syntax tree with the specified root into the batch 'program', variables are bound to slots of the 'schema'
+// subexpressions which have no column kernels are compiled into programs executed row by row,
+// the 'row_program' of the whole expression is used if the expression can't be split
+void BatchCompiler::Compile(const ExpressionNode* root, VariableSchema& schema, const std::shared_ptr<const ExpressionProgram>& row_program, BatchProgram& program)
+{
+   program._nodes.clear();
+   program._constants.clear();
+   program._sets.clear();
+   program._row_programs.clear();
+
+   _program = &program;
+   _schema = &schema;
+
+   uint32_t root_index = 0;
+   if (!root || !CompileNode(root, root_index))
+   {
+      program._nodes.clear();
+      program._constants.clear();
+      program._sets.clear();
+      program._row_programs.clear();
+      AddRowProgram(row_program, root_index);
+   }
+   program._slots_number = schema.Size();
+
+   _program = nullptr;
+   _schema = nullptr;
+}
+
+bool BatchCompiler::CompileNode(const ExpressionNode* node, uint32_t& node_index)
+{
+   BatchProgram::Node batch_node = BatchProgram::Node();
+   batch_node._operator = node->_token._type;
+
+   switch (node->_token._type)
+   {
+      case TokenType::True:
+      case TokenType::False:
+         batch_node._type = BatchProgram::NodeType::Constant;
+         batch_node._value = (node->_token._type == TokenType::True);
+         break;
+      case TokenType::OperatorLogicalAnd:
+      case TokenType::OperatorLogicalOr:
+         if (!node->_child || !node->_child->_sibling ||
+             !CompileNode(node->_child, batch_node._child1) || !CompileNode(node->_child->_sibling, batch_node._child2))
+         {
+            return false;
+         }
+         batch_node._type = (node->_token._type == TokenType::OperatorLogicalAnd ? BatchProgram::NodeType::And : BatchProgram::NodeType::Or);
+         break;
+      default:
+         if (!node->_token.IsOperator() || !node->_child || !node->_child->_sibling)
+            return false;
+
+         if (IsBoolean(node->_child) && IsBoolean(node->_child->_sibling))
+         {
+            if (!CompileNode(node->_child, batch_node._child1) || !CompileNode(node->_child->_sibling, batch_node._child2))
+               return false;
+            batch_node._type = BatchProgram::NodeType::CompareBooleans;
+         }
+         else if (!CompileComparison(node, batch_node))
+            return CompileRows(node, node_index);
+         break;
+   }
+
+   const bool has_children = (batch_node._type == BatchProgram::NodeType::And || batch_node._type == BatchProgram::NodeType::Or ||
+                              batch_node._type == BatchProgram::NodeType::CompareBooleans);
+   if (has_children && IsRowsNode(batch_node._child1) && IsRowsNode(batch_node._child2))
+   {
+      // neither operand has kernels, so the node is executed row by row by a single program instead of two
+      _program->_nodes.resize(batch_node._child1);
+      _program->_row_programs.resize(_program->_row_programs.size() - 2);
+      return CompileRows(node, node_index);
+   }
+
+   node_index = static_cast<uint32_t>(_program->_nodes.size());
+   _program->_nodes.push_back(batch_node);
+   return true;
+}
+
+// compile the boolean subexpression into a program executed row by row
+bool BatchCompiler::CompileRows(const ExpressionNode* node, uint32_t& node_index)
+{
+   auto program = std::make_shared<ExpressionProgram>();
+   ProgramCompiler compiler;
+   if (!compiler.Compile(node, *_schema, *program))
+      return false;
+   AddRowProgram(program, node_index);
+   return true;
+}
+
+void BatchCompiler::AddRowProgram(const std::shared_ptr<const ExpressionProgram>& program, uint32_t& node_index)
+{
+   BatchProgram::RowProgram row_program;
+   row_program._program = program;
+   for (const auto& instruction : program->Instructions())
+   {
+      if (instruction._op_code == OpCode::PushVariable || instruction._op_code == OpCode::PushNumberVariable)
+         row_program._slots.push_back(instruction._operand);
+   }
+   std::sort(row_program._slots.begin(), row_program._slots.end());
+   row_program._slots.erase(std::unique(row_program._slots.begin(), row_program._slots.end()), row_program._slots.end());
+
+   BatchProgram::Node batch_node = BatchProgram::Node();
+   batch_node._type = BatchProgram::NodeType::Rows;
+   batch_node._row_program = static_cast<uint32_t>(_program->_row_programs.size());
+   _program->_row_programs.push_back(std::move(row_program));
+   node_index = static_cast<uint32_t>(_program->_nodes.size());
+   _program->_nodes.push_back(batch_node);
+}
+
+bool BatchCompiler::IsRowsNode(const uint32_t node_index) const
+{
+   return node_index < _program->_nodes.size() && _program->_nodes[node_index]._type == BatchProgram::NodeType::Rows;
+}
+
+// compile comparison of strings, the only supported ones are == and != comparisons of variables, SUBSTR of variables and literals
+// comparisons of numbers are left to the row by row execution
+bool BatchCompiler::CompileComparison(const ExpressionNode* node, BatchProgram::Node& batch_node)
+{
+   if (node->_token._type != TokenType::OperatorEqual && node->_token._type != TokenType::OperatorNotEqual)
+      return false;
+
+   const auto& arg1 = node->_child;
+   const auto& arg2 = node->_child->_sibling;
+   if (IsNumberVariable(arg1) || IsNumberVariable(arg2) || (ProgramCompiler::IsNumber(arg1, *_schema) && ProgramCompiler::IsNumber(arg2, *_schema)))
+      return false;
+
+   batch_node._negate = (node->_token._type == TokenType::OperatorNotEqual);
+   if (!CompileOperand(arg1, batch_node._operand1))
+      return false;
+
+   if (arg2->_token._type != TokenType::LSquareBracket)
+   {
+      batch_node._type = BatchProgram::NodeType::CompareStrings;
+      return CompileOperand(arg2, batch_node._operand2);
+   }
+
+   std::vector<std::string> items;
+   for (auto item = arg2->_child; item; item = item->_sibling)
+   {
+      if (!item->_token.IsLiteral())
+         return false;
+      items.push_back(item->_token.ToString());
+   }
+
+   batch_node._type = BatchProgram::NodeType::InSet;
+   batch_node._set = static_cast<uint32_t>(_program->_sets.size());
+   _program->_sets.emplace_back(std::move(items));
+   return true;
+}
+
+bool BatchCompiler::CompileOperand(const ExpressionNode* node, BatchProgram::StringOperand& operand)
+{
+   operand = BatchProgram::StringOperand();
+   switch (node->_token._type)
+   {
+      case TokenType::Scalar:
+      case TokenType::Number:
+         operand._type = BatchProgram::OperandType::Constant;
+         operand._constant = static_cast<uint32_t>(_program->_constants.size());
+         _program->_constants.push_back(node->_token.ToString());
+         return true;
+      case TokenType::Variable:
+         operand._type = BatchProgram::OperandType::Column;
+         return _schema->FindVariable(node->_token.ToString(), operand._slot);
+      case TokenType::Func:
+      {
+         // only substring of a variable at the literal position is supported
+         const auto& source = node->_child;
+         if (node->_token.Text() != "SUBSTR" || !source || source->_token._type != TokenType::Variable ||
+             !source->_sibling || !source->_sibling->_token.IsLiteral() ||
+             !source->_sibling->_sibling || !source->_sibling->_sibling->_token.IsLiteral() ||
+             source->_sibling->_sibling->_sibling)
+         {
+            return false;
+         }
+
+         int from = 0;
+         int length = 0;
+         const NumberParsing from_parsing = ParseInt(source->_sibling->_token.Text(), from);
+         const NumberParsing length_parsing = ParseInt(source->_sibling->_sibling->_token.Text(), length);
+         if (from_parsing == NumberParsing::Invalid || length_parsing == NumberParsing::Invalid)
+            return false;
+
+         operand._type = BatchProgram::OperandType::Substr;
+         // negative numbers become huge positions or lengths, it's the same that std::string::substr does with them
+         operand._from = static_cast<uint32_t>(from);
+         operand._length = static_cast<uint32_t>(length);
+         // the substring is empty if any of the numbers doesn't fit into int
+         if (from_parsing == NumberParsing::OutOfRange || length_parsing == NumberParsing::OutOfRange)
+            operand._from = std::numeric_limits<uint32_t>::max();
+         return _schema->FindVariable(source->_token.ToString(), operand._slot);
+      }
+      default:
+         return false;
+   }
+}
+
+bool BatchCompiler::IsNumberVariable(const ExpressionNode* node) const
+{
+   return node->_token._type == TokenType::Variable && _schema->IsNumber(node->_token.ToString());
+}
+
+// returns true if the node is evaluated to a boolean value
+bool BatchCompiler::IsBoolean(const ExpressionNode* node)
+{
+   return node->_token._type == TokenType::True || node->_token._type == TokenType::False || node->_token.IsOperator();
+}
+}
@@ -0,0 +1,142 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <vector>
+#include "common.h"
+#include "expression_program.h"
+#include "string_set.h"
+#include "variable_schema.h"
+
+// This is to evaluate an expression over a batch of records stored by columns at once.
+// Every comparison is evaluated by a kernel which runs over whole columns and packs results into bitmasks, 64 rows per word,
+// logical operators become bitwise operations over the masks of their operands, the second operand of && and || is evaluated
+// only for the rows where the first one doesn't decide the result.
+// A string kernel takes 64 rows at once: lengths of values are compared (or looked up in the lengths mask of a set) in a branchless loop,
+// and only rows which pass this filter are compared by memcmp or looked up in the set.
+// Every boolean subexpression is represented by two masks: rows where it's true and rows where it's evaluated successfully,
+// so results (including evaluation failures, e.g. because of a missing value) are exactly the same as of the row by row evaluation.
+// Subexpressions which have no kernels (e.g. SUBSTR with variable position or comparisons of numbers) are compiled into programs
+// executed row by row, their results are packed into masks as well, so the rest of the expression is still evaluated by kernels.
+namespace Renaissance
+{
+// records stored by columns, a column of every variable is indexed by the variable slot
+struct RecordBatch
+{
+   struct Column
+   {
+      const char* _data = nullptr;         // values of all rows one after another
+      const uint32_t* _offsets = nullptr;  // rows number + 1 offsets of values in the data, a column without offsets is missing in all rows
+      const uint64_t* _validity = nullptr; // bit per row, value of the row is missing if its bit is not set, all values are present if null
+   };
+
+   size_t _rows_number = 0;
+   std::vector<Column> _columns;
+};
+
+// bit per row, bit N of word N / 64 stands for the row N
+typedef std::vector<uint64_t> SelectionMask;
+
+class BatchProgram
+{
+public:
+   BatchProgram() = default;
+   BatchProgram(const BatchProgram&) = delete;
+   BatchProgram(BatchProgram&&) = delete;
+   BatchProgram& operator =(const BatchProgram&) = delete;
+   BatchProgram& operator =(BatchProgram&&) = delete;
+   ~BatchProgram() = default;
+
+   bool Execute(const RecordBatch& batch, SelectionMask& selection, SelectionMask& failures) const;
+
+   // true if the expression is evaluated by column kernels, false if it's executed row by row as a whole
+   inline bool IsVectorized() const noexcept { return !_nodes.empty() && _nodes.back()._type != NodeType::Rows; }
+
+private:
+   friend class BatchCompiler;
+
+   enum class NodeType : uint8_t
+   {
+      Constant,       // _value
+      CompareStrings, // _operand1 == _operand2 (or != if _negate)
+      InSet,          // _operand1 == [_set] (or != if _negate)
+      CompareBooleans,// _child1 _operator _child2
+      And,            // _child1 && _child2
+      Or,             // _child1 || _child2
+      Rows            // _row_programs[_row_program] executed row by row
+   };
+
+   enum class OperandType : uint8_t
+   {
+      Column,         // value of the _slot variable
+      Substr,         // SUBSTR{_slot variable, _from, _length}
+      Constant        // _constant
+   };
+
+   struct StringOperand
+   {
+      OperandType _type;
+      uint32_t _slot;
+      uint32_t _from;
+      uint32_t _length;
+      uint32_t _constant;
+   };
+
+   struct Node
+   {
+      NodeType _type;
+      TokenType _operator;
+      bool _value;
+      bool _negate;
+      uint32_t _child1;
+      uint32_t _child2;
+      uint32_t _set;
+      uint32_t _row_program;
+      StringOperand _operand1;
+      StringOperand _operand2;
+   };
+
+   // a subexpression without kernels, only the variables it takes are copied into the record of a row
+   struct RowProgram
+   {
+      std::shared_ptr<const ExpressionProgram> _program;
+      std::vector<uint32_t> _slots;
+   };
+
+   std::vector<Node> _nodes; // children go before their parents, the root is the last one
+   std::vector<std::string> _constants;
+   std::vector<StringSet> _sets;
+   std::vector<RowProgram> _row_programs;
+   size_t _slots_number = 0;
+
+   void ExecuteNode(const size_t node_index, const RecordBatch& batch, const size_t words_number,
+                    std::vector<uint64_t>& values, std::vector<uint64_t>& valid, std::vector<uint64_t>& needed) const;
+   void ExecuteStrings(const Node& node, const RecordBatch& batch, const size_t words_number, const uint64_t* needed, uint64_t* node_values, uint64_t* node_valid) const;
+   void ExecuteRows(const Node& node, const RecordBatch& batch, const size_t words_number, const uint64_t* needed, uint64_t* node_values, uint64_t* node_valid) const;
+};
+
+class BatchCompiler
+{
+public:
+   BatchCompiler() = default;
+   BatchCompiler(const BatchCompiler&) = delete;
+   BatchCompiler(BatchCompiler&&) = delete;
+   BatchCompiler& operator =(const BatchCompiler&) = delete;
+   BatchCompiler& operator =(BatchCompiler&&) = delete;
+   ~BatchCompiler() = default;
+
+   void Compile(const ExpressionNode* root, VariableSchema& schema, const std::shared_ptr<const ExpressionProgram>& row_program, BatchProgram& program);
+
+private:
+   BatchProgram* _program = nullptr;
+   VariableSchema* _schema = nullptr;
+
+   bool CompileNode(const ExpressionNode* node, uint32_t& node_index);
+   bool CompileRows(const ExpressionNode* node, uint32_t& node_index);
+   void AddRowProgram(const std::shared_ptr<const ExpressionProgram>& program, uint32_t& node_index);
+   bool IsRowsNode(const uint32_t node_index) const;
+   bool CompileComparison(const ExpressionNode* node, BatchProgram::Node& batch_node);
+   bool CompileOperand(const ExpressionNode* node, BatchProgram::StringOperand& operand);
+   bool IsNumberVariable(const ExpressionNode* node) const;
+   static bool IsBoolean(const ExpressionNode* node);
+};
+}
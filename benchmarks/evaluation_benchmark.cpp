@@ -0,0 +1,245 @@
+#include <algorithm>
+#include <chrono>
+#include <benchmark/benchmark.h>
+#include "../expression_evaluator.h"
+#include "../rule_set.h"
+#include "perf_counters.h"
+#include "workload.h"
+
+using namespace Renaissance;
+
+namespace
+{
+const size_t TransactionsNumber = 4096;
+
+// value of the percentile (0 - 100) of the sorted values
+double Percentile(const std::vector<double>& sorted_values, const double percentile)
+{
+   if (sorted_values.empty())
+      return 0;
+   return sorted_values[std::min(sorted_values.size() - 1, static_cast<size_t>(sorted_values.size() * percentile / 100))];
+}
+
+// evaluate every record by the compiled expression 'iterations' times, the items are records
+void EvaluateRecords(benchmark::State& state, const CompiledExpression& compiled_expression, const std::vector<VariableRecord>& records)
+{
+   ExpressionEvaluator evaluator;
+   PerfCounters counters;
+   counters.Start();
+   for (auto _ : state)
+   {
+      for (const auto& record : records)
+      {
+         bool result = false;
+         benchmark::DoNotOptimize(evaluator.Evaluate(compiled_expression, record, result));
+         benchmark::DoNotOptimize(result);
+      }
+   }
+   counters.Stop();
+   state.SetItemsProcessed(state.iterations() * records.size());
+   counters.Report(state, state.iterations() * records.size());
+}
+
+// columns of records laid out the way RecordBatch expects them, a value without data is missing
+class ColumnBatch
+{
+public:
+   ColumnBatch(const std::vector<VariableRecord>& records, const size_t slots_number)
+      : _data(slots_number), _offsets(slots_number), _validity(slots_number, std::vector<uint64_t>((records.size() + 63) / 64))
+   {
+      _batch._rows_number = records.size();
+      _batch._columns.resize(slots_number);
+      for (size_t slot = 0; slot < slots_number; slot++)
+      {
+         _offsets[slot].push_back(0);
+         for (size_t row = 0; row < records.size(); row++)
+         {
+            if (records[row][slot].data() != nullptr)
+            {
+               _data[slot].append(records[row][slot].data(), records[row][slot].size());
+               _validity[slot][row / 64] |= uint64_t(1) << (row % 64);
+            }
+            _offsets[slot].push_back(static_cast<uint32_t>(_data[slot].size()));
+         }
+         _batch._columns[slot]._data = _data[slot].data();
+         _batch._columns[slot]._offsets = _offsets[slot].data();
+         _batch._columns[slot]._validity = _validity[slot].data();
+      }
+   }
+   ColumnBatch(const ColumnBatch&) = delete;
+   ColumnBatch(ColumnBatch&&) = delete;
+   ColumnBatch& operator =(const ColumnBatch&) = delete;
+   ColumnBatch& operator =(ColumnBatch&&) = delete;
+   ~ColumnBatch() = default;
+
+   inline const RecordBatch& Batch() const noexcept { return _batch; }
+
+private:
+   std::vector<std::string> _data;
+   std::vector<std::vector<uint32_t>> _offsets;
+   std::vector<std::vector<uint64_t>> _validity;
+   RecordBatch _batch;
+};
+}
+
+// latency of a single evaluation, every evaluation is timed on its own, so the percentiles include the clock overhead of some nanoseconds
+static void BM_EvaluateLatency(benchmark::State& state)
+{
+   VariableSchema schema;
+   ExpressionEvaluator evaluator;
+   CompiledExpression compiled_expression;
+   evaluator.Compile(Workload::MakeRules(1)[0], schema, compiled_expression);
+   Workload::Transactions transactions;
+   transactions.Generate(schema, TransactionsNumber);
+   const auto& records = transactions.Records();
+
+   // the loop runs exactly max_iterations times, so the latencies are stored without allocations while it runs
+   std::vector<double> latencies(static_cast<size_t>(state.max_iterations));
+   size_t record_index = 0;
+   size_t latency_index = 0;
+   for (auto _ : state)
+   {
+      bool result = false;
+      const auto start = std::chrono::steady_clock::now();
+      benchmark::DoNotOptimize(evaluator.Evaluate(compiled_expression, records[record_index], result));
+      const auto end = std::chrono::steady_clock::now();
+      benchmark::DoNotOptimize(result);
+      latencies[latency_index++] = std::chrono::duration<double, std::nano>(end - start).count();
+      record_index = (record_index + 1) % records.size();
+   }
+   latencies.resize(latency_index);
+
+   std::sort(latencies.begin(), latencies.end());
+   state.counters["p50_ns"] = Percentile(latencies, 50);
+   state.counters["p99_ns"] = Percentile(latencies, 99);
+}
+BENCHMARK(BM_EvaluateLatency);
+
+// a routing rule evaluated against every transaction row by row, the items are transactions
+static void BM_EvaluateRows(benchmark::State& state)
+{
+   VariableSchema schema;
+   ExpressionEvaluator evaluator;
+   CompiledExpression compiled_expression;
+   evaluator.Compile(Workload::MakeRules(1)[0], schema, compiled_expression);
+   Workload::Transactions transactions;
+   transactions.Generate(schema, TransactionsNumber);
+   EvaluateRecords(state, compiled_expression, transactions.Records());
+}
+BENCHMARK(BM_EvaluateRows);
+
+// the same rule evaluated against all transactions stored by columns at once, the items are transactions
+static void BM_EvaluateBatch(benchmark::State& state)
+{
+   VariableSchema schema;
+   ExpressionEvaluator evaluator;
+   CompiledExpression compiled_expression;
+   evaluator.Compile(Workload::MakeRules(1)[0], schema, compiled_expression);
+   Workload::Transactions transactions;
+   transactions.Generate(schema, TransactionsNumber);
+   const ColumnBatch columns(transactions.Records(), schema.Size());
+
+   SelectionMask selection;
+   SelectionMask failures;
+   PerfCounters counters;
+   counters.Start();
+   for (auto _ : state)
+   {
+      benchmark::DoNotOptimize(evaluator.EvaluateBatch(compiled_expression, columns.Batch(), selection, failures));
+      benchmark::DoNotOptimize(selection.data());
+   }
+   counters.Stop();
+   state.SetItemsProcessed(state.iterations() * TransactionsNumber);
+   counters.Report(state, state.iterations() * TransactionsNumber);
+   state.counters["vectorized"] = compiled_expression.IsVectorized();
+}
+BENCHMARK(BM_EvaluateBatch);
+
+// all rules of a rule set evaluated against every transaction, the items are transactions
+static void BM_RuleSetEvaluate(benchmark::State& state)
+{
+   RuleSet rule_set;
+   size_t rule_index = 0;
+   for (const auto& rule : Workload::MakeRules(static_cast<size_t>(state.range(0))))
+      rule_set.AddRule(rule, rule_index);
+   Workload::Transactions transactions;
+   transactions.Generate(rule_set.Schema(), TransactionsNumber);
+
+   RuleSetContext context;
+   PerfCounters counters;
+   counters.Start();
+   for (auto _ : state)
+   {
+      for (const auto& record : transactions.Records())
+         benchmark::DoNotOptimize(rule_set.Evaluate(record, context));
+   }
+   counters.Stop();
+   state.SetItemsProcessed(state.iterations() * transactions.Records().size());
+   counters.Report(state, state.iterations() * transactions.Records().size());
+}
+BENCHMARK(BM_RuleSetEvaluate)->Arg(100)->Arg(1000)->Arg(10000)->Unit(benchmark::kMillisecond);
+
+// the same rules, only the rules consistent with the index are evaluated
+static void BM_RuleSetFindAllMatches(benchmark::State& state)
+{
+   RuleSet rule_set;
+   size_t rule_index = 0;
+   for (const auto& rule : Workload::MakeRules(static_cast<size_t>(state.range(0))))
+      rule_set.AddRule(rule, rule_index);
+   Workload::Transactions transactions;
+   transactions.Generate(rule_set.Schema(), TransactionsNumber);
+
+   RuleSetContext context;
+   PerfCounters counters;
+   counters.Start();
+   for (auto _ : state)
+   {
+      for (const auto& record : transactions.Records())
+         benchmark::DoNotOptimize(rule_set.FindAllMatches(record, context));
+   }
+   counters.Stop();
+   state.SetItemsProcessed(state.iterations() * transactions.Records().size());
+   counters.Report(state, state.iterations() * transactions.Records().size());
+}
+BENCHMARK(BM_RuleSetFindAllMatches)->Arg(100)->Arg(1000)->Arg(10000)->Unit(benchmark::kMillisecond);
+
+// membership in an array of the given size, half of the values are in the array
+static void BM_ArrayMembership(benchmark::State& state)
+{
+   const size_t items_number = static_cast<size_t>(state.range(0));
+   std::string expression = "IN.PAN_PREFIX == [";
+   for (size_t i = 0; i < items_number; i++)
+      expression += (i == 0 ? "\"" : ", \"") + std::to_string(400000 + 2 * i) + "\"";
+   expression += "]";
+
+   VariableSchema schema;
+   ExpressionEvaluator evaluator;
+   CompiledExpression compiled_expression;
+   evaluator.Compile(expression, schema, compiled_expression);
+
+   std::vector<std::string> values(TransactionsNumber);
+   std::vector<VariableRecord> records(TransactionsNumber, VariableRecord(schema.Size()));
+   for (size_t i = 0; i < values.size(); i++)
+   {
+      values[i] = std::to_string(400000 + i % (2 * items_number));
+      records[i][0] = values[i];
+   }
+   EvaluateRecords(state, compiled_expression, records);
+}
+BENCHMARK(BM_ArrayMembership)->RangeMultiplier(4)->Range(1, 4096);
+
+// many substrings of the same variable
+static void BM_SubstrHeavy(benchmark::State& state)
+{
+   const char* const expression = "SUBSTR{IN.VAR6,0,3} == \"___\" && SUBSTR{IN.VAR6,3,1} == [\"S\", \"A\", \"N\"] && "
+                                  "(SUBSTR{IN.VAR6,4,4} == \"OMET\" || SUBSTR{IN.VAR6,4,4} == \"NYTH\" || SUBSTR{IN.VAR6,5,3} != \"THI\") && "
+                                  "SUBSTR{IN.VAR6,IN.VAR2,2} != \"__\" && SUBSTR{IN.VAR6,12,5} == [\"_0042\", \"_0043\"] && SUBSTR{IN.VAR4,0,1} != \"X\"";
+   VariableSchema schema;
+   ExpressionEvaluator evaluator;
+   CompiledExpression compiled_expression;
+   evaluator.Compile(expression, schema, compiled_expression);
+   Workload::Transactions transactions;
+   transactions.Generate(schema, TransactionsNumber);
+   EvaluateRecords(state, compiled_expression, transactions.Records());
+}
+BENCHMARK(BM_SubstrHeavy);
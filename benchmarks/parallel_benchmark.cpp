@@ -0,0 +1,68 @@
+#include <thread>
+#include <benchmark/benchmark.h>
+#include "../expression_evaluator.h"
+
+using namespace Renaissance;
+
+namespace
+{
+const char* const BenchmarkExpression = "((IN.CURRENCY != \"985\") && (IN.BIN_ISSUEING_COUNTRY == \"616\") && (IN.MT==1) && (SUBSTR{IN.TID,3,1} == [\"9\", \"2\", \"L\", \"V\", \"U\"]))";
+const size_t RecordsNumber = 1000000;
+
+// values of the records, views of the records point into them
+struct BenchmarkData
+{
+   VariableSchema _schema;
+   CompiledExpression _compiled_expression;
+   std::vector<std::vector<std::string>> _values;
+   std::vector<VariableRecord> _records;
+
+   BenchmarkData()
+   {
+      ExpressionEvaluator evaluator;
+      evaluator.Compile(BenchmarkExpression, _schema, _compiled_expression);
+
+      const std::vector<std::string> currencies = {"985", "978", "840"};
+      const std::vector<std::string> tids = {"abc9", "abcd", "abcL", "abcU"};
+      _values.resize(RecordsNumber);
+      _records.resize(RecordsNumber);
+      for (size_t i = 0; i < RecordsNumber; i++)
+      {
+         _values[i] = {currencies[i % currencies.size()], i % 5 == 0 ? "616" : "276", i % 2 == 0 ? "1" : "2", tids[i % tids.size()]};
+         _records[i].resize(_schema.Size());
+         const char* names[] = {"IN.CURRENCY", "IN.BIN_ISSUEING_COUNTRY", "IN.MT", "IN.TID"};
+         for (size_t j = 0; j < _values[i].size(); j++)
+         {
+            uint32_t slot = 0;
+            if (_schema.FindVariable(names[j], slot))
+               _records[i][slot] = _values[i][j];
+         }
+      }
+   }
+};
+
+const BenchmarkData& GetBenchmarkData()
+{
+   static const BenchmarkData data;
+   return data;
+}
+}
+
+// evaluation of a million records by 1 to N threads sharing the same evaluator and compiled expression
+static void BM_EvaluateParallel(benchmark::State& state)
+{
+   const BenchmarkData& data = GetBenchmarkData();
+   ExpressionEvaluator evaluator;
+   ThreadPool pool(static_cast<size_t>(state.range(0)));
+   SelectionMask selection;
+   SelectionMask failures;
+   for (auto _ : state)
+   {
+      evaluator.EvaluateParallel(data._compiled_expression, data._records, pool, selection, failures);
+      benchmark::DoNotOptimize(selection.data());
+   }
+   state.SetItemsProcessed(state.iterations() * data._records.size());
+}
+BENCHMARK(BM_EvaluateParallel)->DenseRange(1, std::max(1u, std::thread::hardware_concurrency()))->UseRealTime()->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
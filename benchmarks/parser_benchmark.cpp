@@ -0,0 +1,84 @@
+#include <memory_resource>
+#include <benchmark/benchmark.h>
+#include "../expression_parser.h"
+#include "workload.h"
+
+using namespace Renaissance;
+
+namespace
+{
+size_t TotalSize(const std::vector<std::string>& rules)
+{
+   size_t size = 0;
+   for (const auto& rule : rules)
+      size += rule.size();
+   return size;
+}
+}
+
+// bytes per second is the parsing throughput
+static void BM_Parse(benchmark::State& state)
+{
+   const auto rules = Workload::MakeRules(static_cast<size_t>(state.range(0)));
+   ExpressionParser parser;
+   ExpressionTree tree;
+   for (auto _ : state)
+   {
+      for (const auto& rule : rules)
+         benchmark::DoNotOptimize(parser.Parse(rule, tree));
+   }
+   state.SetBytesProcessed(state.iterations() * TotalSize(rules));
+   state.SetItemsProcessed(state.iterations() * rules.size());
+}
+BENCHMARK(BM_Parse)->Arg(10000);
+
+static void BM_ParseInPlace(benchmark::State& state)
+{
+   const auto rules = Workload::MakeRules(static_cast<size_t>(state.range(0)));
+   ExpressionParser parser;
+   ExpressionTree tree;
+   for (auto _ : state)
+   {
+      for (const auto& rule : rules)
+         benchmark::DoNotOptimize(parser.ParseInPlace(rule, tree));
+   }
+   state.SetBytesProcessed(state.iterations() * TotalSize(rules));
+   state.SetItemsProcessed(state.iterations() * rules.size());
+}
+BENCHMARK(BM_ParseInPlace)->Arg(10000);
+
+static void BM_ParseMany(benchmark::State& state)
+{
+   const auto rules = Workload::MakeRules(static_cast<size_t>(state.range(0)));
+   const std::vector<StringView> views(rules.cbegin(), rules.cend());
+   ExpressionParser parser;
+   std::vector<ExpressionTree> trees;
+   std::vector<size_t> failed_indexes;
+   std::shared_ptr<const std::string> source;
+   for (auto _ : state)
+      benchmark::DoNotOptimize(parser.ParseMany(views, trees, failed_indexes, source));
+   state.SetBytesProcessed(state.iterations() * TotalSize(rules));
+   state.SetItemsProcessed(state.iterations() * rules.size());
+}
+BENCHMARK(BM_ParseMany)->Arg(10000);
+
+// nodes of all trees are allocated from one arena, its memory is released at once when the rule set is rebuilt
+static void BM_ParseManyArena(benchmark::State& state)
+{
+   const auto rules = Workload::MakeRules(static_cast<size_t>(state.range(0)));
+   const std::vector<StringView> views(rules.cbegin(), rules.cend());
+   std::pmr::monotonic_buffer_resource arena;
+   ExpressionParser parser(&arena);
+   std::vector<ExpressionTree> trees;
+   std::vector<size_t> failed_indexes;
+   std::shared_ptr<const std::string> source;
+   for (auto _ : state)
+   {
+      benchmark::DoNotOptimize(parser.ParseMany(views, trees, failed_indexes, source));
+      trees.clear();
+      arena.release();
+   }
+   state.SetBytesProcessed(state.iterations() * TotalSize(rules));
+   state.SetItemsProcessed(state.iterations() * rules.size());
+}
+BENCHMARK(BM_ParseManyArena)->Arg(10000);
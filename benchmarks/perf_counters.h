@@ -0,0 +1,100 @@
+#pragma once
+#include <cstdint>
+#include <benchmark/benchmark.h>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// Hardware counters of the calling thread read by perf_event_open, they are optional:
+// without the permission (e.g. in a container or if kernel.perf_event_paranoid is too strict) nothing is reported.
+namespace Renaissance
+{
+class PerfCounters
+{
+public:
+   PerfCounters()
+   {
+#ifdef __linux__
+      _cycles_fd = Open(PERF_COUNT_HW_CPU_CYCLES);
+      _cache_misses_fd = Open(PERF_COUNT_HW_CACHE_MISSES);
+#endif
+   }
+   PerfCounters(const PerfCounters&) = delete;
+   PerfCounters(PerfCounters&&) = delete;
+   PerfCounters& operator =(const PerfCounters&) = delete;
+   PerfCounters& operator =(PerfCounters&&) = delete;
+   ~PerfCounters()
+   {
+#ifdef __linux__
+      if (_cycles_fd >= 0)
+         close(_cycles_fd);
+      if (_cache_misses_fd >= 0)
+         close(_cache_misses_fd);
+#endif
+   }
+
+   inline bool IsAvailable() const noexcept { return _cycles_fd >= 0 && _cache_misses_fd >= 0; }
+
+   void Start()
+   {
+#ifdef __linux__
+      if (!IsAvailable())
+         return;
+      for (const int fd : {_cycles_fd, _cache_misses_fd})
+      {
+         ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+         ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+      }
+#endif
+   }
+
+   void Stop()
+   {
+#ifdef __linux__
+      if (!IsAvailable())
+         return;
+      ioctl(_cycles_fd, PERF_EVENT_IOC_DISABLE, 0);
+      ioctl(_cache_misses_fd, PERF_EVENT_IOC_DISABLE, 0);
+      if (read(_cycles_fd, &_cycles, sizeof(_cycles)) != sizeof(_cycles) ||
+          read(_cache_misses_fd, &_cache_misses, sizeof(_cache_misses)) != sizeof(_cache_misses))
+      {
+         _cycles = 0;
+         _cache_misses = 0;
+      }
+#endif
+   }
+
+   // add cycles and cache misses per item counted between Start and Stop to the benchmark counters
+   void Report(benchmark::State& state, const size_t items_number) const
+   {
+      if (!IsAvailable() || items_number == 0)
+         return;
+      state.counters["cycles/item"] = static_cast<double>(_cycles) / items_number;
+      state.counters["cache_misses/item"] = static_cast<double>(_cache_misses) / items_number;
+   }
+
+private:
+   int _cycles_fd = -1;
+   int _cache_misses_fd = -1;
+   uint64_t _cycles = 0;
+   uint64_t _cache_misses = 0;
+
+#ifdef __linux__
+   // returns a descriptor of the disabled counter or -1
+   static int Open(const uint64_t config)
+   {
+      perf_event_attr attributes{};
+      attributes.type = PERF_TYPE_HARDWARE;
+      attributes.size = sizeof(attributes);
+      attributes.config = config;
+      attributes.disabled = 1;
+      attributes.exclude_kernel = 1;
+      attributes.exclude_hv = 1;
+      return static_cast<int>(syscall(SYS_perf_event_open, &attributes, 0, -1, -1, 0));
+   }
+#endif
+};
+}
@@ -0,0 +1,95 @@
+#include <benchmark/benchmark.h>
+#include "../expression_evaluator.h"
+#include "../static_expression.h"
+
+using namespace Renaissance;
+
+namespace
+{
+#define BENCHMARK_EXPRESSION "((IN.CURRENCY != \"985\") && (IN.BIN_ISSUEING_COUNTRY == \"616\") && (IN.MT==1) && (SUBSTR{IN.TID,3,1} == [\"9\", \"2\", \"L\", \"V\", \"U\"]))"
+RENAISSANCE_STATIC_EXPRESSION(BenchmarkRule, BENCHMARK_EXPRESSION);
+
+// records in the order of the static expression variables: IN.CURRENCY, IN.BIN_ISSUEING_COUNTRY, IN.MT, IN.TID
+std::vector<VariableRecord> MakeRecords()
+{
+   static const char* const currencies[] = {"985", "978", "840"};
+   static const char* const tids[] = {"abc9", "abcd", "abcL", "abcU"};
+   std::vector<VariableRecord> records(1024, VariableRecord(4));
+   for (size_t i = 0; i < records.size(); i++)
+   {
+      records[i][0] = currencies[i % 3];
+      records[i][1] = (i % 5 == 0 ? "616" : "276");
+      records[i][2] = (i % 2 == 0 ? "1" : "2");
+      records[i][3] = tids[i % 4];
+   }
+   return records;
+}
+
+// the same rule written by hand
+inline bool EvaluateByHand(const VariableRecord& record, bool& result)
+{
+   for (const auto& value : record)
+   {
+      if (value.data() == nullptr)
+         return false;
+   }
+   const StringView tid = Substring(record[3], 3, 1);
+   result = record[0] != "985" && record[1] == "616" && record[2] == "1" &&
+            (tid == "9" || tid == "2" || tid == "L" || tid == "V" || tid == "U");
+   return true;
+}
+}
+
+static void BM_HandWritten(benchmark::State& state)
+{
+   const auto records = MakeRecords();
+   for (auto _ : state)
+   {
+      for (const auto& record : records)
+      {
+         bool result = false;
+         benchmark::DoNotOptimize(EvaluateByHand(record, result));
+         benchmark::DoNotOptimize(result);
+      }
+   }
+   state.SetItemsProcessed(state.iterations() * records.size());
+}
+BENCHMARK(BM_HandWritten);
+
+static void BM_StaticExpression(benchmark::State& state)
+{
+   const auto records = MakeRecords();
+   for (auto _ : state)
+   {
+      for (const auto& record : records)
+      {
+         bool result = false;
+         benchmark::DoNotOptimize(EvaluateStatic<BenchmarkRule>(record, result));
+         benchmark::DoNotOptimize(result);
+      }
+   }
+   state.SetItemsProcessed(state.iterations() * records.size());
+}
+BENCHMARK(BM_StaticExpression);
+
+static void BM_CompiledExpression(benchmark::State& state)
+{
+   const auto records = MakeRecords();
+   VariableSchema schema;
+   for (size_t slot = 0; slot < BenchmarkRule.VariablesNumber(); slot++)
+      schema.AddVariable(std::string(BenchmarkRule.VariableName(slot)));
+   ExpressionEvaluator evaluator;
+   CompiledExpression compiled_expression;
+   evaluator.Compile(BENCHMARK_EXPRESSION, schema, compiled_expression);
+   for (auto _ : state)
+   {
+      for (const auto& record : records)
+      {
+         bool result = false;
+         benchmark::DoNotOptimize(evaluator.Evaluate(compiled_expression, record, result));
+         benchmark::DoNotOptimize(result);
+      }
+   }
+   state.SetItemsProcessed(state.iterations() * records.size());
+}
+BENCHMARK(BM_CompiledExpression);
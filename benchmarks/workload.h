@@ -0,0 +1,84 @@
+#pragma once
+#include <random>
+#include <string>
+#include <vector>
+#include "../common.h"
+#include "../variable_schema.h"
+
+// Synthetic payment routing workload for the benchmarks, rules and transactions are modelled on BigExpressionTest1:
+// (IN.VAR1 == 6011 && IN.VAR2 == [1,2,4,5] && IN.VAR3 != ["abc","def","ghi"] && (IN.VAR4 != "EG" || IN.VAR5 != "Y" && SUBSTR{IN.VAR6,3,9} == "SOMETHING"))
+// Values are drawn from small domains by a seeded generator, so runs are repeatable and some of the rules match every transaction.
+namespace Renaissance
+{
+namespace Workload
+{
+const std::vector<std::string> MerchantCategories = {"6011", "5411", "5812", "4111", "7011", "5999", "4829", "5732"};
+const std::vector<std::string> Codes = {"abc", "def", "ghi", "jkl", "mno", "pqr", "stu", "vwx"};
+const std::vector<std::string> Countries = {"EG", "PL", "DE", "US", "GB", "FR"};
+const std::vector<std::string> Words = {"SOMETHING", "ANYTHING1", "NOTHING12", "EVERYTHIN"};
+
+template <typename Generator>
+const std::string& Pick(const std::vector<std::string>& values, Generator& generator)
+{
+   return values[std::uniform_int_distribution<size_t>(0, values.size() - 1)(generator)];
+}
+
+// 'rules_number' rules over the variables IN.VAR1 - IN.VAR6
+inline std::vector<std::string> MakeRules(const size_t rules_number, const uint32_t seed = 1)
+{
+   std::mt19937 generator(seed);
+   std::uniform_int_distribution<int> digits(1, 9);
+   std::vector<std::string> rules(rules_number);
+   for (auto& rule : rules)
+   {
+      rule = "(IN.VAR1 == " + Pick(MerchantCategories, generator) + " && IN.VAR2 == [";
+      for (int i = 0; i < 4; i++)
+         rule += (i == 0 ? "" : ",") + std::to_string(digits(generator));
+      rule += "] && IN.VAR3 != [";
+      for (int i = 0; i < 3; i++)
+         rule += (i == 0 ? "\"" : ",\"") + Pick(Codes, generator) + "\"";
+      rule += "] && (IN.VAR4 != \"" + Pick(Countries, generator) + "\" || IN.VAR5 != \"Y\" && SUBSTR{IN.VAR6,3,9} == \"" + Pick(Words, generator) + "\"))";
+   }
+   return rules;
+}
+
+// transactions as records bound to slots of a schema, the records point into the values, so transactions can't be copied
+class Transactions
+{
+public:
+   Transactions() = default;
+   Transactions(const Transactions&) = delete;
+   Transactions(Transactions&&) = delete;
+   Transactions& operator =(const Transactions&) = delete;
+   Transactions& operator =(Transactions&&) = delete;
+   ~Transactions() = default;
+
+   // generate 'transactions_number' transactions with the variables IN.VAR1 - IN.VAR6, variables missing in the schema are skipped
+   void Generate(const VariableSchema& schema, const size_t transactions_number, const uint32_t seed = 2)
+   {
+      static const char* const names[] = {"IN.VAR1", "IN.VAR2", "IN.VAR3", "IN.VAR4", "IN.VAR5", "IN.VAR6"};
+      std::mt19937 generator(seed);
+      std::uniform_int_distribution<int> digits(1, 9);
+      _values.resize(transactions_number);
+      _records.assign(transactions_number, VariableRecord(schema.Size()));
+      for (size_t i = 0; i < transactions_number; i++)
+      {
+         _values[i] = {Pick(MerchantCategories, generator), std::to_string(digits(generator)), Pick(Codes, generator),
+                       Pick(Countries, generator), (digits(generator) % 2 == 0 ? "Y" : "N"), "___" + Pick(Words, generator) + "_0042"};
+         for (size_t j = 0; j < _values[i].size(); j++)
+         {
+            uint32_t slot = 0;
+            if (schema.FindVariable(names[j], slot))
+               _records[i][slot] = _values[i][j];
+         }
+      }
+   }
+
+   inline const std::vector<VariableRecord>& Records() const noexcept { return _records; }
+
+private:
+   std::vector<std::vector<std::string>> _values;
+   std::vector<VariableRecord> _records;
+};
+}
+}
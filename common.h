@@ -1,11 +1,18 @@
 #pragma once
 #include <memory>
+#include <memory_resource>
+#include <new>
 #include <string>
 #include <stack>
+#include <type_traits>
 #include <unordered_map>
+#include <vector>
+#include <boost/utility/string_view.hpp>
 
 namespace Renaissance
 {
+typedef boost::string_view StringView;
+
 enum class TokenType
 {
    Func                 = 0,  // e.g. SUBSTR{1, 3, VAR}
@@ -13,7 +20,8 @@ enum class TokenType
    LBracket             = 2,  // (
    RBracket             = 3,  // )
    Variable             = 4,  // e.g. IN.MT
-   Scalar               = 5,  // e.g. 8 or "something"
+   Scalar               = 5,  // e.g. "something"
+   Number               = 6,  // e.g. 8 or -12.50, it's compared as a number with numbers and as a string with strings
    LSquareBracket       = 7,  // [
    RSquareBracket       = 8,  // ]
    LBrace               = 9,  // {
@@ -27,19 +35,26 @@ enum class TokenType
    OperatorLessOrEqual  = 16, // <=
    OperatorMore         = 17, // >
    OperatorMoreOrEqual  = 18, // >=
+   OperatorPrefix       = 19, // PREFIX, e.g. IN.PAN PREFIX ["4000", "5100"]
+   OperatorInRanges     = 20, // IN RANGES, e.g. IN.BIN IN RANGES [400000, 499999, 510000, 559999] with inclusive bounds of every range
+   // boolean constants are never read by the parser, they are results of constant folding
+   True                 = 21,
+   False                = 22,
    OperatorFirst        = OperatorLogicalOr,
-   OperatorLast         = OperatorMoreOrEqual
+   OperatorLast         = OperatorInRanges
 };
 
 struct Token
 {
    TokenType _type;
-   std::string::const_iterator _begin;
-   std::string::const_iterator _end;
+   const char* _begin = nullptr;
+   const char* _end = nullptr;
 
    Token() = default;
    explicit Token(const TokenType& type) : _type(type) {}
    inline bool IsOperator() const noexcept { return _type >= TokenType::OperatorFirst && _type <= TokenType::OperatorLast; }
+   inline bool IsLiteral() const noexcept { return _type == TokenType::Scalar || _type == TokenType::Number; }
+   inline StringView Text() const { return StringView(_begin, _end - _begin); }
    std::string ToString() const
    {
       switch (_type)
@@ -51,6 +66,7 @@ struct Token
       case TokenType::RBracket:
          return ")";
       case TokenType::Scalar:
+      case TokenType::Number:
       case TokenType::Variable:
       case TokenType::Func:
          return std::string(_begin, _end);
@@ -78,22 +94,45 @@ struct Token
          return ">";
       case TokenType::OperatorMoreOrEqual:
          return ">=";
+      case TokenType::OperatorPrefix:
+         return "prefix";
+      case TokenType::OperatorInRanges:
+         return "in_ranges";
+      case TokenType::True:
+         return "true";
+      case TokenType::False:
+         return "false";
       default:
          return "";
       }
    }
 };
 
+// links of the nodes don't own them, the nodes are owned by the memory resource of the tree (see MakeExpressionNode)
 struct ExpressionNode
 {
    Token _token;
-   std::shared_ptr<ExpressionNode> _child;
-   std::shared_ptr<ExpressionNode> _sibling;
+   ExpressionNode* _child = nullptr;
+   ExpressionNode* _sibling = nullptr;
    ExpressionNode() = default;
    explicit ExpressionNode(const Token& token) : _token(token) {}
+   ExpressionNode(const ExpressionNode&) = default;
+   ExpressionNode& operator =(const ExpressionNode&) = default;
+   ~ExpressionNode() = default;
 };
 
-typedef std::stack<std::shared_ptr<ExpressionNode>> ExpressionTree;
+// nodes are allocated from the memory resource, e.g. an arena of a rule set, so nodes of a tree sit contiguously
+// and the memory of the whole tree is released at once without destroying the nodes one by one, the resource must outlive the nodes
+inline ExpressionNode* MakeExpressionNode(const Token& token, std::pmr::memory_resource* resource)
+{
+   static_assert(std::is_trivially_destructible<ExpressionNode>::value, "nodes are released with their memory resource");
+   return new (resource->allocate(sizeof(ExpressionNode), alignof(ExpressionNode))) ExpressionNode(token);
+}
+
+typedef std::stack<ExpressionNode*> ExpressionTree;
 typedef std::unordered_map<std::string, std::string> VariableValues;
+
+// variable values indexed by slots of a VariableSchema, a value without data (default constructed view) means the variable is missing
+typedef std::vector<StringView> VariableRecord;
 }
 
@@ -0,0 +1,40 @@
+#pragma once
+#include <memory>
+#include <string>
+#include "batch_program.h"
+#include "common.h"
+#include "expression_program.h"
+
+namespace Renaissance
+{
+// This is an immutable result of ExpressionEvaluator::Compile.
+// It owns the expression text the syntax tree tokens point into, so it doesn't depend on the evaluator which compiled it
+// and might be evaluated any number of times without parsing. Copies share the same immutable data.
+// Besides of the syntax tree it holds the program compiled from the tree, which is what gets executed on evaluation,
+// and the batch program which evaluates the expression over a batch of records stored by columns.
+class CompiledExpression
+{
+public:
+   CompiledExpression() = default;
+   CompiledExpression(const CompiledExpression&) = default;
+   CompiledExpression(CompiledExpression&&) = default;
+   CompiledExpression& operator =(const CompiledExpression&) = default;
+   CompiledExpression& operator =(CompiledExpression&&) = default;
+   ~CompiledExpression() = default;
+
+   // true if the handle holds a successfully compiled expression
+   inline bool IsCompiled() const noexcept { return static_cast<bool>(_source); }
+   // true if the compiled expression has no syntax tree (e.g. "" or "()"), such expression is evaluated as true
+   inline bool IsEmpty() const noexcept { return !_root; }
+   // true if the expression is evaluated over batches by column kernels rather than row by row
+   inline bool IsVectorized() const noexcept { return _batch_program && _batch_program->IsVectorized(); }
+
+private:
+   friend class ExpressionEvaluator;
+
+   std::shared_ptr<const std::string> _source;
+   std::shared_ptr<ExpressionNode> _root; // it also owns the arena the tree nodes are allocated from
+   std::shared_ptr<const ExpressionProgram> _program;
+   std::shared_ptr<const BatchProgram> _batch_program;
+};
+}
@@ -0,0 +1,335 @@
+#include "expression_cache.h"
+#include <algorithm>
+#include <cctype>
+#include <functional>
+#include <limits>
+
+namespace Renaissance
+{
+namespace
+{
+enum class CharClass
+{
+   Word,     // part of a variable, function name or number
+   Operator, // part of an operator
+   Boundary, // always a single char token or an end of a string literal
+   LBrace,   // function arguments start, it's a part of the function token, so whitespace before it matters
+   Other
+};
+
+CharClass GetCharClass(const char ch)
+{
+   if (std::isalnum(static_cast<unsigned char>(ch)) || ch == '.' || ch == '_')
+      return CharClass::Word;
+
+   switch (ch)
+   {
+      case '<':
+      case '>':
+      case '=':
+      case '!':
+      case '&':
+      case '|':
+         return CharClass::Operator;
+      case '(':
+      case ')':
+      case '[':
+      case ']':
+      case '}':
+      case ',':
+      case '\"':
+         return CharClass::Boundary;
+      case '{':
+         return CharClass::LBrace;
+      default:
+         return CharClass::Other;
+   }
+}
+
+// whitespace between two chars is needed only if they might be read as a single token without it
+bool IsWhitespaceNeeded(const char left, const char right)
+{
+   const CharClass left_class = GetCharClass(left);
+   const CharClass right_class = GetCharClass(right);
+   if (left_class == CharClass::Boundary || left_class == CharClass::LBrace || right_class == CharClass::Boundary)
+      return false;
+   if ((left_class == CharClass::Word && right_class == CharClass::Operator) || (left_class == CharClass::Operator && right_class == CharClass::Word))
+      return false;
+   return true;
+}
+
+// precedence of the operator starting at the position, it's the same as in the parser, 0 if there is no operator
+int GetOperatorPrecedence(const std::string& text, const size_t position, size_t& length)
+{
+   const char ch = text[position];
+   const char next = (position + 1 < text.size() ? text[position + 1] : '\0');
+   TokenType type;
+   length = 2;
+   if (ch == '|' && next == '|')
+      type = TokenType::OperatorLogicalOr;
+   else if (ch == '&' && next == '&')
+      type = TokenType::OperatorLogicalAnd;
+   else if (ch == '=' && next == '=')
+      type = TokenType::OperatorEqual;
+   else if (ch == '!' && next == '=')
+      type = TokenType::OperatorNotEqual;
+   else if (ch == '<' && next == '=')
+      type = TokenType::OperatorLessOrEqual;
+   else if (ch == '>' && next == '=')
+      type = TokenType::OperatorMoreOrEqual;
+   else if (ch == '<' || ch == '>')
+   {
+      type = (ch == '<' ? TokenType::OperatorLess : TokenType::OperatorMore);
+      length = 1;
+   }
+   else
+      return 0;
+   return static_cast<int>(type);
+}
+
+// remove whitespace which doesn't separate tokens, whitespace in string literals is kept
+void RemoveWhitespace(const std::string& expression, std::string& text)
+{
+   text.clear();
+   text.reserve(expression.size());
+   bool in_string = false;
+   bool pending_space = false;
+   for (const char ch : expression)
+   {
+      if (in_string)
+      {
+         text.push_back(ch);
+         in_string = (ch != '\"');
+         continue;
+      }
+
+      if (std::isspace(static_cast<unsigned char>(ch)))
+      {
+         pending_space = !text.empty();
+         continue;
+      }
+
+      if (pending_space && IsWhitespaceNeeded(text.back(), ch))
+         text.push_back(' ');
+      pending_space = false;
+      text.push_back(ch);
+      in_string = (ch == '\"');
+   }
+}
+
+// remove parentheses which don't change the order the parser applies operators in
+// a pair is removed if every operator directly inside it binds tighter than operators around it,
+// pairs next to function arguments or array items are kept
+void RemoveRedundantParentheses(std::string& text)
+{
+   const size_t no_parent = std::numeric_limits<size_t>::max();
+   const int no_operator = std::numeric_limits<int>::max();
+
+   struct Pair
+   {
+      size_t _open;
+      size_t _close;
+      size_t _parent;      // index of the enclosing pair
+      int _lowest_operator; // precedence of the lowest operator directly inside the pair
+   };
+
+   // match the parentheses, the inner pairs go first
+   std::vector<Pair> pairs;
+   std::vector<size_t> opened;        // indexes of pairs which are not closed yet
+   std::vector<int> opened_operators; // the lowest operators directly inside them
+   bool in_string = false;
+   for (size_t i = 0; i < text.size(); i++)
+   {
+      const char ch = text[i];
+      size_t length = 0;
+      if (in_string || ch == '\"')
+         in_string = (in_string ? ch != '\"' : true);
+      else if (ch == '(')
+      {
+         opened.push_back(i);
+         opened_operators.push_back(no_operator);
+      }
+      else if (ch == ')')
+      {
+         // unbalanced parentheses are left as is, the parser will reject them
+         if (opened.empty())
+            return;
+         pairs.push_back(Pair{opened.back(), i, no_parent, opened_operators.back()});
+         opened.pop_back();
+         opened_operators.pop_back();
+      }
+      else if (const int precedence = GetOperatorPrecedence(text, i, length))
+      {
+         if (!opened_operators.empty())
+            opened_operators.back() = std::min(opened_operators.back(), precedence);
+         i += length - 1;
+      }
+   }
+   if (!opened.empty() || in_string)
+      return;
+
+   // a pair encloses the next pairs which are inside it and have no parent yet
+   for (size_t i = 0; i < pairs.size(); i++)
+   {
+      for (size_t j = i; j-- > 0 && pairs[j]._open > pairs[i]._open;)
+      {
+         if (pairs[j]._parent == no_parent)
+            pairs[j]._parent = i;
+      }
+   }
+
+   std::vector<bool> removed(text.size(), false);
+   for (Pair& pair : pairs)
+   {
+      // keep empty pairs and pairs of nothing but other pairs
+      if (text.find_first_not_of("()", pair._open) >= pair._close)
+         continue;
+
+      // the nearest chars around the pair which are not removed
+      size_t left = pair._open;
+      while (left > 0 && removed[left - 1])
+         left--;
+      size_t right = pair._close + 1;
+      while (right < text.size() && removed[right])
+         right++;
+
+      bool is_redundant = true;
+      if (left > 0)
+      {
+         const char ch = text[left - 1];
+         if (GetCharClass(ch) == CharClass::Operator)
+         {
+            // the operator before the pair is one or two chars long
+            size_t length = 0;
+            int precedence = (left >= 2 ? GetOperatorPrecedence(text, left - 2, length) : 0);
+            if (precedence == 0 || length != 2)
+               precedence = GetOperatorPrecedence(text, left - 1, length);
+            is_redundant = (precedence != 0 && pair._lowest_operator > precedence);
+         }
+         else
+            is_redundant = (ch == '(');
+      }
+      if (is_redundant && right < text.size())
+      {
+         const char ch = text[right];
+         size_t length = 0;
+         if (GetCharClass(ch) == CharClass::Operator)
+         {
+            const int precedence = GetOperatorPrecedence(text, right, length);
+            is_redundant = (precedence != 0 && pair._lowest_operator >= precedence);
+         }
+         else
+            is_redundant = (ch == ')');
+      }
+
+      if (is_redundant)
+      {
+         removed[pair._open] = true;
+         removed[pair._close] = true;
+         // operators of the removed pair are directly inside the enclosing one now
+         if (pair._parent != no_parent)
+            pairs[pair._parent]._lowest_operator = std::min(pairs[pair._parent]._lowest_operator, pair._lowest_operator);
+      }
+   }
+
+   size_t length = 0;
+   for (size_t i = 0; i < text.size(); i++)
+   {
+      if (!removed[i])
+         text[length++] = text[i];
+   }
+   text.resize(length);
+}
+}
+
+ExpressionCache::ExpressionCache(const size_t capacity, const size_t shards_number)
+   : _capacity(capacity), _hits(0), _misses(0), _evictions(0)
+{
+   const size_t shards = (shards_number == 0 ? 1 : shards_number);
+   _shard_capacity = (capacity + shards - 1) / shards;
+   for (size_t i = 0; i < shards; i++)
+      _shards.emplace_back(new Shard());
+}
+
+// find the compiled expression by the key made by MakeKey, the entry becomes the most recently used one
+// returns true if found
+bool ExpressionCache::Find(const std::string& key, CompiledExpression& compiled_expression)
+{
+   Shard& shard = GetShard(key);
+   {
+      std::lock_guard<std::mutex> lock(shard._mutex);
+      const auto it = shard._entries.find(key);
+      if (it != shard._entries.end())
+      {
+         shard._lru.splice(shard._lru.begin(), shard._lru, it->second._position);
+         compiled_expression = it->second._compiled_expression;
+         _hits++;
+         return true;
+      }
+   }
+   _misses++;
+   return false;
+}
+
+// add the compiled expression, the least recently used entry of the shard is evicted if the shard is full
+void ExpressionCache::Insert(const std::string& key, const CompiledExpression& compiled_expression)
+{
+   if (_shard_capacity == 0)
+      return;
+
+   Shard& shard = GetShard(key);
+   std::lock_guard<std::mutex> lock(shard._mutex);
+   const auto result = shard._entries.emplace(key, Entry());
+   Entry& entry = result.first->second;
+   entry._compiled_expression = compiled_expression;
+   if (!result.second)
+   {
+      // another thread has added it meanwhile
+      shard._lru.splice(shard._lru.begin(), shard._lru, entry._position);
+      return;
+   }
+
+   shard._lru.push_front(&result.first->first);
+   entry._position = shard._lru.begin();
+   if (shard._entries.size() > _shard_capacity)
+   {
+      const std::string* evicted = shard._lru.back();
+      shard._lru.pop_back();
+      shard._entries.erase(*evicted);
+      _evictions++;
+   }
+}
+
+void ExpressionCache::Clear()
+{
+   for (auto& shard : _shards)
+   {
+      std::lock_guard<std::mutex> lock(shard->_mutex);
+      shard->_lru.clear();
+      shard->_entries.clear();
+   }
+}
+
+size_t ExpressionCache::Size() const
+{
+   size_t size = 0;
+   for (auto& shard : _shards)
+   {
+      std::lock_guard<std::mutex> lock(shard->_mutex);
+      size += shard->_entries.size();
+   }
+   return size;
+}
+
+// make the cache key of the expression, expressions which differ only by whitespace between tokens or redundant parentheses get the same key
+void ExpressionCache::MakeKey(const std::string& expression, std::string& key)
+{
+   RemoveWhitespace(expression, key);
+   RemoveRedundantParentheses(key);
+}
+
+ExpressionCache::Shard& ExpressionCache::GetShard(const std::string& key) const
+{
+   return *_shards[std::hash<std::string>()(key) % _shards.size()];
+}
+}
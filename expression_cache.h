@@ -0,0 +1,66 @@
+#pragma once
+#include <atomic>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "common.h"
+#include "compiled_expression.h"
+
+// This is a bounded cache of compiled expressions for evaluation of raw expression text, so repeated expressions are not parsed again.
+// Expressions are keyed by their canonical text: whitespace which doesn't separate tokens and redundant parentheses are removed,
+// e.g. '((IN.MT == 1) && (IN.CURRENCY != "985"))' and 'IN.MT==1 && IN.CURRENCY!="985"' share the same entry.
+// The cache is split into shards with their own locks and least recently used lists, so it might be used by many threads at once.
+namespace Renaissance
+{
+class ExpressionCache
+{
+public:
+   static const size_t DefaultCapacity = 1024;
+   static const size_t DefaultShardsNumber = 16;
+
+   explicit ExpressionCache(const size_t capacity = DefaultCapacity, const size_t shards_number = DefaultShardsNumber);
+   ExpressionCache(const ExpressionCache&) = delete;
+   ExpressionCache(ExpressionCache&&) = delete;
+   ExpressionCache& operator =(const ExpressionCache&) = delete;
+   ExpressionCache& operator =(ExpressionCache&&) = delete;
+   ~ExpressionCache() = default;
+
+   bool Find(const std::string& key, CompiledExpression& compiled_expression);
+   void Insert(const std::string& key, const CompiledExpression& compiled_expression);
+   void Clear();
+
+   static void MakeKey(const std::string& expression, std::string& key);
+
+   inline size_t Capacity() const noexcept { return _capacity; }
+   inline uint64_t Hits() const noexcept { return _hits; }
+   inline uint64_t Misses() const noexcept { return _misses; }
+   inline uint64_t Evictions() const noexcept { return _evictions; }
+   size_t Size() const;
+
+private:
+   struct Entry
+   {
+      CompiledExpression _compiled_expression;
+      std::list<const std::string*>::iterator _position;
+   };
+
+   struct Shard
+   {
+      std::mutex _mutex;
+      std::unordered_map<std::string, Entry> _entries;
+      std::list<const std::string*> _lru; // keys of the entries, the most recently used one is the first
+   };
+
+   size_t _capacity;
+   size_t _shard_capacity;
+   std::vector<std::unique_ptr<Shard>> _shards;
+   std::atomic<uint64_t> _hits;
+   std::atomic<uint64_t> _misses;
+   std::atomic<uint64_t> _evictions;
+
+   Shard& GetShard(const std::string& key) const;
+};
+}
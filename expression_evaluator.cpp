@@ -1,20 +1,198 @@
 #include "expression_evaluator.h"
+#include <algorithm>
+#include <memory_resource>
+#include "string_functions.h"
 
 namespace Renaissance
 {
+   namespace
+   {
+      // the syntax tree kept by a compiled expression together with the arena its nodes are allocated from
+      struct ArenaTree
+      {
+         std::pmr::monotonic_buffer_resource _arena;
+         ExpressionNode* _root = nullptr;
+
+         explicit ArenaTree(const size_t initial_size) : _arena(initial_size) {}
+      };
+   }
+
+   // parse an expression once into the self-owning 'compiled_expression', which can be evaluated many times afterwards
+   // method returns true if successful
+   bool ExpressionEvaluator::Compile(const std::string& expression, CompiledExpression& compiled_expression) const
+   {
+      VariableSchema schema;
+      return Compile(expression, schema, compiled_expression);
+   }
+
+   // parse an expression once into the self-owning 'compiled_expression', variables are bound to slots of the 'schema'
+   // variables which are not registered in the schema yet are added to it, as numbers if they are compared with a number by <, <=, > or >=
+   // method returns true if successful
+   bool ExpressionEvaluator::Compile(const std::string& expression, VariableSchema& schema, CompiledExpression& compiled_expression) const
+   {
+      compiled_expression = CompiledExpression();
+
+      // a node takes 40 bytes, the optimized tree is allocated from the arena too, so the first arena block fits both trees with a node per 4 chars of the expression
+      auto arena_tree = std::make_shared<ArenaTree>(20 * expression.size() + 256);
+
+      // the parser keeps its state while parsing, a local one makes compilation safe to run from many threads
+      ExpressionParser parser(&arena_tree->_arena);
+      ExpressionTree expression_tree;
+      std::shared_ptr<const std::string> source;
+      if (!parser.Parse(expression, expression_tree, source))
+         return false;
+
+      if (!expression_tree.empty())
+      {
+         auto program = std::make_shared<ExpressionProgram>();
+         // variables compared with number literals are numbers unless the schema tells otherwise
+         ProgramCompiler::InferNumberVariables(expression_tree.top(), schema);
+         ProgramCompiler compiler;
+         // the original tree is compiled first to check it, so optimizations never make an invalid expression valid
+         if (!compiler.Compile(expression_tree.top(), schema, *program))
+            return false;
+
+         ExpressionOptimizer optimizer(&arena_tree->_arena);
+         const auto optimized_root = optimizer.Optimize(expression_tree.top());
+         if (!compiler.Compile(optimized_root, schema, *program))
+            return false;
+
+         auto batch_program = std::make_shared<BatchProgram>();
+         BatchCompiler batch_compiler;
+         batch_compiler.Compile(optimized_root, schema, program, *batch_program);
+
+         // the root shares the ownership of the whole arena tree
+         arena_tree->_root = expression_tree.top();
+         compiled_expression._root = std::shared_ptr<ExpressionNode>(arena_tree, arena_tree->_root);
+         compiled_expression._program = std::move(program);
+         compiled_expression._batch_program = std::move(batch_program);
+      }
+      compiled_expression._source = std::move(source);
+      return true;
+   }
+
+   // evaluate a compiled expression with variables values given in 'variable_values' parameter, no parsing is done here
+   // evaluation result will be returned in the output parameter 'result'
+   // method returns true if successful
+   bool ExpressionEvaluator::Evaluate(const CompiledExpression& compiled_expression, const VariableValues& variable_values, bool& result) const
+   {
+      result = false;
+
+      if (!compiled_expression.IsCompiled())
+         return false;
+
+      if (compiled_expression.IsEmpty()) // treat empty tree as a true statement
+      {
+         result = true;
+         return true;
+      }
+
+      return compiled_expression._program->Execute(variable_values, result);
+   }
+
+   // evaluate a compiled expression for all records of the 'batch', its columns are indexed by slots of the schema the expression was compiled with
+   // rows where the expression is true are set in 'selection', rows where it couldn't be evaluated are set in 'failures'
+   // method returns true if successful
+   bool ExpressionEvaluator::EvaluateBatch(const CompiledExpression& compiled_expression, const RecordBatch& batch, SelectionMask& selection, SelectionMask& failures) const
+   {
+      selection.clear();
+      failures.clear();
+
+      if (!compiled_expression.IsCompiled())
+         return false;
+
+      if (compiled_expression.IsEmpty()) // treat empty tree as a true statement
+      {
+         const size_t words_number = (batch._rows_number + 63) / 64;
+         selection.assign(words_number, ~uint64_t(0));
+         failures.assign(words_number, 0);
+         if (batch._rows_number % 64 != 0)
+            selection.back() = (uint64_t(1) << (batch._rows_number % 64)) - 1;
+         return true;
+      }
+
+      return compiled_expression._batch_program->Execute(batch, selection, failures);
+   }
+
+   // evaluate a compiled expression for all 'records' on threads of the 'pool', records are split into chunks of ParallelChunkSize
+   // records where the expression is true are set in 'selection', records where it couldn't be evaluated are set in 'failures'
+   // method returns true if successful
+   bool ExpressionEvaluator::EvaluateParallel(const CompiledExpression& compiled_expression, const std::vector<VariableRecord>& records, ThreadPool& pool, SelectionMask& selection, SelectionMask& failures) const
+   {
+      selection.clear();
+      failures.clear();
+
+      if (!compiled_expression.IsCompiled())
+         return false;
+
+      selection.assign((records.size() + 63) / 64, 0);
+      failures.assign(selection.size(), 0);
+      pool.Run((records.size() + ParallelChunkSize - 1) / ParallelChunkSize, [&](const size_t chunk)
+      {
+         const size_t end = std::min(records.size(), (chunk + 1) * ParallelChunkSize);
+         for (size_t i = chunk * ParallelChunkSize; i < end; i++)
+         {
+            bool result = false;
+            if (!Evaluate(compiled_expression, records[i], result))
+               failures[i / 64] |= uint64_t(1) << (i % 64);
+            else if (result)
+               selection[i / 64] |= uint64_t(1) << (i % 64);
+         }
+      });
+      return true;
+   }
+
+   // evaluate a compiled expression with variables values given in 'variable_record' by slots of the schema the expression was compiled with
+   // evaluation result will be returned in the output parameter 'result'
+   // method returns true if successful
+   bool ExpressionEvaluator::Evaluate(const CompiledExpression& compiled_expression, const VariableRecord& variable_record, bool& result) const
+   {
+      result = false;
+
+      if (!compiled_expression.IsCompiled())
+         return false;
+
+      if (compiled_expression.IsEmpty()) // treat empty tree as a true statement
+      {
+         result = true;
+         return true;
+      }
+
+      return compiled_expression._program->Execute(variable_record, result);
+   }
+
    // evaluate an expression with variables values given in 'variable_values' parameter
    // evaluation result will be returned in the output parameter 'result'
    // method returns true if successful
-   bool ExpressionEvaluator::Evaluate(const std::string& expression, const VariableValues& variable_values, bool& result)
+   bool ExpressionEvaluator::Evaluate(const std::string& expression, const VariableValues& variable_values, bool& result) const
    {
       result = false;
 
-      // parse
-      ExpressionTree expression_tree;
-      if (!_parser.Parse(expression, expression_tree))
+      // the expression is parsed only the first time, its variants which differ only by whitespace or redundant parentheses share the cache entry
+      std::string key;
+      ExpressionCache::MakeKey(expression, key);
+      CompiledExpression compiled_expression;
+      if (!_cache.Find(key, compiled_expression))
+      {
+         if (!Compile(expression, compiled_expression))
+            return false;
+         _cache.Insert(key, compiled_expression);
+      }
+
+      return Evaluate(compiled_expression, variable_values, result);
+   }
+
+   // evaluate a compiled expression by walking its syntax tree instead of executing the compiled program
+   // this is much slower than Evaluate, it's kept as the reference implementation to compare the program results with
+   // method returns true if successful
+   bool ExpressionEvaluator::EvaluateTree(const CompiledExpression& compiled_expression, const VariableValues& variable_values, bool& result) const
+   {
+      result = false;
+
+      if (!compiled_expression.IsCompiled())
          return false;
 
-      if (expression_tree.empty()) // treat empty tree as a true statement
+      if (compiled_expression.IsEmpty()) // treat empty tree as a true statement
       {
          result = true;
          return true;
@@ -22,8 +200,9 @@ namespace Renaissance
 
       // evaluate
       // create root expression value, it must have boolean type
+      const TreeContext context = {variable_values, *compiled_expression._program};
       ExpressionValue value;
-      bool res = Evaluate(variable_values, expression_tree.top(), value);
+      bool res = Evaluate(context, compiled_expression._root.get(), value);
 
       if (res && value._type == ExpressionType::Boolean)
       {
@@ -34,29 +213,35 @@ namespace Renaissance
          return false;
    }
 
-   bool ExpressionEvaluator::Evaluate(const VariableValues& variable_values, const std::shared_ptr<ExpressionNode>& expression_node, ExpressionValue& expression_value) const
+   bool ExpressionEvaluator::Evaluate(const TreeContext& context, const ExpressionNode* expression_node, ExpressionValue& expression_value) const
    {
       if (!expression_node)
          return true;
 
       switch (expression_node->_token._type)
       {
+         case TokenType::True:
+         case TokenType::False:
+            expression_value._type = ExpressionType::Boolean;
+            expression_value._bool_value = (expression_node->_token._type == TokenType::True);
+            return true;
          case TokenType::Scalar:
-            return EvaluateScalar(variable_values, expression_node, expression_value);
+         case TokenType::Number:
+            return EvaluateScalar(context, expression_node, expression_value);
          case TokenType::Variable:
-            return EvaluateVariable(variable_values, expression_node, expression_value);
+            return EvaluateVariable(context, expression_node, expression_value);
          case TokenType::Func:
-            return EvaluateFunction(variable_values, expression_node, expression_value);
+            return EvaluateFunction(context, expression_node, expression_value);
          case TokenType::LSquareBracket:
-            return EvaluateArray(variable_values, expression_node, expression_value);
+            return EvaluateArray(context, expression_node, expression_value);
          default:
             if (expression_node->_token.IsOperator())
-               return EvaluateOperator(variable_values, expression_node, expression_value);
+               return EvaluateOperator(context, expression_node, expression_value);
       }
       return false;
    }
 
-   bool ExpressionEvaluator::EvaluateScalar(const VariableValues& /*not used*/, const std::shared_ptr<ExpressionNode>& expression_node, ExpressionValue& expression_value) const
+   bool ExpressionEvaluator::EvaluateScalar(const TreeContext& /*not used*/, const ExpressionNode* expression_node, ExpressionValue& expression_value) const
    {
       std::string val = std::string(expression_node->_token._begin, expression_node->_token._end);
       expression_value._type = ExpressionType::String;
@@ -64,20 +249,35 @@ namespace Renaissance
       return true;
    }
 
-   bool ExpressionEvaluator::EvaluateVariable(const VariableValues& variable_values, const std::shared_ptr<ExpressionNode>& expression_node, ExpressionValue& expression_value) const
+   bool ExpressionEvaluator::EvaluateVariable(const TreeContext& context, const ExpressionNode* expression_node, ExpressionValue& expression_value) const
    {
       std::string val = std::string(expression_node->_token._begin, expression_node->_token._end);
-      auto variable_value = variable_values.find(val);
-      if (variable_value != variable_values.end())
+      auto variable_value = context._variable_values.find(val);
+      if (variable_value == context._variable_values.end())
+         return false; // variable is mentioned in the expression but no corresponding value is passed
+
+      if (context._program.IsNumberVariable(val))
       {
-         expression_value._type = ExpressionType::String;
-         expression_value._string_value = variable_value->second;
-         return true;
+         expression_value._type = ExpressionType::Number;
+         return ParseNumber(variable_value->second, expression_value._number_value); // variable value might be not a number
       }
-      return false; // variable is mentioned in the expression but no corresponding value is passed
+
+      expression_value._type = ExpressionType::String;
+      expression_value._string_value = variable_value->second;
+      return true;
+   }
+
+   // evaluate an operand of a comparison of numbers, it's a number literal or a variable tagged as a number
+   bool ExpressionEvaluator::EvaluateNumber(const TreeContext& context, const ExpressionNode* expression_node, ExpressionValue& expression_value) const
+   {
+      if (expression_node->_token._type == TokenType::Variable)
+         return EvaluateVariable(context, expression_node, expression_value) && expression_value._type == ExpressionType::Number;
+
+      expression_value._type = ExpressionType::Number;
+      return ParseNumber(expression_node->_token.Text(), expression_value._number_value);
    }
 
-   bool ExpressionEvaluator::EvaluateFunction(const VariableValues& variable_values, const std::shared_ptr<ExpressionNode>& expression_node, ExpressionValue& expression_value) const
+   bool ExpressionEvaluator::EvaluateFunction(const TreeContext& context, const ExpressionNode* expression_node, ExpressionValue& expression_value) const
    {
       // assuming here that the only supported function is substring and it has 3 arguments
       if (!expression_node->_child || !expression_node->_child->_sibling || !expression_node->_child->_sibling->_sibling)
@@ -85,38 +285,41 @@ namespace Renaissance
 
       // retrieve and evaluate 3 function arguments
       ExpressionValue arg1;
-      if (!Evaluate(variable_values, expression_node->_child, arg1) || arg1._type != ExpressionType::String)
+      if (!Evaluate(context, expression_node->_child, arg1) || arg1._type != ExpressionType::String)
          return false;
 
       ExpressionValue arg2;
-      if (!Evaluate(variable_values, expression_node->_child->_sibling, arg2) || arg2._type != ExpressionType::String)
+      if (!Evaluate(context, expression_node->_child->_sibling, arg2) || arg2._type != ExpressionType::String)
          return false;
 
       ExpressionValue arg3;
-      if (!Evaluate(variable_values, expression_node->_child->_sibling->_sibling, arg3) || arg3._type != ExpressionType::String)
+      if (!Evaluate(context, expression_node->_child->_sibling->_sibling, arg3) || arg3._type != ExpressionType::String)
          return false;
 
+      int from = 0;
+      int length = 0;
+      const NumberParsing from_parsing = ParseInt(arg2._string_value, from);
+      const NumberParsing length_parsing = ParseInt(arg3._string_value, length);
+      if (from_parsing == NumberParsing::Invalid || length_parsing == NumberParsing::Invalid)
+         return false; // function argument is not a number
+
       // evaluate function
       expression_value._type = ExpressionType::String;
-      try
-      {
-         expression_value._string_value = arg1._string_value.substr(std::stoi(arg2._string_value), std::stoi(arg3._string_value));
-      }
-      catch (const std::out_of_range&)
-      {
+      if (from_parsing == NumberParsing::OutOfRange || length_parsing == NumberParsing::OutOfRange)
          expression_value._string_value.clear();
-      }
+      else
+         expression_value._string_value = Substring(arg1._string_value, static_cast<size_t>(from), static_cast<size_t>(length)).to_string();
       return true;
    }
 
-   bool ExpressionEvaluator::EvaluateArray(const VariableValues& variable_values, const std::shared_ptr<ExpressionNode>& expression_node, ExpressionValue& expression_value) const
+   bool ExpressionEvaluator::EvaluateArray(const TreeContext& context, const ExpressionNode* expression_node, ExpressionValue& expression_value) const
    {
       if (!expression_node || !expression_node->_child) // at least one array item should exist in the syntax tree
          return false;
 
       // evaluate first array item
       ExpressionValue first_array_item;
-      if (!Evaluate(variable_values, expression_node->_child, first_array_item))
+      if (!Evaluate(context, expression_node->_child, first_array_item))
          return false;
 
       expression_value._type = ExpressionType::StringArray;
@@ -126,7 +329,7 @@ namespace Renaissance
       while (node)
       {
          ExpressionValue next_array_item;
-         if (!Evaluate(variable_values, node, next_array_item) || next_array_item._type != first_array_item._type)
+         if (!Evaluate(context, node, next_array_item) || next_array_item._type != first_array_item._type)
             return false;
          expression_value._array_value.push_back(std::move(next_array_item._string_value));
          node = node->_sibling;
@@ -134,19 +337,47 @@ namespace Renaissance
       return true;
    }
 
-   bool ExpressionEvaluator::EvaluateOperator(const VariableValues& variable_values, const std::shared_ptr<ExpressionNode>& expression_node, ExpressionValue& expression_value) const
+   bool ExpressionEvaluator::EvaluateOperator(const TreeContext& context, const ExpressionNode* expression_node, ExpressionValue& expression_value) const
    {
       // two operator arguments must exist
       if (!expression_node->_child || !expression_node->_child->_sibling)
          return false;
 
+      const auto& node1 = expression_node->_child;
+      const auto& node2 = expression_node->_child->_sibling;
+
+      // logical operators don't evaluate the second argument if the first one decides the result
+      if (expression_node->_token._type == TokenType::OperatorLogicalOr || expression_node->_token._type == TokenType::OperatorLogicalAnd)
+      {
+         ExpressionValue arg1;
+         if (!Evaluate(context, node1, arg1))
+            return false;
+         return EvaluateLogicalOperator(context, expression_node, arg1, expression_value);
+      }
+
+      if (expression_node->_token._type == TokenType::OperatorPrefix || expression_node->_token._type == TokenType::OperatorInRanges)
+         return EvaluateTableTest(context, expression_node, expression_value);
+
+      // numbers are compared with arrays of number literals as numbers
+      if (node2->_token._type == TokenType::LSquareBracket && IsNumber(context, node1))
+      {
+         bool is_number_array = static_cast<bool>(node2->_child);
+         for (auto item = node2->_child; item; item = item->_sibling)
+            is_number_array = is_number_array && item->_token._type == TokenType::Number;
+         if (is_number_array)
+            return EvaluateNumberArrayComparison(context, expression_node, expression_value);
+      }
+
+      // a number literal is compared as a number only if the other operand is a number too
+      const bool is_number = IsNumber(context, node1) && IsNumber(context, node2);
+
       // retrieve and evaluate 2 operator arguments
       ExpressionValue arg1;
-      if (!Evaluate(variable_values, expression_node->_child, arg1))
+      if (!(is_number ? EvaluateNumber(context, node1, arg1) : Evaluate(context, node1, arg1)))
          return false;
 
       ExpressionValue arg2;
-      if (!Evaluate(variable_values, expression_node->_child->_sibling, arg2))
+      if (!(is_number ? EvaluateNumber(context, node2, arg2) : Evaluate(context, node2, arg2)))
          return false;
 
       // argument types must be the same or there is comparison with array
@@ -157,45 +388,167 @@ namespace Renaissance
 
       switch (expression_node->_token._type)
       {
-         case TokenType::OperatorLogicalOr:
-            expression_value._bool_value = (arg1._bool_value || arg2._bool_value);
-            break;
-         case TokenType::OperatorLogicalAnd:
-            expression_value._bool_value = (arg1._bool_value && arg2._bool_value);
-            break;
          case TokenType::OperatorEqual:
             if (arg2._type == ExpressionType::StringArray)
                expression_value._bool_value = (std::find(arg2._array_value.cbegin(), arg2._array_value.cend(), arg1._string_value) != arg2._array_value.cend());
             else if (arg1._type == ExpressionType::Boolean)
                expression_value._bool_value = (arg1._bool_value == arg2._bool_value);
+            else if (arg1._type == ExpressionType::Number)
+               expression_value._bool_value = (arg1._number_value == arg2._number_value);
             else
                expression_value._bool_value = (arg1._string_value == arg2._string_value);
-            break;
+            return true;
          case TokenType::OperatorNotEqual:
             if (arg2._type == ExpressionType::StringArray)
                expression_value._bool_value = (std::find(arg2._array_value.cbegin(), arg2._array_value.cend(), arg1._string_value) == arg2._array_value.cend());
             else if (arg1._type == ExpressionType::Boolean)
                expression_value._bool_value = (arg1._bool_value != arg2._bool_value);
+            else if (arg1._type == ExpressionType::Number)
+               expression_value._bool_value = (arg1._number_value != arg2._number_value);
             else
                expression_value._bool_value = (arg1._string_value != arg2._string_value);
+            return true;
+         default:
             break;
+      }
+
+      // relational operators are defined for numbers and booleans
+      if (arg1._type == ExpressionType::Number)
+      {
+         switch (expression_node->_token._type)
+         {
+            case TokenType::OperatorLess:
+               expression_value._bool_value = (arg1._number_value < arg2._number_value);
+               return true;
+            case TokenType::OperatorLessOrEqual:
+               expression_value._bool_value = (arg1._number_value <= arg2._number_value);
+               return true;
+            case TokenType::OperatorMore:
+               expression_value._bool_value = (arg1._number_value > arg2._number_value);
+               return true;
+            case TokenType::OperatorMoreOrEqual:
+               expression_value._bool_value = (arg1._number_value >= arg2._number_value);
+               return true;
+            default:
+               return false;
+         }
+      }
+
+      if (arg1._type != ExpressionType::Boolean)
+         return false;
+
+      switch (expression_node->_token._type)
+      {
          case TokenType::OperatorLess:
             expression_value._bool_value = (arg1._bool_value < arg2._bool_value);
-            break;
+            return true;
          case TokenType::OperatorLessOrEqual:
             expression_value._bool_value = (arg1._bool_value <= arg2._bool_value);
-            break;
+            return true;
          case TokenType::OperatorMore:
             expression_value._bool_value = (arg1._bool_value > arg2._bool_value);
-            break;
+            return true;
          case TokenType::OperatorMoreOrEqual:
             expression_value._bool_value = (arg1._bool_value >= arg2._bool_value);
-            break;
+            return true;
          default:
             return false;
       }
+   }
+
+   bool ExpressionEvaluator::EvaluateNumberArrayComparison(const TreeContext& context, const ExpressionNode* expression_node, ExpressionValue& expression_value) const
+   {
+      const bool is_equal = (expression_node->_token._type == TokenType::OperatorEqual);
+      if (!is_equal && expression_node->_token._type != TokenType::OperatorNotEqual)
+         return false;
+
+      ExpressionValue value;
+      if (!EvaluateNumber(context, expression_node->_child, value))
+         return false;
 
+      bool found = false;
+      for (auto item = expression_node->_child->_sibling->_child; item; item = item->_sibling)
+      {
+         ExpressionValue item_value;
+         if (!EvaluateNumber(context, item, item_value))
+            return false;
+         found = found || (item_value._number_value == value._number_value);
+      }
+
+      expression_value._type = ExpressionType::Boolean;
+      expression_value._bool_value = (found == is_equal);
       return true;
    }
-}
 
+   // prefixes and ranges are tested one by one here, the compiled program looks them up in the sorted sets
+   bool ExpressionEvaluator::EvaluateTableTest(const TreeContext& context, const ExpressionNode* expression_node, ExpressionValue& expression_value) const
+   {
+      const auto& array_node = expression_node->_child->_sibling;
+      if (array_node->_token._type != TokenType::LSquareBracket)
+         return false;
+
+      ExpressionValue value;
+      if (!Evaluate(context, expression_node->_child, value))
+         return false;
+
+      bool found = false;
+      if (expression_node->_token._type == TokenType::OperatorPrefix)
+      {
+         if (value._type != ExpressionType::String)
+            return false;
+         for (auto item = array_node->_child; item; item = item->_sibling)
+            found = found || StringView(value._string_value).starts_with(item->_token.Text());
+      }
+      else
+      {
+         // strings are parsed as numbers, e.g. substrings of card numbers
+         if (value._type == ExpressionType::String && !ParseNumber(value._string_value, value._number_value))
+            return false;
+         if (value._type != ExpressionType::String && value._type != ExpressionType::Number)
+            return false;
+
+         for (auto item = array_node->_child; item; item = item->_sibling->_sibling)
+         {
+            int64_t from = 0;
+            int64_t to = 0;
+            if (!item->_sibling || !ParseNumber(item->_token.Text(), from) || !ParseNumber(item->_sibling->_token.Text(), to))
+               return false;
+            found = found || (from <= value._number_value && value._number_value <= to);
+         }
+      }
+
+      expression_value._type = ExpressionType::Boolean;
+      expression_value._bool_value = found;
+      return true;
+   }
+
+   bool ExpressionEvaluator::EvaluateLogicalOperator(const TreeContext& context, const ExpressionNode* expression_node, const ExpressionValue& arg1, ExpressionValue& expression_value) const
+   {
+      if (arg1._type != ExpressionType::Boolean)
+         return false;
+
+      expression_value._type = ExpressionType::Boolean;
+
+      // the first argument decides the result: false for 'and', true for 'or'
+      const bool is_and = (expression_node->_token._type == TokenType::OperatorLogicalAnd);
+      if (arg1._bool_value != is_and)
+      {
+         expression_value._bool_value = arg1._bool_value;
+         return true;
+      }
+
+      ExpressionValue arg2;
+      if (!Evaluate(context, expression_node->_child->_sibling, arg2) || arg2._type != ExpressionType::Boolean)
+         return false;
+
+      expression_value._bool_value = arg2._bool_value;
+      return true;
+   }
+
+   // returns true if the node is a number literal or a variable the program uses as a number
+   bool ExpressionEvaluator::IsNumber(const TreeContext& context, const ExpressionNode* expression_node)
+   {
+      return expression_node->_token._type == TokenType::Number ||
+             (expression_node->_token._type == TokenType::Variable && context._program.IsNumberVariable(expression_node->_token.ToString()));
+   }
+}
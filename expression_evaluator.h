@@ -1,27 +1,49 @@
 #pragma once
+#include "batch_program.h"
 #include "common.h"
+#include "compiled_expression.h"
+#include "expression_cache.h"
+#include "expression_optimizer.h"
 #include "expression_parser.h"
+#include "expression_program.h"
+#include "thread_pool.h"
+#include "variable_schema.h"
 
 namespace Renaissance
 {
+// The evaluator has no mutable state but the internally synchronized cache of expressions evaluated by their text,
+// so a single instance and expressions compiled by it might be shared between threads.
+// Only a VariableSchema passed to Compile is modified, so compilation with the same schema must not run simultaneously.
 class ExpressionEvaluator
 {
 public:
    ExpressionEvaluator() = default;
+   explicit ExpressionEvaluator(const size_t cache_capacity) : _cache(cache_capacity) {}
    ExpressionEvaluator(const ExpressionEvaluator&) = delete;
    ExpressionEvaluator(ExpressionEvaluator&&) = delete;
    ExpressionEvaluator& operator =(const ExpressionEvaluator&) = delete;
    ExpressionEvaluator& operator =(ExpressionEvaluator&&) = delete;
    ~ExpressionEvaluator() = default;
 
-   bool Evaluate(const std::string& expression, const VariableValues& variable_values, bool& result);
+   bool Compile(const std::string& expression, CompiledExpression& compiled_expression) const;
+   bool Compile(const std::string& expression, VariableSchema& schema, CompiledExpression& compiled_expression) const;
+   bool Evaluate(const CompiledExpression& compiled_expression, const VariableValues& variable_values, bool& result) const;
+   bool Evaluate(const CompiledExpression& compiled_expression, const VariableRecord& variable_record, bool& result) const;
+   bool Evaluate(const std::string& expression, const VariableValues& variable_values, bool& result) const;
+   bool EvaluateBatch(const CompiledExpression& compiled_expression, const RecordBatch& batch, SelectionMask& selection, SelectionMask& failures) const;
+   bool EvaluateParallel(const CompiledExpression& compiled_expression, const std::vector<VariableRecord>& records, ThreadPool& pool, SelectionMask& selection, SelectionMask& failures) const;
+   bool EvaluateTree(const CompiledExpression& compiled_expression, const VariableValues& variable_values, bool& result) const;
+
+   // cache of expressions compiled by Evaluate with the expression text
+   inline const ExpressionCache& Cache() const noexcept { return _cache; }
 
 private:
    enum class ExpressionType
    {
       Boolean,
       String,
-      StringArray
+      StringArray,
+      Number
    };
 
    struct ExpressionValue
@@ -30,16 +52,32 @@ private:
       bool _bool_value;
       std::string _string_value;
       std::vector<std::string> _array_value;
+      int64_t _number_value;
    };
 
-   ExpressionParser _parser;
+   // what the syntax tree is evaluated with, the program tells which variables are numbers
+   struct TreeContext
+   {
+      const VariableValues& _variable_values;
+      const ExpressionProgram& _program;
+   };
+
+   mutable ExpressionCache _cache;
+
+   // records evaluated by a single task of EvaluateParallel, it's a multiple of 64, so tasks never share words of the masks
+   static const size_t ParallelChunkSize = 1024;
 
-   bool Evaluate(const VariableValues& variable_values, const std::shared_ptr<ExpressionNode>& expression_node, ExpressionValue& expression_value) const;
-   bool EvaluateScalar(const VariableValues& variable_values, const std::shared_ptr<ExpressionNode>& expression_node, ExpressionValue& expression_value) const;
-   bool EvaluateVariable(const VariableValues& variable_values, const std::shared_ptr<ExpressionNode>& expression_node, ExpressionValue& expression_value) const;
-   bool EvaluateFunction(const VariableValues& variable_values, const std::shared_ptr<ExpressionNode>& expression_node, ExpressionValue& expression_value) const;
-   bool EvaluateArray(const VariableValues& variable_values, const std::shared_ptr<ExpressionNode>& expression_node, ExpressionValue& expression_value) const;
-   bool EvaluateOperator(const VariableValues& variable_values, const std::shared_ptr<ExpressionNode>& expression_node, ExpressionValue& expression_value) const;
+   bool Evaluate(const TreeContext& context, const ExpressionNode* expression_node, ExpressionValue& expression_value) const;
+   bool EvaluateScalar(const TreeContext& context, const ExpressionNode* expression_node, ExpressionValue& expression_value) const;
+   bool EvaluateVariable(const TreeContext& context, const ExpressionNode* expression_node, ExpressionValue& expression_value) const;
+   bool EvaluateNumber(const TreeContext& context, const ExpressionNode* expression_node, ExpressionValue& expression_value) const;
+   bool EvaluateFunction(const TreeContext& context, const ExpressionNode* expression_node, ExpressionValue& expression_value) const;
+   bool EvaluateArray(const TreeContext& context, const ExpressionNode* expression_node, ExpressionValue& expression_value) const;
+   bool EvaluateOperator(const TreeContext& context, const ExpressionNode* expression_node, ExpressionValue& expression_value) const;
+   bool EvaluateNumberArrayComparison(const TreeContext& context, const ExpressionNode* expression_node, ExpressionValue& expression_value) const;
+   bool EvaluateTableTest(const TreeContext& context, const ExpressionNode* expression_node, ExpressionValue& expression_value) const;
+   bool EvaluateLogicalOperator(const TreeContext& context, const ExpressionNode* expression_node, const ExpressionValue& arg1, ExpressionValue& expression_value) const;
+   static bool IsNumber(const TreeContext& context, const ExpressionNode* expression_node);
 };
 }
 
@@ -0,0 +1,394 @@
+#include "expression_optimizer.h"
+#include <algorithm>
+#include "string_functions.h"
+
+namespace Renaissance
+{
+// build an optimized copy of the syntax tree with the specified root, the original tree is not changed
+// tokens of the optimized tree point into the same expression text as the original ones
+ExpressionNode* ExpressionOptimizer::Optimize(const ExpressionNode* root) const
+{
+   if (!root)
+      return nullptr;
+   return OptimizeNode(root);
+}
+
+// returns true if both subtrees have the same structure and tokens, so they are evaluated to the same value
+bool ExpressionOptimizer::IsEqual(const ExpressionNode* node1, const ExpressionNode* node2)
+{
+   if (node1->_token._type != node2->_token._type)
+      return false;
+
+   switch (node1->_token._type)
+   {
+      case TokenType::Scalar:
+      case TokenType::Number:
+      case TokenType::Variable:
+      case TokenType::Func:
+         if (node1->_token.Text() != node2->_token.Text())
+            return false;
+         break;
+      default:
+         break;
+   }
+
+   auto child1 = node1->_child;
+   auto child2 = node2->_child;
+   for (; child1 && child2; child1 = child1->_sibling, child2 = child2->_sibling)
+   {
+      if (!IsEqual(child1, child2))
+         return false;
+   }
+   return !child1 && !child2;
+}
+
+// text of the subtree which is the same for all equal subtrees (see IsEqual) and differs for all others,
+// string literals are quoted, number literals are not, e.g. (and (== IN.MT 1) (!= SUBSTR{IN.TID 3 1} ["9" "2"]))
+std::string ExpressionOptimizer::CanonicalForm(const ExpressionNode* node)
+{
+   std::string form;
+   switch (node->_token._type)
+   {
+      case TokenType::Scalar:
+         form += '"';
+         for (const char ch : node->_token.Text())
+         {
+            if (ch == '"' || ch == '\\')
+               form += '\\';
+            form += ch;
+         }
+         return form + '"';
+      case TokenType::Number:
+      case TokenType::Variable:
+         return node->_token.ToString();
+      case TokenType::Func:
+         form = node->_token.ToString() + "{";
+         break;
+      case TokenType::LSquareBracket:
+         form = "[";
+         break;
+      default:
+         form = "(" + node->_token.ToString() + " ";
+         break;
+   }
+
+   for (auto child = node->_child; child; child = child->_sibling)
+      form += CanonicalForm(child) + (child->_sibling ? " " : "");
+
+   switch (node->_token._type)
+   {
+      case TokenType::Func:
+         return form + "}";
+      case TokenType::LSquareBracket:
+         return form + "]";
+      default:
+         return node->_child ? form + ")" : node->_token.ToString();
+   }
+}
+
+ExpressionNode* ExpressionOptimizer::OptimizeNode(const ExpressionNode* node) const
+{
+   switch (node->_token._type)
+   {
+      case TokenType::Func:
+         return OptimizeFunction(node);
+      case TokenType::OperatorLogicalOr:
+      case TokenType::OperatorLogicalAnd:
+         return OptimizeLogicalOperator(node);
+      case TokenType::OperatorEqual:
+      case TokenType::OperatorNotEqual:
+         return OptimizeComparison(node);
+      case TokenType::OperatorLess:
+      case TokenType::OperatorLessOrEqual:
+      case TokenType::OperatorMore:
+      case TokenType::OperatorMoreOrEqual:
+         return OptimizeRelation(node);
+      default:
+         return Clone(node);
+   }
+}
+
+ExpressionNode* ExpressionOptimizer::OptimizeFunction(const ExpressionNode* node) const
+{
+   std::vector<ExpressionNode*> arguments;
+   for (const auto& child : Children(node))
+      arguments.push_back(OptimizeNode(child));
+
+   // substring of a literal with literal position and length is a string literal,
+   // its token points into the part of the source literal
+   if (node->_token.Text() == "SUBSTR" && arguments.size() == 3 &&
+       std::all_of(arguments.cbegin(), arguments.cend(), [](const ExpressionNode* argument) { return argument->_token.IsLiteral(); }))
+   {
+      int from = 0;
+      int length = 0;
+      const NumberParsing from_parsing = ParseInt(arguments[1]->_token.Text(), from);
+      const NumberParsing length_parsing = ParseInt(arguments[2]->_token.Text(), length);
+      if (from_parsing != NumberParsing::Invalid && length_parsing != NumberParsing::Invalid)
+      {
+         Token token = arguments[0]->_token;
+         const StringView source = token.Text();
+         StringView substring = Substring(source, static_cast<size_t>(from), static_cast<size_t>(length));
+         if (from_parsing == NumberParsing::OutOfRange || length_parsing == NumberParsing::OutOfRange)
+            substring = StringView(source.data(), 0);
+
+         token._type = TokenType::Scalar;
+         token._begin += substring.data() - source.data();
+         token._end = token._begin + substring.size();
+         return MakeNode(token, {});
+      }
+   }
+
+   return MakeNode(node->_token, arguments);
+}
+
+ExpressionNode* ExpressionOptimizer::OptimizeComparison(const ExpressionNode* node) const
+{
+   const auto children = Children(node);
+   if (children.size() != 2)
+      return Clone(node);
+
+   auto arg1 = OptimizeNode(children[0]);
+   auto arg2 = OptimizeNode(children[1]);
+   const bool is_equal = (node->_token._type == TokenType::OperatorEqual);
+
+   // comparison with a single item array is a plain comparison
+   if (arg2->_token._type == TokenType::LSquareBracket && IsScalarArray(arg2) && !arg2->_child->_sibling)
+      arg2 = Clone(arg2->_child);
+
+   // literals are compared as numbers only if all of them are numbers, numbers which can't be represented are left to the compiler to fail
+   if (arg1->_token.IsLiteral() && (arg2->_token.IsLiteral() || (arg2->_token._type == TokenType::LSquareBracket && IsScalarArray(arg2))))
+   {
+      const auto items = (arg2->_token.IsLiteral() ? std::vector<const ExpressionNode*>{arg2} : Children(arg2));
+      const bool is_number = (arg1->_token._type == TokenType::Number) &&
+                             std::all_of(items.cbegin(), items.cend(), [](const ExpressionNode* item) { return item->_token._type == TokenType::Number; });
+      int64_t number = 0;
+      if (is_number && !ParseNumber(arg1->_token.Text(), number))
+         return MakeNode(node->_token, {arg1, arg2});
+
+      bool found = false;
+      for (const auto& item : items)
+      {
+         int64_t item_number = 0;
+         if (is_number && !ParseNumber(item->_token.Text(), item_number))
+            return MakeNode(node->_token, {arg1, arg2});
+         found = found || (is_number ? item_number == number : item->_token.Text() == arg1->_token.Text());
+      }
+      return MakeBoolean(found == is_equal);
+   }
+
+   if (IsBoolean(arg1) && IsBoolean(arg2))
+      return MakeBoolean((arg1->_token._type == arg2->_token._type) == is_equal);
+
+   return MakeNode(node->_token, {arg1, arg2});
+}
+
+ExpressionNode* ExpressionOptimizer::OptimizeRelation(const ExpressionNode* node) const
+{
+   const auto children = Children(node);
+   if (children.size() != 2)
+      return Clone(node);
+
+   auto arg1 = OptimizeNode(children[0]);
+   auto arg2 = OptimizeNode(children[1]);
+
+   if (IsBoolean(arg1) && IsBoolean(arg2))
+   {
+      const bool value1 = (arg1->_token._type == TokenType::True);
+      const bool value2 = (arg2->_token._type == TokenType::True);
+      switch (node->_token._type)
+      {
+         case TokenType::OperatorLess:
+            return MakeBoolean(value1 < value2);
+         case TokenType::OperatorLessOrEqual:
+            return MakeBoolean(value1 <= value2);
+         case TokenType::OperatorMore:
+            return MakeBoolean(value1 > value2);
+         default:
+            return MakeBoolean(value1 >= value2);
+      }
+   }
+
+   int64_t number1 = 0;
+   int64_t number2 = 0;
+   if (arg1->_token._type == TokenType::Number && arg2->_token._type == TokenType::Number &&
+       ParseNumber(arg1->_token.Text(), number1) && ParseNumber(arg2->_token.Text(), number2))
+   {
+      switch (node->_token._type)
+      {
+         case TokenType::OperatorLess:
+            return MakeBoolean(number1 < number2);
+         case TokenType::OperatorLessOrEqual:
+            return MakeBoolean(number1 <= number2);
+         case TokenType::OperatorMore:
+            return MakeBoolean(number1 > number2);
+         default:
+            return MakeBoolean(number1 >= number2);
+      }
+   }
+
+   return MakeNode(node->_token, {arg1, arg2});
+}
+
+ExpressionNode* ExpressionOptimizer::OptimizeLogicalOperator(const ExpressionNode* node) const
+{
+   const TokenType operator_type = node->_token._type;
+   const bool is_and = (operator_type == TokenType::OperatorLogicalAnd);
+
+   // the whole chain of the same operators is processed at once, as they are evaluated from left to right until the result is known
+   std::vector<const ExpressionNode*> source_operands;
+   CollectOperands(node, operator_type, source_operands);
+
+   std::vector<ExpressionNode*> optimized_operands;
+   for (const auto& operand : source_operands)
+      CollectOperands(OptimizeNode(operand), operator_type, optimized_operands);
+
+   // 'true' doesn't change the result of 'and', 'false' doesn't change the result of 'or',
+   // the opposite constant decides the result, so the following operands are never evaluated
+   const TokenType neutral = (is_and ? TokenType::True : TokenType::False);
+   const TokenType decisive = (is_and ? TokenType::False : TokenType::True);
+
+   std::vector<ExpressionNode*> operands;
+   for (const auto& operand : optimized_operands)
+   {
+      if (operand->_token._type == neutral)
+         continue;
+
+      // a repeated operand is evaluated to the same value as the first one, which didn't decide the result
+      if (std::any_of(operands.cbegin(), operands.cend(), [&operand](const ExpressionNode* previous) { return IsEqual(previous, operand); }))
+         continue;
+
+      operands.push_back(operand);
+      if (operand->_token._type == decisive)
+         break;
+   }
+
+   if (operands.empty())
+      return MakeBoolean(is_and);
+   if (operands.front()->_token._type == decisive)
+      return MakeBoolean(!is_and);
+
+   MergeSetTests(is_and ? TokenType::OperatorNotEqual : TokenType::OperatorEqual, operands);
+
+   // rebuild the chain as the parser does, from left to right
+   auto chain = operands.front();
+   for (size_t i = 1; i < operands.size(); i++)
+      chain = MakeNode(node->_token, {chain, operands[i]});
+   return chain;
+}
+
+// collect operands of the chain of the same logical operators, e.g. a, b, c from 'a && (b && c)'
+// the operands are collected from the original tree and from the optimized one, only nodes of the optimized tree might be linked again
+template <typename Node>
+void ExpressionOptimizer::CollectOperands(Node* node, const TokenType operator_type, std::vector<Node*>& operands)
+{
+   if (node->_token._type != operator_type)
+   {
+      operands.push_back(node);
+      return;
+   }
+
+   for (Node* child = node->_child; child; child = child->_sibling)
+      CollectOperands(child, operator_type, operands);
+}
+
+// merge adjacent comparisons of the same value with literals into a single array comparison,
+// e.g. 'A != x && A != [y, z]' gives 'A != [x, y, z]', 'A == x || A == y' gives 'A == [x, y]'
+void ExpressionOptimizer::MergeSetTests(const TokenType comparison_type, std::vector<ExpressionNode*>& operands) const
+{
+   std::vector<ExpressionNode*> merged_operands;
+   for (size_t i = 0; i < operands.size(); )
+   {
+      size_t last = i + 1;
+      if (IsSetTest(operands[i], comparison_type))
+      {
+         while (last < operands.size() && IsSetTest(operands[last], comparison_type) && IsEqual(operands[i]->_child, operands[last]->_child))
+            ++last;
+      }
+
+      if (last == i + 1)
+      {
+         merged_operands.push_back(operands[i]);
+         ++i;
+         continue;
+      }
+
+      // build the array of all literals, skipping duplicates
+      const auto first = operands[i];
+      Token array_token(TokenType::LSquareBracket);
+      std::vector<ExpressionNode*> items;
+      for (; i < last; i++)
+      {
+         const auto& value = operands[i]->_child->_sibling;
+         if (value->_token._type == TokenType::LSquareBracket)
+            array_token = value->_token;
+         const auto literals = (value->_token.IsLiteral() ? std::vector<const ExpressionNode*>{value} : Children(value));
+         for (const auto& literal : literals)
+         {
+            if (std::none_of(items.cbegin(), items.cend(), [&literal](const ExpressionNode* item) { return item->_token.Text() == literal->_token.Text(); }))
+               items.push_back(Clone(literal));
+         }
+      }
+
+      merged_operands.push_back(MakeNode(first->_token, {Clone(first->_child), MakeNode(array_token, items)}));
+   }
+   operands.swap(merged_operands);
+}
+
+// returns true if the node is a comparison of the specified type with a literal or an array of literals
+bool ExpressionOptimizer::IsSetTest(const ExpressionNode* node, const TokenType comparison_type)
+{
+   if (node->_token._type != comparison_type || !node->_child || !node->_child->_sibling)
+      return false;
+
+   const auto& value = node->_child->_sibling;
+   return value->_token.IsLiteral() || (value->_token._type == TokenType::LSquareBracket && IsScalarArray(value));
+}
+
+// returns true if the node is a non-empty array of literals
+bool ExpressionOptimizer::IsScalarArray(const ExpressionNode* node)
+{
+   if (!node->_child)
+      return false;
+
+   for (auto item = node->_child; item; item = item->_sibling)
+   {
+      if (!item->_token.IsLiteral())
+         return false;
+   }
+   return true;
+}
+
+std::vector<const ExpressionNode*> ExpressionOptimizer::Children(const ExpressionNode* node)
+{
+   std::vector<const ExpressionNode*> children;
+   for (auto child = node->_child; child; child = child->_sibling)
+      children.push_back(child);
+   return children;
+}
+
+// create a node with the specified children, children must not belong to any other node
+ExpressionNode* ExpressionOptimizer::MakeNode(const Token& token, const std::vector<ExpressionNode*>& children) const
+{
+   auto node = MakeExpressionNode(token, _resource);
+   for (auto child = children.crbegin(); child != children.crend(); ++child)
+   {
+      (*child)->_sibling = node->_child;
+      node->_child = *child;
+   }
+   return node;
+}
+
+ExpressionNode* ExpressionOptimizer::MakeBoolean(const bool value) const
+{
+   return MakeExpressionNode(Token(value ? TokenType::True : TokenType::False), _resource);
+}
+
+// deep copy of the subtree, the copy has no siblings
+ExpressionNode* ExpressionOptimizer::Clone(const ExpressionNode* node) const
+{
+   std::vector<ExpressionNode*> children;
+   for (auto child = node->_child; child; child = child->_sibling)
+      children.push_back(Clone(child));
+   return MakeNode(node->_token, children);
+}
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <vector>
+#include "common.h"
+
+// This is to simplify a syntax tree built by ExpressionParser before it gets compiled.
+// The optimizer folds constant subtrees (comparisons of literals, SUBSTR of literals, logical operators with constant operands),
+// removes duplicated operands of && and || chains, rewrites single-item arrays to plain comparisons
+// and merges adjacent comparisons of the same value, e.g. 'A != x && A != y' into 'A != [x, y]'.
+// Results of the optimized tree are always the same as of the original one, including evaluation failures.
+namespace Renaissance
+{
+class ExpressionOptimizer
+{
+public:
+   explicit ExpressionOptimizer(std::pmr::memory_resource* resource) : _resource(resource) {}
+   ExpressionOptimizer(const ExpressionOptimizer&) = delete;
+   ExpressionOptimizer(ExpressionOptimizer&&) = delete;
+   ExpressionOptimizer& operator =(const ExpressionOptimizer&) = delete;
+   ExpressionOptimizer& operator =(ExpressionOptimizer&&) = delete;
+   ~ExpressionOptimizer() = default;
+
+   ExpressionNode* Optimize(const ExpressionNode* root) const;
+
+   static bool IsEqual(const ExpressionNode* node1, const ExpressionNode* node2);
+   static std::string CanonicalForm(const ExpressionNode* node);
+
+private:
+   std::pmr::memory_resource* _resource; // new nodes are allocated from it, e.g. the arena of the original tree, it must outlive the optimized tree
+
+   ExpressionNode* OptimizeNode(const ExpressionNode* node) const;
+   ExpressionNode* OptimizeFunction(const ExpressionNode* node) const;
+   ExpressionNode* OptimizeComparison(const ExpressionNode* node) const;
+   ExpressionNode* OptimizeRelation(const ExpressionNode* node) const;
+   ExpressionNode* OptimizeLogicalOperator(const ExpressionNode* node) const;
+
+   template <typename Node>
+   static void CollectOperands(Node* node, const TokenType operator_type, std::vector<Node*>& operands);
+   void MergeSetTests(const TokenType comparison_type, std::vector<ExpressionNode*>& operands) const;
+   static bool IsSetTest(const ExpressionNode* node, const TokenType comparison_type);
+   static bool IsScalarArray(const ExpressionNode* node);
+   static inline bool IsBoolean(const ExpressionNode* node) { return node->_token._type == TokenType::True || node->_token._type == TokenType::False; }
+
+   static std::vector<const ExpressionNode*> Children(const ExpressionNode* node);
+   ExpressionNode* MakeNode(const Token& token, const std::vector<ExpressionNode*>& children) const;
+   ExpressionNode* MakeBoolean(const bool value) const;
+   ExpressionNode* Clone(const ExpressionNode* node) const;
+};
+}
@@ -1,72 +1,259 @@
 #include "expression_parser.h"
-#include <algorithm>
+#include <array>
+#include <cstring>
 #include <iostream>
 
 namespace Renaissance
 {
+namespace
+{
+// the lexer dispatches on the class of the first char of a token
+enum class CharClass : uint8_t
+{
+   Invalid,
+   Space,
+   Digit,
+   Minus,
+   Letter,
+   Quote,
+   Single,       // a single char token, e.g. '('
+   Pair,         // the first char of a two chars operator, e.g. '=' of "=="
+   SingleOrPair  // a single char operator which might be followed by the second char, e.g. '<' or "<="
+};
+
+struct CharInfo
+{
+   CharClass _class = CharClass::Invalid;
+   bool _is_name_part = false;             // a char of a function or variable name after its first letter
+   TokenType _type = TokenType::Func;      // type of a single char token
+   char _second = '\0';                    // the second char of a two chars operator
+   TokenType _pair_type = TokenType::Func; // type of a two chars operator
+};
+
+constexpr void SetSingle(std::array<CharInfo, 256>& table, const char ch, const TokenType type)
+{
+   table[static_cast<unsigned char>(ch)]._class = CharClass::Single;
+   table[static_cast<unsigned char>(ch)]._type = type;
+}
+
+constexpr void SetPair(std::array<CharInfo, 256>& table, const char ch, const char second, const TokenType pair_type)
+{
+   table[static_cast<unsigned char>(ch)]._class = CharClass::Pair;
+   table[static_cast<unsigned char>(ch)]._second = second;
+   table[static_cast<unsigned char>(ch)]._pair_type = pair_type;
+}
+
+constexpr std::array<CharInfo, 256> MakeCharTable()
+{
+   std::array<CharInfo, 256> table{};
+   for (const char ch : {' ', '\t', '\n', '\v', '\f', '\r'})
+      table[static_cast<unsigned char>(ch)]._class = CharClass::Space;
+   for (char ch = '0'; ch <= '9'; ch++)
+      table[static_cast<unsigned char>(ch)] = {CharClass::Digit, true};
+   for (char ch = 'a'; ch <= 'z'; ch++)
+      table[static_cast<unsigned char>(ch)] = {CharClass::Letter, true};
+   for (char ch = 'A'; ch <= 'Z'; ch++)
+      table[static_cast<unsigned char>(ch)] = {CharClass::Letter, true};
+   table['.']._is_name_part = true;
+   table['_']._is_name_part = true;
+   table['-']._class = CharClass::Minus;
+   table['\"']._class = CharClass::Quote;
+
+   SetSingle(table, '(', TokenType::LBracket);
+   SetSingle(table, ')', TokenType::RBracket);
+   SetSingle(table, ',', TokenType::ArgSep);
+   SetSingle(table, '[', TokenType::LSquareBracket);
+   SetSingle(table, ']', TokenType::RSquareBracket);
+   SetSingle(table, '{', TokenType::LBrace);
+   SetSingle(table, '}', TokenType::RBrace);
+
+   SetPair(table, '=', '=', TokenType::OperatorEqual);
+   SetPair(table, '!', '=', TokenType::OperatorNotEqual);
+   SetPair(table, '&', '&', TokenType::OperatorLogicalAnd);
+   SetPair(table, '|', '|', TokenType::OperatorLogicalOr);
+   SetPair(table, '<', '=', TokenType::OperatorLessOrEqual);
+   SetPair(table, '>', '=', TokenType::OperatorMoreOrEqual);
+   table['<']._class = CharClass::SingleOrPair;
+   table['<']._type = TokenType::OperatorLess;
+   table['>']._class = CharClass::SingleOrPair;
+   table['>']._type = TokenType::OperatorMore;
+   return table;
+}
+
+constexpr std::array<CharInfo, 256> CharTable = MakeCharTable();
+
+inline const CharInfo& GetCharInfo(const char ch)
+{
+   return CharTable[static_cast<unsigned char>(ch)];
+}
+
+inline bool IsDigit(const char ch)
+{
+   return GetCharInfo(ch)._class == CharClass::Digit;
+}
+}
+
 // parse the specified expression, returns true if successful
-bool ExpressionParser::Parse(const std::string& expression, ExpressionTree& expression_tree)
+// tokens of the resulting tree point into the parser's own copy of the expression, so the tree is valid until the next parsing
+bool ExpressionParser::Parse(const StringView& expression, ExpressionTree& expression_tree)
+{
+   std::shared_ptr<const std::string> source;
+   return Parse(expression, expression_tree, source);
+}
+
+// parse the specified expression, returns true if successful
+// 'source' receives the buffer the tokens of the resulting tree point into, the tree stays valid as long as the buffer and the nodes are alive
+bool ExpressionParser::Parse(const StringView& expression, ExpressionTree& expression_tree, std::shared_ptr<const std::string>& source)
 {
    while (!expression_tree.empty())
       expression_tree.pop();
+   ReleaseArena();
 
-   Clear();
+   // every parsing gets its own buffer, so tokens of previously returned trees are not invalidated
+   _expression = std::make_shared<const std::string>(expression.data(), expression.size());
+   if (!ParseBuffer(_expression->data(), _expression->data() + _expression->size()))
+      return false;
 
-   _expression = "(" + expression + ")";
-   _current = _expression.cbegin();
+   expression_tree.swap(_expression_tree);
+   source = _expression;
+   return true;
+}
 
-   Token token;
-   while (ReadToken(token))
-   {
-      if (!ProcessToken(token))
-         return false;
-   }
+// parse the specified expression without copying it, returns true if successful
+// tokens of the resulting tree point into the caller's memory, so the tree is valid as long as the expression is alive
+bool ExpressionParser::ParseInPlace(const StringView& expression, ExpressionTree& expression_tree)
+{
+   while (!expression_tree.empty())
+      expression_tree.pop();
+   ReleaseArena();
 
-   while (!_operators.empty())
-   {
-      if (_operators.top()._type == TokenType::LBracket)
-         return false;
-      if (!MoveToOutput(2, false))
-         return false;
-      _operators.pop();
-   }
+   _expression.reset();
+   if (!ParseBuffer(expression.data(), expression.data() + expression.size()))
+      return false;
 
    expression_tree.swap(_expression_tree);
    return true;
 }
 
+// parse many expressions at once, e.g. all rules loaded at startup
+// the expressions are copied into the single 'source' buffer, the tokens of all resulting trees point into it
+// 'expression_trees' gets a tree for every expression, a failed expression gets an empty tree and its index is added to 'failed_indexes'
+// returns true if all expressions were parsed
+bool ExpressionParser::ParseMany(const std::vector<StringView>& expressions, std::vector<ExpressionTree>& expression_trees,
+                                 std::vector<size_t>& failed_indexes, std::shared_ptr<const std::string>& source)
+{
+   expression_trees.clear();
+   expression_trees.resize(expressions.size());
+   failed_indexes.clear();
+   ReleaseArena();
+
+   size_t size = 0;
+   for (const auto& expression : expressions)
+      size += expression.size();
+   auto buffer = std::make_shared<std::string>();
+   buffer->reserve(size);
+   for (const auto& expression : expressions)
+      buffer->append(expression.data(), expression.size());
+
+   _expression.reset();
+   const char* begin = buffer->data();
+   for (size_t i = 0; i < expressions.size(); i++)
+   {
+      const char* end = begin + expressions[i].size();
+      if (ParseBuffer(begin, end))
+         expression_trees[i].swap(_expression_tree);
+      else
+         failed_indexes.push_back(i);
+      begin = end;
+   }
+
+   Clear();
+   source = std::move(buffer);
+   return failed_indexes.empty();
+}
+
 // print the syntax tree to stdout
 void ExpressionParser::PrintOutputTree() const
 {
    if (!_expression_tree.empty())
-      PrintOutputTree(static_cast<std::shared_ptr<ExpressionNode>>(_expression_tree.top()), 0);
+      PrintOutputTree(_expression_tree.top(), 0);
 }
 
 
-// this is to clear everything to prepare a new parsing
+// nodes of the trees returned by the previous parsing are released if they are allocated from the parser's own arena
+void ExpressionParser::ReleaseArena()
+{
+   if (_resource == &_arena)
+      _arena.release();
+}
+
+// this is to clear everything to prepare a new parsing, memory of the stacks is kept
 void ExpressionParser::Clear()
 {
-   _expression.clear();
    while (!_expression_tree.empty()) _expression_tree.pop();
    while (!_operators.empty())       _operators.pop();
    while (!_args_number.empty())     _args_number.pop();
 }
 
+// parse the chars from 'begin' to 'end' into _expression_tree, returns true if successful
+// partial trees of a failed parsing are dropped, their nodes stay in the resource until it's released
+bool ExpressionParser::ParseBuffer(const char* begin, const char* end)
+{
+   if (ProcessBuffer(begin, end))
+      return true;
+   Clear();
+   return false;
+}
+
+bool ExpressionParser::ProcessBuffer(const char* begin, const char* end)
+{
+   Clear();
+   _current = begin;
+   _end = end;
+
+   // the expression is parsed as if it was enclosed in brackets
+   if (!ProcessLBracket(Token(TokenType::LBracket)))
+      return false;
+
+   // keywords of operators are operators only after an operand, so variables might still be named PREFIX or IN
+   Token token(TokenType::LBracket);
+   for (SkipWhiteSpaces(); _current != _end; SkipWhiteSpaces())
+   {
+      const bool after_operand = (token._type == TokenType::Variable || token._type == TokenType::Scalar || token._type == TokenType::Number ||
+                                  token._type == TokenType::RBracket || token._type == TokenType::RSquareBracket || token._type == TokenType::RBrace);
+      if (!ReadToken(token, after_operand) || !ProcessToken(token))
+         return false;
+   }
+
+   if (!ProcessRBracket(Token(TokenType::RBracket)))
+      return false;
+
+   while (!_operators.empty())
+   {
+      if (_operators.top()._type == TokenType::LBracket)
+         return false;
+      if (!MoveToOutput(2, false))
+         return false;
+      _operators.pop();
+   }
+   return true;
+}
+
 // skip whitespaces in the parsed string
 void ExpressionParser::SkipWhiteSpaces()
 {
-   while (_current != _expression.cend() && isspace(*_current))
+   while (_current != _end && GetCharInfo(*_current)._class == CharClass::Space)
       ++_current;
 }
 
 // retrieve specified number of operands from the tree and build a new tree node
-bool ExpressionParser::MoveToOutput(const uint16_t operands_number, const bool is_function)
+bool ExpressionParser::MoveToOutput(const uint32_t operands_number, const bool is_function)
 {
    if (operands_number == 0 || _expression_tree.empty())
       return false;
 
    // create a parent tree node, add the first child
-   auto parent_node = std::make_shared<ExpressionNode>();
+   auto parent_node = MakeExpressionNode(Token(), _resource);
 
    // for all token types we retrieve a token from current operator on stack
    // except for functions - here we can't do it as current operator on stack is left brace, so we do it later
@@ -81,7 +268,7 @@ bool ExpressionParser::MoveToOutput(const uint16_t operands_number, const bool i
    _expression_tree.pop();
 
    // retrieve other operands, add them into the tree in reversed order (to keep original arguments order in syntax tree)
-   for (uint16_t i = 0; i < operands_number - 1; i++)
+   for (uint32_t i = 0; i < operands_number - 1; i++)
    {
       if (_expression_tree.empty())
          return false; // some operands are missed
@@ -96,215 +283,123 @@ bool ExpressionParser::MoveToOutput(const uint16_t operands_number, const bool i
    return CheckOutputNode(parent_node, operands_number);
 }
 
-// reads a token from the parsed string into the 'token' output parameter
+// reads a token at the current parsing position, which is not a whitespace, into the 'token' output parameter
+// 'after_operand' tells if the previous token ends an operand, so an operator keyword is expected rather than a variable
 // moves current parsing position
 // returns true if a token was parsed
-bool ExpressionParser::ReadToken(Token& token)
-{
-   if (_current == _expression.cend())
-      return false;
-
-   SkipWhiteSpaces();
-
-   if (ReadLBracket(token))
-      return true;
-
-   if (ReadRBracket(token))
-      return true;
-
-   if (ReadOperator(token))
-      return true;
-
-   if (ReadArgSep(token))
-      return true;
-
-   if (ReadNumber(token))
-      return true;
-
-   if (ReadString(token))
-      return true;
-
-   if (ReadFunctionOrVariable(token))
-      return true;
-
-   if (ReadLSquareBracket(token))
-      return true;
-
-   if (ReadRSquareBracket(token))
-      return true;
-
-   if (ReadLBrace(token))
-      return true;
-
-   if (ReadRBrace(token))
-      return true;
-
-   return false;
-}
-
-// reads a single character token of specified token type into the 'token' output parameter
-// returns true if successful
-bool ExpressionParser::ReadCharToken(const char ch, const TokenType enTokenType, Token& token)
+bool ExpressionParser::ReadToken(Token& token, const bool after_operand)
 {
-   if (*_current == ch)
+   const CharInfo& info = GetCharInfo(*_current);
+   token._begin = _current;
+   switch (info._class)
    {
-      token._type = enTokenType;
-      ++_current;
-      return true;
+      case CharClass::Digit:
+      case CharClass::Minus:
+         return ReadNumber(token);
+      case CharClass::Quote:
+         return ReadString(token);
+      case CharClass::Letter:
+         return ReadFunctionOrVariable(token, after_operand);
+      case CharClass::Single:
+         token._type = info._type;
+         token._end = ++_current;
+         return true;
+      case CharClass::Pair:
+      case CharClass::SingleOrPair:
+         if (_current + 1 != _end && *(_current + 1) == info._second)
+         {
+            token._type = info._pair_type;
+            token._end = (_current += 2);
+            return true;
+         }
+         if (info._class == CharClass::Pair)
+            return false;
+         token._type = info._type;
+         token._end = ++_current;
+         return true;
+      default:
+         return false;
    }
-   else
-      return false;
 }
 
-// reads a two chars token of specified token type into the 'token' output parameter
+// reads a number token into the 'token' output parameter, it's an optional minus, digits and optional point with fraction digits
 // returns true if successful
-bool ExpressionParser::Read2CharsToken(const std::pair<char, char>& ch, const TokenType enTokenType, Token& token)
+bool ExpressionParser::ReadNumber(Token& token)
 {
-   if (*_current == ch.first && *(_current + 1) == ch.second)
-   {
-      token._type = enTokenType;
-      _current += 2;
-      return true;
-   }
-   else
+   auto it = _current;
+   if (*it == '-')
+      ++it;
+   if (it == _end || !IsDigit(*it))
       return false;
-}
 
-// reads a left bracket token into the 'token' output parameter
-// returns true if successful
-bool ExpressionParser::ReadLBracket(Token& token)
-{
-   return ReadCharToken('(', TokenType::LBracket, token);
-}
-
-// reads an right bracket token into the 'token' output parameter
-// returns true if successful
-bool ExpressionParser::ReadRBracket(Token& token)
-{
-   return ReadCharToken(')', TokenType::RBracket, token);
-}
-
-// reads an argument separator into the 'token' output parameter
-// returns true if successful
-bool ExpressionParser::ReadArgSep(Token& token)
-{
-   return ReadCharToken(',', TokenType::ArgSep, token);
-}
-
-// reads an operator token into the 'token' output parameter
-// returns true if successful
-bool ExpressionParser::ReadOperator(Token& token)
-{
-   if (Read2CharsToken(std::make_pair('<', '='), TokenType::OperatorLessOrEqual, token) ||
-       Read2CharsToken(std::make_pair('>', '='), TokenType::OperatorMoreOrEqual, token) ||
-       Read2CharsToken(std::make_pair('=', '='), TokenType::OperatorEqual, token)       ||
-       Read2CharsToken(std::make_pair('!', '='), TokenType::OperatorNotEqual, token)    ||
-       Read2CharsToken(std::make_pair('&', '&'), TokenType::OperatorLogicalAnd, token)  ||
-       Read2CharsToken(std::make_pair('|', '|'), TokenType::OperatorLogicalOr, token)   ||
-       ReadCharToken('<', TokenType::OperatorLess, token)                               ||
-       ReadCharToken('>', TokenType::OperatorMore, token))
+   // this is a number, search for its end
+   while (++it != _end && IsDigit(*it)) {}
+   if (it != _end && *it == '.' && it + 1 != _end && IsDigit(*(it + 1)))
    {
-      return true;
+      ++it;
+      while (++it != _end && IsDigit(*it)) {}
    }
-   return false;
-}
 
-// reads a number token into the 'token' output parameter
-// returns true if successful
-bool ExpressionParser::ReadNumber(Token& token)
-{
-   if (std::isdigit(*_current))
-   {
-      // this is a number, search for its end
-      auto it = std::find_if(_current + 1, _expression.cend(), [](const char ch) { return !std::isdigit(ch); });
-      if (it != _expression.cend())
-      {
-         token._type  = TokenType::Scalar;
-         token._begin = _current;
-         token._end   = it;
-         _current     = it;
-         return true;
-      }
-   }
-
-   return false;
+   token._type  = TokenType::Number;
+   token._begin = _current;
+   token._end   = it;
+   _current     = it;
+   return true;
 }
 
 // reads a string token into the 'token' output parameter
 // returns true if successful
 bool ExpressionParser::ReadString(Token& token)
 {
-   if (*_current == '\"')
-   {
-      // this is a string, search for its end
-      auto it = std::find(_current + 1, _expression.cend(), '\"');
-      if (it != _expression.cend())
-      {
-         token._type  = TokenType::Scalar;
-         token._begin = _current + 1;
-         token._end   = it;
-         _current     = it + 1;
-         return true;
-      }
-   }
+   // this is a string, search for its end
+   const auto it = static_cast<const char*>(std::memchr(_current + 1, '\"', _end - _current - 1));
+   if (it == nullptr)
+      return false;
 
-   return false;
+   token._type  = TokenType::Scalar;
+   token._begin = _current + 1;
+   token._end   = it;
+   _current     = it + 1;
+   return true;
 }
 
-// reads a function or variable token into the 'token' output parameter
+// reads a function or variable token into the 'token' output parameter, operator keywords are read as operators after an operand
 // returns true if successful
-bool ExpressionParser::ReadFunctionOrVariable(Token& token)
+bool ExpressionParser::ReadFunctionOrVariable(Token& token, const bool after_operand)
 {
    // figure out whether token is function or variable
    // function name contains alphanumeric characters + '{', variable - without a brace in the end
-   // either way first character should be a letter
-   if (std::isalpha(*_current))
+   // the first character is a letter, the token ends at any char which is not alphanumeric, '.' or '_'
+   auto it = _current;
+   while (++it != _end && GetCharInfo(*it)._is_name_part) {}
+
+   // function should have a brace after the name
+   token._type  = (it != _end && *it == '{' ? TokenType::Func : TokenType::Variable);
+   if (token._type == TokenType::Variable && after_operand)
    {
-      // search for the token end - any non-alpha character
-      auto it = std::find_if(_current + 1, _expression.cend(), [](const char ch) { return !std::isalnum(ch) && ch != '.' && ch != '_'; });
-      if (it != _expression.cend())
+      const StringView name(_current, it - _current);
+      if (name == "PREFIX")
+         token._type = TokenType::OperatorPrefix;
+      else if (name == "IN")
       {
-         // function should have a brace after the name
-         if (it != _expression.cend() && *it == '{')
-            token._type = TokenType::Func;
-         else
-            token._type = TokenType::Variable;
-
-         token._begin = _current;
-         token._end   = it;
-         _current     = it;
-         return true;
+         // 'IN RANGES' is a single token of two words separated by whitespaces
+         auto next = it;
+         while (next != _end && GetCharInfo(*next)._class == CharClass::Space)
+            ++next;
+         auto next_end = next;
+         while (next_end != _end && GetCharInfo(*next_end)._is_name_part)
+            ++next_end;
+         if (next != it && StringView(next, next_end - next) == "RANGES")
+         {
+            token._type = TokenType::OperatorInRanges;
+            it = next_end;
+         }
       }
    }
-   return false;
-}
-
-// reads a left square bracket token (array) into the 'token' output parameter
-// returns true if successful
-bool ExpressionParser::ReadLSquareBracket(Token& token)
-{
-   return ReadCharToken('[', TokenType::LSquareBracket, token);
-}
-
-// reads a right square bracket token (array) into the 'token' output parameter
-// returns true if successful
-bool ExpressionParser::ReadRSquareBracket(Token& token)
-{
-   return ReadCharToken(']', TokenType::RSquareBracket, token);
-}
-
-// reads a left brace token into the 'token' output parameter
-// returns true if successful
-bool ExpressionParser::ReadLBrace(Token& token)
-{
-   return ReadCharToken('{', TokenType::LBrace, token);
-}
-
-// reads a right brace token into the 'token' output parameter
-// returns true if successful
-bool ExpressionParser::ReadRBrace(Token& token)
-{
-   return ReadCharToken('}', TokenType::RBrace, token);
+   token._begin = _current;
+   token._end   = it;
+   _current     = it;
+   return true;
 }
 
 // process the specified token, returns true if successful
@@ -313,6 +408,7 @@ bool ExpressionParser::ProcessToken(const Token& token)
    switch (token._type)
    {
       case TokenType::Scalar:
+      case TokenType::Number:
       case TokenType::Variable:
          return ProcessScalar(token);
       case TokenType::ArgSep:
@@ -340,7 +436,7 @@ bool ExpressionParser::ProcessToken(const Token& token)
 
 bool ExpressionParser::ProcessScalar(const Token& token)
 {
-   _expression_tree.push(std::make_shared<ExpressionNode>(token));
+   _expression_tree.push(MakeExpressionNode(token, _resource));
    return true;
 }
 
@@ -460,7 +556,7 @@ bool ExpressionParser::ProcessRBrace(const Token& token)
       return false;
 }
 
-bool ExpressionParser::CheckOutputNode(const std::shared_ptr<ExpressionNode>& node, const uint16_t operands_number) const
+bool ExpressionParser::CheckOutputNode(const ExpressionNode* node, const uint32_t operands_number) const
 {
    if (!node)
       return false;
@@ -471,13 +567,16 @@ bool ExpressionParser::CheckOutputNode(const std::shared_ptr<ExpressionNode>& no
          return CheckFunctionNode(node);
       case TokenType::RSquareBracket:
          return CheckArrayNode(node, operands_number);
+      case TokenType::OperatorPrefix:
+      case TokenType::OperatorInRanges:
+         return CheckTableOperatorNode(node);
       // TODO: check other token types
       default:
          return true;
    }
 }
 
-bool ExpressionParser::CheckFunctionNode(const std::shared_ptr<ExpressionNode>& node) const
+bool ExpressionParser::CheckFunctionNode(const ExpressionNode* node) const
 {
    if (!node)
       return false;
@@ -486,8 +585,8 @@ bool ExpressionParser::CheckFunctionNode(const std::shared_ptr<ExpressionNode>&
    {
       if (!node->_child || !node->_child->_sibling || !node->_child->_sibling->_sibling ||
           node->_child->_token._type != TokenType::Variable ||
-          node->_child->_sibling->_token._type != TokenType::Scalar ||
-          node->_child->_sibling->_sibling->_token._type != TokenType::Scalar)
+          !node->_child->_sibling->_token.IsLiteral() ||
+          !node->_child->_sibling->_sibling->_token.IsLiteral())
       {
          return false;
       }
@@ -495,7 +594,7 @@ bool ExpressionParser::CheckFunctionNode(const std::shared_ptr<ExpressionNode>&
    return true;
 }
 
-bool ExpressionParser::CheckArrayNode(const std::shared_ptr<ExpressionNode>& node, const uint16_t operands_number) const
+bool ExpressionParser::CheckArrayNode(const ExpressionNode* node, const uint32_t operands_number) const
 {
    if (!node)
       return false;
@@ -503,9 +602,9 @@ bool ExpressionParser::CheckArrayNode(const std::shared_ptr<ExpressionNode>& nod
    // check that all array items are scalar
    auto child_node = node->_child;
 
-   for (uint16_t i = 0; i < operands_number && child_node; i++)
+   for (uint32_t i = 0; i < operands_number && child_node; i++)
    {
-      if (child_node->_token._type != TokenType::Scalar)
+      if (!child_node->_token.IsLiteral())
          return false;
       child_node = child_node->_sibling;
    }
@@ -513,11 +612,17 @@ bool ExpressionParser::CheckArrayNode(const std::shared_ptr<ExpressionNode>& nod
    return true;
 }
 
+// the right operand of PREFIX and IN RANGES operators is an array of literals, it's compiled into a lookup table
+bool ExpressionParser::CheckTableOperatorNode(const ExpressionNode* node) const
+{
+   return node->_child && node->_child->_sibling && node->_child->_token._type != TokenType::LSquareBracket &&
+          node->_child->_sibling->_token._type == TokenType::LSquareBracket;
+}
 
 // syntax tree print helper function
 // recursively traverses the syntax tree and prints every node to stdout
 // 'level' the nesting level of current node, is used for indentation while printing
-void ExpressionParser::PrintOutputTree(const std::shared_ptr<ExpressionNode>& node, const size_t level) const
+void ExpressionParser::PrintOutputTree(const ExpressionNode* node, const size_t level) const
 {
    if (!node)
       return;
@@ -11,7 +11,12 @@
 // ((IN.CURRENCY != "985") && (IN.BIN_ISSUEING_COUNTRY == "616") && (IN.MT==1) && (SUBSTR{3,1,IN.TID} == ["9", "2", "L", "V", "U"]))
 // At the moment the only supported function is SUBSTR, 1st arg - <from> 0-based position, 2nd arg - length of substring to take, 3rd arg - source string.
 // Functions without arguments are not supported now.
+// Literals are strings in double quotes and numbers like 8 or -12.50, relational operators compare numbers and booleans,
+// a number literal compared with a string is compared as a string, so IN.MT==1 compares the text of IN.MT with "1".
 // Beside of simple logical operators, a value might be compared with an array by using equal operator and it works like "IN" SQL operator.
+// Large tables are matched by PREFIX and IN RANGES operators, e.g. IN.PAN PREFIX ["4000", "5100"] is true if the value starts with any of the items
+// and SUBSTR{IN.PAN, 0, 6} IN RANGES [400000, 499999, 510000, 559999] is true if the value is a number within any of the ranges given by pairs of bounds.
+// PREFIX and IN RANGES are operators only right after an operand, elsewhere PREFIX and IN are names of variables as before, e.g. PREFIX PREFIX ["1"].
 // There are also variables, all variable values are passed via a hashtable into the ExpressionParser::Evaluate method.
 using namespace boost::property_tree;
 
@@ -21,41 +26,43 @@ class ExpressionParser
 {
 public:
    ExpressionParser() = default;
+   explicit ExpressionParser(std::pmr::memory_resource* resource) : _resource(resource) {}
    ExpressionParser(const ExpressionParser&) = delete;
    ExpressionParser(ExpressionParser&&) = delete;
    ExpressionParser& operator =(const ExpressionParser&) = delete;
    ExpressionParser& operator =(ExpressionParser&&) = delete;
    ~ExpressionParser() = default;
 
-   bool Parse(const std::string& expression, ExpressionTree& expression_tree);
+   bool Parse(const StringView& expression, ExpressionTree& expression_tree);
+   bool Parse(const StringView& expression, ExpressionTree& expression_tree, std::shared_ptr<const std::string>& source);
+   bool ParseInPlace(const StringView& expression, ExpressionTree& expression_tree);
+   bool ParseMany(const std::vector<StringView>& expressions, std::vector<ExpressionTree>& expression_trees,
+                  std::vector<size_t>& failed_indexes, std::shared_ptr<const std::string>& source);
    void PrintOutputTree() const;
 
 private:
-   std::string _expression;
-   std::string::const_iterator _current;
-   std::stack<Token> _operators;
-   std::stack<uint16_t> _args_number;
+   std::pmr::monotonic_buffer_resource _arena; // nodes are allocated from it unless a resource is given, it's released by every parsing
+   std::pmr::memory_resource* _resource = &_arena; // syntax tree nodes are allocated from it
+   std::shared_ptr<const std::string> _expression;
+   const char* _current = nullptr;
+   const char* _end = nullptr;
+   // stacks are backed by vectors, so their memory is reused by the next parsing
+   std::stack<Token, std::vector<Token>> _operators;
+   std::stack<uint32_t, std::vector<uint32_t>> _args_number;
    ExpressionTree _expression_tree;
 
+   void ReleaseArena();
    void Clear();
+   bool ParseBuffer(const char* begin, const char* end);
+   bool ProcessBuffer(const char* begin, const char* end);
    void SkipWhiteSpaces();
-   bool MoveToOutput(const uint16_t operands_number, const bool is_function);
+   bool MoveToOutput(const uint32_t operands_number, const bool is_function);
    inline bool IsCurrentToken(const TokenType& token_type) const { return !_operators.empty() && _operators.top()._type == token_type; }
 
-   bool ReadToken(Token& token);
-   bool ReadCharToken(const char ch, const TokenType enTokenType, Token& token);
-   bool Read2CharsToken(const std::pair<char, char>& ch, const TokenType enTokenType, Token& token);
-   bool ReadLBracket(Token& token);
-   bool ReadRBracket(Token& token);
-   bool ReadArgSep(Token& token);
-   bool ReadOperator(Token& token);
+   bool ReadToken(Token& token, const bool after_operand);
    bool ReadNumber(Token& token);
    bool ReadString(Token& token);
-   bool ReadFunctionOrVariable(Token& token);
-   bool ReadLSquareBracket(Token& token);
-   bool ReadRSquareBracket(Token& token);
-   bool ReadLBrace(Token& token);
-   bool ReadRBrace(Token& token);
+   bool ReadFunctionOrVariable(Token& token, const bool after_operand);
 
    bool ProcessToken(const Token& token);
    bool ProcessScalar(const Token& token);
@@ -69,11 +76,12 @@ private:
    bool ProcessLBrace(const Token& token);
    bool ProcessRBrace(const Token& token);
 
-   bool CheckOutputNode(const std::shared_ptr<ExpressionNode>& node, const uint16_t operands_number) const;
-   bool CheckFunctionNode(const std::shared_ptr<ExpressionNode>& node) const;
-   bool CheckArrayNode(const std::shared_ptr<ExpressionNode>& node, const uint16_t operands_number) const;
+   bool CheckOutputNode(const ExpressionNode* node, const uint32_t operands_number) const;
+   bool CheckFunctionNode(const ExpressionNode* node) const;
+   bool CheckArrayNode(const ExpressionNode* node, const uint32_t operands_number) const;
+   bool CheckTableOperatorNode(const ExpressionNode* node) const;
 
-   void PrintOutputTree(const std::shared_ptr<ExpressionNode>& node, const size_t level) const;
+   void PrintOutputTree(const ExpressionNode* node, const size_t level) const;
 };
 }
 
@@ -0,0 +1,499 @@
+#include "expression_program.h"
+#include "program_executor.h"
+#include "string_functions.h"
+#include <algorithm>
+#include <limits>
+
+namespace Renaissance
+{
+namespace
+{
+// provides values of variables by their slots from a hashtable of variable values
+class VariableValuesSource
+{
+public:
+   VariableValuesSource(const VariableValues& variable_values, const std::vector<std::string>& variables) : _variable_values(variable_values), _variables(variables) {}
+
+   inline bool GetValue(const uint32_t slot, StringView& value) const
+   {
+      auto variable_value = _variable_values.find(_variables[slot]);
+      if (variable_value == _variable_values.end())
+         return false;
+      value = variable_value->second;
+      return true;
+   }
+
+private:
+   const VariableValues& _variable_values;
+   const std::vector<std::string>& _variables;
+};
+}
+
+// execute the program with variables values given in 'variable_values' parameter
+// execution result will be returned in the output parameter 'result'
+// returns true if successful
+bool ExpressionProgram::Execute(const VariableValues& variable_values, bool& result) const
+{
+   return ExecuteProgram(*this, VariableValuesSource(variable_values, _variables), result);
+}
+
+// execute the program with variables values given by slots of the schema the program was compiled with
+// execution result will be returned in the output parameter 'result'
+// returns true if successful
+bool ExpressionProgram::Execute(const VariableRecord& variable_record, bool& result) const
+{
+   return ExecuteProgram(*this, VariableRecordSource(variable_record), result);
+}
+
+// returns true if the variable is used by the program as a number
+// it's a linear search, which is fine for the syntax tree walker it's meant for
+bool ExpressionProgram::IsNumberVariable(const std::string& variable) const
+{
+   for (size_t slot = 0; slot < _variables.size(); slot++)
+   {
+      if (_variables[slot] == variable)
+         return _variable_types[slot] == VariableType::Number;
+   }
+   return false;
+}
+
+
+// compile the syntax tree with the specified root into the 'program', the tree root must have boolean type
+// variables get slots of their own, in order of their appearance in the expression
+// returns true if successful
+bool ProgramCompiler::Compile(const ExpressionNode* root, ExpressionProgram& program)
+{
+   VariableSchema schema;
+   return Compile(root, schema, program);
+}
+
+// compile the syntax tree with the specified root into the 'program', the tree root must have boolean type
+// variables get slots from the 'schema', variables missing in the schema are added to it
+// returns true if successful
+bool ProgramCompiler::Compile(const ExpressionNode* root, VariableSchema& schema, ExpressionProgram& program)
+{
+   program._instructions.clear();
+   program._constants.clear();
+   program._variables.clear();
+   program._variable_types.clear();
+   program._numbers.clear();
+   program._arrays.clear();
+   program._number_arrays.clear();
+   program._prefix_sets.clear();
+   program._range_sets.clear();
+   program._max_stack_depth = 0;
+
+   _program = &program;
+   _schema = &schema;
+   _stack_depth = 0;
+
+   ValueType value_type;
+   const bool res = CompileNode(root, value_type) && value_type == ValueType::Boolean && _stack_depth == 1;
+
+   _program = nullptr;
+   _schema = nullptr;
+   return res;
+}
+
+bool ProgramCompiler::CompileNode(const ExpressionNode* node, ValueType& value_type)
+{
+   if (!node)
+      return false;
+
+   switch (node->_token._type)
+   {
+      case TokenType::True:
+      case TokenType::False:
+         return CompileBoolean(node, value_type);
+      case TokenType::Scalar:
+      case TokenType::Number:
+         return CompileScalar(node, value_type);
+      case TokenType::Variable:
+         return CompileVariable(node, value_type);
+      case TokenType::Func:
+         return CompileFunction(node, value_type);
+      default:
+         // arrays are only allowed as the right operand of == and != operators, they are compiled along with the operator
+         if (node->_token.IsOperator())
+            return CompileOperator(node, value_type);
+   }
+   return false;
+}
+
+bool ProgramCompiler::CompileBoolean(const ExpressionNode* node, ValueType& value_type)
+{
+   Emit(Instruction(OpCode::PushBool, node->_token._type == TokenType::True ? 1 : 0), 1);
+   value_type = ValueType::Boolean;
+   return true;
+}
+
+bool ProgramCompiler::CompileScalar(const ExpressionNode* node, ValueType& value_type)
+{
+   Emit(Instruction(OpCode::PushConstant, AddConstant(std::string(node->_token._begin, node->_token._end))), 1);
+   value_type = ValueType::String;
+   return true;
+}
+
+bool ProgramCompiler::CompileVariable(const ExpressionNode* node, ValueType& value_type)
+{
+   const uint32_t slot = AddVariable(std::string(node->_token._begin, node->_token._end));
+   const bool is_number = (_schema->GetVariableType(slot) == VariableType::Number);
+   Emit(Instruction(is_number ? OpCode::PushNumberVariable : OpCode::PushVariable, slot), 1);
+   value_type = (is_number ? ValueType::Number : ValueType::String);
+   return true;
+}
+
+// compile a number literal or a variable tagged as a number, literals are converted to numbers here once
+bool ProgramCompiler::CompileNumber(const ExpressionNode* node)
+{
+   if (node->_token._type == TokenType::Variable)
+   {
+      ValueType value_type;
+      return CompileVariable(node, value_type) && value_type == ValueType::Number;
+   }
+
+   int64_t number = 0;
+   if (node->_token._type != TokenType::Number || !ParseNumber(node->_token.Text(), number))
+      return false; // the number can't be represented exactly
+   Emit(Instruction(OpCode::PushNumber, AddNumber(number)), 1);
+   return true;
+}
+
+bool ProgramCompiler::CompileFunction(const ExpressionNode* node, ValueType& value_type)
+{
+   // the only supported function is substring with 3 arguments
+   if (std::string(node->_token._begin, node->_token._end) != "SUBSTR")
+      return false;
+
+   const auto& source = node->_child;
+   if (!source || !source->_sibling || !source->_sibling->_sibling || source->_sibling->_sibling->_sibling)
+      return false;
+
+   ValueType source_type;
+   if (!CompileNode(source, source_type) || source_type != ValueType::String)
+      return false;
+
+   // substring position and length are mostly literals, so they are converted to numbers here once
+   uint32_t from = 0;
+   uint32_t length = 0;
+   bool from_out_of_range = false;
+   bool length_out_of_range = false;
+   if (ReadConstantNumber(source->_sibling, from, from_out_of_range) && ReadConstantNumber(source->_sibling->_sibling, length, length_out_of_range))
+   {
+      // the substring is empty if any of the numbers doesn't fit into int
+      if (from_out_of_range || length_out_of_range)
+         from = std::numeric_limits<uint32_t>::max();
+      Emit(Instruction(OpCode::Substr, from, length), 0);
+   }
+   else
+   {
+      ValueType from_type;
+      ValueType length_type;
+      if (!CompileNode(source->_sibling, from_type) || from_type != ValueType::String ||
+          !CompileNode(source->_sibling->_sibling, length_type) || length_type != ValueType::String)
+      {
+         return false;
+      }
+      Emit(Instruction(OpCode::SubstrDynamic), -2);
+   }
+
+   value_type = ValueType::String;
+   return true;
+}
+
+bool ProgramCompiler::CompileOperator(const ExpressionNode* node, ValueType& value_type)
+{
+   // two operator arguments must exist
+   if (!node->_child || !node->_child->_sibling)
+      return false;
+
+   if (node->_token._type == TokenType::OperatorLogicalOr || node->_token._type == TokenType::OperatorLogicalAnd)
+      return CompileLogicalOperator(node, value_type);
+
+   if (node->_token._type == TokenType::OperatorPrefix)
+      return CompilePrefixTest(node, value_type);
+
+   if (node->_token._type == TokenType::OperatorInRanges)
+      return CompileRangeTest(node, value_type);
+
+   if (node->_child->_sibling->_token._type == TokenType::LSquareBracket)
+      return CompileArrayComparison(node, value_type);
+
+   // a number literal is compared as a number only if the other operand is a number too
+   ValueType arg1_type;
+   ValueType arg2_type;
+   if (IsNumber(node->_child, *_schema) && IsNumber(node->_child->_sibling, *_schema))
+   {
+      if (!CompileNumber(node->_child) || !CompileNumber(node->_child->_sibling))
+         return false;
+      arg1_type = arg2_type = ValueType::Number;
+   }
+   else if (!CompileNode(node->_child, arg1_type) || !CompileNode(node->_child->_sibling, arg2_type) || arg1_type != arg2_type)
+      return false;
+
+   const bool is_number = (arg1_type == ValueType::Number);
+   OpCode op_code;
+   switch (node->_token._type)
+   {
+      case TokenType::OperatorEqual:
+         op_code = (arg1_type == ValueType::String ? OpCode::EqualString : is_number ? OpCode::EqualNumber : OpCode::EqualBool);
+         break;
+      case TokenType::OperatorNotEqual:
+         op_code = (arg1_type == ValueType::String ? OpCode::NotEqualString : is_number ? OpCode::NotEqualNumber : OpCode::NotEqualBool);
+         break;
+      // relational operators are defined for numbers and booleans
+      case TokenType::OperatorLess:
+         op_code = (is_number ? OpCode::LessNumber : OpCode::LessBool);
+         break;
+      case TokenType::OperatorLessOrEqual:
+         op_code = (is_number ? OpCode::LessOrEqualNumber : OpCode::LessOrEqualBool);
+         break;
+      case TokenType::OperatorMore:
+         op_code = (is_number ? OpCode::MoreNumber : OpCode::MoreBool);
+         break;
+      case TokenType::OperatorMoreOrEqual:
+         op_code = (is_number ? OpCode::MoreOrEqualNumber : OpCode::MoreOrEqualBool);
+         break;
+      default:
+         return false;
+   }
+
+   if (arg1_type == ValueType::String && op_code != OpCode::EqualString && op_code != OpCode::NotEqualString)
+      return false;
+
+   Emit(Instruction(op_code), -1);
+   value_type = ValueType::Boolean;
+   return true;
+}
+
+bool ProgramCompiler::CompileLogicalOperator(const ExpressionNode* node, ValueType& value_type)
+{
+   ValueType arg1_type;
+   if (!CompileNode(node->_child, arg1_type) || arg1_type != ValueType::Boolean)
+      return false;
+
+   // the jump target is not known until the right operand is compiled
+   const size_t jump = _program->_instructions.size();
+   Emit(Instruction(node->_token._type == TokenType::OperatorLogicalAnd ? OpCode::JumpIfFalseOrPop : OpCode::JumpIfTrueOrPop), -1);
+
+   ValueType arg2_type;
+   if (!CompileNode(node->_child->_sibling, arg2_type) || arg2_type != ValueType::Boolean)
+      return false;
+
+   _program->_instructions[jump]._operand = static_cast<uint32_t>(_program->_instructions.size());
+   value_type = ValueType::Boolean;
+   return true;
+}
+
+bool ProgramCompiler::CompileArrayComparison(const ExpressionNode* node, ValueType& value_type)
+{
+   if (node->_token._type != TokenType::OperatorEqual && node->_token._type != TokenType::OperatorNotEqual)
+      return false;
+
+   // array items must be literals, so the array set is built here once
+   const auto& array_node = node->_child->_sibling;
+   if (!array_node->_child)
+      return false;
+
+   // numbers are looked up in the sorted array of numbers if all items are number literals
+   bool is_number = IsNumber(node->_child, *_schema);
+   for (auto item = array_node->_child; item; item = item->_sibling)
+   {
+      if (!item->_token.IsLiteral())
+         return false;
+      is_number = is_number && item->_token._type == TokenType::Number;
+   }
+
+   const bool is_equal = (node->_token._type == TokenType::OperatorEqual);
+   if (is_number)
+   {
+      if (!CompileNumber(node->_child))
+         return false;
+
+      std::vector<int64_t> array;
+      for (auto item = array_node->_child; item; item = item->_sibling)
+      {
+         int64_t number = 0;
+         if (!ParseNumber(item->_token.Text(), number))
+            return false;
+         array.push_back(number);
+      }
+      std::sort(array.begin(), array.end());
+      array.erase(std::unique(array.begin(), array.end()), array.end());
+
+      _program->_number_arrays.push_back(std::move(array));
+      Emit(Instruction(is_equal ? OpCode::InNumberArray : OpCode::NotInNumberArray, static_cast<uint32_t>(_program->_number_arrays.size() - 1)), 0);
+      value_type = ValueType::Boolean;
+      return true;
+   }
+
+   ValueType arg1_type;
+   if (!CompileNode(node->_child, arg1_type) || arg1_type != ValueType::String)
+      return false;
+
+   std::vector<std::string> array;
+   for (auto item = array_node->_child; item; item = item->_sibling)
+      array.emplace_back(item->_token._begin, item->_token._end);
+
+   _program->_arrays.emplace_back(std::move(array));
+   Emit(Instruction(is_equal ? OpCode::InArray : OpCode::NotInArray, static_cast<uint32_t>(_program->_arrays.size() - 1)), 0);
+   value_type = ValueType::Boolean;
+   return true;
+}
+
+// the tested value is a string and the prefixes are literals, so the prefix set is built here once
+bool ProgramCompiler::CompilePrefixTest(const ExpressionNode* node, ValueType& value_type)
+{
+   const auto& array_node = node->_child->_sibling;
+   if (array_node->_token._type != TokenType::LSquareBracket || !array_node->_child)
+      return false;
+
+   ValueType arg1_type;
+   if (!CompileNode(node->_child, arg1_type) || arg1_type != ValueType::String)
+      return false;
+
+   std::vector<std::string> prefixes;
+   for (auto item = array_node->_child; item; item = item->_sibling)
+   {
+      if (!item->_token.IsLiteral())
+         return false;
+      prefixes.emplace_back(item->_token._begin, item->_token._end);
+   }
+
+   _program->_prefix_sets.emplace_back(std::move(prefixes));
+   Emit(Instruction(OpCode::InPrefixSet, static_cast<uint32_t>(_program->_prefix_sets.size() - 1)), 0);
+   value_type = ValueType::Boolean;
+   return true;
+}
+
+// the tested value is a number or a string parsed as a number while executing, e.g. SUBSTR{IN.PAN, 0, 6}
+// the ranges are pairs of number literals with inclusive bounds, so the range set is built here once
+bool ProgramCompiler::CompileRangeTest(const ExpressionNode* node, ValueType& value_type)
+{
+   const auto& array_node = node->_child->_sibling;
+   if (array_node->_token._type != TokenType::LSquareBracket || !array_node->_child)
+      return false;
+
+   std::vector<std::pair<int64_t, int64_t>> ranges;
+   for (auto item = array_node->_child; item; item = item->_sibling->_sibling)
+   {
+      int64_t from = 0;
+      int64_t to = 0;
+      if (!item->_sibling || item->_token._type != TokenType::Number || item->_sibling->_token._type != TokenType::Number ||
+          !ParseNumber(item->_token.Text(), from) || !ParseNumber(item->_sibling->_token.Text(), to) || from > to)
+      {
+         return false; // bounds must be pairs of numbers which can be represented exactly
+      }
+      ranges.emplace_back(from, to);
+   }
+
+   ValueType arg1_type;
+   if (!CompileNode(node->_child, arg1_type) || (arg1_type != ValueType::String && arg1_type != ValueType::Number))
+      return false;
+   if (arg1_type == ValueType::String)
+      Emit(Instruction(OpCode::ToNumber), 0);
+
+   _program->_range_sets.emplace_back(std::move(ranges));
+   Emit(Instruction(OpCode::InRangeSet, static_cast<uint32_t>(_program->_range_sets.size() - 1)), 0);
+   value_type = ValueType::Boolean;
+   return true;
+}
+
+// append an instruction to the program, 'stack_change' is the number of values the instruction adds to the stack (negative if it removes)
+void ProgramCompiler::Emit(const Instruction& instruction, const int stack_change)
+{
+   _program->_instructions.push_back(instruction);
+   _stack_depth += stack_change;
+   _program->_max_stack_depth = std::max(_program->_max_stack_depth, _stack_depth);
+}
+
+// add a string constant to the program, equal constants share the same index
+uint32_t ProgramCompiler::AddConstant(const std::string& constant)
+{
+   auto& constants = _program->_constants;
+   auto it = std::find(constants.cbegin(), constants.cend(), constant);
+   if (it != constants.cend())
+      return static_cast<uint32_t>(it - constants.cbegin());
+   constants.push_back(constant);
+   return static_cast<uint32_t>(constants.size() - 1);
+}
+
+// resolve a variable name to its slot in the schema, the name is also kept in the program to look up values by name
+uint32_t ProgramCompiler::AddVariable(const std::string& variable)
+{
+   const uint32_t slot = _schema->AddVariable(variable);
+   auto& variables = _program->_variables;
+   if (variables.size() <= slot)
+   {
+      variables.resize(slot + 1);
+      _program->_variable_types.resize(slot + 1, VariableType::String);
+   }
+   variables[slot] = variable;
+   _program->_variable_types[slot] = _schema->GetVariableType(slot);
+   return slot;
+}
+
+// add a number constant to the program, equal constants share the same index
+uint32_t ProgramCompiler::AddNumber(const int64_t number)
+{
+   auto& numbers = _program->_numbers;
+   auto it = std::find(numbers.cbegin(), numbers.cend(), number);
+   if (it != numbers.cend())
+      return static_cast<uint32_t>(it - numbers.cbegin());
+   numbers.push_back(number);
+   return static_cast<uint32_t>(numbers.size() - 1);
+}
+
+// returns true if the node is a number literal or a variable tagged as a number in the schema,
+// a comparison is a comparison of numbers if both its operands are numbers
+bool ProgramCompiler::IsNumber(const ExpressionNode* node, const VariableSchema& schema)
+{
+   return node->_token._type == TokenType::Number || (node->_token._type == TokenType::Variable && schema.IsNumber(node->_token.ToString()));
+}
+
+// tag variables which are not in the schema yet as numbers if they are compared with a number literal by a relational operator,
+// such a comparison is not defined for strings, so no expression which compiles without the tags changes its meaning
+void ProgramCompiler::InferNumberVariables(const ExpressionNode* node, VariableSchema& schema)
+{
+   for (auto child = node->_child; child; child = child->_sibling)
+      InferNumberVariables(child, schema);
+
+   const auto type = node->_token._type;
+   if (type != TokenType::OperatorLess && type != TokenType::OperatorLessOrEqual && type != TokenType::OperatorMore && type != TokenType::OperatorMoreOrEqual)
+      return;
+
+   const auto& arg1 = node->_child;
+   if (!arg1 || !arg1->_sibling)
+      return;
+   const auto& arg2 = arg1->_sibling;
+   uint32_t slot;
+   if (arg1->_token._type == TokenType::Variable && arg2->_token._type == TokenType::Number && !schema.FindVariable(arg1->_token.ToString(), slot))
+      schema.AddVariable(arg1->_token.ToString(), VariableType::Number);
+   else if (arg2->_token._type == TokenType::Variable && arg1->_token._type == TokenType::Number && !schema.FindVariable(arg2->_token.ToString(), slot))
+      schema.AddVariable(arg2->_token.ToString(), VariableType::Number);
+}
+
+// read a number from a scalar node into the 'number' output parameter
+// 'out_of_range' is set if the number doesn't fit into int
+// returns false if the node is not a scalar number
+bool ProgramCompiler::ReadConstantNumber(const ExpressionNode* node, uint32_t& number, bool& out_of_range)
+{
+   if (!node->_token.IsLiteral())
+      return false;
+
+   int value = 0;
+   switch (ParseInt(node->_token.Text(), value))
+   {
+      case NumberParsing::Ok:
+         // negative numbers become huge positions or lengths, it's the same that std::string::substr does with them
+         number = static_cast<uint32_t>(value);
+         out_of_range = false;
+         return true;
+      case NumberParsing::OutOfRange:
+         out_of_range = true;
+         return true;
+      default:
+         return false;
+   }
+}
+}
@@ -0,0 +1,163 @@
+#pragma once
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+#include "common.h"
+#include "prefix_set.h"
+#include "range_set.h"
+#include "string_set.h"
+#include "variable_schema.h"
+
+// This is a flat form of a parsed expression: the syntax tree built by ExpressionParser is compiled by ProgramCompiler
+// into a contiguous array of instructions of a simple stack machine, which is executed by ExpressionProgram::Execute in a single loop.
+// Logical operators are compiled into conditional jumps, so the right operand of && and || is skipped when the left one decides the result.
+// Types of all values are checked at compile time, so there are no type checks while executing.
+// Number literals are converted to the fixed-point form at compile time, so comparisons of numbers are comparisons of integers,
+// only values of variables tagged as numbers and values tested by IN RANGES are parsed while executing.
+namespace Renaissance
+{
+enum class OpCode : uint8_t
+{
+   PushBool,           // push boolean constant, operand - 0 or 1
+   PushConstant,       // push string constant, operand - constant index
+   PushVariable,       // push variable value, operand - variable slot
+   PushNumber,         // push number constant, operand - number index
+   PushNumberVariable, // push variable value parsed as a number, operand - variable slot
+   Substr,             // replace string on top with its substring, operand - from, operand2 - length
+   SubstrDynamic,      // pop length, from and source string and push the substring
+   EqualString,        // pop two strings and push the comparison result
+   NotEqualString,
+   EqualBool,          // pop two booleans and push the comparison result
+   NotEqualBool,
+   LessBool,
+   LessOrEqualBool,
+   MoreBool,
+   MoreOrEqualBool,
+   EqualNumber,        // pop two numbers and push the comparison result
+   NotEqualNumber,
+   LessNumber,
+   LessOrEqualNumber,
+   MoreNumber,
+   MoreOrEqualNumber,
+   InArray,            // replace string on top with a boolean whether it's in the array set, operand - array index
+   NotInArray,
+   InNumberArray,      // replace number on top with a boolean whether it's in the sorted array, operand - number array index
+   NotInNumberArray,
+   ToNumber,           // replace string on top with it parsed as a number
+   InPrefixSet,        // replace string on top with a boolean whether it starts with any prefix of the set, operand - prefix set index
+   InRangeSet,         // replace number on top with a boolean whether it's within any range of the set, operand - range set index
+   JumpIfFalseOrPop,   // jump to operand keeping the boolean on top if it's false, pop it otherwise
+   JumpIfTrueOrPop,    // jump to operand keeping the boolean on top if it's true, pop it otherwise
+};
+
+struct Instruction
+{
+   OpCode _op_code;
+   uint32_t _operand;
+   uint32_t _operand2;
+
+   Instruction() = default;
+   Instruction(const OpCode op_code, const uint32_t operand = 0, const uint32_t operand2 = 0) : _op_code(op_code), _operand(operand), _operand2(operand2) {}
+};
+
+class ExpressionProgram
+{
+public:
+   ExpressionProgram() = default;
+   ExpressionProgram(const ExpressionProgram&) = delete;
+   ExpressionProgram(ExpressionProgram&&) = delete;
+   ExpressionProgram& operator =(const ExpressionProgram&) = delete;
+   ExpressionProgram& operator =(ExpressionProgram&&) = delete;
+   ~ExpressionProgram() = default;
+
+   bool Execute(const VariableValues& variable_values, bool& result) const;
+   bool Execute(const VariableRecord& variable_record, bool& result) const;
+
+   bool IsNumberVariable(const std::string& variable) const;
+
+   inline const std::vector<Instruction>& Instructions() const noexcept { return _instructions; }
+   inline const std::vector<std::string>& Constants() const noexcept { return _constants; }
+   inline const std::vector<int64_t>& Numbers() const noexcept { return _numbers; }
+   inline const std::vector<StringSet>& Arrays() const noexcept { return _arrays; }
+   inline const std::vector<std::vector<int64_t>>& NumberArrays() const noexcept { return _number_arrays; }
+   inline const std::vector<PrefixSet>& PrefixSets() const noexcept { return _prefix_sets; }
+   inline const std::vector<RangeSet>& RangeSets() const noexcept { return _range_sets; }
+
+   // the program interface of ExecuteProgram
+   inline size_t InstructionsNumber() const noexcept { return _instructions.size(); }
+   inline const Instruction& GetInstruction(const size_t index) const { return _instructions[index]; }
+   inline StringView Constant(const uint32_t index) const { return _constants[index]; }
+   inline int64_t Number(const uint32_t index) const { return _numbers[index]; }
+   inline bool ArrayContains(const uint32_t index, const StringView& value) const { return _arrays[index].Contains(value); }
+   inline bool NumberArrayContains(const uint32_t index, const int64_t number) const
+   {
+      return std::binary_search(_number_arrays[index].cbegin(), _number_arrays[index].cend(), number);
+   }
+   inline bool PrefixSetContains(const uint32_t index, const StringView& value) const { return _prefix_sets[index].Contains(value); }
+   inline bool RangeSetContains(const uint32_t index, const int64_t number) const { return _range_sets[index].Contains(number); }
+   inline size_t MaxStackDepth() const noexcept { return _max_stack_depth; }
+
+private:
+   friend class ProgramCompiler;
+
+   std::vector<Instruction> _instructions;
+   std::vector<std::string> _constants;
+   std::vector<std::string> _variables; // variable names indexed by their slots, used to look up values by name
+   std::vector<VariableType> _variable_types;
+   std::vector<int64_t> _numbers;
+
+   std::vector<StringSet> _arrays;
+   std::vector<std::vector<int64_t>> _number_arrays;
+   std::vector<PrefixSet> _prefix_sets;
+   std::vector<RangeSet> _range_sets;
+   size_t _max_stack_depth = 0;
+};
+
+class ProgramCompiler
+{
+public:
+   ProgramCompiler() = default;
+   ProgramCompiler(const ProgramCompiler&) = delete;
+   ProgramCompiler(ProgramCompiler&&) = delete;
+   ProgramCompiler& operator =(const ProgramCompiler&) = delete;
+   ProgramCompiler& operator =(ProgramCompiler&&) = delete;
+   ~ProgramCompiler() = default;
+
+   bool Compile(const ExpressionNode* root, ExpressionProgram& program);
+   bool Compile(const ExpressionNode* root, VariableSchema& schema, ExpressionProgram& program);
+
+   static bool IsNumber(const ExpressionNode* node, const VariableSchema& schema);
+   static void InferNumberVariables(const ExpressionNode* node, VariableSchema& schema);
+
+private:
+   enum class ValueType
+   {
+      Boolean,
+      String,
+      Number
+   };
+
+   ExpressionProgram* _program = nullptr;
+   VariableSchema* _schema = nullptr;
+   size_t _stack_depth = 0;
+
+   bool CompileNode(const ExpressionNode* node, ValueType& value_type);
+   bool CompileBoolean(const ExpressionNode* node, ValueType& value_type);
+   bool CompileScalar(const ExpressionNode* node, ValueType& value_type);
+   bool CompileVariable(const ExpressionNode* node, ValueType& value_type);
+   bool CompileNumber(const ExpressionNode* node);
+   bool CompileFunction(const ExpressionNode* node, ValueType& value_type);
+   bool CompileOperator(const ExpressionNode* node, ValueType& value_type);
+   bool CompileLogicalOperator(const ExpressionNode* node, ValueType& value_type);
+   bool CompileArrayComparison(const ExpressionNode* node, ValueType& value_type);
+   bool CompilePrefixTest(const ExpressionNode* node, ValueType& value_type);
+   bool CompileRangeTest(const ExpressionNode* node, ValueType& value_type);
+
+   void Emit(const Instruction& instruction, const int stack_change);
+   uint32_t AddConstant(const std::string& constant);
+   uint32_t AddVariable(const std::string& variable);
+   uint32_t AddNumber(const int64_t number);
+   static bool ReadConstantNumber(const ExpressionNode* node, uint32_t& number, bool& out_of_range);
+};
+}
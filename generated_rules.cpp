@@ -0,0 +1,60 @@
+#include "generated_rules.h"
+#include <dlfcn.h>
+
+namespace Renaissance
+{
+GeneratedRuleRegistry::~GeneratedRuleRegistry()
+{
+   for (void* library : _libraries)
+      dlclose(library);
+}
+
+// add all rules of the rule set, the rule set must outlive the registry
+// returns false if some rule id is registered already, nothing is added then
+bool GeneratedRuleRegistry::Register(const GeneratedRuleSet& rule_set)
+{
+   for (size_t i = 0; i < rule_set._rules_number; i++)
+   {
+      if (_rules.count(rule_set._rules[i]._id) != 0)
+         return false;
+   }
+
+   for (size_t i = 0; i < rule_set._rules_number; i++)
+      _rules.emplace(rule_set._rules[i]._id, std::make_pair(&rule_set._rules[i], &rule_set));
+   return true;
+}
+
+// load a shared object built of a generated file and register its rules, 'symbol' is the name of the function the file exports
+// the library stays loaded until the registry is destroyed
+// returns true if successful
+bool GeneratedRuleRegistry::Load(const std::string& library_path, const std::string& symbol)
+{
+   void* library = dlopen(library_path.c_str(), RTLD_NOW | RTLD_LOCAL);
+   if (library == nullptr)
+      return false;
+
+   const auto getter = reinterpret_cast<GeneratedRuleSetGetter>(dlsym(library, symbol.c_str()));
+   const GeneratedRuleSet* rule_set = (getter != nullptr ? getter() : nullptr);
+   if (rule_set == nullptr || !Register(*rule_set))
+   {
+      dlclose(library);
+      return false;
+   }
+
+   _libraries.push_back(library);
+   return true;
+}
+
+// find the rule by its id and the rule set it belongs to, the rule set gives slots of variables the rule takes
+// returns true if found
+bool GeneratedRuleRegistry::FindRule(const std::string& rule_id, const GeneratedRule*& rule, const GeneratedRuleSet*& rule_set) const
+{
+   const auto it = _rules.find(rule_id);
+   if (it == _rules.end())
+      return false;
+
+   rule = it->second.first;
+   rule_set = it->second.second;
+   return true;
+}
+}
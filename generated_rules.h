@@ -0,0 +1,85 @@
+#pragma once
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "common.h"
+#include "prefix_set.h"
+#include "range_set.h"
+#include "string_functions.h"
+
+// This is the interface of rules compiled ahead of time by the rule_compiler tool into C++ functions (see RuleCodeGenerator).
+// Every generated file defines a GeneratedRuleSet with its rules and variables and exports an extern "C" function returning it,
+// so it might be compiled into a binary or into a shared object loaded with GeneratedRuleRegistry::Load.
+// Generated functions take a VariableRecord with values of the rule set variables by their slots
+// and give exactly the same results as ExpressionEvaluator, including evaluation failures.
+namespace Renaissance
+{
+typedef bool (*GeneratedRuleFunction)(const VariableRecord& variable_record, bool& result);
+
+struct GeneratedRule
+{
+   const char* _id;
+   const char* _expression;
+   GeneratedRuleFunction _function;
+};
+
+struct GeneratedRuleSet
+{
+   const GeneratedRule* _rules;
+   size_t _rules_number;
+   const char* const* _variables; // variable names indexed by their slots
+   size_t _variables_number;
+};
+
+typedef const GeneratedRuleSet* (*GeneratedRuleSetGetter)();
+
+// the name of the function a generated file exports by default
+const char* const DefaultGeneratedRuleSetSymbol = "GetGeneratedRuleSet";
+
+// helpers the generated code is built of
+inline bool GetRecordValue(const VariableRecord& variable_record, const size_t slot, StringView& value)
+{
+   if (slot >= variable_record.size() || variable_record[slot].data() == nullptr)
+      return false; // variable is mentioned in the expression but no corresponding value is passed
+   value = variable_record[slot];
+   return true;
+}
+
+inline bool SubstringDynamic(const StringView& value, const StringView& from, const StringView& length, StringView& substring)
+{
+   int from_number = 0;
+   int length_number = 0;
+   const NumberParsing from_parsing = ParseInt(from, from_number);
+   const NumberParsing length_parsing = ParseInt(length, length_number);
+   if (from_parsing == NumberParsing::Invalid || length_parsing == NumberParsing::Invalid)
+      return false; // function argument is not a number
+
+   if (from_parsing == NumberParsing::OutOfRange || length_parsing == NumberParsing::OutOfRange)
+      substring = StringView(value.data(), 0);
+   else
+      substring = Substring(value, static_cast<size_t>(from_number), static_cast<size_t>(length_number));
+   return true;
+}
+
+// rules of generated rule sets by their ids
+class GeneratedRuleRegistry
+{
+public:
+   GeneratedRuleRegistry() = default;
+   GeneratedRuleRegistry(const GeneratedRuleRegistry&) = delete;
+   GeneratedRuleRegistry(GeneratedRuleRegistry&&) = delete;
+   GeneratedRuleRegistry& operator =(const GeneratedRuleRegistry&) = delete;
+   GeneratedRuleRegistry& operator =(GeneratedRuleRegistry&&) = delete;
+   ~GeneratedRuleRegistry();
+
+   bool Register(const GeneratedRuleSet& rule_set);
+   bool Load(const std::string& library_path, const std::string& symbol = DefaultGeneratedRuleSetSymbol);
+   bool FindRule(const std::string& rule_id, const GeneratedRule*& rule, const GeneratedRuleSet*& rule_set) const;
+
+   inline size_t RulesNumber() const noexcept { return _rules.size(); }
+
+private:
+   std::unordered_map<std::string, std::pair<const GeneratedRule*, const GeneratedRuleSet*>> _rules;
+   std::vector<void*> _libraries;
+};
+}
@@ -0,0 +1,25 @@
+#include "prefix_set.h"
+#include <algorithm>
+
+namespace Renaissance
+{
+// build the set from the array items, duplicated items and items starting with other items are removed
+PrefixSet::PrefixSet(std::vector<std::string> items)
+{
+   std::sort(items.begin(), items.end());
+   items.erase(std::unique(items.begin(), items.end()), items.end());
+
+   // all items starting with an item follow it in the sorted order
+   for (auto& item : items)
+   {
+      if (_items.empty() || !StringView(item).starts_with(_items.back()))
+         _items.push_back(std::move(item));
+   }
+}
+
+// returns true if the value starts with any of the set items
+bool PrefixSet::Contains(const StringView& value) const noexcept
+{
+   return Contains(value, _items.size(), [this](const size_t index) { return StringView(_items[index]); });
+}
+}
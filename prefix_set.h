@@ -0,0 +1,54 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "common.h"
+
+namespace Renaissance
+{
+// This is an immutable set of prefixes built once from an array literal, it's used for 'PREFIX [...]' operators, e.g. tables of BINs.
+// Items are sorted and items starting with another item are removed, as they never change the result,
+// so the only item which might be a prefix of a value is the greatest item not greater than the value and a lookup is a single binary search.
+// Lookups are done by a string view and never allocate.
+class PrefixSet
+{
+public:
+   PrefixSet() = default;
+   explicit PrefixSet(std::vector<std::string> items);
+   PrefixSet(const PrefixSet&) = default;
+   PrefixSet(PrefixSet&&) = default;
+   PrefixSet& operator =(const PrefixSet&) = default;
+   PrefixSet& operator =(PrefixSet&&) = default;
+   ~PrefixSet() = default;
+
+   bool Contains(const StringView& value) const noexcept;
+
+   inline size_t Size() const noexcept { return _items.size(); }
+   inline const std::vector<std::string>& Items() const noexcept { return _items; }
+
+   // the lookup over the sorted items, it's shared with sets mapped from a rule set image (see RuleSetImage) and generated rules
+   // 'item' returns the item with the given index as a string view
+   // returns true if the value starts with any of the items
+   template <typename ItemGetter>
+   static bool Contains(const StringView& value, const size_t items_number, const ItemGetter& item) noexcept
+   {
+      // search for the first item greater than the value
+      size_t first = 0;
+      size_t count = items_number;
+      while (count > 0)
+      {
+         const size_t half = count / 2;
+         if (item(first + half) <= value)
+         {
+            first += half + 1;
+            count -= half + 1;
+         }
+         else
+            count = half;
+      }
+      return first != 0 && value.starts_with(item(first - 1));
+   }
+
+private:
+   std::vector<std::string> _items;
+};
+}
@@ -0,0 +1,214 @@
+#pragma once
+#include <vector>
+#include "common.h"
+#include "expression_program.h"
+#include "string_functions.h"
+
+// The stack machine loop which executes instructions of an ExpressionProgram. It's a template over the program,
+// so the same loop executes programs owning their data and programs mapped from a rule set image (see RuleSetImage).
+// A program provides InstructionsNumber(), GetInstruction(index), Constant(index), Number(index), ArrayContains(index, value),
+// NumberArrayContains(index, number), PrefixSetContains(index, value), RangeSetContains(index, number) and MaxStackDepth().
+namespace Renaissance
+{
+// values are views into the program constants or into the variable values passed for execution,
+// substrings are views into their source strings, so the execution doesn't allocate memory
+struct ProgramValue
+{
+   bool _bool_value;
+   StringView _string_value;
+   int64_t _number_value;
+};
+
+// provides values of variables by their slots from a variable record
+class VariableRecordSource
+{
+public:
+   explicit VariableRecordSource(const VariableRecord& variable_record) : _variable_record(variable_record) {}
+
+   inline bool GetValue(const uint32_t slot, StringView& value) const
+   {
+      if (slot >= _variable_record.size() || _variable_record[slot].data() == nullptr)
+         return false;
+      value = _variable_record[slot];
+      return true;
+   }
+
+private:
+   const VariableRecord& _variable_record;
+};
+
+// stack size which is enough for most of expressions, so it's allocated on the execution thread stack
+constexpr size_t ProgramLocalStackSize = 32;
+
+// execute the program with variables values provided by the 'variable_source'
+// execution result will be returned in the output parameter 'result'
+// returns true if successful
+template <typename Program, typename VariableSource>
+bool ExecuteProgram(const Program& program, const VariableSource& variable_source, bool& result)
+{
+   result = false;
+
+   // the stack is allocated on the heap only for really deep expressions
+   ProgramValue local_stack[ProgramLocalStackSize];
+   std::vector<ProgramValue> heap_stack;
+   ProgramValue* stack = local_stack;
+   if (program.MaxStackDepth() > ProgramLocalStackSize)
+   {
+      heap_stack.resize(program.MaxStackDepth());
+      stack = heap_stack.data();
+   }
+   size_t top = 0; // number of values on the stack
+
+   const size_t instructions_number = program.InstructionsNumber();
+   size_t current = 0;
+   while (current < instructions_number)
+   {
+      const Instruction& instruction = program.GetInstruction(current++);
+      switch (instruction._op_code)
+      {
+         case OpCode::PushBool:
+            stack[top++]._bool_value = (instruction._operand != 0);
+            break;
+         case OpCode::PushConstant:
+            stack[top++]._string_value = program.Constant(instruction._operand);
+            break;
+         case OpCode::PushVariable:
+            if (!variable_source.GetValue(instruction._operand, stack[top++]._string_value))
+               return false; // variable is mentioned in the expression but no corresponding value is passed
+            break;
+         case OpCode::PushNumber:
+            stack[top++]._number_value = program.Number(instruction._operand);
+            break;
+         case OpCode::PushNumberVariable:
+         {
+            StringView value;
+            if (!variable_source.GetValue(instruction._operand, value))
+               return false; // variable is mentioned in the expression but no corresponding value is passed
+            if (!ParseNumber(value, stack[top++]._number_value))
+               return false; // variable value is not a number
+            break;
+         }
+         case OpCode::Substr:
+            stack[top - 1]._string_value = Substring(stack[top - 1]._string_value, instruction._operand, instruction._operand2);
+            break;
+         case OpCode::SubstrDynamic:
+         {
+            int from = 0;
+            int length = 0;
+            const NumberParsing from_parsing = ParseInt(stack[top - 2]._string_value, from);
+            const NumberParsing length_parsing = ParseInt(stack[top - 1]._string_value, length);
+            if (from_parsing == NumberParsing::Invalid || length_parsing == NumberParsing::Invalid)
+               return false; // function argument is not a number
+
+            StringView& value = stack[top - 3]._string_value;
+            if (from_parsing == NumberParsing::OutOfRange || length_parsing == NumberParsing::OutOfRange)
+               value = StringView(value.data(), 0);
+            else
+               value = Substring(value, static_cast<size_t>(from), static_cast<size_t>(length));
+            top -= 2;
+            break;
+         }
+         case OpCode::EqualString:
+            --top;
+            stack[top - 1]._bool_value = (stack[top - 1]._string_value == stack[top]._string_value);
+            break;
+         case OpCode::NotEqualString:
+            --top;
+            stack[top - 1]._bool_value = (stack[top - 1]._string_value != stack[top]._string_value);
+            break;
+         case OpCode::EqualBool:
+            --top;
+            stack[top - 1]._bool_value = (stack[top - 1]._bool_value == stack[top]._bool_value);
+            break;
+         case OpCode::NotEqualBool:
+            --top;
+            stack[top - 1]._bool_value = (stack[top - 1]._bool_value != stack[top]._bool_value);
+            break;
+         case OpCode::LessBool:
+            --top;
+            stack[top - 1]._bool_value = (stack[top - 1]._bool_value < stack[top]._bool_value);
+            break;
+         case OpCode::LessOrEqualBool:
+            --top;
+            stack[top - 1]._bool_value = (stack[top - 1]._bool_value <= stack[top]._bool_value);
+            break;
+         case OpCode::MoreBool:
+            --top;
+            stack[top - 1]._bool_value = (stack[top - 1]._bool_value > stack[top]._bool_value);
+            break;
+         case OpCode::MoreOrEqualBool:
+            --top;
+            stack[top - 1]._bool_value = (stack[top - 1]._bool_value >= stack[top]._bool_value);
+            break;
+         case OpCode::EqualNumber:
+            --top;
+            stack[top - 1]._bool_value = (stack[top - 1]._number_value == stack[top]._number_value);
+            break;
+         case OpCode::NotEqualNumber:
+            --top;
+            stack[top - 1]._bool_value = (stack[top - 1]._number_value != stack[top]._number_value);
+            break;
+         case OpCode::LessNumber:
+            --top;
+            stack[top - 1]._bool_value = (stack[top - 1]._number_value < stack[top]._number_value);
+            break;
+         case OpCode::LessOrEqualNumber:
+            --top;
+            stack[top - 1]._bool_value = (stack[top - 1]._number_value <= stack[top]._number_value);
+            break;
+         case OpCode::MoreNumber:
+            --top;
+            stack[top - 1]._bool_value = (stack[top - 1]._number_value > stack[top]._number_value);
+            break;
+         case OpCode::MoreOrEqualNumber:
+            --top;
+            stack[top - 1]._bool_value = (stack[top - 1]._number_value >= stack[top]._number_value);
+            break;
+         case OpCode::InArray:
+         case OpCode::NotInArray:
+         {
+            const bool found = program.ArrayContains(instruction._operand, stack[top - 1]._string_value);
+            stack[top - 1]._bool_value = (instruction._op_code == OpCode::InArray ? found : !found);
+            break;
+         }
+         case OpCode::InNumberArray:
+         case OpCode::NotInNumberArray:
+         {
+            const bool found = program.NumberArrayContains(instruction._operand, stack[top - 1]._number_value);
+            stack[top - 1]._bool_value = (instruction._op_code == OpCode::InNumberArray ? found : !found);
+            break;
+         }
+         case OpCode::ToNumber:
+            if (!ParseNumber(stack[top - 1]._string_value, stack[top - 1]._number_value))
+               return false; // value is not a number
+            break;
+         case OpCode::InPrefixSet:
+            stack[top - 1]._bool_value = program.PrefixSetContains(instruction._operand, stack[top - 1]._string_value);
+            break;
+         case OpCode::InRangeSet:
+            stack[top - 1]._bool_value = program.RangeSetContains(instruction._operand, stack[top - 1]._number_value);
+            break;
+         case OpCode::JumpIfFalseOrPop:
+            if (!stack[top - 1]._bool_value)
+               current = instruction._operand;
+            else
+               --top;
+            break;
+         case OpCode::JumpIfTrueOrPop:
+            if (stack[top - 1]._bool_value)
+               current = instruction._operand;
+            else
+               --top;
+            break;
+         default:
+            return false; // unknown instruction
+      }
+   }
+
+   if (top != 1)
+      return false;
+
+   result = stack[0]._bool_value;
+   return true;
+}
+}
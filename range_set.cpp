@@ -0,0 +1,23 @@
+#include "range_set.h"
+#include <algorithm>
+
+namespace Renaissance
+{
+// build the set from ranges given by their inclusive bounds, a range must not have its lower bound greater than the upper one
+RangeSet::RangeSet(std::vector<std::pair<int64_t, int64_t>> ranges)
+{
+   std::sort(ranges.begin(), ranges.end());
+
+   // ranges are merged with the previous one if they overlap
+   for (const auto& range : ranges)
+   {
+      if (!_bounds.empty() && range.first <= _bounds.back())
+         _bounds.back() = std::max(_bounds.back(), range.second);
+      else
+      {
+         _bounds.push_back(range.first);
+         _bounds.push_back(range.second);
+      }
+   }
+}
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace Renaissance
+{
+// This is an immutable set of number ranges built once from an array literal, it's used for 'IN RANGES [...]' operators, e.g. BIN range tables.
+// Overlapping ranges are merged, so the ranges are disjoint and their bounds make a single sorted array 'from0, to0, from1, to1, ...',
+// a number is within a range if the first bound greater than the number is the upper bound of a range or the number is equal to the bound before it,
+// so a lookup is a single binary search over a flat array of numbers.
+class RangeSet
+{
+public:
+   RangeSet() = default;
+   explicit RangeSet(std::vector<std::pair<int64_t, int64_t>> ranges);
+   RangeSet(const RangeSet&) = default;
+   RangeSet(RangeSet&&) = default;
+   RangeSet& operator =(const RangeSet&) = default;
+   RangeSet& operator =(RangeSet&&) = default;
+   ~RangeSet() = default;
+
+   inline bool Contains(const int64_t number) const noexcept { return Contains(number, _bounds.data(), _bounds.size()); }
+
+   inline size_t Size() const noexcept { return _bounds.size() / 2; }
+   inline const std::vector<int64_t>& Bounds() const noexcept { return _bounds; }
+
+   // the lookup over the sorted bounds, it's shared with sets mapped from a rule set image (see RuleSetImage) and generated rules
+   // returns true if the number is within any of the ranges, both bounds are inclusive
+   static inline bool Contains(const int64_t number, const int64_t* bounds, const size_t bounds_number) noexcept
+   {
+      // search for the first bound greater than the number
+      size_t first = 0;
+      size_t count = bounds_number;
+      while (count > 0)
+      {
+         const size_t half = count / 2;
+         if (bounds[first + half] <= number)
+         {
+            first += half + 1;
+            count -= half + 1;
+         }
+         else
+            count = half;
+      }
+      return (first % 2) != 0 || (first != 0 && bounds[first - 1] == number);
+   }
+
+private:
+   std::vector<int64_t> _bounds;
+};
+}
@@ -0,0 +1,397 @@
+#include "rule_code_generator.h"
+#include <cstdio>
+#include <limits>
+#include <map>
+#include <set>
+#include "expression_optimizer.h"
+#include "expression_program.h"
+#include "prefix_set.h"
+#include "range_set.h"
+#include "string_functions.h"
+
+namespace Renaissance
+{
+// add a rule to generate a function for, the rule must be a valid expression and its id must be unique
+// returns true if successful
+bool RuleCodeGenerator::AddRule(const std::string& rule_id, const std::string& expression)
+{
+   if (_rule_ids.count(rule_id) != 0)
+      return false;
+
+   // trees of the previous rule are released, so their memory is reused
+   _arena.release();
+   ExpressionTree expression_tree;
+   std::shared_ptr<const std::string> source;
+   if (!_parser.Parse(expression, expression_tree, source))
+      return false;
+
+   // variables of a failed rule don't get into the schema
+   VariableSchema schema = _schema;
+   Rule rule;
+   rule._id = rule_id;
+   rule._expression = expression;
+   if (expression_tree.empty())
+      rule._body = "   result = true; // empty expression is a true statement\n   return true;\n";
+   else
+   {
+      // the original tree is compiled first to check it, so optimizations never make an invalid expression valid
+      ExpressionProgram program;
+      ProgramCompiler compiler;
+      if (!compiler.Compile(expression_tree.top(), schema, program))
+         return false;
+
+      ExpressionOptimizer optimizer(&_arena);
+      _rule_schema = &schema;
+      _temporaries_number = 0;
+      std::string value;
+      const bool generated = GenerateBoolean(optimizer.Optimize(expression_tree.top()), "   ", rule._body, value);
+      _rule_schema = nullptr;
+      if (!generated)
+         return false;
+      rule._body += "   result = " + value + ";\n   return true;\n";
+   }
+
+   _schema = std::move(schema);
+   _rule_ids.insert(rule_id);
+   _rules.push_back(std::move(rule));
+   return true;
+}
+
+// generate the source code of all added rules, the code defines a GeneratedRuleSet returned by extern "C" function 'symbol'
+void RuleCodeGenerator::Generate(const std::string& symbol, std::string& code) const
+{
+   code = "// generated by rule_compiler, do not edit\n"
+          "#include \"generated_rules.h\"\n"
+          "\n"
+          "namespace\n"
+          "{\n"
+          "using namespace Renaissance;\n";
+
+   for (size_t i = 0; i < _rules.size(); i++)
+   {
+      code += "\n// " + MakeLiteral(_rules[i]._id) + "\n";
+      code += "bool Rule" + std::to_string(i) + "(const VariableRecord& record, bool& result)\n{\n";
+      code += "   result = false;\n";
+      code += _rules[i]._body;
+      code += "}\n";
+   }
+
+   // arrays can't be empty, so they get a dummy item
+   code += "\nconst char* const Variables[] = {";
+   for (size_t slot = 0; slot < _schema.Size(); slot++)
+      code += (slot == 0 ? "" : ", ") + MakeLiteral(_schema.VariableName(static_cast<uint32_t>(slot)));
+   code += (_schema.Size() == 0 ? "nullptr};\n" : "};\n");
+
+   code += "const GeneratedRule Rules[] = {";
+   for (size_t i = 0; i < _rules.size(); i++)
+      code += std::string(i == 0 ? "" : ",") + "\n   {" + MakeLiteral(_rules[i]._id) + ", " + MakeLiteral(_rules[i]._expression) + ", Rule" + std::to_string(i) + "}";
+   code += (_rules.empty() ? "{nullptr, nullptr, nullptr}};\n" : "};\n");
+
+   code += "const GeneratedRuleSet RuleSet = {Rules, " + std::to_string(_rules.size()) + ", Variables, " + std::to_string(_schema.Size()) + "};\n";
+   code += "}\n\n";
+   code += "extern \"C\" const Renaissance::GeneratedRuleSet* " + symbol + "()\n{\n   return &RuleSet;\n}\n";
+}
+
+// generate code evaluating a boolean node, 'value' gets the expression of the result
+// returns true if successful
+bool RuleCodeGenerator::GenerateBoolean(const ExpressionNode* node, const std::string& indent, std::string& code, std::string& value)
+{
+   switch (node->_token._type)
+   {
+      case TokenType::True:
+         value = "true";
+         return true;
+      case TokenType::False:
+         value = "false";
+         return true;
+      case TokenType::OperatorLogicalAnd:
+      case TokenType::OperatorLogicalOr:
+      {
+         // the second operand is evaluated only if the first one doesn't decide the result
+         std::string value1;
+         if (!GenerateBoolean(node->_child, indent, code, value1))
+            return false;
+         value = MakeTemporary("b");
+         code += indent + "bool " + value + " = " + value1 + ";\n";
+         code += indent + (node->_token._type == TokenType::OperatorLogicalAnd ? "if (" : "if (!") + value + ")\n" + indent + "{\n";
+         std::string value2;
+         if (!GenerateBoolean(node->_child->_sibling, indent + "   ", code, value2))
+            return false;
+         code += indent + "   " + value + " = " + value2 + ";\n" + indent + "}\n";
+         return true;
+      }
+      default:
+         break;
+   }
+
+   if (!node->_token.IsOperator() || !node->_child || !node->_child->_sibling)
+      return false;
+
+   if (node->_token._type == TokenType::OperatorPrefix || node->_token._type == TokenType::OperatorInRanges)
+      return GenerateTableTest(node, indent, code, value);
+
+   const auto& arg2 = node->_child->_sibling;
+   if (arg2->_token._type == TokenType::LSquareBracket)
+      return GenerateSetTest(node, indent, code, value);
+
+   std::string value1;
+   std::string value2;
+   if (IsBoolean(node->_child))
+   {
+      if (!GenerateBoolean(node->_child, indent, code, value1) || !GenerateBoolean(arg2, indent, code, value2))
+         return false;
+   }
+   else
+   {
+      // only equality comparisons are defined for strings
+      if ((node->_token._type != TokenType::OperatorEqual && node->_token._type != TokenType::OperatorNotEqual) ||
+          !GenerateString(node->_child, indent, code, value1) || !GenerateString(arg2, indent, code, value2))
+      {
+         return false;
+      }
+   }
+
+   const char* comparison = nullptr;
+   switch (node->_token._type)
+   {
+      case TokenType::OperatorEqual:
+         comparison = " == ";
+         break;
+      case TokenType::OperatorNotEqual:
+         comparison = " != ";
+         break;
+      case TokenType::OperatorLess:
+         comparison = " < ";
+         break;
+      case TokenType::OperatorLessOrEqual:
+         comparison = " <= ";
+         break;
+      case TokenType::OperatorMore:
+         comparison = " > ";
+         break;
+      default:
+         comparison = " >= ";
+         break;
+   }
+
+   value = MakeTemporary("b");
+   code += indent + "const bool " + value + " = (" + value1 + comparison + value2 + ");\n";
+   return true;
+}
+
+// generate code testing whether a string is one of the array items, items are grouped by their length
+// returns true if successful
+bool RuleCodeGenerator::GenerateSetTest(const ExpressionNode* node, const std::string& indent, std::string& code, std::string& value)
+{
+   if (node->_token._type != TokenType::OperatorEqual && node->_token._type != TokenType::OperatorNotEqual)
+      return false;
+
+   std::map<size_t, std::set<std::string>> items;
+   for (auto item = node->_child->_sibling->_child; item; item = item->_sibling)
+   {
+      if (!item->_token.IsLiteral())
+         return false;
+      const std::string text = item->_token.ToString();
+      items[text.size()].insert(text);
+   }
+
+   std::string tested;
+   if (!GenerateString(node->_child, indent, code, tested))
+      return false;
+
+   const std::string string_value = MakeTemporary("s");
+   value = MakeTemporary("b");
+   code += indent + "const StringView " + string_value + " = " + tested + ";\n";
+   code += indent + "bool " + value + " = false;\n";
+   code += indent + "switch (" + string_value + ".size())\n" + indent + "{\n";
+   for (const auto& length_items : items)
+   {
+      code += indent + "   case " + std::to_string(length_items.first) + ":\n";
+      code += indent + "      " + value + " = ";
+      bool is_first = true;
+      for (const auto& item : length_items.second)
+      {
+         code += std::string(is_first ? "" : " || ") + string_value + " == " + MakeStringView(item);
+         is_first = false;
+      }
+      code += ";\n" + indent + "      break;\n";
+   }
+   code += indent + "   default:\n" + indent + "      break;\n" + indent + "}\n";
+
+   if (node->_token._type == TokenType::OperatorNotEqual)
+      code += indent + value + " = !" + value + ";\n";
+   return true;
+}
+
+// generate code looking a value up in a static table of prefixes or ranges, the table is sorted the same way the program compiler sorts it
+// returns true if successful
+bool RuleCodeGenerator::GenerateTableTest(const ExpressionNode* node, const std::string& indent, std::string& code, std::string& value)
+{
+   const auto& array_node = node->_child->_sibling;
+   if (array_node->_token._type != TokenType::LSquareBracket || !array_node->_child)
+      return false;
+
+   std::string tested;
+   if (!GenerateString(node->_child, indent, code, tested))
+      return false;
+
+   const std::string table = MakeTemporary("t");
+   value = MakeTemporary("b");
+   if (node->_token._type == TokenType::OperatorPrefix)
+   {
+      std::vector<std::string> items;
+      for (auto item = array_node->_child; item; item = item->_sibling)
+      {
+         if (!item->_token.IsLiteral())
+            return false;
+         items.push_back(item->_token.ToString());
+      }
+
+      const PrefixSet set(std::move(items));
+      code += indent + "static const StringView " + table + "[] = {";
+      for (size_t i = 0; i < set.Size(); i++)
+         code += (i == 0 ? "" : ", ") + MakeStringView(set.Items()[i]);
+      code += "};\n";
+      code += indent + "const bool " + value + " = PrefixSet::Contains(" + tested + ", " + std::to_string(set.Size()) + ", [](const size_t index) { return " + table + "[index]; });\n";
+      return true;
+   }
+
+   std::vector<std::pair<int64_t, int64_t>> ranges;
+   for (auto item = array_node->_child; item; item = item->_sibling->_sibling)
+   {
+      int64_t from = 0;
+      int64_t to = 0;
+      if (!item->_sibling || item->_token._type != TokenType::Number || item->_sibling->_token._type != TokenType::Number ||
+          !ParseNumber(item->_token.Text(), from) || !ParseNumber(item->_sibling->_token.Text(), to) || from > to)
+      {
+         return false;
+      }
+      ranges.emplace_back(from, to);
+   }
+
+   // the tested string is parsed as a number, the same way ToNumber instruction does it
+   const std::string number = MakeTemporary("n");
+   code += indent + "int64_t " + number + " = 0;\n";
+   code += indent + "if (!ParseNumber(" + tested + ", " + number + "))\n";
+   code += indent + "   return false;\n";
+
+   const RangeSet set(std::move(ranges));
+   code += indent + "static const int64_t " + table + "[] = {";
+   for (size_t i = 0; i < set.Bounds().size(); i++)
+      code += (i == 0 ? "" : ", ") + MakeNumber(set.Bounds()[i]);
+   code += "};\n";
+   code += indent + "const bool " + value + " = RangeSet::Contains(" + number + ", " + table + ", " + std::to_string(set.Bounds().size()) + ");\n";
+   return true;
+}
+
+// generate code evaluating a string node, 'value' gets the expression of the result
+// returns true if successful
+bool RuleCodeGenerator::GenerateString(const ExpressionNode* node, const std::string& indent, std::string& code, std::string& value)
+{
+   switch (node->_token._type)
+   {
+      case TokenType::Scalar:
+      case TokenType::Number:
+         value = MakeStringView(node->_token.ToString());
+         return true;
+      case TokenType::Variable:
+      {
+         const uint32_t slot = _rule_schema->AddVariable(node->_token.ToString());
+         value = MakeTemporary("s");
+         code += indent + "StringView " + value + ";\n";
+         code += indent + "if (!GetRecordValue(record, " + std::to_string(slot) + ", " + value + "))\n";
+         code += indent + "   return false;\n";
+         return true;
+      }
+      case TokenType::Func:
+         break;
+      default:
+         return false;
+   }
+
+   const auto& source = node->_child;
+   if (node->_token.Text() != "SUBSTR" || !source || !source->_sibling || !source->_sibling->_sibling || source->_sibling->_sibling->_sibling)
+      return false;
+
+   std::string source_value;
+   if (!GenerateString(source, indent, code, source_value))
+      return false;
+
+   // literal numbers are parsed once here, the same way the program compiler does it
+   const auto& from_node = source->_sibling;
+   const auto& length_node = from_node->_sibling;
+   int from = 0;
+   int length = 0;
+   const NumberParsing from_parsing = (from_node->_token.IsLiteral() ? ParseInt(from_node->_token.Text(), from) : NumberParsing::Invalid);
+   const NumberParsing length_parsing = (length_node->_token.IsLiteral() ? ParseInt(length_node->_token.Text(), length) : NumberParsing::Invalid);
+   if (from_parsing != NumberParsing::Invalid && length_parsing != NumberParsing::Invalid)
+   {
+      // negative numbers become huge positions or lengths, the substring is empty if any of the numbers doesn't fit into int
+      uint32_t from_position = static_cast<uint32_t>(from);
+      if (from_parsing == NumberParsing::OutOfRange || length_parsing == NumberParsing::OutOfRange)
+         from_position = std::numeric_limits<uint32_t>::max();
+      value = "Substring(" + source_value + ", " + std::to_string(from_position) + "u, " + std::to_string(static_cast<uint32_t>(length)) + "u)";
+      return true;
+   }
+
+   std::string from_value;
+   std::string length_value;
+   if (!GenerateString(from_node, indent, code, from_value) || !GenerateString(length_node, indent, code, length_value))
+      return false;
+
+   value = MakeTemporary("s");
+   code += indent + "StringView " + value + ";\n";
+   code += indent + "if (!SubstringDynamic(" + source_value + ", " + from_value + ", " + length_value + ", " + value + "))\n";
+   code += indent + "   return false;\n";
+   return true;
+}
+
+std::string RuleCodeGenerator::MakeTemporary(const char* prefix)
+{
+   return prefix + std::to_string(_temporaries_number++);
+}
+
+// returns true if the node is evaluated to a boolean value
+bool RuleCodeGenerator::IsBoolean(const ExpressionNode* node)
+{
+   return node->_token._type == TokenType::True || node->_token._type == TokenType::False || node->_token.IsOperator();
+}
+
+// C++ string literal of the value, non-printable chars are written as octal escapes
+std::string RuleCodeGenerator::MakeLiteral(const std::string& value)
+{
+   std::string literal = "\"";
+   for (const char ch : value)
+   {
+      const unsigned char code = static_cast<unsigned char>(ch);
+      if (ch == '\"' || ch == '\\')
+      {
+         literal += '\\';
+         literal += ch;
+      }
+      else if (code < 0x20 || code >= 0x7f || ch == '?')
+      {
+         // '?' is escaped to avoid trigraphs
+         char escape[5];
+         std::snprintf(escape, sizeof(escape), "\\%03o", code);
+         literal += escape;
+      }
+      else
+         literal += ch;
+   }
+   return literal + "\"";
+}
+
+std::string RuleCodeGenerator::MakeStringView(const std::string& value)
+{
+   return "StringView(" + MakeLiteral(value) + ", " + std::to_string(value.size()) + ")";
+}
+
+// C++ literal of the number, the minimal number has no literal of its own
+std::string RuleCodeGenerator::MakeNumber(const int64_t number)
+{
+   if (number == std::numeric_limits<int64_t>::min())
+      return "(" + std::to_string(number + 1) + "LL - 1)";
+   return std::to_string(number) + "LL";
+}
+}
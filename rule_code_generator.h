@@ -0,0 +1,63 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <unordered_set>
+#include <vector>
+#include "common.h"
+#include "expression_parser.h"
+#include "variable_schema.h"
+
+// This is to compile rules ahead of time into C++ source code, which is built into a binary or a shared object (see generated_rules.h).
+// Every rule is validated and optimized the same way ExpressionEvaluator::Compile does it and becomes a function of straight-line code:
+// literals are inlined, && and || become nested ifs keeping the short-circuit semantics,
+// comparisons with arrays become a switch by the value length over the array items of that length,
+// PREFIX and IN RANGES operators become binary searches over static sorted tables.
+// Rule files have no schema to tag variables as numbers, so all variables are strings and comparisons of number literals are folded by the optimizer.
+namespace Renaissance
+{
+class RuleCodeGenerator
+{
+public:
+   RuleCodeGenerator() = default;
+   RuleCodeGenerator(const RuleCodeGenerator&) = delete;
+   RuleCodeGenerator(RuleCodeGenerator&&) = delete;
+   RuleCodeGenerator& operator =(const RuleCodeGenerator&) = delete;
+   RuleCodeGenerator& operator =(RuleCodeGenerator&&) = delete;
+   ~RuleCodeGenerator() = default;
+
+   bool AddRule(const std::string& rule_id, const std::string& expression);
+   void Generate(const std::string& symbol, std::string& code) const;
+
+   inline size_t RulesNumber() const noexcept { return _rules.size(); }
+   inline const VariableSchema& Schema() const noexcept { return _schema; }
+
+private:
+   struct Rule
+   {
+      std::string _id;
+      std::string _expression;
+      std::string _body;
+   };
+
+   std::pmr::monotonic_buffer_resource _arena; // nodes of the trees of the rule being added
+   ExpressionParser _parser{&_arena};
+   VariableSchema _schema;
+   std::vector<Rule> _rules;
+   std::unordered_set<std::string> _rule_ids;
+
+   // state of the rule being generated
+   VariableSchema* _rule_schema = nullptr;
+   size_t _temporaries_number = 0;
+
+   bool GenerateBoolean(const ExpressionNode* node, const std::string& indent, std::string& code, std::string& value);
+   bool GenerateString(const ExpressionNode* node, const std::string& indent, std::string& code, std::string& value);
+   bool GenerateSetTest(const ExpressionNode* node, const std::string& indent, std::string& code, std::string& value);
+   bool GenerateTableTest(const ExpressionNode* node, const std::string& indent, std::string& code, std::string& value);
+   std::string MakeTemporary(const char* prefix);
+
+   static bool IsBoolean(const ExpressionNode* node);
+   static std::string MakeLiteral(const std::string& value);
+   static std::string MakeStringView(const std::string& value);
+   static std::string MakeNumber(const int64_t number);
+};
+}
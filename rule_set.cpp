@@ -0,0 +1,943 @@
+#include "rule_set.h"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <limits>
+#include <numeric>
+#include "expression_optimizer.h"
+
+namespace Renaissance
+{
+// compile the expression and add it to the rule set, index of the new rule is returned in the 'rule_index' output parameter
+// predicates which are equal to the ones of already added rules are reused
+// returns true if successful
+bool RuleSet::AddRule(const std::string& expression, size_t& rule_index)
+{
+   // trees of the previous rule are released, so their memory is reused, the trees of this rule point into the expression
+   _arena.release();
+   _rule_expression = expression;
+   ExpressionTree expression_tree;
+   if (!_parser.ParseInPlace(expression, expression_tree))
+      return false;
+
+   Rule rule;
+   rule._max_stack_depth = 1;
+   const ExpressionNode* optimized_root = nullptr;
+   if (expression_tree.empty()) // treat empty tree as a true statement
+   {
+      rule._instructions.push_back({RuleOpCode::PushBool, 1});
+      rule._terms.push_back({RuleTermType::Bool, 1, {}});
+   }
+   else
+   {
+      // check the whole expression first, so an invalid rule doesn't leave its predicates in the set
+      ExpressionProgram program;
+      ProgramCompiler compiler;
+      if (!compiler.Compile(expression_tree.top(), _schema, program))
+         return false;
+
+      ExpressionOptimizer optimizer(&_arena);
+      optimized_root = optimizer.Optimize(expression_tree.top());
+      size_t stack_depth = 0;
+      if (!CompileRule(optimized_root, rule, stack_depth))
+         return false;
+      size_t instruction_index = 0;
+      AddTerm(optimized_root, instruction_index, rule);
+   }
+
+   _max_stack_depth = std::max(_max_stack_depth, rule._max_stack_depth);
+   _rules.push_back(std::move(rule));
+   _reordered_rules.emplace_back(false);
+   rule_index = _rules.size() - 1;
+   for (const auto& instruction : _rules.back()._instructions)
+   {
+      if (instruction._op_code != RuleOpCode::PushPredicate)
+         continue;
+      auto& rules = _predicate_rules[instruction._operand];
+      if (rules.empty() || rules.back() != rule_index)
+         rules.push_back(static_cast<uint32_t>(rule_index));
+   }
+   IndexRule(optimized_root, static_cast<uint32_t>(rule_index));
+   return true;
+}
+
+// evaluate all rules with variables values given in 'variable_values' parameter
+// results are returned in the 'context', returns false if some rules couldn't be evaluated
+bool RuleSet::Evaluate(const VariableValues& variable_values, RuleSetContext& context) const
+{
+   return Evaluate<VariableValues>(variable_values, context);
+}
+
+// evaluate all rules with variables values given by slots of the rule set schema
+// results are returned in the 'context', returns false if some rules couldn't be evaluated
+bool RuleSet::Evaluate(const VariableRecord& variable_record, RuleSetContext& context) const
+{
+   return Evaluate<VariableRecord>(variable_record, context);
+}
+
+// find the first matching rule for variables values given in 'variable_values' parameter, rules are checked in order of their indexes
+// only rules consistent with the index are evaluated, the evaluation stops at the first match
+// returns true if a matching rule is found, its index is returned in the 'rule_index' output parameter
+bool RuleSet::FindFirstMatch(const VariableValues& variable_values, RuleSetContext& context, size_t& rule_index) const
+{
+   return FindFirstMatch<VariableValues>(variable_values, context, rule_index);
+}
+
+// find the first matching rule for variables values given by slots of the rule set schema
+// returns true if a matching rule is found, its index is returned in the 'rule_index' output parameter
+bool RuleSet::FindFirstMatch(const VariableRecord& variable_record, RuleSetContext& context, size_t& rule_index) const
+{
+   return FindFirstMatch<VariableRecord>(variable_record, context, rule_index);
+}
+
+// find all matching rules for variables values given in 'variable_values' parameter, only rules consistent with the index are evaluated
+// results are returned in the 'context', rules which are not evaluated are neither matches nor failures
+// returns false if some of the evaluated rules couldn't be evaluated
+bool RuleSet::FindAllMatches(const VariableValues& variable_values, RuleSetContext& context) const
+{
+   return FindAllMatches<VariableValues>(variable_values, context);
+}
+
+// find all matching rules for variables values given by slots of the rule set schema
+// returns false if some of the evaluated rules couldn't be evaluated
+bool RuleSet::FindAllMatches(const VariableRecord& variable_record, RuleSetContext& context) const
+{
+   return FindAllMatches<VariableRecord>(variable_record, context);
+}
+
+// evaluate the rules again after the variables listed in 'changed_variables' changed their values,
+// the context must hold the results of Evaluate or Reevaluate for the previous values of the variables, otherwise all rules are evaluated
+// results are returned in the 'context', returns false if some rules couldn't be evaluated
+bool RuleSet::Reevaluate(const VariableValues& variable_values, const std::vector<std::string>& changed_variables, RuleSetContext& context) const
+{
+   context._changed_slots.clear();
+   for (const auto& variable : changed_variables)
+   {
+      uint32_t slot = 0;
+      if (_schema.FindVariable(variable, slot))
+         context._changed_slots.push_back(slot);
+   }
+   return Reevaluate<VariableValues>(variable_values, context._changed_slots, context);
+}
+
+// evaluate the rules again after the variables of 'changed_slots' of the rule set schema changed their values
+// results are returned in the 'context', returns false if some rules couldn't be evaluated
+bool RuleSet::Reevaluate(const VariableRecord& variable_record, const std::vector<uint32_t>& changed_slots, RuleSetContext& context) const
+{
+   return Reevaluate<VariableRecord>(variable_record, changed_slots, context);
+}
+
+// compile logical operators of the rule into its instructions, all other subtrees are predicates
+bool RuleSet::CompileRule(const ExpressionNode* node, Rule& rule, size_t& stack_depth)
+{
+   switch (node->_token._type)
+   {
+      case TokenType::True:
+      case TokenType::False:
+         rule._instructions.push_back({RuleOpCode::PushBool, node->_token._type == TokenType::True ? 1u : 0u});
+         break;
+      case TokenType::OperatorLogicalAnd:
+      case TokenType::OperatorLogicalOr:
+      {
+         if (!node->_child || !node->_child->_sibling || !CompileRule(node->_child, rule, stack_depth))
+            return false;
+
+         // the jump target is not known until the right operand is compiled
+         const size_t jump = rule._instructions.size();
+         rule._instructions.push_back({node->_token._type == TokenType::OperatorLogicalAnd ? RuleOpCode::JumpIfFalseOrPop : RuleOpCode::JumpIfTrueOrPop, 0});
+         --stack_depth;
+
+         if (!CompileRule(node->_child->_sibling, rule, stack_depth))
+            return false;
+         rule._instructions[jump]._operand = static_cast<uint32_t>(rule._instructions.size());
+         return true;
+      }
+      default:
+      {
+         uint32_t predicate_index = 0;
+         if (!AddPredicate(node, predicate_index))
+            return false;
+         rule._instructions.push_back({RuleOpCode::PushPredicate, predicate_index});
+         break;
+      }
+   }
+
+   ++stack_depth;
+   rule._max_stack_depth = std::max(rule._max_stack_depth, stack_depth);
+   return true;
+}
+
+// find an equal predicate or compile a new one, its index is returned in the 'predicate_index' output parameter
+bool RuleSet::AddPredicate(const ExpressionNode* node, uint32_t& predicate_index)
+{
+   const std::string canonical_form = ExpressionOptimizer::CanonicalForm(node);
+   auto it = _predicate_indexes.find(canonical_form);
+   if (it != _predicate_indexes.end())
+   {
+      predicate_index = it->second;
+      return true;
+   }
+
+   std::unique_ptr<ExpressionProgram> program(new ExpressionProgram());
+   ProgramCompiler compiler;
+   if (!compiler.Compile(node, _schema, *program))
+      return false;
+
+   predicate_index = static_cast<uint32_t>(_predicates.size());
+   PredicateRequirements requirements;
+   for (const auto& instruction : program->Instructions())
+   {
+      if (instruction._op_code == OpCode::PushVariable)
+         requirements._slots.push_back(instruction._operand);
+      else if (instruction._op_code == OpCode::PushNumberVariable || instruction._op_code == OpCode::SubstrDynamic || instruction._op_code == OpCode::ToNumber)
+         requirements._may_fail = true;
+
+      if (instruction._op_code == OpCode::PushVariable || instruction._op_code == OpCode::PushNumberVariable)
+      {
+         if (instruction._operand >= _variable_predicates.size())
+            _variable_predicates.resize(instruction._operand + 1);
+         auto& predicates = _variable_predicates[instruction._operand];
+         if (predicates.empty() || predicates.back() != predicate_index)
+            predicates.push_back(predicate_index);
+      }
+   }
+
+   _predicates.push_back(std::move(program));
+   _predicate_requirements.push_back(std::move(requirements));
+   _predicate_rules.emplace_back();
+   _predicate_indexes.emplace(canonical_form, predicate_index);
+
+   // tokens point into the rule expression, so their positions give the source of the predicate
+   const char* begin = nullptr;
+   const char* end = nullptr;
+   FindSpan(node, begin, end);
+   if (begin != nullptr && begin >= _rule_expression.begin() && end <= _rule_expression.end())
+      end = FindClosingBrackets(begin, end, _rule_expression.end());
+   SourceSpan span;
+   span._rule_index = static_cast<uint32_t>(_rules.size());
+   if (begin != nullptr && begin >= _rule_expression.begin() && end <= _rule_expression.end())
+   {
+      span._offset = static_cast<uint32_t>(begin - _rule_expression.begin());
+      span._length = static_cast<uint32_t>(end - begin);
+   }
+   _predicate_spans.push_back(span);
+   return true;
+}
+
+// add the term of the node to the rule, && and || operators of the same type are flattened into a single chain
+// predicates are taken from the rule instructions starting at 'instruction_index', as CompileRule visits them in the same order
+// returns the index of the new term
+uint32_t RuleSet::AddTerm(const ExpressionNode* node, size_t& instruction_index, Rule& rule)
+{
+   const uint32_t term_index = static_cast<uint32_t>(rule._terms.size());
+   rule._terms.push_back({RuleTermType::Predicate, 0, {}});
+   switch (node->_token._type)
+   {
+      case TokenType::True:
+      case TokenType::False:
+         rule._terms[term_index] = {RuleTermType::Bool, node->_token._type == TokenType::True ? 1u : 0u, {}};
+         break;
+      case TokenType::OperatorLogicalAnd:
+      case TokenType::OperatorLogicalOr:
+      {
+         std::vector<const ExpressionNode*> operands;
+         CollectChain(node, node->_token._type, operands);
+         std::vector<uint32_t> operand_terms;
+         for (const auto& operand : operands)
+            operand_terms.push_back(AddTerm(operand, instruction_index, rule));
+
+         const RuleTermType type = (node->_token._type == TokenType::OperatorLogicalAnd ? RuleTermType::And : RuleTermType::Or);
+         rule._terms[term_index] = {type, static_cast<uint32_t>(_chain_orders.size()), std::move(operand_terms)};
+         _chain_orders.emplace_back(SourceOrder);
+         break;
+      }
+      default:
+         while (rule._instructions[instruction_index]._op_code != RuleOpCode::PushPredicate)
+            ++instruction_index;
+         rule._terms[term_index]._operand = rule._instructions[instruction_index++]._operand;
+         break;
+   }
+   return term_index;
+}
+
+// collect operands of the chain of 'operator_type' operators in the source order
+void RuleSet::CollectChain(const ExpressionNode* node, const TokenType operator_type, std::vector<const ExpressionNode*>& operands)
+{
+   if (node->_token._type != operator_type)
+   {
+      operands.push_back(node);
+      return;
+   }
+   for (auto child = node->_child; child; child = child->_sibling)
+      CollectChain(child, operator_type, operands);
+}
+
+// reorder operands of && and || chains by the statistics of the predicates, e.g. summed up statistics of profiling contexts,
+// operands which are cheap and likely to decide the result are evaluated first
+// it might be called while other threads evaluate records, orders of the chains are swapped atomically
+void RuleSet::Replan(const RuleSetStatistics& statistics)
+{
+   for (size_t i = 0; i < _rules.size(); i++)
+   {
+      double probability = 0;
+      double cost = 0;
+      bool is_reordered = false;
+      PlanTerm(_rules[i], 0, statistics, probability, cost, is_reordered);
+      _reordered_rules[i].store(is_reordered, std::memory_order_relaxed);
+   }
+}
+
+// plan the term and its operands, 'probability' gets the estimated probability of the term being true
+// and 'cost' the expected cost of its evaluation in nanoseconds, operands are assumed to be independent
+void RuleSet::PlanTerm(const Rule& rule, const uint32_t term_index, const RuleSetStatistics& statistics, double& probability, double& cost, bool& is_reordered)
+{
+   const RuleTerm& term = rule._terms[term_index];
+   switch (term._type)
+   {
+      case RuleTermType::Bool:
+         probability = term._operand;
+         cost = 0;
+         return;
+      case RuleTermType::Predicate:
+         EstimatePredicate(term._operand, statistics, probability, cost);
+         return;
+      default:
+         break;
+   }
+
+   const size_t operands_number = term._operands.size();
+   std::vector<double> probabilities(operands_number);
+   std::vector<double> costs(operands_number);
+   for (size_t i = 0; i < operands_number; i++)
+      PlanTerm(rule, term._operands[i], statistics, probabilities[i], costs[i], is_reordered);
+
+   // an operand decides the result of && if it's false and of || if it's true,
+   // the order by the cost per probability of deciding the result is optimal for independent operands
+   const bool is_and = (term._type == RuleTermType::And);
+   std::vector<size_t> order(operands_number);
+   std::iota(order.begin(), order.end(), 0);
+   if (operands_number <= MaxReorderedOperands)
+   {
+      std::vector<double> keys(operands_number);
+      for (size_t i = 0; i < operands_number; i++)
+      {
+         const double deciding_probability = (is_and ? 1 - probabilities[i] : probabilities[i]);
+         keys[i] = (deciding_probability > 0 ? costs[i] / deciding_probability : std::numeric_limits<double>::infinity());
+      }
+      std::stable_sort(order.begin(), order.end(), [&keys](const size_t i, const size_t j) { return keys[i] < keys[j]; });
+
+      uint64_t chain_order = SourceOrder;
+      for (size_t i = 0; i < operands_number; i++)
+         chain_order = (chain_order & ~(uint64_t(0xF) << (4 * i))) | (uint64_t(order[i]) << (4 * i));
+      _chain_orders[term._operand].store(chain_order, std::memory_order_relaxed);
+      is_reordered = is_reordered || (chain_order != SourceOrder);
+   }
+
+   double not_decided = 1;
+   cost = 0;
+   for (const size_t i : order)
+   {
+      cost += not_decided * costs[i];
+      not_decided *= (is_and ? probabilities[i] : 1 - probabilities[i]);
+   }
+   probability = (is_and ? not_decided : 1 - not_decided);
+}
+
+// estimate the probability of the predicate being true and the cost of its evaluation in nanoseconds
+// the cost is the mean of the sampled latencies, or the number of instructions if there are no samples
+void RuleSet::EstimatePredicate(const uint32_t predicate_index, const RuleSetStatistics& statistics, double& probability, double& cost) const
+{
+   probability = 0.5;
+   cost = static_cast<double>(_predicates[predicate_index]->Instructions().size());
+   if (predicate_index >= statistics._predicates.size())
+      return;
+
+   const EvaluationStatistics& predicate = statistics._predicates[predicate_index];
+   if (predicate._evaluations > 0)
+      probability = static_cast<double>(predicate._true_results) / predicate._evaluations;
+
+   // latencies of a bucket are taken as the middle of the bucket
+   double samples = 0;
+   double latency = 0;
+   for (size_t i = 0; i < LatencyBucketsNumber; i++)
+   {
+      samples += predicate._latency_histogram[i];
+      latency += predicate._latency_histogram[i] * (i == 0 ? 1.0 : 1.5 * static_cast<double>(uint64_t(1) << i));
+   }
+   if (samples > 0)
+      cost = latency / samples;
+}
+
+// extend the range from 'begin' to 'end' to the chars of all tokens of the subtree, quotes of string literals included
+void RuleSet::FindSpan(const ExpressionNode* node, const char*& begin, const char*& end)
+{
+   const Token& token = node->_token;
+   if (token._begin != nullptr)
+   {
+      const bool is_string = (token._type == TokenType::Scalar);
+      if (begin == nullptr || token._begin - is_string < begin)
+         begin = token._begin - is_string;
+      if (end == nullptr || token._end + is_string > end)
+         end = token._end + is_string;
+   }
+   for (auto child = node->_child; child; child = child->_sibling)
+      FindSpan(child, begin, end);
+}
+
+// closing brackets of arrays and functions are not tokens of the tree, so the span is extended to the brackets opened in it
+// returns the new end of the span
+const char* RuleSet::FindClosingBrackets(const char* begin, const char* end, const char* expression_end)
+{
+   std::string closing_brackets;
+   for (const char* it = begin; it != end; ++it)
+   {
+      if (*it == '\"')
+      {
+         it = std::find(it + 1, end, '\"');
+         if (it == end)
+            break;
+      }
+      else if (*it == '[' || *it == '{' || *it == '(')
+         closing_brackets.push_back(*it == '[' ? ']' : (*it == '{' ? '}' : ')'));
+      else if (!closing_brackets.empty() && *it == closing_brackets.back())
+         closing_brackets.pop_back();
+   }
+
+   const char* it = end;
+   while (!closing_brackets.empty())
+   {
+      while (it != expression_end && std::isspace(static_cast<unsigned char>(*it)))
+         ++it;
+      if (it == expression_end || *it != closing_brackets.back())
+         break;
+      closing_brackets.pop_back();
+      end = ++it;
+   }
+   return end;
+}
+
+// start profiling of the rules and predicates evaluated with the context, the previous counters of the context are dropped
+// latencies are measured for every 'sampling_period'-th record, 0 means latencies are not measured
+void RuleSet::EnableProfiling(RuleSetContext& context, const uint32_t sampling_period) const
+{
+   context._profile.reset(new RuleSetProfile(_rules.size(), _predicates.size(), sampling_period));
+   context._is_sampled = false;
+}
+
+// add the profiling counters of the context to the 'statistics', so statistics of many contexts might be summed up
+// it might be called while another thread evaluates records with the context, returns false if the context is not profiling
+bool RuleSet::GetStatistics(const RuleSetContext& context, RuleSetStatistics& statistics) const
+{
+   if (!context._profile)
+      return false;
+   statistics._rules.resize(std::max(statistics._rules.size(), _rules.size()));
+   statistics._predicates.resize(std::max(statistics._predicates.size(), _predicates.size()));
+   context._profile->AddTo(statistics);
+   return true;
+}
+
+// add the rule to the index of one of its top-level conjuncts 'variable == literal' or 'variable == [literals]'
+// the rule can't be true unless the variable has one of the literal values
+// the conjunct with the least number of values is chosen, variables which are already indexed are preferred
+void RuleSet::IndexRule(const ExpressionNode* root, const uint32_t rule_index)
+{
+   _unindexed_rules.resize(_rules.size());
+
+   std::vector<const ExpressionNode*> conjuncts;
+   if (root)
+      conjuncts.push_back(root);
+   for (size_t i = 0; i < conjuncts.size(); )
+   {
+      if (conjuncts[i]->_token._type == TokenType::OperatorLogicalAnd && conjuncts[i]->_child && conjuncts[i]->_child->_sibling)
+      {
+         auto node = conjuncts[i];
+         conjuncts[i] = node->_child;
+         conjuncts.insert(conjuncts.begin() + i + 1, node->_child->_sibling);
+      }
+      else
+         ++i;
+   }
+
+   const ExpressionNode* best_conjunct = nullptr;
+   size_t best_values_number = 0;
+   bool best_is_indexed = false;
+   for (const auto& conjunct : conjuncts)
+   {
+      if (conjunct->_token._type != TokenType::OperatorEqual || !conjunct->_child || conjunct->_child->_token._type != TokenType::Variable)
+         continue;
+
+      // numbers are equal by value rather than by text, so they are not indexed
+      if (_schema.IsNumber(conjunct->_child->_token.ToString()))
+         continue;
+
+      const auto& value = conjunct->_child->_sibling;
+      size_t values_number = 0;
+      if (value->_token.IsLiteral())
+         values_number = 1;
+      else if (value->_token._type == TokenType::LSquareBracket)
+      {
+         for (auto item = value->_child; item; item = item->_sibling, values_number++)
+         {
+            if (!item->_token.IsLiteral())
+            {
+               values_number = 0;
+               break;
+            }
+         }
+      }
+      if (values_number == 0)
+         continue;
+
+      uint32_t slot = 0;
+      _schema.FindVariable(conjunct->_child->_token.ToString(), slot);
+      const bool is_indexed = std::any_of(_variable_indexes.cbegin(), _variable_indexes.cend(), [slot](const VariableIndex& index) { return index._slot == slot; });
+      if (!best_conjunct || values_number < best_values_number || (values_number == best_values_number && is_indexed && !best_is_indexed))
+      {
+         best_conjunct = conjunct;
+         best_values_number = values_number;
+         best_is_indexed = is_indexed;
+      }
+   }
+
+   if (!best_conjunct)
+   {
+      _unindexed_rules.set(rule_index);
+      return;
+   }
+
+   uint32_t slot = 0;
+   _schema.FindVariable(best_conjunct->_child->_token.ToString(), slot);
+   auto index = std::find_if(_variable_indexes.begin(), _variable_indexes.end(), [slot](const VariableIndex& index) { return index._slot == slot; });
+   if (index == _variable_indexes.end())
+   {
+      _variable_indexes.push_back(VariableIndex());
+      index = _variable_indexes.end() - 1;
+      index->_slot = slot;
+   }
+
+   const auto& value = best_conjunct->_child->_sibling;
+   if (value->_token.IsLiteral())
+      index->_rules[value->_token.ToString()].push_back(rule_index);
+   else
+   {
+      for (auto item = value->_child; item; item = item->_sibling)
+      {
+         auto& rules = index->_rules[item->_token.ToString()];
+         if (rules.empty() || rules.back() != rule_index) // the same value might be listed twice
+            rules.push_back(rule_index);
+      }
+   }
+}
+
+uint64_t RuleSet::NewGeneration()
+{
+   static std::atomic<uint64_t> last_generation{0};
+   return last_generation.fetch_add(1, std::memory_order_relaxed) + 1;
+}
+
+// reset the context for a new record, all predicates are unknown and there are no results yet
+void RuleSet::PrepareContext(RuleSetContext& context) const
+{
+   context._predicate_states.assign(_predicates.size(), RuleSetContext::PredicateState::Unknown);
+   context._stack.resize(_max_stack_depth);
+   context._matches.resize(_rules.size());
+   context._matches.reset();
+   context._failures.resize(_rules.size());
+   context._failures.reset();
+   context._predicate_evaluations = 0;
+   context._rule_evaluations = 0;
+   context._is_sampled = (context._profile && context._profile->StartRecord());
+   context._evaluated_generation = 0;
+}
+
+// collect rules consistent with the index into the context candidates
+template <typename VariableSource>
+void RuleSet::FindCandidates(const VariableSource& variable_source, RuleSetContext& context) const
+{
+   context._candidates = _unindexed_rules;
+   context._candidates.resize(_rules.size());
+
+   for (const auto& index : _variable_indexes)
+   {
+      // rules of a missing variable can't be true, as their conjunct fails
+      StringView value;
+      if (!GetValue(variable_source, index._slot, value))
+         continue;
+
+      context._value.assign(value.data(), value.size());
+      auto rules = index._rules.find(context._value);
+      if (rules == index._rules.end())
+         continue;
+
+      for (const uint32_t rule_index : rules->second)
+         context._candidates.set(rule_index);
+   }
+}
+
+bool RuleSet::GetValue(const VariableValues& variable_values, const uint32_t slot, StringView& value) const
+{
+   auto variable_value = variable_values.find(_schema.VariableName(slot));
+   if (variable_value == variable_values.end())
+      return false;
+   value = variable_value->second;
+   return true;
+}
+
+bool RuleSet::GetValue(const VariableRecord& variable_record, const uint32_t slot, StringView& value) const
+{
+   if (slot >= variable_record.size() || variable_record[slot].data() == nullptr)
+      return false;
+   value = variable_record[slot];
+   return true;
+}
+
+template <typename VariableSource>
+bool RuleSet::FindFirstMatch(const VariableSource& variable_source, RuleSetContext& context, size_t& rule_index) const
+{
+   PrepareContext(context);
+   FindCandidates(variable_source, context);
+
+   for (size_t i = context._candidates.find_first(); i != RuleBitmap::npos; i = context._candidates.find_next(i))
+   {
+      bool result = false;
+      if (!EvaluateRule(i, variable_source, context, result))
+         context._failures.set(i);
+      else if (result)
+      {
+         context._matches.set(i);
+         rule_index = i;
+         return true;
+      }
+   }
+   return false;
+}
+
+template <typename VariableSource>
+bool RuleSet::FindAllMatches(const VariableSource& variable_source, RuleSetContext& context) const
+{
+   PrepareContext(context);
+   FindCandidates(variable_source, context);
+
+   for (size_t i = context._candidates.find_first(); i != RuleBitmap::npos; i = context._candidates.find_next(i))
+   {
+      bool result = false;
+      if (!EvaluateRule(i, variable_source, context, result))
+         context._failures.set(i);
+      else if (result)
+         context._matches.set(i);
+   }
+   return context._failures.none();
+}
+
+template <typename VariableSource>
+bool RuleSet::Evaluate(const VariableSource& variable_source, RuleSetContext& context) const
+{
+   PrepareContext(context);
+
+   for (size_t i = 0; i < _rules.size(); i++)
+   {
+      bool result = false;
+      if (!EvaluateRule(i, variable_source, context, result))
+         context._failures.set(i);
+      else if (result)
+         context._matches.set(i);
+   }
+
+   context._evaluated_generation = _generation;
+   return context._failures.none();
+}
+
+// a rule in the source order depends only on the predicates it evaluated, so predicates which weren't evaluated for the previous values are left unknown,
+// but a reordered rule also checks whether the predicates it skipped might fail, so it's reevaluated when any of its variables is changed
+template <typename VariableSource>
+bool RuleSet::Reevaluate(const VariableSource& variable_source, const std::vector<uint32_t>& changed_slots, RuleSetContext& context) const
+{
+   if (context._evaluated_generation != _generation || context._matches.size() != _rules.size() || context._predicate_states.size() != _predicates.size())
+      return Evaluate(variable_source, context);
+
+   context._candidates.resize(_rules.size());
+   context._candidates.reset();
+   for (const uint32_t slot : changed_slots)
+   {
+      if (slot >= _variable_predicates.size())
+         continue;
+      for (const uint32_t predicate_index : _variable_predicates[slot])
+      {
+         auto& state = context._predicate_states[predicate_index];
+         const bool is_evaluated = (state != RuleSetContext::PredicateState::Unknown);
+         state = RuleSetContext::PredicateState::Unknown;
+         for (const uint32_t rule_index : _predicate_rules[predicate_index])
+         {
+            if (is_evaluated || _reordered_rules[rule_index].load(std::memory_order_relaxed))
+               context._candidates.set(rule_index);
+         }
+      }
+   }
+
+   context._predicate_evaluations = 0;
+   context._rule_evaluations = 0;
+   context._is_sampled = (context._profile && context._profile->StartRecord());
+   for (size_t i = context._candidates.find_first(); i != RuleBitmap::npos; i = context._candidates.find_next(i))
+   {
+      bool result = false;
+      context._matches.reset(i);
+      context._failures.reset(i);
+      if (!EvaluateRule(i, variable_source, context, result))
+         context._failures.set(i);
+      else if (result)
+         context._matches.set(i);
+   }
+   return context._failures.none();
+}
+
+// evaluate the rule, its evaluation is counted by the context profile if profiling is enabled
+template <typename VariableSource>
+bool RuleSet::EvaluateRule(const size_t rule_index, const VariableSource& variable_source, RuleSetContext& context, bool& result) const
+{
+   ++context._rule_evaluations;
+   const Rule& rule = _rules[rule_index];
+   RuleSetProfile* const profile = context._profile.get();
+   if (profile == nullptr || !profile->IsProfiledRule(rule_index))
+   {
+      if (!_reordered_rules[rule_index].load(std::memory_order_relaxed))
+         return ExecuteRule(rule, variable_source, context, result);
+      const auto state = EvaluateTerm(rule, 0, variable_source, context);
+      result = (state == RuleSetContext::PredicateState::True);
+      return state != RuleSetContext::PredicateState::Failed;
+   }
+
+   const auto start = (context._is_sampled ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point());
+   bool is_evaluated = false;
+   if (!_reordered_rules[rule_index].load(std::memory_order_relaxed))
+      is_evaluated = ExecuteRule(rule, variable_source, context, result);
+   else
+   {
+      const auto state = EvaluateTerm(rule, 0, variable_source, context);
+      result = (state == RuleSetContext::PredicateState::True);
+      is_evaluated = (state != RuleSetContext::PredicateState::Failed);
+   }
+   const uint64_t latency = (context._is_sampled ? std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count() : RuleSetProfile::NotSampled);
+   profile->AddRuleResult(rule_index, is_evaluated, result, latency);
+   return is_evaluated;
+}
+
+// evaluate the predicate unless it's already evaluated for the record
+template <typename VariableSource>
+RuleSetContext::PredicateState RuleSet::EvaluatePredicate(const uint32_t predicate_index, const VariableSource& variable_source, RuleSetContext& context) const
+{
+   auto& state = context._predicate_states[predicate_index];
+   if (state == RuleSetContext::PredicateState::Unknown)
+   {
+      bool predicate_result = false;
+      if (!ExecutePredicate(predicate_index, variable_source, context, predicate_result))
+         state = RuleSetContext::PredicateState::Failed;
+      else
+         state = (predicate_result ? RuleSetContext::PredicateState::True : RuleSetContext::PredicateState::False);
+   }
+   return state;
+}
+
+// evaluate the term with the chains in their planned orders, the result is the same as of the evaluation in the source order:
+// the first operand of a chain which isn't true for && (or false for ||) decides the result, so after an operand decided the result
+// the operands before it are evaluated as long as some of them might fail
+template <typename VariableSource>
+RuleSetContext::PredicateState RuleSet::EvaluateTerm(const Rule& rule, const uint32_t term_index, const VariableSource& variable_source, RuleSetContext& context) const
+{
+   typedef RuleSetContext::PredicateState State;
+   const RuleTerm& term = rule._terms[term_index];
+   switch (term._type)
+   {
+      case RuleTermType::Bool:
+         return (term._operand != 0 ? State::True : State::False);
+      case RuleTermType::Predicate:
+         return EvaluatePredicate(term._operand, variable_source, context);
+      default:
+         break;
+   }
+
+   const State deciding_state = (term._type == RuleTermType::And ? State::False : State::True);
+   const size_t operands_number = term._operands.size();
+   const bool is_reordered = (operands_number <= MaxReorderedOperands);
+   const uint64_t order = (is_reordered ? _chain_orders[term._operand].load(std::memory_order_relaxed) : SourceOrder);
+   size_t decided_position = operands_number; // position of the first operand in the source order which decided the result so far
+   State decided_state = (deciding_state == State::False ? State::True : State::False);
+   uint32_t evaluated_positions = 0;
+   for (size_t i = 0; i < operands_number; i++)
+   {
+      const size_t position = (is_reordered ? (order >> (4 * i)) & 0xF : i);
+      if (position >= decided_position)
+         continue;
+
+      if (decided_state == deciding_state && is_reordered)
+      {
+         // operands before the decided one are either not deciding or deciding the same way, unless they fail
+         bool may_fail = false;
+         for (size_t j = 0; j < decided_position && !may_fail; j++)
+            may_fail = ((evaluated_positions & (1u << j)) == 0 && MayFail(rule, term._operands[j], variable_source, context));
+         if (!may_fail)
+            break;
+      }
+
+      const State state = EvaluateTerm(rule, term._operands[position], variable_source, context);
+      if (is_reordered)
+         evaluated_positions |= (1u << position);
+      if (state == deciding_state || state == State::Failed)
+      {
+         decided_position = position;
+         decided_state = state;
+      }
+   }
+   return decided_state;
+}
+
+// returns true if the term might fail for the record, it's true if a variable of some of its predicates is missing
+template <typename VariableSource>
+bool RuleSet::MayFail(const Rule& rule, const uint32_t term_index, const VariableSource& variable_source, const RuleSetContext& context) const
+{
+   const RuleTerm& term = rule._terms[term_index];
+   switch (term._type)
+   {
+      case RuleTermType::Bool:
+         return false;
+      case RuleTermType::Predicate:
+      {
+         const auto state = context._predicate_states[term._operand];
+         if (state != RuleSetContext::PredicateState::Unknown)
+            return state == RuleSetContext::PredicateState::Failed;
+
+         const PredicateRequirements& requirements = _predicate_requirements[term._operand];
+         if (requirements._may_fail)
+            return true;
+         StringView value;
+         return std::any_of(requirements._slots.cbegin(), requirements._slots.cend(),
+                            [this, &variable_source, &value](const uint32_t slot) { return !GetValue(variable_source, slot, value); });
+      }
+      default:
+         return std::any_of(term._operands.cbegin(), term._operands.cend(),
+                            [this, &rule, &variable_source, &context](const uint32_t operand) { return MayFail(rule, operand, variable_source, context); });
+   }
+}
+
+// evaluate the predicate, its evaluation is counted by the context profile if profiling is enabled
+template <typename VariableSource>
+bool RuleSet::ExecutePredicate(const uint32_t predicate_index, const VariableSource& variable_source, RuleSetContext& context, bool& result) const
+{
+   ++context._predicate_evaluations;
+   RuleSetProfile* const profile = context._profile.get();
+   if (profile == nullptr || !profile->IsProfiledPredicate(predicate_index))
+      return _predicates[predicate_index]->Execute(variable_source, result);
+
+   const auto start = (context._is_sampled ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point());
+   const bool is_evaluated = _predicates[predicate_index]->Execute(variable_source, result);
+   const uint64_t latency = (context._is_sampled ? std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count() : RuleSetProfile::NotSampled);
+   profile->AddPredicateResult(predicate_index, is_evaluated, result, latency);
+   return is_evaluated;
+}
+
+template <typename VariableSource>
+bool RuleSet::ExecuteRule(const Rule& rule, const VariableSource& variable_source, RuleSetContext& context, bool& result) const
+{
+   auto& stack = context._stack;
+   size_t top = 0; // number of values on the stack
+
+   const size_t instructions_number = rule._instructions.size();
+   size_t current = 0;
+   while (current < instructions_number)
+   {
+      const RuleInstruction& instruction = rule._instructions[current++];
+      switch (instruction._op_code)
+      {
+         case RuleOpCode::PushBool:
+            stack[top++] = (instruction._operand != 0);
+            break;
+         case RuleOpCode::PushPredicate:
+         {
+            const auto state = EvaluatePredicate(instruction._operand, variable_source, context);
+            if (state == RuleSetContext::PredicateState::Failed)
+               return false;
+            stack[top++] = (state == RuleSetContext::PredicateState::True);
+            break;
+         }
+         case RuleOpCode::JumpIfFalseOrPop:
+            if (!stack[top - 1])
+               current = instruction._operand;
+            else
+               --top;
+            break;
+         case RuleOpCode::JumpIfTrueOrPop:
+            if (stack[top - 1])
+               current = instruction._operand;
+            else
+               --top;
+            break;
+         default:
+            return false; // unknown instruction
+      }
+   }
+
+   if (top != 1)
+      return false;
+
+   result = stack[0];
+   return true;
+}
+
+RuleSetProfile::RuleSetProfile(const size_t rules_number, const size_t predicates_number, const uint32_t sampling_period)
+   : _rules_number(rules_number), _predicates_number(predicates_number), _sampling_period(sampling_period),
+     _counters(new std::atomic<uint64_t>[(rules_number + predicates_number) * CountersNumber])
+{
+   for (size_t i = 0; i < (rules_number + predicates_number) * CountersNumber; i++)
+      _counters[i].store(0, std::memory_order_relaxed);
+}
+
+bool RuleSetProfile::StartRecord()
+{
+   Increment(_records);
+   if (_sampling_period == 0)
+      return false;
+   if (_records_to_sample > 0)
+   {
+      --_records_to_sample;
+      return false;
+   }
+   _records_to_sample = _sampling_period - 1;
+   Increment(_sampled_records);
+   return true;
+}
+
+void RuleSetProfile::AddResult(const size_t item, const bool is_evaluated, const bool result, const uint64_t latency)
+{
+   std::atomic<uint64_t>* const counters = &_counters[item * CountersNumber];
+   Increment(counters[Evaluations]);
+   Increment(counters[!is_evaluated ? Failures : (result ? TrueResults : FalseResults)]);
+   if (latency != NotSampled)
+   {
+      size_t bucket = 0;
+      for (uint64_t value = latency; value > 1 && bucket < LatencyBucketsNumber - 1; value >>= 1)
+         ++bucket;
+      Increment(counters[FirstLatencyBucket + bucket]);
+   }
+}
+
+// the statistics must have items for all profiled rules and predicates
+void RuleSetProfile::AddTo(RuleSetStatistics& statistics) const
+{
+   statistics._records += _records.load(std::memory_order_relaxed);
+   statistics._sampled_records += _sampled_records.load(std::memory_order_relaxed);
+   for (size_t i = 0; i < _rules_number; i++)
+      AddTo(i, statistics._rules[i]);
+   for (size_t i = 0; i < _predicates_number; i++)
+      AddTo(_rules_number + i, statistics._predicates[i]);
+}
+
+void RuleSetProfile::AddTo(const size_t item, EvaluationStatistics& statistics) const
+{
+   const std::atomic<uint64_t>* const counters = &_counters[item * CountersNumber];
+   statistics._evaluations += counters[Evaluations].load(std::memory_order_relaxed);
+   statistics._true_results += counters[TrueResults].load(std::memory_order_relaxed);
+   statistics._false_results += counters[FalseResults].load(std::memory_order_relaxed);
+   statistics._failures += counters[Failures].load(std::memory_order_relaxed);
+   for (size_t i = 0; i < LatencyBucketsNumber; i++)
+      statistics._latency_histogram[i] += counters[FirstLatencyBucket + i].load(std::memory_order_relaxed);
+}
+}
@@ -0,0 +1,313 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <memory_resource>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <boost/dynamic_bitset.hpp>
+#include "common.h"
+#include "expression_parser.h"
+#include "expression_program.h"
+#include "variable_schema.h"
+
+// This is to evaluate many rules (expressions) against the same record at once.
+// Every rule is split into predicates - boolean subexpressions which are not && or || operators, e.g. 'IN.MT == 1' or 'SUBSTR{IN.TID,3,1} == ["9", "L"]'.
+// Equal predicates of all rules are compiled only once and evaluated at most once per record, lazily, when some rule needs them.
+// The rule itself becomes a small program of && and || over predicates, so the short-circuit semantics is kept.
+// Rules are also indexed by their top-level conjuncts like 'IN.MT == 1' or 'IN.CURRENCY == ["985", "978"]',
+// so FindFirstMatch and FindAllMatches evaluate only the rules which might match values of the record.
+// Profiling is opt-in per context: evaluations and results of every rule and predicate are counted and latencies of sampled records
+// are collected into histograms, predicates are mapped back to the parts of the rule expressions they come from.
+// The statistics might be given back to Replan, which reorders operands of && and || chains, so cheap operands likely to decide
+// the result are evaluated first. Results and failures never depend on the order: an operand which might fail is still evaluated
+// if it's written before the operand which decided the result.
+// After a record is evaluated, Reevaluate takes the record with some variables changed: only the predicates of the changed variables
+// which were evaluated are evaluated again, as well as the rules which use them, results of all other rules are kept.
+// Reordered rules are evaluated again if any of their variables is changed, as they check whether skipped predicates might fail.
+namespace Renaissance
+{
+// bit N stands for the rule with index N
+typedef boost::dynamic_bitset<uint64_t> RuleBitmap;
+
+// histogram of sampled latencies, bucket N counts latencies from 2^N to 2^(N+1) - 1 nanoseconds
+constexpr size_t LatencyBucketsNumber = 32;
+
+// profiling counters of a rule or a predicate
+struct EvaluationStatistics
+{
+   uint64_t _evaluations = 0;
+   uint64_t _true_results = 0;
+   uint64_t _false_results = 0;
+   uint64_t _failures = 0;
+   std::array<uint64_t, LatencyBucketsNumber> _latency_histogram{};
+};
+
+// snapshot of profiling counters of one or many contexts, rules and predicates are listed by their indexes
+struct RuleSetStatistics
+{
+   uint64_t _records = 0;
+   uint64_t _sampled_records = 0;
+   std::vector<EvaluationStatistics> _rules;
+   std::vector<EvaluationStatistics> _predicates;
+};
+
+// the part of a rule expression a predicate is compiled from, predicates shared by many rules refer to the first of the rules
+struct SourceSpan
+{
+   uint32_t _rule_index = 0;
+   uint32_t _offset = 0;
+   uint32_t _length = 0;
+};
+
+// profiling counters of a RuleSetContext, they are written only by the thread evaluating with the context
+// and might be read by other threads at any time, so they are relaxed atomics updated without read-modify-write operations
+class RuleSetProfile
+{
+public:
+   RuleSetProfile(const size_t rules_number, const size_t predicates_number, const uint32_t sampling_period);
+   RuleSetProfile(const RuleSetProfile&) = delete;
+   RuleSetProfile(RuleSetProfile&&) = delete;
+   RuleSetProfile& operator =(const RuleSetProfile&) = delete;
+   RuleSetProfile& operator =(RuleSetProfile&&) = delete;
+   ~RuleSetProfile() = default;
+
+   // latencies are measured for every 'sampling_period'-th record, returns true if the new record is sampled
+   bool StartRecord();
+   // rules and predicates added after profiling was enabled are not profiled
+   inline bool IsProfiledRule(const size_t rule_index) const noexcept { return rule_index < _rules_number; }
+   inline bool IsProfiledPredicate(const size_t predicate_index) const noexcept { return predicate_index < _predicates_number; }
+   inline void AddRuleResult(const size_t rule_index, const bool is_evaluated, const bool result, const uint64_t latency) { AddResult(rule_index, is_evaluated, result, latency); }
+   inline void AddPredicateResult(const size_t predicate_index, const bool is_evaluated, const bool result, const uint64_t latency) { AddResult(_rules_number + predicate_index, is_evaluated, result, latency); }
+   void AddTo(RuleSetStatistics& statistics) const;
+
+   static constexpr uint64_t NotSampled = UINT64_MAX;
+
+private:
+   enum Counter : size_t
+   {
+      Evaluations,
+      TrueResults,
+      FalseResults,
+      Failures,
+      FirstLatencyBucket,
+      CountersNumber = FirstLatencyBucket + LatencyBucketsNumber
+   };
+
+   const size_t _rules_number;
+   const size_t _predicates_number;
+   const uint32_t _sampling_period;
+   uint32_t _records_to_sample = 0;
+   std::atomic<uint64_t> _records{0};
+   std::atomic<uint64_t> _sampled_records{0};
+   std::unique_ptr<std::atomic<uint64_t>[]> _counters; // counters of rules followed by counters of predicates
+
+   static inline void Increment(std::atomic<uint64_t>& counter) { counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed); }
+   void AddResult(const size_t item, const bool is_evaluated, const bool result, const uint64_t latency);
+   void AddTo(const size_t item, EvaluationStatistics& statistics) const;
+};
+
+// evaluation state and results of a RuleSet, it's reused between records, so evaluation doesn't allocate memory
+// a context must not be shared between threads which evaluate simultaneously
+class RuleSetContext
+{
+public:
+   RuleSetContext() = default;
+   RuleSetContext(const RuleSetContext&) = delete;
+   RuleSetContext(RuleSetContext&&) = default;
+   RuleSetContext& operator =(const RuleSetContext&) = delete;
+   RuleSetContext& operator =(RuleSetContext&&) = default;
+   ~RuleSetContext() = default;
+
+   // rules evaluated to true for the last record
+   inline const RuleBitmap& Matches() const noexcept { return _matches; }
+   // rules which couldn't be evaluated for the last record, e.g. because of a missing variable
+   inline const RuleBitmap& Failures() const noexcept { return _failures; }
+   // number of predicates evaluated for the last record
+   inline size_t PredicateEvaluations() const noexcept { return _predicate_evaluations; }
+   // number of rules evaluated for the last record
+   inline size_t RuleEvaluations() const noexcept { return _rule_evaluations; }
+   // profiling is opt-in, see RuleSet::EnableProfiling, it must not be disabled while statistics are taken by RuleSet::GetStatistics
+   inline bool IsProfiling() const noexcept { return static_cast<bool>(_profile); }
+   inline void DisableProfiling() { _profile.reset(); _is_sampled = false; }
+
+private:
+   friend class RuleSet;
+   friend class RuleSetImage;
+
+   enum class PredicateState : uint8_t
+   {
+      Unknown,
+      False,
+      True,
+      Failed
+   };
+
+   std::vector<PredicateState> _predicate_states;
+   std::vector<bool> _stack;
+   RuleBitmap _matches;
+   RuleBitmap _failures;
+   RuleBitmap _candidates;
+   std::string _value; // variable value to look up in the index, it's kept to reuse its memory
+   std::vector<uint32_t> _changed_slots; // slots of the changed variables, it's kept to reuse its memory
+   size_t _predicate_evaluations = 0;
+   size_t _rule_evaluations = 0;
+   std::unique_ptr<RuleSetProfile> _profile;
+   bool _is_sampled = false; // latencies are measured for the current record
+   uint64_t _evaluated_generation = 0; // generation of the rule set which evaluated all rules for the last record, 0 if there is none
+};
+
+class RuleSet
+{
+public:
+   RuleSet() = default;
+   explicit RuleSet(const VariableSchema& schema) : _schema(schema) {}
+   RuleSet(const RuleSet&) = delete;
+   RuleSet(RuleSet&&) = delete;
+   RuleSet& operator =(const RuleSet&) = delete;
+   RuleSet& operator =(RuleSet&&) = delete;
+   ~RuleSet() = default;
+
+   bool AddRule(const std::string& expression, size_t& rule_index);
+   bool Evaluate(const VariableValues& variable_values, RuleSetContext& context) const;
+   bool Evaluate(const VariableRecord& variable_record, RuleSetContext& context) const;
+   bool FindFirstMatch(const VariableValues& variable_values, RuleSetContext& context, size_t& rule_index) const;
+   bool FindFirstMatch(const VariableRecord& variable_record, RuleSetContext& context, size_t& rule_index) const;
+   bool FindAllMatches(const VariableValues& variable_values, RuleSetContext& context) const;
+   bool FindAllMatches(const VariableRecord& variable_record, RuleSetContext& context) const;
+   bool Reevaluate(const VariableValues& variable_values, const std::vector<std::string>& changed_variables, RuleSetContext& context) const;
+   bool Reevaluate(const VariableRecord& variable_record, const std::vector<uint32_t>& changed_slots, RuleSetContext& context) const;
+
+   inline size_t RulesNumber() const noexcept { return _rules.size(); }
+   inline size_t PredicatesNumber() const noexcept { return _predicates.size(); }
+   inline size_t IndexedVariablesNumber() const noexcept { return _variable_indexes.size(); }
+   inline const VariableSchema& Schema() const noexcept { return _schema; }
+   inline const SourceSpan& PredicateSpan(const size_t predicate_index) const { return _predicate_spans[predicate_index]; }
+
+   void EnableProfiling(RuleSetContext& context, const uint32_t sampling_period = 64) const;
+   bool GetStatistics(const RuleSetContext& context, RuleSetStatistics& statistics) const;
+   void Replan(const RuleSetStatistics& statistics);
+   inline bool IsReordered(const size_t rule_index) const { return _reordered_rules[rule_index].load(std::memory_order_relaxed); }
+
+private:
+   friend class RuleSetImage;
+
+   enum class RuleOpCode : uint8_t
+   {
+      PushBool,         // push boolean constant, operand - 0 or 1
+      PushPredicate,    // push predicate value, operand - predicate index
+      JumpIfFalseOrPop, // jump to operand keeping the boolean on top if it's false, pop it otherwise
+      JumpIfTrueOrPop   // jump to operand keeping the boolean on top if it's true, pop it otherwise
+   };
+
+   struct RuleInstruction
+   {
+      RuleOpCode _op_code;
+      uint32_t _operand;
+   };
+
+   enum class RuleTermType : uint8_t
+   {
+      Bool,      // operand - 0 or 1
+      Predicate, // operand - predicate index
+      And,       // chain of && operands, operand - index of the chain order
+      Or         // chain of || operands, operand - index of the chain order
+   };
+
+   // a rule as nested chains of && and || operands, it's evaluated instead of the instructions once some of its chains are reordered
+   struct RuleTerm
+   {
+      RuleTermType _type;
+      uint32_t _operand;
+      std::vector<uint32_t> _operands; // terms of the chain operands in the source order
+   };
+
+   struct Rule
+   {
+      std::vector<RuleInstruction> _instructions;
+      size_t _max_stack_depth;
+      std::vector<RuleTerm> _terms; // the first term is the root
+   };
+
+   // a predicate can't fail if all its variables are passed, unless it parses values, e.g. of number variables
+   struct PredicateRequirements
+   {
+      std::vector<uint32_t> _slots;
+      bool _may_fail = false;
+   };
+
+   // operand positions in the order of evaluation are 4 bit nibbles of a chain order, so only chains of up to 16 operands are reordered
+   static constexpr size_t MaxReorderedOperands = 16;
+   static constexpr uint64_t SourceOrder = 0xFEDCBA9876543210ull;
+
+   // rules indexed by values of a single variable, a rule is listed under every value its conjunct allows
+   struct VariableIndex
+   {
+      uint32_t _slot;
+      std::unordered_map<std::string, std::vector<uint32_t>> _rules;
+   };
+
+   // every rule set gets a unique generation, so a context evaluated by another rule set (e.g. a previous version of it) isn't reevaluated
+   const uint64_t _generation = NewGeneration();
+   VariableSchema _schema;
+   // syntax trees are needed only while a rule is added, their nodes are allocated from the arena released by the next rule
+   std::array<std::byte, 16 * 1024> _arena_buffer;
+   std::pmr::monotonic_buffer_resource _arena{_arena_buffer.data(), _arena_buffer.size()};
+   ExpressionParser _parser{&_arena};
+   std::vector<Rule> _rules;
+   std::vector<std::unique_ptr<ExpressionProgram>> _predicates;
+   std::unordered_map<std::string, uint32_t> _predicate_indexes; // canonical form of a predicate -> predicate index
+   std::vector<SourceSpan> _predicate_spans;
+   std::vector<PredicateRequirements> _predicate_requirements;
+   std::vector<std::vector<uint32_t>> _predicate_rules;      // rules which use the predicate by predicate indexes
+   std::vector<std::vector<uint32_t>> _variable_predicates;  // predicates which take the variable by variable slots
+   // orders are swapped atomically by Replan while records are evaluated, the deques never move their items
+   std::deque<std::atomic<uint64_t>> _chain_orders;
+   std::deque<std::atomic<bool>> _reordered_rules;
+   StringView _rule_expression; // expression of the rule being added
+   size_t _max_stack_depth = 0;
+   std::vector<VariableIndex> _variable_indexes;
+   RuleBitmap _unindexed_rules;
+
+   bool CompileRule(const ExpressionNode* node, Rule& rule, size_t& stack_depth);
+   bool AddPredicate(const ExpressionNode* node, uint32_t& predicate_index);
+   uint32_t AddTerm(const ExpressionNode* node, size_t& instruction_index, Rule& rule);
+   static void CollectChain(const ExpressionNode* node, const TokenType operator_type, std::vector<const ExpressionNode*>& operands);
+   void PlanTerm(const Rule& rule, const uint32_t term_index, const RuleSetStatistics& statistics, double& probability, double& cost, bool& is_reordered);
+   void EstimatePredicate(const uint32_t predicate_index, const RuleSetStatistics& statistics, double& probability, double& cost) const;
+   static void FindSpan(const ExpressionNode* node, const char*& begin, const char*& end);
+   static const char* FindClosingBrackets(const char* begin, const char* end, const char* expression_end);
+   void IndexRule(const ExpressionNode* root, const uint32_t rule_index);
+
+   static uint64_t NewGeneration();
+   void PrepareContext(RuleSetContext& context) const;
+   template <typename VariableSource>
+   void FindCandidates(const VariableSource& variable_source, RuleSetContext& context) const;
+   bool GetValue(const VariableValues& variable_values, const uint32_t slot, StringView& value) const;
+   bool GetValue(const VariableRecord& variable_record, const uint32_t slot, StringView& value) const;
+   template <typename VariableSource>
+   bool FindFirstMatch(const VariableSource& variable_source, RuleSetContext& context, size_t& rule_index) const;
+   template <typename VariableSource>
+   bool FindAllMatches(const VariableSource& variable_source, RuleSetContext& context) const;
+
+   template <typename VariableSource>
+   bool Evaluate(const VariableSource& variable_source, RuleSetContext& context) const;
+   template <typename VariableSource>
+   bool Reevaluate(const VariableSource& variable_source, const std::vector<uint32_t>& changed_slots, RuleSetContext& context) const;
+   template <typename VariableSource>
+   bool EvaluateRule(const size_t rule_index, const VariableSource& variable_source, RuleSetContext& context, bool& result) const;
+   template <typename VariableSource>
+   bool ExecuteRule(const Rule& rule, const VariableSource& variable_source, RuleSetContext& context, bool& result) const;
+   template <typename VariableSource>
+   RuleSetContext::PredicateState EvaluatePredicate(const uint32_t predicate_index, const VariableSource& variable_source, RuleSetContext& context) const;
+   template <typename VariableSource>
+   RuleSetContext::PredicateState EvaluateTerm(const Rule& rule, const uint32_t term_index, const VariableSource& variable_source, RuleSetContext& context) const;
+   template <typename VariableSource>
+   bool MayFail(const Rule& rule, const uint32_t term_index, const VariableSource& variable_source, const RuleSetContext& context) const;
+   template <typename VariableSource>
+   bool ExecutePredicate(const uint32_t predicate_index, const VariableSource& variable_source, RuleSetContext& context, bool& result) const;
+};
+}
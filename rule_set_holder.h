@@ -0,0 +1,182 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+// This is a holder of the current version of a rule set (a RuleSet or a RuleSetImage), which is replaced while other threads evaluate records.
+// Readers take the current version without locks and without shared reference counters: every reader thread has its own slot,
+// where it announces the epoch it started reading in, so a read is a store to its own cache line and a load of the version pointer.
+// A writer compiles the new version on its own thread and publishes it with a single atomic exchange, the previous version is retired
+// with the epoch of the exchange and destroyed by writers once every reader has either left or started reading in a later epoch,
+// so evaluations in flight finish on the version they started with and readers never wait for a writer nor destroy anything.
+// Usage:
+//    RuleSetHolder<RuleSet> holder(std::move(rule_set));
+//    RuleSetHolder<RuleSet>::Reader reader(holder); // once per thread
+//    {
+//       RuleSetHolder<RuleSet>::ReadLock lock(reader);
+//       lock->FindAllMatches(variable_record, context);
+//    }
+//    holder.Publish(std::move(new_rule_set));         // on the writer thread
+namespace Renaissance
+{
+template <typename RuleSetType>
+class RuleSetHolder
+{
+public:
+   explicit RuleSetHolder(std::unique_ptr<const RuleSetType> rule_set = nullptr) : _current(rule_set.release()) {}
+   RuleSetHolder(const RuleSetHolder&) = delete;
+   RuleSetHolder(RuleSetHolder&&) = delete;
+   RuleSetHolder& operator =(const RuleSetHolder&) = delete;
+   RuleSetHolder& operator =(RuleSetHolder&&) = delete;
+   // all readers must be destroyed before the holder
+   ~RuleSetHolder()
+   {
+      delete _current.load(std::memory_order_relaxed);
+      for (auto& retired : _retired)
+         delete retired.second;
+   }
+
+   // a reader of a single thread, it must not be used by many threads at once
+   class Reader
+   {
+   public:
+      explicit Reader(RuleSetHolder& holder) : _holder(holder), _slot(holder.AddSlot()) {}
+      Reader(const Reader&) = delete;
+      Reader(Reader&&) = delete;
+      Reader& operator =(const Reader&) = delete;
+      Reader& operator =(Reader&&) = delete;
+      ~Reader() { _holder.RemoveSlot(_slot); }
+
+      // returns the current version, it stays alive until Unlock, locks might be nested
+      const RuleSetType* Lock()
+      {
+         if (_locks++ == 0)
+         {
+            _slot._epoch.store(_holder._epoch.load(std::memory_order_seq_cst), std::memory_order_seq_cst);
+            _rule_set = _holder._current.load(std::memory_order_seq_cst);
+         }
+         return _rule_set;
+      }
+
+      void Unlock()
+      {
+         if (--_locks == 0)
+            _slot._epoch.store(Idle, std::memory_order_release);
+      }
+
+   private:
+      RuleSetHolder& _holder;
+      typename RuleSetHolder::Slot& _slot;
+      size_t _locks = 0;
+      const RuleSetType* _rule_set = nullptr;
+   };
+
+   // the current version for the scope of the lock, it might be null if nothing is published yet
+   class ReadLock
+   {
+   public:
+      explicit ReadLock(Reader& reader) : _reader(reader), _rule_set(reader.Lock()) {}
+      ReadLock(const ReadLock&) = delete;
+      ReadLock(ReadLock&&) = delete;
+      ReadLock& operator =(const ReadLock&) = delete;
+      ReadLock& operator =(ReadLock&&) = delete;
+      ~ReadLock() { _reader.Unlock(); }
+
+      inline const RuleSetType* Get() const noexcept { return _rule_set; }
+      inline const RuleSetType* operator ->() const noexcept { return _rule_set; }
+      inline const RuleSetType& operator *() const noexcept { return *_rule_set; }
+      inline explicit operator bool() const noexcept { return _rule_set != nullptr; }
+
+   private:
+      Reader& _reader;
+      const RuleSetType* const _rule_set;
+   };
+
+   // make the rule set the current version, the previous one is destroyed as soon as no reader might use it
+   // it might be called by many writers, they are serialized
+   void Publish(std::unique_ptr<const RuleSetType> rule_set)
+   {
+      std::lock_guard<std::mutex> lock(_mutex);
+      const RuleSetType* const previous = _current.exchange(rule_set.release(), std::memory_order_seq_cst);
+      // readers which announce a later epoch load the pointer after the exchange
+      const uint64_t epoch = _epoch.fetch_add(1, std::memory_order_seq_cst);
+      if (previous != nullptr)
+         _retired.emplace_back(epoch, previous);
+      ReclaimRetired();
+   }
+
+   // destroy retired versions which are not used by readers any more, e.g. once the readers of the last published version are done
+   // returns the number of versions which are still retired
+   size_t Reclaim()
+   {
+      std::lock_guard<std::mutex> lock(_mutex);
+      ReclaimRetired();
+      return _retired.size();
+   }
+
+private:
+   static constexpr uint64_t Idle = 0;
+
+   // the slot of a reader is on its own cache line, so readers don't share lines written on every read
+   struct alignas(64) Slot
+   {
+      std::atomic<uint64_t> _epoch{Idle};
+      bool _is_used = false; // guarded by the holder mutex
+   };
+
+   std::atomic<const RuleSetType*> _current;
+   std::atomic<uint64_t> _epoch{Idle + 1};
+   std::mutex _mutex;                                                // guards the fields below
+   std::deque<Slot> _slots;                                          // the deque never moves its items
+   std::vector<std::pair<uint64_t, const RuleSetType*>> _retired;    // versions with the epochs they were retired in
+
+   Slot& AddSlot()
+   {
+      std::lock_guard<std::mutex> lock(_mutex);
+      for (auto& slot : _slots)
+      {
+         if (!slot._is_used)
+         {
+            slot._is_used = true;
+            return slot;
+         }
+      }
+      _slots.emplace_back();
+      _slots.back()._is_used = true;
+      return _slots.back();
+   }
+
+   void RemoveSlot(Slot& slot)
+   {
+      std::lock_guard<std::mutex> lock(_mutex);
+      slot._epoch.store(Idle, std::memory_order_release);
+      slot._is_used = false;
+   }
+
+   // a version retired in epoch E might be used only by readers which announced an epoch up to E
+   void ReclaimRetired()
+   {
+      uint64_t oldest_epoch = UINT64_MAX;
+      for (const auto& slot : _slots)
+      {
+         const uint64_t epoch = slot._epoch.load(std::memory_order_seq_cst);
+         if (epoch != Idle && epoch < oldest_epoch)
+            oldest_epoch = epoch;
+      }
+
+      size_t kept = 0;
+      for (auto& retired : _retired)
+      {
+         if (retired.first < oldest_epoch)
+            delete retired.second;
+         else
+            _retired[kept++] = retired;
+      }
+      _retired.resize(kept);
+   }
+};
+}
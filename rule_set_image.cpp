@@ -0,0 +1,509 @@
+#include "rule_set_image.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <numeric>
+#include <type_traits>
+#include <unordered_map>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "program_executor.h"
+
+namespace Renaissance
+{
+// instructions are mapped as they are, so a change of their layout must change the version of the format
+static_assert(std::is_trivially_copyable<Instruction>::value && sizeof(Instruction) == 12, "the layout of instructions is a part of the image format");
+
+const char RuleSetImage::Magic[8] = {'R', 'U', 'L', 'E', 'S', 'E', 'T', '\0'};
+
+// collects items of the image sections and lays them out, equal strings are stored in the pool once
+class RuleSetImage::Writer
+{
+public:
+   template <typename Item>
+   uint32_t Append(const Section section, const Item& item)
+   {
+      static_assert(std::is_trivially_copyable<Item>::value, "image items are copied as they are");
+      _sections[section].append(reinterpret_cast<const char*>(&item), sizeof(Item));
+      return _counts[section]++;
+   }
+
+   ImageString AddString(const StringView& value)
+   {
+      auto it = _strings.find(std::string(value.data(), value.size()));
+      if (it != _strings.end())
+         return it->second;
+
+      const ImageString string = {static_cast<uint32_t>(_sections[Chars].size()), static_cast<uint32_t>(value.size())};
+      _sections[Chars].append(value.data(), value.size());
+      _counts[Chars] += static_cast<uint32_t>(value.size());
+      _strings.emplace(std::string(value.data(), value.size()), string);
+      return string;
+   }
+
+   inline uint32_t Count(const Section section) const { return _counts[section]; }
+
+   void Write(const uint32_t max_stack_depth, std::string& image) const
+   {
+      ImageHeader header;
+      std::memset(&header, 0, sizeof(header));
+      std::memcpy(header._magic, Magic, sizeof(Magic));
+      header._version = Version;
+      header._byte_order = ByteOrderMark;
+      header._max_stack_depth = max_stack_depth;
+
+      image.assign(sizeof(header), '\0');
+      for (size_t i = 0; i < SectionsNumber; i++)
+      {
+         image.resize((image.size() + 7) & ~size_t(7), '\0');
+         header._sections[i]._offset = image.size();
+         header._sections[i]._count = _counts[i];
+         image += _sections[i];
+      }
+      header._size = image.size();
+      std::memcpy(&image[0], &header, sizeof(header));
+   }
+
+private:
+   std::string _sections[SectionsNumber];
+   uint32_t _counts[SectionsNumber] = {};
+   std::unordered_map<std::string, ImageString> _strings;
+};
+
+RuleSetImage::~RuleSetImage()
+{
+   Unload();
+}
+
+// write the image of the compiled rule set into the 'image' buffer
+// rules are saved with their programs in the source order, orders planned by RuleSet::Replan are not saved
+void RuleSetImage::Build(const RuleSet& rule_set, std::string& image)
+{
+   Writer writer;
+
+   const VariableSchema& schema = rule_set._schema;
+   std::vector<uint32_t> sorted_variables(schema.Size());
+   std::iota(sorted_variables.begin(), sorted_variables.end(), 0);
+   std::sort(sorted_variables.begin(), sorted_variables.end(),
+             [&schema](const uint32_t left, const uint32_t right) { return schema.VariableName(left) < schema.VariableName(right); });
+   for (uint32_t slot = 0; slot < schema.Size(); slot++)
+      writer.Append(Variables, ImageVariable{writer.AddString(schema.VariableName(slot)), static_cast<uint32_t>(schema.GetVariableType(slot))});
+   for (const uint32_t slot : sorted_variables)
+      writer.Append(SortedVariables, slot);
+
+   for (const auto& program : rule_set._predicates)
+   {
+      ImagePredicate predicate;
+      predicate._instructions = {writer.Count(Instructions), static_cast<uint32_t>(program->Instructions().size())};
+      for (const Instruction& instruction : program->Instructions())
+      {
+         // padding bytes are cleared, so equal rule sets give equal images
+         Instruction image_instruction;
+         std::memset(&image_instruction, 0, sizeof(image_instruction));
+         image_instruction._op_code = instruction._op_code;
+         image_instruction._operand = instruction._operand;
+         image_instruction._operand2 = instruction._operand2;
+         writer.Append(Instructions, image_instruction);
+      }
+
+      predicate._constants = {writer.Count(Constants), static_cast<uint32_t>(program->Constants().size())};
+      for (const auto& constant : program->Constants())
+         writer.Append(Constants, writer.AddString(constant));
+
+      predicate._numbers = {writer.Count(Numbers), static_cast<uint32_t>(program->Numbers().size())};
+      for (const int64_t number : program->Numbers())
+         writer.Append(Numbers, number);
+
+      predicate._sets = {writer.Count(Sets), static_cast<uint32_t>(program->Arrays().size())};
+      for (const StringSet& set : program->Arrays())
+      {
+         ImageStringSet image_set = {set.LengthsMask(), {writer.Count(SetItems), static_cast<uint32_t>(set.Size())},
+                                     {writer.Count(SetBuckets), static_cast<uint32_t>(set.Buckets().size())}};
+         for (size_t i = 0; i < set.Size(); i++)
+         {
+            writer.Append(SetItems, writer.AddString(set.Items()[i]));
+            writer.Append(SetHashes, set.Hashes().empty() ? StringSet::Hash(set.Items()[i]) : set.Hashes()[i]);
+         }
+         for (const uint32_t bucket : set.Buckets())
+            writer.Append(SetBuckets, bucket);
+         writer.Append(Sets, image_set);
+      }
+
+      predicate._number_arrays = {writer.Count(NumberArrays), static_cast<uint32_t>(program->NumberArrays().size())};
+      for (const auto& array : program->NumberArrays())
+      {
+         writer.Append(NumberArrays, ImageRange{writer.Count(NumberArrayItems), static_cast<uint32_t>(array.size())});
+         for (const int64_t number : array)
+            writer.Append(NumberArrayItems, number);
+      }
+
+      predicate._prefix_sets = {writer.Count(PrefixSets), static_cast<uint32_t>(program->PrefixSets().size())};
+      for (const PrefixSet& set : program->PrefixSets())
+      {
+         writer.Append(PrefixSets, ImageRange{writer.Count(PrefixItems), static_cast<uint32_t>(set.Size())});
+         for (const auto& item : set.Items())
+            writer.Append(PrefixItems, writer.AddString(item));
+      }
+
+      predicate._range_sets = {writer.Count(RangeSets), static_cast<uint32_t>(program->RangeSets().size())};
+      for (const RangeSet& set : program->RangeSets())
+      {
+         writer.Append(RangeSets, ImageRange{writer.Count(RangeBounds), static_cast<uint32_t>(set.Bounds().size())});
+         for (const int64_t bound : set.Bounds())
+            writer.Append(RangeBounds, bound);
+      }
+
+      predicate._max_stack_depth = static_cast<uint32_t>(program->MaxStackDepth());
+      writer.Append(Predicates, predicate);
+   }
+
+   for (const auto& rule : rule_set._rules)
+   {
+      writer.Append(Rules, ImageRule{{writer.Count(RuleInstructions), static_cast<uint32_t>(rule._instructions.size())}});
+      for (const auto& instruction : rule._instructions)
+         writer.Append(RuleInstructions, ImageRuleInstruction{static_cast<uint32_t>(instruction._op_code), instruction._operand});
+   }
+
+   for (const auto& index : rule_set._variable_indexes)
+   {
+      std::vector<const std::pair<const std::string, std::vector<uint32_t>>*> entries;
+      for (const auto& entry : index._rules)
+         entries.push_back(&entry);
+      std::sort(entries.begin(), entries.end(), [](const auto* left, const auto* right) { return left->first < right->first; });
+
+      writer.Append(VariableIndexes, ImageVariableIndex{index._slot, {writer.Count(IndexEntries), static_cast<uint32_t>(entries.size())}});
+      for (const auto* entry : entries)
+      {
+         writer.Append(IndexEntries, ImageIndexEntry{writer.AddString(entry->first), {writer.Count(IndexRules), static_cast<uint32_t>(entry->second.size())}});
+         for (const uint32_t rule_index : entry->second)
+            writer.Append(IndexRules, rule_index);
+      }
+   }
+
+   for (size_t i = rule_set._unindexed_rules.find_first(); i != RuleBitmap::npos; i = rule_set._unindexed_rules.find_next(i))
+      writer.Append(UnindexedRules, static_cast<uint32_t>(i));
+
+   writer.Write(static_cast<uint32_t>(rule_set._max_stack_depth), image);
+}
+
+// write the image of the compiled rule set into the file
+// returns true if successful
+bool RuleSetImage::Save(const RuleSet& rule_set, const std::string& path)
+{
+   std::string image;
+   Build(rule_set, image);
+   std::ofstream file(path, std::ios::binary | std::ios::trunc);
+   file.write(image.data(), image.size());
+   return static_cast<bool>(file);
+}
+
+// map the image file read-only, the previous image is unloaded
+// returns true if successful
+bool RuleSetImage::Load(const std::string& path)
+{
+   Unload();
+
+   const int file = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+   if (file < 0)
+      return false;
+
+   struct stat file_status;
+   void* mapping = MAP_FAILED;
+   if (fstat(file, &file_status) == 0 && file_status.st_size > 0)
+      mapping = mmap(nullptr, static_cast<size_t>(file_status.st_size), PROT_READ, MAP_SHARED, file, 0);
+   close(file); // the mapping keeps the file
+   if (mapping == MAP_FAILED)
+      return false;
+
+   // the image is attached before the mapping is taken, as attaching unloads the previous image
+   if (!Attach(mapping, static_cast<size_t>(file_status.st_size)))
+   {
+      munmap(mapping, static_cast<size_t>(file_status.st_size));
+      return false;
+   }
+   _mapping = mapping;
+   _mapping_size = static_cast<size_t>(file_status.st_size);
+   return true;
+}
+
+// use the image in the buffer, e.g. built by Build, the buffer must be aligned to 8 bytes and outlive the image
+// returns false if the buffer doesn't hold an image of this version
+bool RuleSetImage::Attach(const void* data, const size_t size)
+{
+   Unload();
+
+   if (data == nullptr || reinterpret_cast<uintptr_t>(data) % 8 != 0 || size < sizeof(ImageHeader))
+      return false;
+
+   const char* const image = static_cast<const char*>(data);
+   const ImageHeader* const header = reinterpret_cast<const ImageHeader*>(image);
+   if (std::memcmp(header->_magic, Magic, sizeof(Magic)) != 0 || header->_version != Version || header->_byte_order != ByteOrderMark || header->_size > size)
+      return false;
+
+   const size_t item_sizes[SectionsNumber] = {sizeof(char), sizeof(ImageVariable), sizeof(uint32_t), sizeof(Instruction), sizeof(ImageString), sizeof(int64_t),
+                                              sizeof(ImageString), sizeof(uint64_t), sizeof(uint32_t), sizeof(ImageStringSet), sizeof(int64_t), sizeof(ImageRange),
+                                              sizeof(ImageString), sizeof(ImageRange), sizeof(int64_t), sizeof(ImageRange),
+                                              sizeof(ImagePredicate), sizeof(ImageRuleInstruction), sizeof(ImageRule), sizeof(ImageVariableIndex),
+                                              sizeof(ImageIndexEntry), sizeof(uint32_t), sizeof(uint32_t)};
+   for (size_t i = 0; i < SectionsNumber; i++)
+   {
+      const ImageSection& section = header->_sections[i];
+      if (section._offset % 8 != 0 || section._offset > header->_size || section._count > (header->_size - section._offset) / item_sizes[i])
+         return false;
+   }
+
+   const auto section = [image, header](const Section section) { return image + header->_sections[section]._offset; };
+   _chars = section(Chars);
+   _variables = reinterpret_cast<const ImageVariable*>(section(Variables));
+   _sorted_variables = reinterpret_cast<const uint32_t*>(section(SortedVariables));
+   _instructions = reinterpret_cast<const Instruction*>(section(Instructions));
+   _constants = reinterpret_cast<const ImageString*>(section(Constants));
+   _numbers = reinterpret_cast<const int64_t*>(section(Numbers));
+   _set_items = reinterpret_cast<const ImageString*>(section(SetItems));
+   _set_hashes = reinterpret_cast<const uint64_t*>(section(SetHashes));
+   _set_buckets = reinterpret_cast<const uint32_t*>(section(SetBuckets));
+   _sets = reinterpret_cast<const ImageStringSet*>(section(Sets));
+   _number_array_items = reinterpret_cast<const int64_t*>(section(NumberArrayItems));
+   _number_arrays = reinterpret_cast<const ImageRange*>(section(NumberArrays));
+   _prefix_items = reinterpret_cast<const ImageString*>(section(PrefixItems));
+   _prefix_sets = reinterpret_cast<const ImageRange*>(section(PrefixSets));
+   _range_bounds = reinterpret_cast<const int64_t*>(section(RangeBounds));
+   _range_sets = reinterpret_cast<const ImageRange*>(section(RangeSets));
+   _predicates = reinterpret_cast<const ImagePredicate*>(section(Predicates));
+   _rule_instructions = reinterpret_cast<const ImageRuleInstruction*>(section(RuleInstructions));
+   _rules = reinterpret_cast<const ImageRule*>(section(Rules));
+   _variable_indexes = reinterpret_cast<const ImageVariableIndex*>(section(VariableIndexes));
+   _index_entries = reinterpret_cast<const ImageIndexEntry*>(section(IndexEntries));
+   _index_rules = reinterpret_cast<const uint32_t*>(section(IndexRules));
+   _unindexed_rules = reinterpret_cast<const uint32_t*>(section(UnindexedRules));
+   _header = header;
+   return true;
+}
+
+void RuleSetImage::Unload()
+{
+   if (_mapping != nullptr)
+      munmap(_mapping, _mapping_size);
+   _mapping = nullptr;
+   _mapping_size = 0;
+   _header = nullptr;
+}
+
+// evaluate all rules with variables values given by slots of the image variables
+// results are returned in the 'context', returns false if some rules couldn't be evaluated
+bool RuleSetImage::Evaluate(const VariableRecord& variable_record, RuleSetContext& context) const
+{
+   PrepareContext(context);
+
+   for (uint32_t i = 0; i < RulesNumber(); i++)
+   {
+      bool result = false;
+      if (!ExecuteRule(i, variable_record, context, result))
+         context._failures.set(i);
+      else if (result)
+         context._matches.set(i);
+   }
+   return context._failures.none();
+}
+
+// find the first matching rule for variables values given by slots of the image variables, see RuleSet::FindFirstMatch
+// returns true if a matching rule is found, its index is returned in the 'rule_index' output parameter
+bool RuleSetImage::FindFirstMatch(const VariableRecord& variable_record, RuleSetContext& context, size_t& rule_index) const
+{
+   PrepareContext(context);
+   FindCandidates(variable_record, context);
+
+   for (size_t i = context._candidates.find_first(); i != RuleBitmap::npos; i = context._candidates.find_next(i))
+   {
+      bool result = false;
+      if (!ExecuteRule(static_cast<uint32_t>(i), variable_record, context, result))
+         context._failures.set(i);
+      else if (result)
+      {
+         context._matches.set(i);
+         rule_index = i;
+         return true;
+      }
+   }
+   return false;
+}
+
+// find all matching rules for variables values given by slots of the image variables, see RuleSet::FindAllMatches
+// returns false if some of the evaluated rules couldn't be evaluated
+bool RuleSetImage::FindAllMatches(const VariableRecord& variable_record, RuleSetContext& context) const
+{
+   PrepareContext(context);
+   FindCandidates(variable_record, context);
+
+   for (size_t i = context._candidates.find_first(); i != RuleBitmap::npos; i = context._candidates.find_next(i))
+   {
+      bool result = false;
+      if (!ExecuteRule(static_cast<uint32_t>(i), variable_record, context, result))
+         context._failures.set(i);
+      else if (result)
+         context._matches.set(i);
+   }
+   return context._failures.none();
+}
+
+// search for a variable of the image, its slot is returned in the 'slot' output parameter
+// returns true if the variable is found
+bool RuleSetImage::FindVariable(const StringView& name, uint32_t& slot) const
+{
+   const uint32_t* const begin = _sorted_variables;
+   const uint32_t* const end = _sorted_variables + VariablesNumber();
+   const uint32_t* it = std::lower_bound(begin, end, name, [this](const uint32_t slot, const StringView& name) { return VariableName(slot) < name; });
+   if (it == end || VariableName(*it) != name)
+      return false;
+
+   slot = *it;
+   return true;
+}
+
+StringView RuleSetImage::VariableName(const uint32_t slot) const
+{
+   return String(_variables[slot]._name);
+}
+
+VariableType RuleSetImage::GetVariableType(const uint32_t slot) const
+{
+   return static_cast<VariableType>(_variables[slot]._type);
+}
+
+bool RuleSetImage::SetContains(const uint32_t set_index, const StringView& value) const
+{
+   const ImageStringSet& set = _sets[set_index];
+   return StringSet::Contains(value, set._lengths_mask, set._items._number, _set_buckets + set._buckets._first, set._buckets._number, _set_hashes + set._items._first,
+                              [this, &set](const size_t index) { return String(_set_items[set._items._first + index]); });
+}
+
+bool RuleSetImage::Program::NumberArrayContains(const uint32_t index, const int64_t number) const
+{
+   const ImageRange& array = _image._number_arrays[_predicate._number_arrays._first + index];
+   const int64_t* const begin = _image._number_array_items + array._first;
+   return std::binary_search(begin, begin + array._number, number);
+}
+
+bool RuleSetImage::Program::PrefixSetContains(const uint32_t index, const StringView& value) const
+{
+   const ImageRange& set = _image._prefix_sets[_predicate._prefix_sets._first + index];
+   return PrefixSet::Contains(value, set._number, [this, &set](const size_t item) { return _image.String(_image._prefix_items[set._first + item]); });
+}
+
+bool RuleSetImage::Program::RangeSetContains(const uint32_t index, const int64_t number) const
+{
+   const ImageRange& set = _image._range_sets[_predicate._range_sets._first + index];
+   return RangeSet::Contains(number, _image._range_bounds + set._first, set._number);
+}
+
+// reset the context for a new record, the context profile is not used for images
+void RuleSetImage::PrepareContext(RuleSetContext& context) const
+{
+   context._predicate_states.assign(PredicatesNumber(), RuleSetContext::PredicateState::Unknown);
+   context._stack.resize(IsLoaded() ? _header->_max_stack_depth : 0);
+   context._matches.resize(RulesNumber());
+   context._matches.reset();
+   context._failures.resize(RulesNumber());
+   context._failures.reset();
+   context._predicate_evaluations = 0;
+   context._rule_evaluations = 0;
+   context._is_sampled = false;
+   context._evaluated_generation = 0;
+}
+
+// collect rules consistent with the index into the context candidates, values are looked up by a binary search of the sorted entries
+void RuleSetImage::FindCandidates(const VariableRecord& variable_record, RuleSetContext& context) const
+{
+   context._candidates.resize(RulesNumber());
+   context._candidates.reset();
+   const size_t unindexed_rules_number = _header->_sections[UnindexedRules]._count;
+   for (size_t i = 0; i < unindexed_rules_number; i++)
+      context._candidates.set(_unindexed_rules[i]);
+
+   const VariableRecordSource variable_source(variable_record);
+   const size_t indexes_number = _header->_sections[VariableIndexes]._count;
+   for (size_t i = 0; i < indexes_number; i++)
+   {
+      // rules of a missing variable can't be true, as their conjunct fails
+      StringView value;
+      if (!variable_source.GetValue(_variable_indexes[i]._slot, value))
+         continue;
+
+      const ImageIndexEntry* const begin = _index_entries + _variable_indexes[i]._entries._first;
+      const ImageIndexEntry* const end = begin + _variable_indexes[i]._entries._number;
+      const ImageIndexEntry* entry = std::lower_bound(begin, end, value, [this](const ImageIndexEntry& entry, const StringView& value) { return String(entry._value) < value; });
+      if (entry == end || String(entry->_value) != value)
+         continue;
+
+      for (uint32_t j = 0; j < entry->_rules._number; j++)
+         context._candidates.set(_index_rules[entry->_rules._first + j]);
+   }
+}
+
+bool RuleSetImage::ExecuteRule(const uint32_t rule_index, const VariableRecord& variable_record, RuleSetContext& context, bool& result) const
+{
+   ++context._rule_evaluations;
+   auto& stack = context._stack;
+   size_t top = 0; // number of values on the stack
+
+   const ImageRuleInstruction* const instructions = _rule_instructions + _rules[rule_index]._instructions._first;
+   const size_t instructions_number = _rules[rule_index]._instructions._number;
+   size_t current = 0;
+   while (current < instructions_number)
+   {
+      const ImageRuleInstruction& instruction = instructions[current++];
+      switch (static_cast<RuleSet::RuleOpCode>(instruction._op_code))
+      {
+         case RuleSet::RuleOpCode::PushBool:
+            stack[top++] = (instruction._operand != 0);
+            break;
+         case RuleSet::RuleOpCode::PushPredicate:
+         {
+            const auto state = EvaluatePredicate(instruction._operand, variable_record, context);
+            if (state == RuleSetContext::PredicateState::Failed)
+               return false;
+            stack[top++] = (state == RuleSetContext::PredicateState::True);
+            break;
+         }
+         case RuleSet::RuleOpCode::JumpIfFalseOrPop:
+            if (!stack[top - 1])
+               current = instruction._operand;
+            else
+               --top;
+            break;
+         case RuleSet::RuleOpCode::JumpIfTrueOrPop:
+            if (stack[top - 1])
+               current = instruction._operand;
+            else
+               --top;
+            break;
+         default:
+            return false; // unknown instruction
+      }
+   }
+
+   if (top != 1)
+      return false;
+
+   result = stack[0];
+   return true;
+}
+
+// evaluate the predicate unless it's already evaluated for the record
+RuleSetContext::PredicateState RuleSetImage::EvaluatePredicate(const uint32_t predicate_index, const VariableRecord& variable_record, RuleSetContext& context) const
+{
+   auto& state = context._predicate_states[predicate_index];
+   if (state == RuleSetContext::PredicateState::Unknown)
+   {
+      ++context._predicate_evaluations;
+      bool predicate_result = false;
+      if (!ExecuteProgram(Program(*this, _predicates[predicate_index]), VariableRecordSource(variable_record), predicate_result))
+         state = RuleSetContext::PredicateState::Failed;
+      else
+         state = (predicate_result ? RuleSetContext::PredicateState::True : RuleSetContext::PredicateState::False);
+   }
+   return state;
+}
+}
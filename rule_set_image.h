@@ -0,0 +1,221 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include "common.h"
+#include "expression_program.h"
+#include "rule_set.h"
+
+// This is a compiled RuleSet saved in a versioned binary format, so a process starts without parsing and compiling its rules.
+// The image holds the predicate programs with their constants, the precomputed hash tables of array sets, the sorted prefix and range sets, the rule programs,
+// the variable slots and the rule index. All items are fixed size records and strings are offsets into a single string pool,
+// so an image mapped from a file with Load is evaluated in place: loading doesn't parse the rules or allocate memory per rule,
+// and the pages of the file are shared read-only by all processes which load it through the page cache.
+// Images are evaluated over records of the variable slots, the rules are executed in their source order and there is no profiling.
+// Images are trusted like the shared objects of generated rules: the header and sections are checked, the programs are not.
+namespace Renaissance
+{
+class RuleSetImage
+{
+public:
+   RuleSetImage() = default;
+   RuleSetImage(const RuleSetImage&) = delete;
+   RuleSetImage(RuleSetImage&&) = delete;
+   RuleSetImage& operator =(const RuleSetImage&) = delete;
+   RuleSetImage& operator =(RuleSetImage&&) = delete;
+   ~RuleSetImage();
+
+   static void Build(const RuleSet& rule_set, std::string& image);
+   static bool Save(const RuleSet& rule_set, const std::string& path);
+
+   bool Load(const std::string& path);
+   bool Attach(const void* data, const size_t size);
+
+   bool Evaluate(const VariableRecord& variable_record, RuleSetContext& context) const;
+   bool FindFirstMatch(const VariableRecord& variable_record, RuleSetContext& context, size_t& rule_index) const;
+   bool FindAllMatches(const VariableRecord& variable_record, RuleSetContext& context) const;
+
+   bool FindVariable(const StringView& name, uint32_t& slot) const;
+   StringView VariableName(const uint32_t slot) const;
+   VariableType GetVariableType(const uint32_t slot) const;
+
+   inline bool IsLoaded() const noexcept { return _header != nullptr; }
+   inline size_t VariablesNumber() const noexcept { return IsLoaded() ? _header->_sections[Variables]._count : 0; }
+   inline size_t RulesNumber() const noexcept { return IsLoaded() ? _header->_sections[Rules]._count : 0; }
+   inline size_t PredicatesNumber() const noexcept { return IsLoaded() ? _header->_sections[Predicates]._count : 0; }
+
+   // the version of the format, images of other versions are not loaded
+   static constexpr uint32_t Version = 2;
+
+private:
+   enum Section : uint32_t
+   {
+      Chars,            // string pool
+      Variables,        // ImageVariable by slots
+      SortedVariables,  // slots sorted by variable names
+      Instructions,     // Instruction of all predicates
+      Constants,        // ImageString of all predicates
+      Numbers,          // int64_t of all predicates
+      SetItems,         // ImageString of all array sets
+      SetHashes,        // uint64_t hash of every set item
+      SetBuckets,       // uint32_t item index + 1 of all hashed sets
+      Sets,             // ImageStringSet of all predicates
+      NumberArrayItems, // int64_t of all number arrays, every array is sorted
+      NumberArrays,     // ImageRange of number array items
+      PrefixItems,      // ImageString of all prefix sets, every set is sorted
+      PrefixSets,       // ImageRange of prefix set items
+      RangeBounds,      // int64_t of all range sets, every set is sorted
+      RangeSets,        // ImageRange of range set bounds
+      Predicates,       // ImagePredicate
+      RuleInstructions, // ImageRuleInstruction of all rules
+      Rules,            // ImageRule
+      VariableIndexes,  // ImageVariableIndex
+      IndexEntries,     // ImageIndexEntry of all indexes, entries of an index are sorted by values
+      IndexRules,       // uint32_t rule indexes of all entries
+      UnindexedRules,   // uint32_t rule indexes
+      SectionsNumber
+   };
+
+   // items of a section from '_first' to '_first + _number'
+   struct ImageRange
+   {
+      uint32_t _first;
+      uint32_t _number;
+   };
+
+   // chars of the string pool
+   struct ImageString
+   {
+      uint32_t _offset;
+      uint32_t _length;
+   };
+
+   struct ImageVariable
+   {
+      ImageString _name;
+      uint32_t _type;
+   };
+
+   // set items and their hashes have the same indexes, there are no buckets for sets searched linearly
+   struct ImageStringSet
+   {
+      uint64_t _lengths_mask;
+      ImageRange _items;
+      ImageRange _buckets;
+   };
+
+   // operands of the instructions are indexes in the ranges of the predicate
+   struct ImagePredicate
+   {
+      ImageRange _instructions;
+      ImageRange _constants;
+      ImageRange _numbers;
+      ImageRange _sets;
+      ImageRange _number_arrays;
+      ImageRange _prefix_sets;
+      ImageRange _range_sets;
+      uint32_t _max_stack_depth;
+   };
+
+   struct ImageRuleInstruction
+   {
+      uint32_t _op_code; // RuleSet::RuleOpCode
+      uint32_t _operand;
+   };
+
+   struct ImageRule
+   {
+      ImageRange _instructions;
+   };
+
+   struct ImageVariableIndex
+   {
+      uint32_t _slot;
+      ImageRange _entries;
+   };
+
+   struct ImageIndexEntry
+   {
+      ImageString _value;
+      ImageRange _rules;
+   };
+
+   struct ImageSection
+   {
+      uint64_t _offset; // from the beginning of the image, aligned to 8 bytes
+      uint64_t _count;  // number of items
+   };
+
+   struct ImageHeader
+   {
+      char _magic[8];
+      uint32_t _version;
+      uint32_t _byte_order;      // ByteOrderMark written in the byte order of the machine which built the image
+      uint64_t _size;
+      uint32_t _max_stack_depth; // of the rule programs
+      uint32_t _reserved;
+      ImageSection _sections[SectionsNumber];
+   };
+
+   // the predicate program interface of ExecuteProgram
+   class Program
+   {
+   public:
+      Program(const RuleSetImage& image, const ImagePredicate& predicate) : _image(image), _predicate(predicate) {}
+
+      inline size_t InstructionsNumber() const noexcept { return _predicate._instructions._number; }
+      inline const Instruction& GetInstruction(const size_t index) const { return _image._instructions[_predicate._instructions._first + index]; }
+      inline StringView Constant(const uint32_t index) const { return _image.String(_image._constants[_predicate._constants._first + index]); }
+      inline int64_t Number(const uint32_t index) const { return _image._numbers[_predicate._numbers._first + index]; }
+      inline bool ArrayContains(const uint32_t index, const StringView& value) const { return _image.SetContains(_predicate._sets._first + index, value); }
+      bool NumberArrayContains(const uint32_t index, const int64_t number) const;
+      bool PrefixSetContains(const uint32_t index, const StringView& value) const;
+      bool RangeSetContains(const uint32_t index, const int64_t number) const;
+      inline size_t MaxStackDepth() const noexcept { return _predicate._max_stack_depth; }
+
+   private:
+      const RuleSetImage& _image;
+      const ImagePredicate& _predicate;
+   };
+
+   class Writer;
+
+   static const char Magic[8];
+   static constexpr uint32_t ByteOrderMark = 0x01020304;
+
+   void* _mapping = nullptr; // the mapped file, null if the image is attached to a buffer
+   size_t _mapping_size = 0;
+   const ImageHeader* _header = nullptr;
+   const char* _chars = nullptr;
+   const ImageVariable* _variables = nullptr;
+   const uint32_t* _sorted_variables = nullptr;
+   const Instruction* _instructions = nullptr;
+   const ImageString* _constants = nullptr;
+   const int64_t* _numbers = nullptr;
+   const ImageString* _set_items = nullptr;
+   const uint64_t* _set_hashes = nullptr;
+   const uint32_t* _set_buckets = nullptr;
+   const ImageStringSet* _sets = nullptr;
+   const int64_t* _number_array_items = nullptr;
+   const ImageRange* _number_arrays = nullptr;
+   const ImageString* _prefix_items = nullptr;
+   const ImageRange* _prefix_sets = nullptr;
+   const int64_t* _range_bounds = nullptr;
+   const ImageRange* _range_sets = nullptr;
+   const ImagePredicate* _predicates = nullptr;
+   const ImageRuleInstruction* _rule_instructions = nullptr;
+   const ImageRule* _rules = nullptr;
+   const ImageVariableIndex* _variable_indexes = nullptr;
+   const ImageIndexEntry* _index_entries = nullptr;
+   const uint32_t* _index_rules = nullptr;
+   const uint32_t* _unindexed_rules = nullptr;
+
+   void Unload();
+   inline StringView String(const ImageString& string) const { return StringView(_chars + string._offset, string._length); }
+   bool SetContains(const uint32_t set_index, const StringView& value) const;
+
+   void PrepareContext(RuleSetContext& context) const;
+   void FindCandidates(const VariableRecord& variable_record, RuleSetContext& context) const;
+   bool ExecuteRule(const uint32_t rule_index, const VariableRecord& variable_record, RuleSetContext& context, bool& result) const;
+   RuleSetContext::PredicateState EvaluatePredicate(const uint32_t predicate_index, const VariableRecord& variable_record, RuleSetContext& context) const;
+};
+}
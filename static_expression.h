@@ -0,0 +1,745 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include "common.h"
+#include "string_functions.h"
+
+// This is a header-only API to parse expressions hard-coded as string literals at compile time, e.g.
+//    RENAISSANCE_STATIC_EXPRESSION(MtRule, "IN.MT == 1 && SUBSTR{IN.TID, 3, 1} == [\"9\", \"L\"]");
+//    bool result = false;
+//    bool success = EvaluateStatic<MtRule>(variable_record, result);
+// The literal is parsed by a constexpr parser into a tree of nodes, an invalid expression fails the build.
+// EvaluateStatic is instantiated for every node of the tree, so evaluation compiles down to inlined comparisons with literals.
+// The grammar and the type rules are the same as of ExpressionParser and ExpressionEvaluator::Compile for infix expressions, including PREFIX and IN RANGES,
+// the parser only doesn't accept operators and operands out of the infix order, which the runtime parser doesn't reject.
+// Results are the same as of ExpressionEvaluator, including evaluation failures and the short-circuit semantics.
+// Variables get slots by their first occurrence in the expression, the variable record passed for evaluation is indexed by them.
+// There is no schema to tag variables as numbers, so all variables are strings and comparisons of number literals are folded while parsing,
+// variables compared with number literals by relational operators, which ExpressionEvaluator::Compile infers as numbers, are rejected.
+namespace Renaissance
+{
+enum class StaticNodeType : uint8_t
+{
+   Literal,         // string or number, _is_number
+   Variable,        // _slot
+   Substr,          // SUBSTR{source, from, length}, from and length are children unless _constant_position
+   Array,           // array of literals
+   And,             // child1 && child2
+   Or,              // child1 || child2
+   CompareStrings,  // child1 _operator child2, == or !=
+   CompareBooleans, // child1 _operator child2
+   InArray,         // child1 == array (or != array)
+   Prefix,          // child1 PREFIX array
+   InRanges,        // child1 IN RANGES array, the array has pairs of number bounds
+   Constant         // _value, comparison of number literals
+};
+
+struct StaticNode
+{
+   StaticNodeType _type = StaticNodeType::Literal;
+   TokenType _operator = TokenType::OperatorEqual;
+   size_t _begin = 0;        // position of the literal or variable name in the expression text
+   size_t _length = 0;
+   size_t _slot = 0;
+   size_t _first_link = 0;   // children of the node are _links[_first_link] ... _links[_first_link + _links_number - 1]
+   size_t _links_number = 0;
+   bool _is_number = false;
+   bool _value = false;
+   bool _constant_position = false;
+   uint32_t _from = 0;
+   uint32_t _substr_length = 0;
+};
+
+template <size_t TextSize>
+class StaticExpression
+{
+public:
+   constexpr explicit StaticExpression(const char (&text)[TextSize])
+   {
+      for (size_t i = 0; i < TextSize; i++)
+         _text[i] = text[i];
+      _valid = Parse();
+   }
+
+   constexpr bool IsValid() const noexcept { return _valid; }
+   // true if the expression has no operands (e.g. "" or "()"), such expression is evaluated as true
+   constexpr bool IsEmpty() const noexcept { return _empty; }
+   constexpr size_t Root() const noexcept { return _root; }
+   constexpr const StaticNode& Node(const size_t index) const { return _nodes[index]; }
+   constexpr size_t Link(const size_t index) const { return _links[index]; }
+   constexpr size_t VariablesNumber() const noexcept { return _variables_number; }
+   constexpr StringView VariableName(const size_t slot) const { return Text(_nodes[_variables[slot]]); }
+   constexpr StringView Text(const StaticNode& node) const { return StringView(_text + node._begin, node._length); }
+
+private:
+   enum class ValueType
+   {
+      Boolean,
+      String,
+      Array
+   };
+
+   // the text ends with '\0', every node takes at least one char of the text and every node but the root is linked once
+   static const size_t End = TextSize - 1;
+
+   char _text[TextSize] = {};
+   StaticNode _nodes[TextSize] = {};
+   size_t _links[TextSize] = {};
+   size_t _variables[TextSize] = {}; // nodes of the first occurrences of variables by their slots
+   size_t _nodes_number = 0;
+   size_t _links_number = 0;
+   size_t _variables_number = 0;
+   size_t _root = 0;
+   size_t _position = 0;
+   bool _valid = false;
+   bool _empty = false;
+
+   constexpr bool Parse()
+   {
+      // the runtime parser gives an empty tree for an expression without operands, e.g. "" or "(())"
+      size_t depth = 0;
+      _empty = true;
+      for (size_t i = 0; i < End && _empty; i++)
+      {
+         if (_text[i] == '(')
+            depth++;
+         else if (_text[i] == ')' && depth > 0)
+            depth--;
+         else if (!IsSpaceChar(_text[i]))
+            _empty = false;
+      }
+      if (_empty)
+         return depth == 0;
+
+      ValueType type = ValueType::Boolean;
+      if (!ParseExpression(0, _root, type) || type != ValueType::Boolean)
+         return false;
+      SkipWhitespace();
+      return _position == End;
+   }
+
+   constexpr void SkipWhitespace()
+   {
+      while (_position < End && IsSpaceChar(_text[_position]))
+         _position++;
+   }
+
+   // operators of the same precedence are applied from left to right, as the runtime parser does
+   constexpr bool ParseExpression(const int min_precedence, size_t& node, ValueType& type)
+   {
+      if (!ParsePrimary(node, type))
+         return false;
+
+      while (true)
+      {
+         SkipWhitespace();
+         TokenType operator_type = TokenType::OperatorEqual;
+         size_t length = 0;
+         if (!ReadOperator(operator_type, length) || static_cast<int>(operator_type) < min_precedence)
+            return true;
+         _position += length;
+
+         size_t right = 0;
+         ValueType right_type = ValueType::Boolean;
+         if (!ParseExpression(static_cast<int>(operator_type) + 1, right, right_type) || !AddOperator(operator_type, node, type, right, right_type))
+            return false;
+      }
+   }
+
+   constexpr bool ReadOperator(TokenType& operator_type, size_t& length) const
+   {
+      const char ch = (_position < End ? _text[_position] : '\0');
+      const char next = (_position + 1 < End ? _text[_position + 1] : '\0');
+      length = 2;
+      if (ch == '<' && next == '=')
+         operator_type = TokenType::OperatorLessOrEqual;
+      else if (ch == '>' && next == '=')
+         operator_type = TokenType::OperatorMoreOrEqual;
+      else if (ch == '=' && next == '=')
+         operator_type = TokenType::OperatorEqual;
+      else if (ch == '!' && next == '=')
+         operator_type = TokenType::OperatorNotEqual;
+      else if (ch == '&' && next == '&')
+         operator_type = TokenType::OperatorLogicalAnd;
+      else if (ch == '|' && next == '|')
+         operator_type = TokenType::OperatorLogicalOr;
+      else if (ch == '<' || ch == '>')
+      {
+         operator_type = (ch == '<' ? TokenType::OperatorLess : TokenType::OperatorMore);
+         length = 1;
+      }
+      else
+         return ReadKeywordOperator(operator_type, length);
+      return true;
+   }
+
+   // operator keywords are read only after an operand, as the runtime parser does, 'IN RANGES' is two words separated by whitespaces
+   constexpr bool ReadKeywordOperator(TokenType& operator_type, size_t& length) const
+   {
+      size_t end = NameEnd(_position);
+      if (Text(_position, end) == "PREFIX")
+      {
+         operator_type = TokenType::OperatorPrefix;
+         length = end - _position;
+         return true;
+      }
+      if (Text(_position, end) != "IN")
+         return false;
+
+      size_t next = end;
+      while (next < End && IsSpaceChar(_text[next]))
+         next++;
+      end = NameEnd(next);
+      if (next == NameEnd(_position) || Text(next, end) != "RANGES")
+         return false;
+      operator_type = TokenType::OperatorInRanges;
+      length = end - _position;
+      return true;
+   }
+
+   // end of the name starting at 'position', names are letters, digits, '.' and '_'
+   constexpr size_t NameEnd(size_t position) const
+   {
+      while (position < End && (IsLetter(_text[position]) || IsDigitChar(_text[position]) || _text[position] == '.' || _text[position] == '_'))
+         position++;
+      return position;
+   }
+
+   constexpr StringView Text(const size_t begin, const size_t end) const { return StringView(_text + begin, end - begin); }
+
+   // the type rules are the same as of ProgramCompiler
+   constexpr bool AddOperator(const TokenType operator_type, size_t& node, ValueType& type, const size_t right, const ValueType right_type)
+   {
+      if (operator_type == TokenType::OperatorPrefix || operator_type == TokenType::OperatorInRanges)
+         return AddTableOperator(operator_type, node, type, right, right_type);
+
+      if (IsNumber(node) && (IsNumber(right) || IsNumberArray(right)))
+         return AddNumberComparison(operator_type, node, type, right);
+
+      StaticNodeType node_type = StaticNodeType::And;
+      switch (operator_type)
+      {
+         case TokenType::OperatorLogicalAnd:
+         case TokenType::OperatorLogicalOr:
+            if (type != ValueType::Boolean || right_type != ValueType::Boolean)
+               return false;
+            node_type = (operator_type == TokenType::OperatorLogicalAnd ? StaticNodeType::And : StaticNodeType::Or);
+            break;
+         case TokenType::OperatorEqual:
+         case TokenType::OperatorNotEqual:
+            if (type == ValueType::String && right_type == ValueType::Array)
+               node_type = StaticNodeType::InArray;
+            else if (type == ValueType::String && right_type == ValueType::String)
+               node_type = StaticNodeType::CompareStrings;
+            else if (type == ValueType::Boolean && right_type == ValueType::Boolean)
+               node_type = StaticNodeType::CompareBooleans;
+            else
+               return false;
+            break;
+         default:
+            // relational operators are defined for numbers and booleans, but all numbers here are literals
+            if (type != ValueType::Boolean || right_type != ValueType::Boolean)
+               return false;
+            node_type = StaticNodeType::CompareBooleans;
+            break;
+      }
+
+      const size_t children[] = {node, right};
+      node = AddNode(node_type, children, 2);
+      _nodes[node]._operator = operator_type;
+      type = ValueType::Boolean;
+      return true;
+   }
+
+   // the left operand of PREFIX and IN RANGES is a string, the right one is an array, bounds of ranges are pairs of numbers
+   constexpr bool AddTableOperator(const TokenType operator_type, size_t& node, ValueType& type, const size_t right, const ValueType right_type)
+   {
+      if (type != ValueType::String || right_type != ValueType::Array)
+         return false;
+
+      if (operator_type == TokenType::OperatorInRanges)
+      {
+         const StaticNode& array = _nodes[right];
+         if (array._links_number % 2 != 0)
+            return false;
+         for (size_t i = 0; i < array._links_number; i += 2)
+         {
+            int64_t from = 0;
+            int64_t to = 0;
+            const size_t from_node = _links[array._first_link + i];
+            const size_t to_node = _links[array._first_link + i + 1];
+            if (!IsNumber(from_node) || !IsNumber(to_node) || !ParseNumber(Text(_nodes[from_node]), from) || !ParseNumber(Text(_nodes[to_node]), to) || from > to)
+               return false; // bounds must be pairs of numbers which can be represented exactly
+         }
+      }
+
+      const size_t children[] = {node, right};
+      node = AddNode(operator_type == TokenType::OperatorPrefix ? StaticNodeType::Prefix : StaticNodeType::InRanges, children, 2);
+      _nodes[node]._operator = operator_type;
+      type = ValueType::Boolean;
+      return true;
+   }
+
+   constexpr bool ParsePrimary(size_t& node, ValueType& type)
+   {
+      SkipWhitespace();
+      if (_position == End)
+         return false;
+
+      const char ch = _text[_position];
+      if (ch == '(')
+      {
+         _position++;
+         if (!ParseExpression(0, node, type))
+            return false;
+         SkipWhitespace();
+         if (_position == End || _text[_position] != ')')
+            return false;
+         _position++;
+         return true;
+      }
+
+      const bool is_number = IsDigitChar(ch) || (ch == '-' && _position + 1 < End && IsDigitChar(_text[_position + 1]));
+      if (ch == '\"' || is_number)
+      {
+         // strings have no escapes, numbers are an optional minus, digits and optional point with fraction digits
+         size_t begin = _position;
+         if (ch == '\"')
+         {
+            begin++;
+            _position++;
+            while (_position < End && _text[_position] != '\"')
+               _position++;
+            if (_position == End)
+               return false;
+         }
+         else
+         {
+            _position++;
+            SkipDigits();
+            if (_position + 1 < End && _text[_position] == '.' && IsDigitChar(_text[_position + 1]))
+            {
+               _position++;
+               SkipDigits();
+            }
+         }
+
+         node = AddNode(StaticNodeType::Literal, nullptr, 0);
+         _nodes[node]._begin = begin;
+         _nodes[node]._length = _position - begin;
+         _nodes[node]._is_number = is_number;
+         if (ch == '\"')
+            _position++;
+         type = ValueType::String;
+         return true;
+      }
+
+      if (IsLetter(ch))
+      {
+         const size_t begin = _position;
+         _position = NameEnd(_position);
+
+         // function name is followed by a brace right away
+         if (_position < End && _text[_position] == '{')
+            return ParseFunction(begin, node, type);
+
+         node = AddNode(StaticNodeType::Variable, nullptr, 0);
+         _nodes[node]._begin = begin;
+         _nodes[node]._length = _position - begin;
+         _nodes[node]._slot = AddVariable(node);
+         type = ValueType::String;
+         return true;
+      }
+
+      if (ch == '[')
+         return ParseArray(node, type);
+
+      return false;
+   }
+
+   // the only supported function is substring with 3 arguments
+   constexpr bool ParseFunction(const size_t name_begin, size_t& node, ValueType& type)
+   {
+      const char name[] = "SUBSTR";
+      if (_position - name_begin != sizeof(name) - 1)
+         return false;
+      for (size_t i = 0; i < sizeof(name) - 1; i++)
+      {
+         if (_text[name_begin + i] != name[i])
+            return false;
+      }
+
+      _position++; // skip the brace
+      size_t arguments[3] = {};
+      for (size_t i = 0; i < 3; i++)
+      {
+         ValueType argument_type = ValueType::String;
+         if (!ParseExpression(0, arguments[i], argument_type) || argument_type != ValueType::String)
+            return false;
+         SkipWhitespace();
+         if (_position == End || _text[_position] != (i == 2 ? '}' : ','))
+            return false;
+         _position++;
+      }
+
+      // substring position and length are mostly literals, so they are converted to numbers here once
+      int from = 0;
+      int length = 0;
+      const NumberParsing from_parsing = (_nodes[arguments[1]]._type == StaticNodeType::Literal ? ParseInt(Text(_nodes[arguments[1]]), from) : NumberParsing::Invalid);
+      const NumberParsing length_parsing = (_nodes[arguments[2]]._type == StaticNodeType::Literal ? ParseInt(Text(_nodes[arguments[2]]), length) : NumberParsing::Invalid);
+      const bool constant_position = (from_parsing != NumberParsing::Invalid && length_parsing != NumberParsing::Invalid);
+
+      node = AddNode(StaticNodeType::Substr, arguments, constant_position ? 1 : 3);
+      if (constant_position)
+      {
+         _nodes[node]._constant_position = true;
+         // negative numbers become huge positions or lengths, the substring is empty if any of the numbers doesn't fit into int
+         _nodes[node]._from = static_cast<uint32_t>(from);
+         _nodes[node]._substr_length = static_cast<uint32_t>(length);
+         if (from_parsing == NumberParsing::OutOfRange || length_parsing == NumberParsing::OutOfRange)
+            _nodes[node]._from = std::numeric_limits<uint32_t>::max();
+      }
+      type = ValueType::String;
+      return true;
+   }
+
+   // arrays are not empty and have only literals
+   constexpr bool ParseArray(size_t& node, ValueType& type)
+   {
+      _position++; // skip the bracket
+      size_t items[TextSize] = {};
+      size_t items_number = 0;
+      while (true)
+      {
+         ValueType item_type = ValueType::String;
+         if (!ParseExpression(0, items[items_number], item_type) || _nodes[items[items_number]]._type != StaticNodeType::Literal)
+            return false;
+         items_number++;
+
+         SkipWhitespace();
+         if (_position == End)
+            return false;
+         if (_text[_position++] == ']')
+            break;
+         if (_text[_position - 1] != ',')
+            return false;
+      }
+
+      node = AddNode(StaticNodeType::Array, items, items_number);
+      type = ValueType::Array;
+      return true;
+   }
+
+   constexpr size_t AddNode(const StaticNodeType node_type, const size_t* children, const size_t children_number)
+   {
+      StaticNode& node = _nodes[_nodes_number];
+      node._type = node_type;
+      node._first_link = _links_number;
+      node._links_number = children_number;
+      for (size_t i = 0; i < children_number; i++)
+         _links[_links_number++] = children[i];
+      return _nodes_number++;
+   }
+
+   // slot of the variable, variables get slots by their first occurrence
+   constexpr size_t AddVariable(const size_t node)
+   {
+      const StringView name = Text(_nodes[node]);
+      for (size_t slot = 0; slot < _variables_number; slot++)
+      {
+         if (Text(_nodes[_variables[slot]]) == name)
+            return slot;
+      }
+      _variables[_variables_number] = node;
+      return _variables_number++;
+   }
+
+   // number literals are compared as numbers with number literals and arrays of them, the result is known at compile time
+   constexpr bool AddNumberComparison(const TokenType operator_type, size_t& node, ValueType& type, const size_t right)
+   {
+      int64_t number = 0;
+      if (!ParseNumber(Text(_nodes[node]), number))
+         return false;
+
+      bool value = false;
+      if (IsNumberArray(right))
+      {
+         if (operator_type != TokenType::OperatorEqual && operator_type != TokenType::OperatorNotEqual)
+            return false;
+         bool found = false;
+         for (size_t i = 0; i < _nodes[right]._links_number; i++)
+         {
+            int64_t item = 0;
+            if (!ParseNumber(Text(_nodes[_links[_nodes[right]._first_link + i]]), item))
+               return false;
+            found = found || item == number;
+         }
+         value = (found == (operator_type == TokenType::OperatorEqual));
+      }
+      else
+      {
+         int64_t right_number = 0;
+         if (!ParseNumber(Text(_nodes[right]), right_number))
+            return false;
+         switch (operator_type)
+         {
+            case TokenType::OperatorEqual:
+               value = (number == right_number);
+               break;
+            case TokenType::OperatorNotEqual:
+               value = (number != right_number);
+               break;
+            case TokenType::OperatorLess:
+               value = (number < right_number);
+               break;
+            case TokenType::OperatorLessOrEqual:
+               value = (number <= right_number);
+               break;
+            case TokenType::OperatorMore:
+               value = (number > right_number);
+               break;
+            case TokenType::OperatorMoreOrEqual:
+               value = (number >= right_number);
+               break;
+            default:
+               return false;
+         }
+      }
+
+      node = AddNode(StaticNodeType::Constant, nullptr, 0);
+      _nodes[node]._value = value;
+      type = ValueType::Boolean;
+      return true;
+   }
+
+   constexpr bool IsNumber(const size_t node) const
+   {
+      return _nodes[node]._type == StaticNodeType::Literal && _nodes[node]._is_number;
+   }
+
+   constexpr bool IsNumberArray(const size_t node) const
+   {
+      if (_nodes[node]._type != StaticNodeType::Array)
+         return false;
+      for (size_t i = 0; i < _nodes[node]._links_number; i++)
+      {
+         if (!IsNumber(_links[_nodes[node]._first_link + i]))
+            return false;
+      }
+      return true;
+   }
+
+   constexpr void SkipDigits()
+   {
+      while (_position < End && IsDigitChar(_text[_position]))
+         _position++;
+   }
+
+   static constexpr bool IsLetter(const char ch)
+   {
+      return (ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z');
+   }
+};
+
+// an expression parsed at compile time, the build fails if it's invalid
+#define RENAISSANCE_STATIC_EXPRESSION(name, text) \
+   static constexpr ::Renaissance::StaticExpression<sizeof(text)> name(text); \
+   static_assert(name.IsValid(), "invalid expression: " text)
+
+template <const auto& Expression, size_t Index>
+inline bool EvaluateStaticString(const VariableRecord& variable_record, StringView& value)
+{
+   constexpr StaticNode node = Expression.Node(Index);
+   if constexpr (node._type == StaticNodeType::Literal)
+   {
+      value = Expression.Text(node);
+      return true;
+   }
+   else if constexpr (node._type == StaticNodeType::Variable)
+   {
+      if (node._slot >= variable_record.size() || variable_record[node._slot].data() == nullptr)
+         return false; // variable is mentioned in the expression but no corresponding value is passed
+      value = variable_record[node._slot];
+      return true;
+   }
+   else
+   {
+      static_assert(node._type == StaticNodeType::Substr, "the node is not a string");
+      StringView source;
+      if (!EvaluateStaticString<Expression, Expression.Link(node._first_link)>(variable_record, source))
+         return false;
+
+      if constexpr (node._constant_position)
+      {
+         value = Substring(source, node._from, node._substr_length);
+         return true;
+      }
+      else
+      {
+         StringView from;
+         StringView length;
+         if (!EvaluateStaticString<Expression, Expression.Link(node._first_link + 1)>(variable_record, from) ||
+             !EvaluateStaticString<Expression, Expression.Link(node._first_link + 2)>(variable_record, length))
+         {
+            return false;
+         }
+
+         int from_number = 0;
+         int length_number = 0;
+         const NumberParsing from_parsing = ParseInt(from, from_number);
+         const NumberParsing length_parsing = ParseInt(length, length_number);
+         if (from_parsing == NumberParsing::Invalid || length_parsing == NumberParsing::Invalid)
+            return false; // function argument is not a number
+
+         if (from_parsing == NumberParsing::OutOfRange || length_parsing == NumberParsing::OutOfRange)
+            value = StringView(source.data(), 0);
+         else
+            value = Substring(source, static_cast<size_t>(from_number), static_cast<size_t>(length_number));
+         return true;
+      }
+   }
+}
+
+template <const auto& Expression, size_t ArrayIndex, size_t... Items>
+inline bool IsStaticArrayItem(const StringView& value, std::index_sequence<Items...>)
+{
+   constexpr StaticNode array = Expression.Node(ArrayIndex);
+   return ((value == Expression.Text(Expression.Node(Expression.Link(array._first_link + Items)))) || ...);
+}
+
+template <const auto& Expression, size_t ArrayIndex, size_t... Items>
+inline bool IsStaticPrefixItem(const StringView& value, std::index_sequence<Items...>)
+{
+   constexpr StaticNode array = Expression.Node(ArrayIndex);
+   return (value.starts_with(Expression.Text(Expression.Node(Expression.Link(array._first_link + Items)))) || ...);
+}
+
+// bounds of the ranges are validated by the parser, so they are parsed at compile time
+template <const auto& Expression, size_t Index>
+constexpr int64_t StaticNumber()
+{
+   int64_t number = 0;
+   ParseNumber(Expression.Text(Expression.Node(Index)), number);
+   return number;
+}
+
+template <const auto& Expression, size_t ArrayIndex, size_t... Ranges>
+inline bool IsStaticRangeItem(const int64_t number, std::index_sequence<Ranges...>)
+{
+   constexpr StaticNode array = Expression.Node(ArrayIndex);
+   return ((number >= StaticNumber<Expression, Expression.Link(array._first_link + 2 * Ranges)>() &&
+            number <= StaticNumber<Expression, Expression.Link(array._first_link + 2 * Ranges + 1)>()) || ...);
+}
+
+template <const auto& Expression, size_t Index>
+inline bool EvaluateStaticBoolean(const VariableRecord& variable_record, bool& value)
+{
+   constexpr StaticNode node = Expression.Node(Index);
+   constexpr size_t child1 = Expression.Link(node._first_link);
+   constexpr size_t child2 = Expression.Link(node._first_link + 1);
+   if constexpr (node._type == StaticNodeType::Constant)
+   {
+      value = node._value;
+      return true;
+   }
+   else if constexpr (node._type == StaticNodeType::And || node._type == StaticNodeType::Or)
+   {
+      // the second operand is evaluated only if the first one doesn't decide the result
+      if (!EvaluateStaticBoolean<Expression, child1>(variable_record, value))
+         return false;
+      if (value == (node._type == StaticNodeType::Or))
+         return true;
+      return EvaluateStaticBoolean<Expression, child2>(variable_record, value);
+   }
+   else if constexpr (node._type == StaticNodeType::InArray)
+   {
+      StringView string_value;
+      if (!EvaluateStaticString<Expression, child1>(variable_record, string_value))
+         return false;
+      const bool is_item = IsStaticArrayItem<Expression, child2>(string_value, std::make_index_sequence<Expression.Node(child2)._links_number>());
+      value = (node._operator == TokenType::OperatorEqual ? is_item : !is_item);
+      return true;
+   }
+   else if constexpr (node._type == StaticNodeType::Prefix)
+   {
+      StringView string_value;
+      if (!EvaluateStaticString<Expression, child1>(variable_record, string_value))
+         return false;
+      value = IsStaticPrefixItem<Expression, child2>(string_value, std::make_index_sequence<Expression.Node(child2)._links_number>());
+      return true;
+   }
+   else if constexpr (node._type == StaticNodeType::InRanges)
+   {
+      StringView string_value;
+      int64_t number = 0;
+      if (!EvaluateStaticString<Expression, child1>(variable_record, string_value) || !ParseNumber(string_value, number))
+         return false; // value is not a number
+      value = IsStaticRangeItem<Expression, child2>(number, std::make_index_sequence<Expression.Node(child2)._links_number / 2>());
+      return true;
+   }
+   else if constexpr (node._type == StaticNodeType::CompareStrings)
+   {
+      StringView string_value1;
+      StringView string_value2;
+      if (!EvaluateStaticString<Expression, child1>(variable_record, string_value1) || !EvaluateStaticString<Expression, child2>(variable_record, string_value2))
+         return false;
+      value = (node._operator == TokenType::OperatorEqual ? string_value1 == string_value2 : string_value1 != string_value2);
+      return true;
+   }
+   else
+   {
+      static_assert(node._type == StaticNodeType::CompareBooleans, "the node is not a boolean");
+      bool value1 = false;
+      bool value2 = false;
+      if (!EvaluateStaticBoolean<Expression, child1>(variable_record, value1) || !EvaluateStaticBoolean<Expression, child2>(variable_record, value2))
+         return false;
+      switch (node._operator)
+      {
+         case TokenType::OperatorEqual:
+            value = (value1 == value2);
+            break;
+         case TokenType::OperatorNotEqual:
+            value = (value1 != value2);
+            break;
+         case TokenType::OperatorLess:
+            value = (value1 < value2);
+            break;
+         case TokenType::OperatorLessOrEqual:
+            value = (value1 <= value2);
+            break;
+         case TokenType::OperatorMore:
+            value = (value1 > value2);
+            break;
+         default:
+            value = (value1 >= value2);
+            break;
+      }
+      return true;
+   }
+}
+
+// evaluate an expression parsed at compile time with variables values given in 'variable_record' by slots of the expression variables
+// evaluation result will be returned in the output parameter 'result'
+// returns true if successful
+template <const auto& Expression>
+inline bool EvaluateStatic(const VariableRecord& variable_record, bool& result)
+{
+   static_assert(Expression.IsValid(), "invalid expression");
+   result = false;
+   if constexpr (Expression.IsEmpty()) // treat empty expression as a true statement
+   {
+      result = true;
+      return true;
+   }
+   else
+   {
+      bool value = false;
+      if (!EvaluateStaticBoolean<Expression, Expression.Root()>(variable_record, value))
+         return false;
+      result = value;
+      return true;
+   }
+}
+}
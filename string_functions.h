@@ -0,0 +1,130 @@
+#pragma once
+#include <cstdint>
+#include <limits>
+#include "common.h"
+
+// Helpers implementing expression functions over string views, they are shared by the compiled program and the expression optimizer
+// to make sure constant folding gives exactly the same results as the evaluation.
+namespace Renaissance
+{
+enum class NumberParsing
+{
+   Ok,
+   OutOfRange,
+   Invalid
+};
+
+// chars std::isspace and std::isdigit accept in the "C" locale, but usable in constant expressions
+constexpr bool IsSpaceChar(const char ch)
+{
+   return ch == ' ' || ch == '\t' || ch == '\n' || ch == '\v' || ch == '\f' || ch == '\r';
+}
+
+constexpr bool IsDigitChar(const char ch)
+{
+   return ch >= '0' && ch <= '9';
+}
+
+// convert the leading part of the value to int the same way std::stoi does, but without exceptions and allocations
+// it's constexpr, so literal numbers of expressions parsed at compile time are converted exactly the same way
+constexpr NumberParsing ParseInt(const StringView& value, int& number)
+{
+   size_t position = 0;
+   while (position < value.size() && IsSpaceChar(value[position]))
+      ++position;
+
+   const bool negative = (position < value.size() && value[position] == '-');
+   if (position < value.size() && (value[position] == '-' || value[position] == '+'))
+      ++position;
+
+   if (position == value.size() || !IsDigitChar(value[position]))
+      return NumberParsing::Invalid;
+
+   // accumulate as a negative number, as its range is wider
+   const int min = std::numeric_limits<int>::min();
+   int accumulated = 0;
+   bool out_of_range = false;
+   for (; position < value.size() && IsDigitChar(value[position]); ++position)
+   {
+      const int digit = value[position] - '0';
+      if (accumulated < (min + digit) / 10)
+         out_of_range = true;
+      else
+         accumulated = accumulated * 10 - digit;
+   }
+
+   if (out_of_range || (!negative && accumulated == min))
+      return NumberParsing::OutOfRange;
+
+   number = negative ? accumulated : -accumulated;
+   return NumberParsing::Ok;
+}
+
+// numbers are fixed-point decimals with NumberFractionDigits digits after the point stored in int64_t scaled by NumberScale,
+// so they are compared as plain integers, e.g. "-12.5" is -125000, the range is the same as of the SQL Server money type
+constexpr int NumberFractionDigits = 4;
+constexpr int64_t NumberScale = 10000;
+
+// convert a decimal number like "12", "-0.25" or "1000.50" to the fixed-point form, without exceptions and allocations
+// the whole value must be a number, there must be digits before the point and after it if the point is present
+// returns false if the value is not a number or it can't be represented exactly (out of range or too many significant fraction digits)
+constexpr bool ParseNumber(const StringView& value, int64_t& number)
+{
+   size_t position = 0;
+   const bool negative = (position < value.size() && value[position] == '-');
+   if (negative)
+      ++position;
+
+   if (position == value.size() || !IsDigitChar(value[position]))
+      return false;
+
+   // accumulate as a negative number, as its range is wider
+   const int64_t min = std::numeric_limits<int64_t>::min();
+   int64_t accumulated = 0;
+   int fraction_digits = -1; // -1 until the point is read
+   for (; position < value.size(); ++position)
+   {
+      const char ch = value[position];
+      if (ch == '.' && fraction_digits < 0 && position + 1 < value.size() && IsDigitChar(value[position + 1]))
+      {
+         fraction_digits = 0;
+         continue;
+      }
+      if (!IsDigitChar(ch))
+         return false;
+
+      const int digit = ch - '0';
+      if (fraction_digits == NumberFractionDigits)
+      {
+         // digits beyond the precision are fine only if they don't change the value
+         if (digit != 0)
+            return false;
+         continue;
+      }
+      if (accumulated < (min + digit) / 10)
+         return false;
+      accumulated = accumulated * 10 - digit;
+      if (fraction_digits >= 0)
+         ++fraction_digits;
+   }
+
+   for (int i = (fraction_digits < 0 ? 0 : fraction_digits); i < NumberFractionDigits; i++)
+   {
+      if (accumulated < min / 10)
+         return false;
+      accumulated *= 10;
+   }
+
+   if (!negative && accumulated == min)
+      return false;
+
+   number = negative ? accumulated : -accumulated;
+   return true;
+}
+
+// substring of the value the same way std::string::substr does, it's empty if 'from' is beyond the value
+inline StringView Substring(const StringView& value, const size_t from, const size_t length)
+{
+   return from > value.size() ? StringView(value.data(), 0) : value.substr(from, length);
+}
+}
@@ -0,0 +1,56 @@
+#include "string_set.h"
+#include <algorithm>
+
+namespace Renaissance
+{
+// build the set from the array items, duplicated items are removed
+StringSet::StringSet(std::vector<std::string> items) : _items(std::move(items))
+{
+   std::sort(_items.begin(), _items.end());
+   _items.erase(std::unique(_items.begin(), _items.end()), _items.end());
+
+   for (const auto& item : _items)
+      _lengths_mask |= LengthBit(item.size());
+
+   if (_items.size() <= LinearSearchMaxSize)
+      return;
+
+   // keep the hash table at most half full, so probing sequences are short
+   size_t buckets_number = 1;
+   while (buckets_number < _items.size() * 2)
+      buckets_number <<= 1;
+
+   _buckets.assign(buckets_number, 0);
+   _hashes.reserve(_items.size());
+   const size_t mask = buckets_number - 1;
+   for (size_t i = 0; i < _items.size(); i++)
+   {
+      const uint64_t hash = Hash(_items[i]);
+      _hashes.push_back(hash);
+
+      size_t bucket = hash & mask;
+      while (_buckets[bucket] != 0)
+         bucket = (bucket + 1) & mask;
+      _buckets[bucket] = static_cast<uint32_t>(i + 1);
+   }
+}
+
+// returns true if the value is one of the set items
+bool StringSet::Contains(const StringView& value) const noexcept
+{
+   return Contains(value, _lengths_mask, _items.size(), _buckets.data(), _buckets.size(), _hashes.data(),
+                   [this](const size_t index) { return StringView(_items[index]); });
+}
+
+// FNV-1a hash of the value
+uint64_t StringSet::Hash(const StringView& value) noexcept
+{
+   uint64_t hash = 14695981039346656037ULL;
+   for (const char ch : value)
+   {
+      hash ^= static_cast<unsigned char>(ch);
+      hash *= 1099511628211ULL;
+   }
+   return hash;
+}
+}
@@ -0,0 +1,74 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "common.h"
+
+namespace Renaissance
+{
+// This is an immutable set of strings built once from an array literal, it's used for '== [...]' and '!= [...]' comparisons.
+// Small sets are scanned linearly, larger ones are stored in an open addressing hash table.
+// Lookups are done by a string view and never allocate.
+class StringSet
+{
+public:
+   StringSet() = default;
+   explicit StringSet(std::vector<std::string> items);
+   StringSet(const StringSet&) = default;
+   StringSet(StringSet&&) = default;
+   StringSet& operator =(const StringSet&) = default;
+   StringSet& operator =(StringSet&&) = default;
+   ~StringSet() = default;
+
+   bool Contains(const StringView& value) const noexcept;
+
+   inline size_t Size() const noexcept { return _items.size(); }
+   inline const std::vector<std::string>& Items() const noexcept { return _items; }
+   inline uint64_t LengthsMask() const noexcept { return _lengths_mask; }
+   inline const std::vector<uint32_t>& Buckets() const noexcept { return _buckets; }
+   inline const std::vector<uint64_t>& Hashes() const noexcept { return _hashes; }
+
+   // the lookup over the set tables, it's shared with sets mapped from a rule set image (see RuleSetImage)
+   // 'item' returns the item with the given index as a string view, there are no buckets if the items are searched linearly
+   template <typename ItemGetter>
+   static bool Contains(const StringView& value, const uint64_t lengths_mask, const size_t items_number, const uint32_t* buckets, const size_t buckets_number,
+                        const uint64_t* hashes, const ItemGetter& item) noexcept
+   {
+      // most of mismatches are rejected by the length
+      if ((lengths_mask & LengthBit(value.size())) == 0)
+         return false;
+
+      if (buckets_number == 0)
+      {
+         for (size_t i = 0; i < items_number; i++)
+         {
+            if (value == item(i))
+               return true;
+         }
+         return false;
+      }
+
+      const uint64_t hash = Hash(value);
+      const size_t mask = buckets_number - 1;
+      for (size_t bucket = hash & mask; buckets[bucket] != 0; bucket = (bucket + 1) & mask)
+      {
+         const uint32_t index = buckets[bucket] - 1;
+         if (hashes[index] == hash && value == item(index))
+            return true;
+      }
+      return false;
+   }
+
+   static uint64_t Hash(const StringView& value) noexcept;
+
+private:
+   // sets up to this size are not hashed, comparing a few strings is cheaper than hashing
+   static const size_t LinearSearchMaxSize = 8;
+
+   std::vector<std::string> _items;
+   uint64_t _lengths_mask = 0;          // bit N is set if there is an item of length N, the last bit stands for all longer items
+   std::vector<uint32_t> _buckets;      // item index + 1, 0 marks an empty bucket, the size is a power of 2
+   std::vector<uint64_t> _hashes;       // hashes of items
+
+   static inline uint64_t LengthBit(const size_t length) noexcept { return uint64_t(1) << (length < 63 ? length : 63); }
+};
+}
@@ -0,0 +1,137 @@
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <memory_resource>
+#include <new>
+#include "gtest/gtest.h"
+#include "../expression_evaluator.h"
+
+using namespace Renaissance;
+
+// count all heap allocations done by the test binary, every form of the global operators is replaced,
+// so memory allocated by any of them (e.g. nothrow new of std::stable_sort) is released by the matching delete
+static std::atomic<size_t> allocations_number(0);
+
+static void* Allocate(const size_t size) noexcept
+{
+	++allocations_number;
+	return std::malloc(size ? size : 1);
+}
+
+static void* AllocateOrThrow(const size_t size)
+{
+	if (void* memory = Allocate(size))
+		return memory;
+	throw std::bad_alloc();
+}
+
+void* operator new(size_t size) { return AllocateOrThrow(size); }
+void* operator new[](size_t size) { return AllocateOrThrow(size); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return Allocate(size); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return Allocate(size); }
+
+void operator delete(void* memory) noexcept { std::free(memory); }
+void operator delete[](void* memory) noexcept { std::free(memory); }
+void operator delete(void* memory, size_t) noexcept { std::free(memory); }
+void operator delete[](void* memory, size_t) noexcept { std::free(memory); }
+void operator delete(void* memory, const std::nothrow_t&) noexcept { std::free(memory); }
+void operator delete[](void* memory, const std::nothrow_t&) noexcept { std::free(memory); }
+
+#ifdef __cpp_aligned_new
+static void* AllocateAligned(const size_t size, const std::align_val_t alignment) noexcept
+{
+	++allocations_number;
+	const size_t bytes = static_cast<size_t>(alignment);
+	return std::aligned_alloc(bytes, (size + bytes) / bytes * bytes); // the size must be a non-zero multiple of the alignment
+}
+
+static void* AllocateAlignedOrThrow(const size_t size, const std::align_val_t alignment)
+{
+	if (void* memory = AllocateAligned(size, alignment))
+		return memory;
+	throw std::bad_alloc();
+}
+
+void* operator new(size_t size, std::align_val_t alignment) { return AllocateAlignedOrThrow(size, alignment); }
+void* operator new[](size_t size, std::align_val_t alignment) { return AllocateAlignedOrThrow(size, alignment); }
+void* operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept { return AllocateAligned(size, alignment); }
+void* operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept { return AllocateAligned(size, alignment); }
+
+void operator delete(void* memory, std::align_val_t) noexcept { std::free(memory); }
+void operator delete[](void* memory, std::align_val_t) noexcept { std::free(memory); }
+void operator delete(void* memory, size_t, std::align_val_t) noexcept { std::free(memory); }
+void operator delete[](void* memory, size_t, std::align_val_t) noexcept { std::free(memory); }
+void operator delete(void* memory, std::align_val_t, const std::nothrow_t&) noexcept { std::free(memory); }
+void operator delete[](void* memory, std::align_val_t, const std::nothrow_t&) noexcept { std::free(memory); }
+#endif
+
+const char* const AllocationTestExpression = "(IN.VAR1 == 6011 && IN.VAR2 == [1,2,4,5] && IN.VAR3 != [\"abc\",\"def\",\"ghi\"] && "
+                                              "(IN.VAR4 != \"EG\" || IN.VAR5 != \"Y\" && SUBSTR{IN.VAR6,3,9} == \"SOMETHING\" && SUBSTR{IN.VAR6,IN.VAR2,2} != \"__\"))";
+
+TEST(Allocation, VariableValuesEvaluationTest)
+{
+	ExpressionEvaluator e;
+	CompiledExpression compiled;
+	ASSERT_TRUE(e.Compile(AllocationTestExpression, compiled));
+	const VariableValues variables = {{"IN.VAR1", "6011"}, {"IN.VAR2", "4"}, {"IN.VAR3", "ikl"}, {"IN.VAR4", "EG"}, {"IN.VAR5", "N"}, {"IN.VAR6", "___SOMETHING"}};
+
+	bool result = false;
+	const size_t allocations_before = allocations_number;
+	for (int i = 0; i < 100; i++)
+		ASSERT_TRUE(e.Evaluate(compiled, variables, result));
+	EXPECT_EQ(allocations_number - allocations_before, 0u);
+	EXPECT_TRUE(result);
+}
+
+TEST(Allocation, VariableRecordEvaluationTest)
+{
+	VariableSchema schema;
+	ExpressionEvaluator e;
+	CompiledExpression compiled;
+	ASSERT_TRUE(e.Compile(AllocationTestExpression, schema, compiled));
+
+	const std::vector<std::pair<std::string, std::string>> values = {{"IN.VAR1", "6011"}, {"IN.VAR2", "4"}, {"IN.VAR3", "ikl"}, {"IN.VAR4", "EG"}, {"IN.VAR5", "N"}, {"IN.VAR6", "___SOMETHING"}};
+	VariableRecord record(schema.Size());
+	for (const auto& value : values)
+	{
+		uint32_t slot = 0;
+		ASSERT_TRUE(schema.FindVariable(value.first, slot));
+		record[slot] = value.second;
+	}
+
+	bool result = false;
+	const size_t allocations_before = allocations_number;
+	for (int i = 0; i < 100; i++)
+		ASSERT_TRUE(e.Evaluate(compiled, record, result));
+	EXPECT_EQ(allocations_number - allocations_before, 0u);
+	EXPECT_TRUE(result);
+}
+
+TEST(Allocation, ArenaParsingTest)
+{
+	// the arena can't grow, parsing fails with bad_alloc if nodes don't fit into the buffer
+	std::array<std::byte, 16 * 1024> buffer;
+	std::pmr::monotonic_buffer_resource arena(buffer.data(), buffer.size(), std::pmr::null_memory_resource());
+	ExpressionParser parser(&arena);
+	ExpressionTree tree;
+	ASSERT_TRUE(parser.ParseInPlace(AllocationTestExpression, tree));
+
+	// nodes are allocated from the arena and the parser's stacks are reused, so parsing again doesn't touch the heap
+	const size_t allocations_before = allocations_number;
+	for (int i = 0; i < 100; i++)
+	{
+		while (!tree.empty())
+			tree.pop();
+		arena.release();
+		ASSERT_TRUE(parser.ParseInPlace(AllocationTestExpression, tree));
+	}
+	EXPECT_EQ(allocations_number - allocations_before, 0u);
+	ASSERT_FALSE(tree.empty());
+	EXPECT_EQ(tree.top()->_token._type, TokenType::OperatorLogicalAnd);
+
+	// the optimized tree is allocated from the same arena, so it's released together with the original one
+	ExpressionOptimizer optimizer(&arena);
+	const auto optimized_root = reinterpret_cast<const std::byte*>(optimizer.Optimize(tree.top()));
+	EXPECT_TRUE(optimized_root >= buffer.data() && optimized_root < buffer.data() + buffer.size());
+}
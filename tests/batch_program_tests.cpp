@@ -0,0 +1,188 @@
+#include "gtest/gtest.h"
+#include "../expression_evaluator.h"
+
+using namespace Renaissance;
+
+// owns the columns data of a RecordBatch built from records, a value with null data is missing
+class TestBatch
+{
+public:
+	TestBatch(const std::vector<VariableRecord>& rows, const size_t slots_number)
+	{
+		_data.resize(slots_number);
+		_offsets.resize(slots_number);
+		_validity.resize(slots_number);
+		_batch._rows_number = rows.size();
+		_batch._columns.resize(slots_number);
+		for (size_t slot = 0; slot < slots_number; slot++)
+		{
+			_offsets[slot].push_back(0);
+			_validity[slot].resize((rows.size() + 63) / 64);
+			for (size_t row = 0; row < rows.size(); row++)
+			{
+				const StringView value = rows[row][slot];
+				if (value.data() != nullptr)
+				{
+					_data[slot].append(value.data(), value.size());
+					_validity[slot][row / 64] |= uint64_t(1) << (row % 64);
+				}
+				_offsets[slot].push_back(static_cast<uint32_t>(_data[slot].size()));
+			}
+			_batch._columns[slot]._data = _data[slot].data();
+			_batch._columns[slot]._offsets = _offsets[slot].data();
+			_batch._columns[slot]._validity = _validity[slot].data();
+		}
+	}
+
+	const RecordBatch& Batch() const { return _batch; }
+
+private:
+	std::vector<std::string> _data;
+	std::vector<std::vector<uint32_t>> _offsets;
+	std::vector<std::vector<uint64_t>> _validity;
+	RecordBatch _batch;
+};
+
+static bool IsSet(const SelectionMask& mask, const size_t row)
+{
+	return ((mask[row / 64] >> (row % 64)) & 1) != 0;
+}
+
+TEST(BatchProgram, SameResultsAsEvaluatorTest)
+{
+	// values longer than 63 chars share the last bit of the lengths mask of a set
+	const std::string long_tid(70, 'x');
+	const std::vector<std::string> expressions = {
+		"IN.MT == 1",
+		"IN.MT != 1 && IN.CURRENCY == \"985\"",
+		"IN.MT == 2 || SUBSTR{IN.TID, 3, 1} == [\"9\", \"2\", \"L\"]",
+		"(IN.MT == 1 && IN.CURRENCY != \"985\") || IN.TID == [\"abc9\", \"abcd\", \"x\", \"y\", \"z\", \"1\", \"2\", \"3\", \"4\", \"5\"]",
+		"(IN.MT == 1) == (IN.CURRENCY == \"985\")",
+		"(IN.MT == 1) > (IN.CURRENCY == \"985\") || (IN.MT == 2) <= (IN.TID != \"abcd\")",
+		"SUBSTR{IN.TID, 1, 2} == SUBSTR{IN.CURRENCY, 0, 2}",
+		"SUBSTR{IN.TID, \"-1\", 2} == \"\" && SUBSTR{IN.TID, 99999999999, 2} == \"\"",
+		"\"1\" == IN.MT || IN.MISSING == 1",
+		"IN.MT == 1 && \"a\" == \"a\"",
+		"\"a\" == \"b\" || IN.MT == 2",
+		"IN.TID == \"" + long_tid + "\" || IN.TID == [\"" + long_tid + "y\", \"abcd\"] || IN.TID == [\"" + long_tid + "\", \"x\"]",
+		// SUBSTR with variable position has no kernel, it's executed row by row, the rest of the expression is still evaluated by kernels
+		"SUBSTR{IN.TID, IN.MT, 1} == \"b\" || IN.CURRENCY == \"978\"",
+		"IN.MT == [\"1\", \"2\"] && (SUBSTR{IN.TID, IN.MT, 1} == \"b\" || SUBSTR{IN.CURRENCY, IN.MT, 1} != \"8\") && IN.TID != \"abcd\"",
+		// the whole expression is executed row by row
+		"SUBSTR{IN.TID, IN.MT, 1} == \"b\" || SUBSTR{IN.CURRENCY, IN.MT, 1} == \"8\""};
+
+	const std::vector<std::string> mts = {"1", "2", "3"};
+	const std::vector<std::string> currencies = {"985", "978", "98"};
+	const std::vector<std::string> tids = {"abc9", "abcd", "abcL", "x", "", "ab", long_tid, long_tid + "y"};
+
+	ExpressionEvaluator evaluator;
+	VariableSchema schema;
+	std::vector<CompiledExpression> compiled_expressions(expressions.size());
+	for (size_t i = 0; i < expressions.size(); i++)
+		ASSERT_TRUE(evaluator.Compile(expressions[i], schema, compiled_expressions[i])) << expressions[i];
+
+	EXPECT_TRUE(compiled_expressions[0].IsVectorized());
+	EXPECT_TRUE(compiled_expressions[expressions.size() - 3].IsVectorized());
+	EXPECT_TRUE(compiled_expressions[expressions.size() - 2].IsVectorized());
+	EXPECT_FALSE(compiled_expressions.back().IsVectorized());
+
+	uint32_t mt_slot = 0;
+	uint32_t currency_slot = 0;
+	uint32_t tid_slot = 0;
+	ASSERT_TRUE(schema.FindVariable("IN.MT", mt_slot));
+	ASSERT_TRUE(schema.FindVariable("IN.CURRENCY", currency_slot));
+	ASSERT_TRUE(schema.FindVariable("IN.TID", tid_slot));
+
+	// 150 rows make the last word of masks incomplete, every 7th value is missing
+	std::vector<VariableRecord> rows;
+	for (size_t row = 0; row < 150; row++)
+	{
+		VariableRecord record(schema.Size());
+		if (row % 7 != 1)
+			record[mt_slot] = mts[row % mts.size()];
+		if (row % 7 != 2)
+			record[currency_slot] = currencies[(row / 3) % currencies.size()];
+		if (row % 7 != 3)
+			record[tid_slot] = tids[(row / 9) % tids.size()];
+		rows.push_back(record);
+	}
+
+	TestBatch test_batch(rows, schema.Size());
+	for (size_t i = 0; i < expressions.size(); i++)
+	{
+		SelectionMask selection;
+		SelectionMask failures;
+		ASSERT_TRUE(evaluator.EvaluateBatch(compiled_expressions[i], test_batch.Batch(), selection, failures));
+		ASSERT_EQ(selection.size(), 3u);
+		ASSERT_EQ(failures.size(), 3u);
+		EXPECT_EQ(selection[2] >> 22, 0u);
+		EXPECT_EQ(failures[2] >> 22, 0u);
+
+		for (size_t row = 0; row < rows.size(); row++)
+		{
+			bool result = false;
+			const bool success = evaluator.Evaluate(compiled_expressions[i], rows[row], result);
+			EXPECT_EQ(IsSet(failures, row), !success) << expressions[i] << ", row " << row;
+			EXPECT_EQ(IsSet(selection, row), success && result) << expressions[i] << ", row " << row;
+		}
+	}
+}
+
+TEST(BatchProgram, NumberComparisonTest)
+{
+	// the comparison of numbers has no kernel, only it is executed row by row
+	VariableSchema schema;
+	schema.AddVariable("IN.AMOUNT", VariableType::Number);
+	ExpressionEvaluator evaluator;
+	CompiledExpression compiled_expression;
+	ASSERT_TRUE(evaluator.Compile("IN.MT == 1 && IN.AMOUNT > 100 && IN.CURRENCY == [\"985\", \"978\"]", schema, compiled_expression));
+	EXPECT_TRUE(compiled_expression.IsVectorized());
+
+	uint32_t mt_slot = 0;
+	uint32_t amount_slot = 0;
+	uint32_t currency_slot = 0;
+	ASSERT_TRUE(schema.FindVariable("IN.MT", mt_slot));
+	ASSERT_TRUE(schema.FindVariable("IN.AMOUNT", amount_slot));
+	ASSERT_TRUE(schema.FindVariable("IN.CURRENCY", currency_slot));
+
+	const std::vector<std::string> amounts = {"50", "100", "100.01", "abc", "250"};
+	std::vector<VariableRecord> rows;
+	for (size_t row = 0; row < 100; row++)
+	{
+		VariableRecord record(schema.Size());
+		record[mt_slot] = (row % 3 == 0 ? "2" : "1");
+		if (row % 11 != 5)
+			record[amount_slot] = amounts[row % amounts.size()];
+		record[currency_slot] = (row % 4 == 0 ? "840" : "985");
+		rows.push_back(record);
+	}
+
+	TestBatch test_batch(rows, schema.Size());
+	SelectionMask selection;
+	SelectionMask failures;
+	ASSERT_TRUE(evaluator.EvaluateBatch(compiled_expression, test_batch.Batch(), selection, failures));
+	for (size_t row = 0; row < rows.size(); row++)
+	{
+		bool result = false;
+		const bool success = evaluator.Evaluate(compiled_expression, rows[row], result);
+		EXPECT_EQ(IsSet(failures, row), !success) << "row " << row;
+		EXPECT_EQ(IsSet(selection, row), success && result) << "row " << row;
+	}
+}
+
+TEST(BatchProgram, EmptyExpressionTest)
+{
+	ExpressionEvaluator evaluator;
+	CompiledExpression compiled_expression;
+	ASSERT_TRUE(evaluator.Compile("", compiled_expression));
+
+	RecordBatch batch;
+	batch._rows_number = 70;
+	SelectionMask selection;
+	SelectionMask failures;
+	ASSERT_TRUE(evaluator.EvaluateBatch(compiled_expression, batch, selection, failures));
+	EXPECT_EQ(selection, SelectionMask({~uint64_t(0), 0x3f}));
+	EXPECT_EQ(failures, SelectionMask({0, 0}));
+
+	EXPECT_FALSE(evaluator.EvaluateBatch(CompiledExpression(), batch, selection, failures));
+}
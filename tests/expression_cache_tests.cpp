@@ -0,0 +1,137 @@
+#include <atomic>
+#include <thread>
+#include "gtest/gtest.h"
+#include "../expression_cache.h"
+#include "../expression_evaluator.h"
+
+using namespace Renaissance;
+
+static std::string MakeKey(const std::string& expression)
+{
+	std::string key;
+	ExpressionCache::MakeKey(expression, key);
+	return key;
+}
+
+TEST(ExpressionCache, MakeKeyTest)
+{
+	const std::string key = "IN.MT==1&&IN.CURRENCY!=\"985\"&&SUBSTR{IN.TID,3,1}==[\"9\",\"2\"]";
+	EXPECT_EQ(MakeKey("IN.MT==1&&IN.CURRENCY!=\"985\"&&SUBSTR{IN.TID,3,1}==[\"9\",\"2\"]"), key);
+	EXPECT_EQ(MakeKey("  IN.MT == 1 && IN.CURRENCY != \"985\" && SUBSTR{ IN.TID , 3 , 1 } == [ \"9\", \"2\" ] "), key);
+	EXPECT_EQ(MakeKey("((IN.MT == 1) && (IN.CURRENCY != \"985\") && (SUBSTR{IN.TID, 3, 1} == [\"9\", \"2\"]))"), key);
+	EXPECT_EQ(MakeKey("(((IN.MT) == 1) && ((IN.CURRENCY != (\"985\")) && (SUBSTR{IN.TID,3,1} == [\"9\",\"2\"])))"), "IN.MT==1&&(IN.CURRENCY!=\"985\"&&SUBSTR{IN.TID,3,1}==[\"9\",\"2\"])");
+
+	// whitespace in strings and between tokens of the same kind is kept
+	EXPECT_EQ(MakeKey("IN.MT == \" a  b \""), "IN.MT==\" a  b \"");
+	EXPECT_EQ(MakeKey("IN.MT == 1   2"), "IN.MT==1 2");
+	EXPECT_EQ(MakeKey("IN.MT = = 1"), "IN.MT= =1");
+	EXPECT_EQ(MakeKey("SUBSTR  {IN.TID, 3, 1} == \"1\""), "SUBSTR {IN.TID,3,1}==\"1\"");
+
+	// parentheses which change the order of operators are kept
+	EXPECT_EQ(MakeKey("(IN.A == 1 || IN.B == 1) && IN.C == 1"), "(IN.A==1||IN.B==1)&&IN.C==1");
+	EXPECT_EQ(MakeKey("IN.A == 1 && (IN.B == 1 && IN.C == 1)"), "IN.A==1&&(IN.B==1&&IN.C==1)");
+	EXPECT_EQ(MakeKey("(IN.A == 1 && IN.B == 1) && IN.C == 1"), "IN.A==1&&IN.B==1&&IN.C==1");
+	EXPECT_EQ(MakeKey("SUBSTR{(IN.TID), 3, 1} == [(\"9\")]"), "SUBSTR{(IN.TID),3,1}==[(\"9\")]");
+	EXPECT_EQ(MakeKey("(())"), "(())");
+	EXPECT_EQ(MakeKey("(IN.MT == 1"), "(IN.MT==1");
+}
+
+TEST(ExpressionCache, SameKeySameResultTest)
+{
+	// variants with the same key must be either all valid and give the same results or all invalid
+	const std::vector<std::vector<std::string>> variants = {
+		{"IN.MT == 1 && IN.CURRENCY != \"985\"", "((IN.MT == 1) && (IN.CURRENCY != \"985\"))", "(IN.MT)==(1)&&(IN.CURRENCY)!=(\"985\")"},
+		{"(IN.MT == 1 || IN.MT == 2) && IN.CURRENCY == \"985\"", "((IN.MT == 1) || (IN.MT == 2)) && (IN.CURRENCY == \"985\")"},
+		{"(IN.MT == 1) == (IN.CURRENCY == \"985\")", "((IN.MT == 1) == (IN.CURRENCY == \"985\"))"},
+		{"", " ", " \t "},
+		{"SUBSTR {IN.TID, 1, 1} == \"1\"", "(SUBSTR {IN.TID, 1, 1} == \"1\")"}};
+
+	ExpressionEvaluator evaluator;
+	for (const auto& group : variants)
+	{
+		CompiledExpression first;
+		const bool first_compiled = evaluator.Compile(group[0], first);
+		for (const auto& variant : group)
+		{
+			EXPECT_EQ(MakeKey(variant), MakeKey(group[0])) << variant;
+			CompiledExpression compiled_expression;
+			EXPECT_EQ(evaluator.Compile(variant, compiled_expression), first_compiled) << variant;
+			if (!first_compiled)
+				continue;
+
+			for (const auto& values : {VariableValues{{"IN.MT", "1"}, {"IN.CURRENCY", "985"}}, VariableValues{{"IN.MT", "2"}, {"IN.CURRENCY", "978"}}})
+			{
+				bool expected = false;
+				bool result = false;
+				EXPECT_EQ(evaluator.Evaluate(first, values, expected), evaluator.Evaluate(compiled_expression, values, result)) << variant;
+				EXPECT_EQ(result, expected) << variant;
+			}
+		}
+	}
+}
+
+TEST(ExpressionCache, CountersTest)
+{
+	ExpressionEvaluator evaluator(2);
+	const VariableValues values{{"IN.MT", "1"}};
+	bool result = false;
+	ASSERT_TRUE(evaluator.Evaluate("IN.MT == 1", values, result));
+	EXPECT_TRUE(result);
+	ASSERT_TRUE(evaluator.Evaluate("(IN.MT==1)", values, result));
+	EXPECT_TRUE(result);
+	EXPECT_EQ(evaluator.Cache().Hits(), 1u);
+	EXPECT_EQ(evaluator.Cache().Misses(), 1u);
+	EXPECT_EQ(evaluator.Cache().Size(), 1u);
+
+	// invalid expressions are not cached
+	EXPECT_FALSE(evaluator.Evaluate("IN.MT == ", values, result));
+	EXPECT_EQ(evaluator.Cache().Misses(), 2u);
+	EXPECT_EQ(evaluator.Cache().Size(), 1u);
+
+	ExpressionCache cache(2, 1);
+	CompiledExpression compiled_expression;
+	ASSERT_TRUE(evaluator.Compile("IN.MT == 1", compiled_expression));
+	cache.Insert("a", compiled_expression);
+	cache.Insert("b", compiled_expression);
+	EXPECT_TRUE(cache.Find("a", compiled_expression));
+	cache.Insert("c", compiled_expression); // "b" is the least recently used one
+	EXPECT_EQ(cache.Evictions(), 1u);
+	EXPECT_EQ(cache.Size(), 2u);
+	EXPECT_TRUE(cache.Find("a", compiled_expression));
+	EXPECT_FALSE(cache.Find("b", compiled_expression));
+	EXPECT_TRUE(cache.Find("c", compiled_expression));
+	EXPECT_EQ(cache.Hits(), 3u);
+	EXPECT_EQ(cache.Misses(), 1u);
+
+	cache.Clear();
+	EXPECT_EQ(cache.Size(), 0u);
+
+	ExpressionCache disabled_cache(0);
+	disabled_cache.Insert("a", compiled_expression);
+	EXPECT_FALSE(disabled_cache.Find("a", compiled_expression));
+}
+
+TEST(ExpressionCache, ConcurrentEvaluationTest)
+{
+	const ExpressionEvaluator evaluator(8);
+	std::vector<std::thread> threads;
+	std::atomic<int> errors(0);
+	for (int t = 0; t < 4; t++)
+	{
+		threads.emplace_back([&evaluator, &errors, t]()
+		{
+			for (int i = 0; i < 500; i++)
+			{
+				const std::string mt = std::to_string((t + i) % 12);
+				bool result = false;
+				if (!evaluator.Evaluate("(IN.MT == " + mt + ")", VariableValues{{"IN.MT", "3"}}, result) || result != (mt == "3"))
+					errors++;
+			}
+		});
+	}
+	for (auto& thread : threads)
+		thread.join();
+	EXPECT_EQ(errors, 0);
+	EXPECT_EQ(evaluator.Cache().Hits() + evaluator.Cache().Misses(), 2000u);
+	EXPECT_LE(evaluator.Cache().Size(), 8u);
+}
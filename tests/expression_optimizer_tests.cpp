@@ -0,0 +1,92 @@
+#include "gtest/gtest.h"
+#include "../expression_optimizer.h"
+#include "../expression_parser.h"
+
+using namespace Renaissance;
+
+// prefix notation of the tree, e.g. (and (== A 1) (!= B [x y]))
+std::string PrintTree(const ExpressionNode* node)
+{
+	if (!node->_child)
+		return node->_token._type == TokenType::LSquareBracket ? "[]" : node->_token.ToString();
+
+	std::string result = node->_token._type == TokenType::LSquareBracket ? "[" : "(" + node->_token.ToString() + " ";
+	for (auto child = node->_child; child; child = child->_sibling)
+		result += PrintTree(child) + (child->_sibling ? " " : "");
+	return result + (node->_token._type == TokenType::LSquareBracket ? "]" : ")");
+}
+
+void DoOptimizerTest(const std::string& expression, const std::string& expected_tree)
+{
+	std::pmr::monotonic_buffer_resource arena;
+	ExpressionParser parser(&arena);
+	ExpressionTree tree;
+	ASSERT_TRUE(parser.Parse(expression, tree));
+	ASSERT_FALSE(tree.empty());
+
+	ExpressionOptimizer optimizer(&arena);
+	EXPECT_EQ(PrintTree(optimizer.Optimize(tree.top())), expected_tree) << expression;
+}
+
+TEST(ExpressionOptimizer, ConstantComparisonTest)
+{
+	DoOptimizerTest("9 == [1, 3, 5, 7, 9]", "true");
+	DoOptimizerTest("9 != [1, 3, 5, 7, 9]", "false");
+	DoOptimizerTest("\"abc\" == \"abd\"", "false");
+	DoOptimizerTest("(1 == 1) != (2 == 3)", "true");
+	DoOptimizerTest("(1 == 1) < (2 == 3)", "false");
+}
+
+TEST(ExpressionOptimizer, ConstantNumberTest)
+{
+	DoOptimizerTest("1.50 == 1.5", "true");
+	DoOptimizerTest("-2 < 1 && 10 >= 9.9999", "true");
+	DoOptimizerTest("7 != [1, 7.0]", "false");
+	// a number compared with a string is a string
+	DoOptimizerTest("1.0 == \"1\"", "false");
+	DoOptimizerTest("01 == [\"1\", 2]", "false");
+	DoOptimizerTest("SUBSTR{12345, 0, 2} == 12.0", "false");
+	// the number can't be represented, so it's left to the compiler to fail
+	DoOptimizerTest("1.00001 == 1", "(== 1.00001 1)");
+}
+
+TEST(ExpressionOptimizer, ConstantSubstringTest)
+{
+	DoOptimizerTest("SUBSTR{\"abcdef\", 2, 3}", "cde");
+	DoOptimizerTest("SUBSTR{\"abcdef\", 2, 3} == \"cde\"", "true");
+	DoOptimizerTest("SUBSTR{\"abcd\", 2, 45} == \"cd\"", "true");
+	DoOptimizerTest("SUBSTR{\"abcd\", 7, 1} == \"\"", "true");
+	DoOptimizerTest("SUBSTR{VAR, 2, 3} == SUBSTR{\"abcdef\", 2, 3}", "(== (SUBSTR VAR 2 3) cde)");
+}
+
+TEST(ExpressionOptimizer, LogicalConstantTest)
+{
+	DoOptimizerTest("1 == 1 && A == 1", "(== A 1)");
+	DoOptimizerTest("1 == 2 && A == 1", "false");
+	DoOptimizerTest("1 == 1 || A == 1", "true");
+	DoOptimizerTest("1 == 2 || A == 1 || 3 == 4", "(== A 1)");
+	// the left operand might fail, so the constant is kept
+	DoOptimizerTest("A == 1 && 1 == 2 && B == 2", "(and (== A 1) false)");
+}
+
+TEST(ExpressionOptimizer, DuplicateOperandTest)
+{
+	DoOptimizerTest("A == 1 && B == 2 && (A == 1)", "(and (== A 1) (== B 2))");
+	DoOptimizerTest("(A == 1 || B == 2) && C == 3 && (A == 1 || B == 2)", "(and (or (== A 1) (== B 2)) (== C 3))");
+}
+
+TEST(ExpressionOptimizer, SingleItemArrayTest)
+{
+	DoOptimizerTest("A == [\"x\"]", "(== A x)");
+	DoOptimizerTest("SUBSTR{A, 1, 2} != [5]", "(!= (SUBSTR A 1 2) 5)");
+}
+
+TEST(ExpressionOptimizer, SetTestMergeTest)
+{
+	DoOptimizerTest("A != \"x\" && A != \"y\" && B == 1", "(and (!= A [x y]) (== B 1))");
+	DoOptimizerTest("A != [1, 2] && A != 3 && A != 2", "(!= A [1 2 3])");
+	DoOptimizerTest("A == 1 || A == 2 || B == 3 || A == 4", "(or (or (== A [1 2]) (== B 3)) (== A 4))");
+	DoOptimizerTest("SUBSTR{A, 0, 1} == 1 || SUBSTR{A, 0, 1} == 2", "(== (SUBSTR A 0 1) [1 2])");
+	// comparisons of different operators are not merged
+	DoOptimizerTest("A == 1 && A == 2", "(and (== A 1) (== A 2))");
+}
@@ -0,0 +1,91 @@
+#include "gtest/gtest.h"
+#include "../expression_optimizer.h"
+#include "../expression_parser.h"
+
+using namespace Renaissance;
+
+std::string ParseToCanonicalForm(const std::string& expression)
+{
+	ExpressionParser parser;
+	ExpressionTree tree;
+	if (!parser.Parse(expression, tree))
+		return "invalid";
+	return tree.empty() ? "empty" : ExpressionOptimizer::CanonicalForm(tree.top());
+}
+
+TEST(ExpressionParser, TokensTest)
+{
+	EXPECT_EQ(ParseToCanonicalForm("IN.MT == 1"), ParseToCanonicalForm("(IN.MT==1)"));
+	EXPECT_EQ(ParseToCanonicalForm("A<=B&&C>=-2.5||D<E"), ParseToCanonicalForm("((A <= B) && (C >= -2.5)) || (D < E)"));
+	EXPECT_EQ(ParseToCanonicalForm("SUBSTR{IN.TID,3,1}!=[\"9\",8]"), ParseToCanonicalForm("SUBSTR{IN.TID, 3, 1} != [\"9\", 8]"));
+	EXPECT_EQ(ParseToCanonicalForm("\tA\r\n==\v\fIN_B.2"), ParseToCanonicalForm("A == IN_B.2"));
+	// a token might end at the end of the expression
+	EXPECT_NE(ParseToCanonicalForm("A == B"), "invalid");
+	EXPECT_NE(ParseToCanonicalForm("A == \"\""), "invalid");
+	EXPECT_EQ(ParseToCanonicalForm(""), "empty");
+	EXPECT_EQ(ParseToCanonicalForm(" ( ) "), "empty");
+
+	EXPECT_EQ(ParseToCanonicalForm("A = B"), "invalid");
+	EXPECT_EQ(ParseToCanonicalForm("A == !B"), "invalid");
+	EXPECT_EQ(ParseToCanonicalForm("A == B & C"), "invalid");
+	EXPECT_EQ(ParseToCanonicalForm("A == - 1"), "invalid");
+	EXPECT_EQ(ParseToCanonicalForm("A == 1.5.5"), "invalid");
+	EXPECT_EQ(ParseToCanonicalForm("A == \"1"), "invalid");
+	EXPECT_EQ(ParseToCanonicalForm("A == 1) # (B"), "invalid");
+	EXPECT_EQ(ParseToCanonicalForm("A == \xe9"), "invalid");
+}
+
+TEST(ExpressionParser, ParseInPlaceTest)
+{
+	const std::string expression = "IN.MT == 1 && SUBSTR{IN.TID, 3, 1} == \"x\"";
+	ExpressionParser parser;
+	ExpressionTree tree;
+	ASSERT_TRUE(parser.ParseInPlace(expression, tree));
+	ASSERT_FALSE(tree.empty());
+	EXPECT_EQ(ExpressionOptimizer::CanonicalForm(tree.top()), ParseToCanonicalForm(expression));
+
+	// tokens point into the parsed expression
+	const StringView text = tree.top()->_child->_child->_token.Text();
+	EXPECT_EQ(text, "IN.MT");
+	EXPECT_EQ(text.data(), expression.data());
+
+	EXPECT_FALSE(parser.ParseInPlace("IN.MT == ", tree));
+}
+
+TEST(ExpressionParser, ParseManyTest)
+{
+	const std::vector<std::string> expressions = {"A == 1", "B == ", "", "(C != \"x\") || D == [1, 2]", "E < 2 &&"};
+	const std::vector<StringView> views(expressions.cbegin(), expressions.cend());
+
+	// nodes of the parser's own arena would be released by the next parsing
+	std::pmr::monotonic_buffer_resource arena;
+	ExpressionParser parser(&arena);
+	std::vector<ExpressionTree> trees;
+	std::vector<size_t> failed_indexes;
+	std::shared_ptr<const std::string> source;
+	EXPECT_FALSE(parser.ParseMany(views, trees, failed_indexes, source));
+	ASSERT_EQ(trees.size(), expressions.size());
+	EXPECT_EQ(failed_indexes, std::vector<size_t>({1, 4}));
+	ASSERT_TRUE(source);
+
+	for (size_t i = 0; i < expressions.size(); i++)
+	{
+		const std::string expected = ParseToCanonicalForm(expressions[i]);
+		if (expected == "invalid" || expected == "empty")
+			EXPECT_TRUE(trees[i].empty()) << expressions[i];
+		else
+		{
+			ASSERT_FALSE(trees[i].empty()) << expressions[i];
+			EXPECT_EQ(ExpressionOptimizer::CanonicalForm(trees[i].top()), expected);
+		}
+	}
+
+	// the trees of the arena stay valid after the next parsing
+	const std::vector<StringView> valid_views = {views[0], views[3]};
+	std::vector<ExpressionTree> valid_trees;
+	std::shared_ptr<const std::string> valid_source;
+	EXPECT_TRUE(parser.ParseMany(valid_views, valid_trees, failed_indexes, valid_source));
+	EXPECT_TRUE(failed_indexes.empty());
+	EXPECT_EQ(ExpressionOptimizer::CanonicalForm(trees[3].top()), ExpressionOptimizer::CanonicalForm(valid_trees[1].top()));
+	EXPECT_NE(trees[3].top()->_child->_child->_token._begin, valid_trees[1].top()->_child->_child->_token._begin);
+}
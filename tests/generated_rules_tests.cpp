@@ -0,0 +1,127 @@
+#include "gtest/gtest.h"
+#include "../expression_evaluator.h"
+#include "../generated_rules.h"
+#include "../rule_code_generator.h"
+
+using namespace Renaissance;
+
+// rules of generated_rules.txt compiled by rule_compiler at build time
+extern "C" const GeneratedRuleSet* GetTestRuleSet();
+
+static void CheckRuleSet(const GeneratedRuleSet& rule_set)
+{
+	const std::vector<std::string> mts = {"1", "2", "3", "x"};
+	const std::vector<std::string> currencies = {"985", "978", "840"};
+	const std::vector<std::string> countries = {"616", "276"};
+	const std::vector<std::string> tids = {"abc9", "abcd", "ab10", "b9", "x", "", "abcabc", "a\\b?"};
+
+	// the variables of the rule set define the schema the rules are compiled with by the evaluator
+	VariableSchema schema;
+	for (size_t slot = 0; slot < rule_set._variables_number; slot++)
+		ASSERT_EQ(schema.AddVariable(rule_set._variables[slot]), slot);
+
+	ExpressionEvaluator evaluator;
+	for (size_t i = 0; i < rule_set._rules_number; i++)
+	{
+		const GeneratedRule& rule = rule_set._rules[i];
+		CompiledExpression compiled_expression;
+		ASSERT_TRUE(evaluator.Compile(rule._expression, schema, compiled_expression)) << rule._id;
+		ASSERT_EQ(schema.Size(), rule_set._variables_number) << rule._id;
+
+		for (size_t record_index = 0; record_index < 2 * 3 * 2 * 8 * 4; record_index++)
+		{
+			size_t index = record_index;
+			std::map<std::string, std::string> values;
+			// every value might also be missing
+			if (index % 5 != 4)
+				values["IN.MT"] = mts[index % 5];
+			index /= 5;
+			if (index % 4 != 3)
+				values["IN.CURRENCY"] = currencies[index % 4];
+			index /= 4;
+			values["IN.BIN_ISSUEING_COUNTRY"] = countries[index % 2];
+			index /= 2;
+			values["IN.TID"] = tids[index % tids.size()];
+
+			VariableRecord record(schema.Size());
+			for (const auto& value : values)
+			{
+				uint32_t slot = 0;
+				if (schema.FindVariable(value.first, slot))
+					record[slot] = value.second;
+			}
+
+			bool expected = false;
+			const bool expected_success = evaluator.Evaluate(compiled_expression, record, expected);
+			bool result = false;
+			EXPECT_EQ(rule._function(record, result), expected_success) << rule._id << ", record " << record_index;
+			EXPECT_EQ(result, expected) << rule._id << ", record " << record_index;
+		}
+	}
+}
+
+TEST(GeneratedRules, SameResultsAsEvaluatorTest)
+{
+	const GeneratedRuleSet* rule_set = GetTestRuleSet();
+	ASSERT_NE(rule_set, nullptr);
+	EXPECT_EQ(rule_set->_rules_number, 13u);
+	CheckRuleSet(*rule_set);
+}
+
+TEST(GeneratedRules, RegistryTest)
+{
+	GeneratedRuleRegistry registry;
+	ASSERT_TRUE(registry.Register(*GetTestRuleSet()));
+	EXPECT_EQ(registry.RulesNumber(), 13u);
+	EXPECT_FALSE(registry.Register(*GetTestRuleSet())); // ids are registered already
+
+	const GeneratedRule* rule = nullptr;
+	const GeneratedRuleSet* rule_set = nullptr;
+	ASSERT_TRUE(registry.FindRule("mt_1_poland", rule, rule_set));
+	EXPECT_EQ(rule_set, GetTestRuleSet());
+	EXPECT_FALSE(registry.FindRule("unknown", rule, rule_set));
+
+	VariableRecord record(rule_set->_variables_number);
+	for (size_t slot = 0; slot < rule_set->_variables_number; slot++)
+	{
+		if (std::string(rule_set->_variables[slot]) == "IN.MT")
+			record[slot] = "1";
+		else if (std::string(rule_set->_variables[slot]) == "IN.BIN_ISSUEING_COUNTRY")
+			record[slot] = "616";
+	}
+	bool result = false;
+	EXPECT_TRUE(rule->_function(record, result));
+	EXPECT_TRUE(result);
+}
+
+TEST(GeneratedRules, LoadTest)
+{
+	GeneratedRuleRegistry registry;
+	EXPECT_FALSE(registry.Load("no_such_library.so"));
+	ASSERT_TRUE(registry.Load(GENERATED_RULES_MODULE));
+	EXPECT_EQ(registry.RulesNumber(), 13u);
+
+	const GeneratedRule* rule = nullptr;
+	const GeneratedRuleSet* rule_set = nullptr;
+	ASSERT_TRUE(registry.FindRule("tid_set", rule, rule_set));
+	EXPECT_NE(rule_set, GetTestRuleSet());
+	CheckRuleSet(*rule_set);
+}
+
+TEST(GeneratedRules, GeneratorTest)
+{
+	RuleCodeGenerator generator;
+	EXPECT_TRUE(generator.AddRule("a", "IN.MT == [\"1\", \"22\", \"33\"]"));
+	EXPECT_FALSE(generator.AddRule("a", "IN.MT == 2")); // duplicated id
+	EXPECT_FALSE(generator.AddRule("b", "IN.MT < \"1\"")); // relational operator on strings
+	EXPECT_FALSE(generator.AddRule("c", "IN.OTHER == (")); // syntax error
+	EXPECT_FALSE(generator.AddRule("d", "IN.OTHER IN RANGES [1, 2, 3]")); // bounds are not pairs
+	EXPECT_EQ(generator.RulesNumber(), 1u);
+	EXPECT_EQ(generator.Schema().Size(), 1u); // variables of invalid rules are not added
+
+	std::string code;
+	generator.Generate("GetRules", code);
+	EXPECT_NE(code.find("switch (s1.size())"), std::string::npos) << code;
+	EXPECT_NE(code.find("case 2:\n         b2 = s1 == StringView(\"22\", 2) || s1 == StringView(\"33\", 2);"), std::string::npos) << code;
+	EXPECT_NE(code.find("extern \"C\" const Renaissance::GeneratedRuleSet* GetRules()"), std::string::npos) << code;
+}
@@ -1,5 +1,8 @@
 #include "gtest/gtest.h"
+#include <limits>
+#include <tuple>
 #include "../expression_evaluator.h"
+#include "../string_functions.h"
 
 int main(int args, char* argv[])
 {
@@ -78,3 +81,446 @@ TEST(ExpressionCompiler, BigExpressionTest2)
 			 false);
 }
 
+
+TEST(ExpressionCompiler, CompileOnceEvaluateManyTest)
+{
+	ExpressionEvaluator e;
+	CompiledExpression compiled;
+	ASSERT_TRUE(e.Compile("IN.MT == 1 && SUBSTR{IN.TID, 3, 1} == [\"9\", \"2\", \"L\"]", compiled));
+
+	bool result = false;
+	EXPECT_TRUE(e.Evaluate(compiled, VariableValues{{"IN.MT", "1"}, {"IN.TID", "abcL"}}, result));
+	EXPECT_TRUE(result);
+	EXPECT_TRUE(e.Evaluate(compiled, VariableValues{{"IN.MT", "1"}, {"IN.TID", "abcd"}}, result));
+	EXPECT_FALSE(result);
+	EXPECT_TRUE(e.Evaluate(compiled, VariableValues{{"IN.MT", "2"}, {"IN.TID", "abc9"}}, result));
+	EXPECT_FALSE(result);
+}
+
+TEST(ExpressionCompiler, CompiledExpressionOwnsSourceTest)
+{
+	CompiledExpression compiled;
+	{
+		ExpressionEvaluator e;
+		ASSERT_TRUE(e.Compile("VAR == \"abc\"", compiled));
+		// next compilation must not invalidate the previous one
+		CompiledExpression other;
+		ASSERT_TRUE(e.Compile("OTHER == \"xyz\"", other));
+	}
+
+	ExpressionEvaluator e;
+	bool result = false;
+	EXPECT_TRUE(e.Evaluate(compiled, VariableValues{{"VAR", "abc"}}, result));
+	EXPECT_TRUE(result);
+}
+
+TEST(ExpressionCompiler, CompileErrorTest)
+{
+	ExpressionEvaluator e;
+	CompiledExpression compiled;
+	EXPECT_FALSE(e.Compile("(5 == 6) && (6 == 7", compiled));
+	EXPECT_FALSE(compiled.IsCompiled());
+
+	bool result = true;
+	EXPECT_FALSE(e.Evaluate(compiled, VariableValues{{}}, result));
+	EXPECT_FALSE(result);
+}
+
+// evaluate every expression over every set of variables by both the compiled program and the syntax tree walker
+// and check that results are the same
+void DoDifferentialTest(const std::vector<std::string>& expressions, const std::vector<VariableValues>& variables, const VariableSchema& schema = VariableSchema())
+{
+	ExpressionEvaluator e;
+	for (const auto& expression : expressions)
+	{
+		VariableSchema expression_schema = schema;
+		CompiledExpression compiled;
+		ASSERT_TRUE(e.Compile(expression, expression_schema, compiled)) << expression;
+		for (const auto& variable_values : variables)
+		{
+			bool program_result = false;
+			bool tree_result = false;
+			EXPECT_EQ(e.Evaluate(compiled, variable_values, program_result), e.EvaluateTree(compiled, variable_values, tree_result)) << expression;
+			EXPECT_EQ(program_result, tree_result) << expression;
+		}
+	}
+}
+
+TEST(ExpressionCompiler, ProgramDifferentialTest)
+{
+	std::vector<VariableValues> variables;
+	for (const auto& mt : {"1", "2"})
+		for (const auto& tid : {"abc9", "abcL", "abcd", "a", ""})
+			for (const auto& currency : {"985", "978"})
+				variables.push_back({{"IN.MT", mt}, {"IN.TID", tid}, {"IN.CURRENCY", currency}});
+
+	DoDifferentialTest({"IN.MT == 1",
+	                    "IN.MT != 1 || IN.CURRENCY == \"985\"",
+	                    "(IN.MT == 1) && (IN.CURRENCY != \"985\")",
+	                    "IN.MT == [1, 3] && SUBSTR{IN.TID, 3, 1} == [\"9\", \"2\", \"L\", \"V\", \"U\"]",
+	                    "IN.MT == 2 || SUBSTR{IN.TID, 3, 1} != [\"9\", \"L\"] && IN.CURRENCY == 978",
+	                    "SUBSTR{IN.TID, 1, 45} == \"bcd\" || SUBSTR{IN.TID, 12, 1} == \"\"",
+	                    "SUBSTR{IN.TID, IN.MT, 2} == \"bc\"",
+	                    "(IN.MT == 1) == (IN.CURRENCY == 985)",
+	                    "(IN.MT == 1) != (IN.CURRENCY == 985) && (IN.MT == 1) < (IN.CURRENCY == 985)",
+	                    "((IN.MT == 1 || IN.MT == 2) && (IN.CURRENCY == 985 || SUBSTR{IN.TID, 0, 1} == \"a\"))"},
+	                   variables);
+}
+
+TEST(ExpressionCompiler, ProgramShortCircuitTest)
+{
+	ExpressionEvaluator e;
+	CompiledExpression compiled;
+	ASSERT_TRUE(e.Compile("VAR1 == 1 && VAR2 == 2", compiled));
+
+	// the right operand is not executed, so the missing variable doesn't matter
+	bool result = true;
+	EXPECT_TRUE(e.Evaluate(compiled, VariableValues{{"VAR1", "0"}}, result));
+	EXPECT_FALSE(result);
+	EXPECT_FALSE(e.Evaluate(compiled, VariableValues{{"VAR1", "1"}}, result));
+}
+
+TEST(ExpressionCompiler, ProgramTypeErrorTest)
+{
+	ExpressionEvaluator e;
+	CompiledExpression compiled;
+	EXPECT_FALSE(e.Compile("VAR", compiled));
+	EXPECT_FALSE(e.Compile("VAR && 1 == 1", compiled));
+	EXPECT_FALSE(e.Compile("[1, 2] == VAR", compiled));
+	EXPECT_FALSE(e.Compile("UNKNOWN{VAR, 1, 2} == \"a\"", compiled));
+}
+
+TEST(ExpressionCompiler, VariableRecordTest)
+{
+	VariableSchema schema;
+	const uint32_t tid = schema.AddVariable("IN.TID");
+	const uint32_t mt = schema.AddVariable("IN.MT");
+
+	ExpressionEvaluator e;
+	CompiledExpression compiled;
+	ASSERT_TRUE(e.Compile("IN.MT == 1 && SUBSTR{IN.TID, 3, 1} == [\"9\", \"2\", \"L\"] || IN.CURRENCY == 985", schema, compiled));
+
+	// unknown variables are registered while compiling
+	uint32_t currency = 0;
+	ASSERT_TRUE(schema.FindVariable("IN.CURRENCY", currency));
+	EXPECT_EQ(schema.Size(), 3u);
+
+	VariableRecord record(schema.Size());
+	record[mt] = "1";
+	record[tid] = "abcL";
+	record[currency] = "978";
+
+	bool result = false;
+	EXPECT_TRUE(e.Evaluate(compiled, record, result));
+	EXPECT_TRUE(result);
+
+	record[tid] = "abcd";
+	EXPECT_TRUE(e.Evaluate(compiled, record, result));
+	EXPECT_FALSE(result);
+
+	// a value without data means the variable is missing
+	record[currency] = StringView();
+	EXPECT_FALSE(e.Evaluate(compiled, record, result));
+
+	record[currency] = "985";
+	EXPECT_TRUE(e.Evaluate(compiled, record, result));
+	EXPECT_TRUE(result);
+}
+
+TEST(ExpressionCompiler, ShortCircuitAndTest)
+{
+	DoTest("VAR1 == 1 && MISSING == 2", {{"VAR1", "0"}}, true, false);
+	DoTest("VAR1 == 1 && MISSING == 2", {{"VAR1", "1"}}, false, false);
+}
+
+TEST(ExpressionCompiler, ShortCircuitOrTest)
+{
+	DoTest("VAR1 == 1 || SUBSTR{MISSING, 3, 1} == [\"9\", \"2\"]", {{"VAR1", "1"}});
+	DoTest("VAR1 == 1 || SUBSTR{MISSING, 3, 1} == [\"9\", \"2\"]", {{"VAR1", "0"}}, false, false);
+}
+
+TEST(ExpressionCompiler, ShortCircuitDifferentialTest)
+{
+	// variables are missing in some of the sets, so the result depends on which operands are skipped
+	DoDifferentialTest({"IN.MT == 1 && IN.CURRENCY == 985",
+	                    "IN.MT == 1 || IN.CURRENCY == 985",
+	                    "(IN.MT == 1 || IN.TID == \"a\") && (IN.CURRENCY == 985 || IN.TID != \"b\")",
+	                    "IN.MT != 1 && SUBSTR{IN.TID, 0, 1} == [\"a\", \"b\"] || IN.CURRENCY != 985"},
+	                   {{{"IN.MT", "1"}},
+	                    {{"IN.MT", "2"}},
+	                    {{"IN.MT", "1"}, {"IN.CURRENCY", "985"}},
+	                    {{"IN.MT", "2"}, {"IN.TID", "a"}},
+	                    {{"IN.TID", "b"}, {"IN.CURRENCY", "978"}}});
+}
+
+TEST(ExpressionCompiler, LargeArrayTest)
+{
+	std::string expression = "IN.MCC != [";
+	for (int i = 0; i < 1000; i++)
+		expression += (i ? ", " : "") + std::to_string(5000 + i * 3);
+	expression += "]";
+
+	DoTest(expression, {{"IN.MCC", "5001"}});
+	DoTest(expression, {{"IN.MCC", "5003"}}, true, false);
+	DoTest(expression, {{"IN.MCC", "7997"}}, true, false);
+}
+
+TEST(ExpressionCompiler, OptimizedProgramDifferentialTest)
+{
+	std::vector<VariableValues> variables;
+	for (const auto& mt : {"1", "2", "3"})
+		for (const auto& tid : {"abc9", "abcL", "a"})
+			variables.push_back({{"IN.MT", mt}, {"IN.TID", tid}});
+	variables.push_back({{"IN.MT", "1"}});
+	variables.push_back({{"IN.TID", "abc9"}});
+
+	DoDifferentialTest({"9 == [1, 3, 5, 7, 9] && IN.MT == 1",
+	                    "SUBSTR{\"abc9\", 3, 1} == SUBSTR{IN.TID, 3, 1}",
+	                    "IN.MT != 1 && IN.MT != 2 && SUBSTR{IN.TID, 3, 1} == [\"9\"]",
+	                    "IN.MT == 1 || IN.MT == [2] || IN.TID == \"a\" || IN.MT == 3",
+	                    "IN.MT == 1 && IN.TID != \"a\" && IN.MT == 1 && 1 == 2",
+	                    "1 == 2 || IN.TID == \"abcL\" && 3 == [3] || IN.MT == 3"},
+	                   variables);
+}
+
+TEST(ExpressionCompiler, ConstantExpressionTest)
+{
+	DoTest("SUBSTR{\"abcdef\", 2, 3} == \"cde\" && 9 == [1, 3, 5, 7, 9]");
+	DoTest("1 == 2 && MISSING == 1", {{}}, true, false);
+}
+
+void DoParseNumberTest(const std::string& value, const bool expected_success, const int64_t expected_number = 0)
+{
+	int64_t number = 0;
+	EXPECT_EQ(ParseNumber(value, number), expected_success) << value;
+	if (expected_success)
+	{
+		EXPECT_EQ(number, expected_number) << value;
+	}
+}
+
+TEST(ExpressionCompiler, ParseNumberTest)
+{
+	DoParseNumberTest("12", true, 120000);
+	DoParseNumberTest("-0.25", true, -2500);
+	DoParseNumberTest("1000.50", true, 10005000);
+	DoParseNumberTest("1.500000", true, 15000);
+	DoParseNumberTest("922337203685477.5807", true, std::numeric_limits<int64_t>::max());
+	DoParseNumberTest("-922337203685477.5808", true, std::numeric_limits<int64_t>::min());
+	DoParseNumberTest("922337203685477.5808", false);
+	DoParseNumberTest("1.00001", false);
+	for (const auto& value : {"", "-", "1.", ".5", "1.2.3", " 1", "1 ", "+1", "1e2", "0x10"})
+		DoParseNumberTest(value, false);
+}
+
+TEST(ExpressionCompiler, NumberLiteralTest)
+{
+	DoTest("1.5 < 2 && -1 <= -1 && 10 > 9 && 0.5 >= 0.50 && 7 == [1, 7.0]");
+	// a number compared with a string is a string, so the relational operators are not defined for them
+	DoTest("IN.MT == 1.0", {{"IN.MT", "1"}}, true, false);
+	DoTest("IN.MT < SUBSTR{IN.TID, 0, 1}", {{"IN.MT", "0"}, {"IN.TID", "1"}}, false, false);
+	DoTest("1 < \"2\"", {{}}, false, false);
+	DoTest("IN.AMOUNT == 1.00001", {{"IN.AMOUNT", "1.00001"}}, true, true);
+	DoTest("1.00001 == 1", {{}}, false, false);
+}
+
+TEST(ExpressionCompiler, NumberVariableTest)
+{
+	VariableSchema schema;
+	const uint32_t amount = schema.AddVariable("IN.AMOUNT", VariableType::Number);
+
+	ExpressionEvaluator e;
+	CompiledExpression compiled;
+	ASSERT_TRUE(e.Compile("IN.AMOUNT >= 10.5 && IN.AMOUNT < 1000 && IN.AMOUNT != [99, 100.25]", schema, compiled));
+
+	const std::vector<std::tuple<std::string, bool, bool>> cases = {
+		std::make_tuple("10.50", true, true),
+		std::make_tuple("10.4999", true, false),
+		std::make_tuple("999.9999", true, true),
+		std::make_tuple("1000", true, false),
+		std::make_tuple("100.250", true, false),
+		std::make_tuple("99.5", true, true),
+		std::make_tuple("-20", true, false),
+		std::make_tuple("abc", false, false),
+		std::make_tuple("12.00001", false, false),
+		std::make_tuple("", false, false)};
+
+	VariableRecord record(schema.Size());
+	for (const auto& test_case : cases)
+	{
+		record[amount] = std::get<0>(test_case);
+		bool result = !std::get<2>(test_case);
+		EXPECT_EQ(e.Evaluate(compiled, record, result), std::get<1>(test_case)) << std::get<0>(test_case);
+		EXPECT_EQ(result, std::get<2>(test_case)) << std::get<0>(test_case);
+	}
+
+	// numbers are compared with numbers only
+	for (const auto& expression : {"IN.AMOUNT == \"5\"", "IN.AMOUNT == SUBSTR{IN.TID, 0, 1}", "IN.AMOUNT == [1, \"2\"]",
+	                               "SUBSTR{IN.AMOUNT, 0, 1} == \"1\"", "IN.AMOUNT < IN.TID", "IN.AMOUNT && 1 == 1", "IN.AMOUNT < 1.00001"})
+	{
+		EXPECT_FALSE(e.Compile(expression, schema, compiled)) << expression;
+	}
+}
+
+TEST(ExpressionCompiler, InferredNumberVariableTest)
+{
+	// a variable compared with a number literal by a relational operator is a number without a schema
+	DoTest("IN.AMOUNT > 100", {{"IN.AMOUNT", "150.5"}});
+	DoTest("IN.AMOUNT > 100", {{"IN.AMOUNT", "99.9999"}}, true, false);
+	DoTest("100 <= IN.AMOUNT && IN.AMOUNT == 100.00", {{"IN.AMOUNT", "100"}});
+	DoTest("IN.AMOUNT >= 10.5 && IN.AMOUNT != [99, 100.25]", {{"IN.AMOUNT", "100.250"}}, true, false);
+	DoTest("IN.AMOUNT > 100", {{"IN.AMOUNT", "abc"}}, false, false);
+	DoTest("IN.AMOUNT > 100 && IN.AMOUNT == \"abc\"", {{"IN.AMOUNT", "abc"}}, false, false);
+	DoTest("IN.MT < 1", {{"IN.MT", "0"}});
+
+	// a variable tagged as a string in the schema is not inferred
+	VariableSchema schema;
+	schema.AddVariable("IN.AMOUNT");
+	ExpressionEvaluator e;
+	CompiledExpression compiled;
+	EXPECT_FALSE(e.Compile("IN.AMOUNT > 100", schema, compiled));
+	EXPECT_TRUE(e.Compile("IN.LIMIT > 100", schema, compiled));
+	EXPECT_TRUE(schema.IsNumber("IN.LIMIT"));
+
+	bool result = false;
+	EXPECT_TRUE(e.EvaluateTree(compiled, {{"IN.LIMIT", "100.0001"}}, result));
+	EXPECT_TRUE(result);
+}
+
+TEST(ExpressionCompiler, NumberDifferentialTest)
+{
+	VariableSchema schema;
+	schema.AddVariable("IN.AMOUNT", VariableType::Number);
+	schema.AddVariable("IN.LIMIT", VariableType::Number);
+
+	std::vector<VariableValues> variables;
+	for (const auto& amount : {"5", "7.50", "-3", "x", ""})
+		for (const auto& limit : {"6", "-1.5", ""})
+			for (const auto& tid : {"5", "5.0", ""})
+			{
+				VariableValues values;
+				for (const auto& value : {std::make_pair("IN.AMOUNT", amount), std::make_pair("IN.LIMIT", limit), std::make_pair("IN.TID", tid)})
+				{
+					// an empty value stands for the missing variable here
+					if (*value.second != '\0')
+						values[value.first] = value.second;
+				}
+				variables.push_back(values);
+			}
+
+	DoDifferentialTest({"IN.AMOUNT < IN.LIMIT",
+	                    "IN.AMOUNT == 5 || IN.TID == 5",
+	                    "IN.AMOUNT == [5, 7.5] && IN.LIMIT > -1",
+	                    "IN.AMOUNT != 5 && IN.AMOUNT != 7.5 || IN.LIMIT <= 6",
+	                    "IN.AMOUNT == [5] || IN.TID == [5, 6]",
+	                    "(IN.AMOUNT >= 0) == (IN.LIMIT >= 0)",
+	                    "1 == 2 && IN.AMOUNT < 0 || 2.0 == 2 && IN.LIMIT != IN.AMOUNT"},
+	                   variables, schema);
+}
+
+TEST(ExpressionCompiler, PrefixTest)
+{
+	DoTest("IN.PAN PREFIX [\"4000\", \"51\", \"4\"]", {{"IN.PAN", "4111111111111111"}});
+	DoTest("IN.PAN PREFIX [\"4000\", \"51\"]", {{"IN.PAN", "4111111111111111"}}, true, false);
+	DoTest("IN.PAN PREFIX [\"4000\", \"51\"]", {{"IN.PAN", "5100"}});
+	DoTest("IN.PAN PREFIX [\"4000\", \"51\"]", {{"IN.PAN", "5"}}, true, false);
+	DoTest("IN.PAN PREFIX [\"\"]", {{"IN.PAN", ""}});
+	DoTest("SUBSTR{IN.PAN, 1, 3} PREFIX [\"00\", 12] && IN.MT == 1", {{"IN.PAN", "4123"}, {"IN.MT", "1"}});
+	DoTest("IN.PAN PREFIX [\"4\"]", {{"IN.MT", "1"}}, false, false);
+}
+
+TEST(ExpressionCompiler, InRangesTest)
+{
+	DoTest("IN.BIN IN RANGES [400000, 499999, 510000, 559999]", {{"IN.BIN", "400000"}});
+	DoTest("IN.BIN IN  RANGES [400000, 499999, 510000, 559999]", {{"IN.BIN", "559999"}});
+	DoTest("IN.BIN IN RANGES [400000, 499999, 510000, 559999]", {{"IN.BIN", "500000"}}, true, false);
+	DoTest("IN.BIN IN RANGES [400000, 499999, 450000, 509999]", {{"IN.BIN", "505000"}});
+	DoTest("IN.AMOUNT IN RANGES [-10.5, -1, 0, 0]", {{"IN.AMOUNT", "-1.00"}});
+	DoTest("IN.AMOUNT IN RANGES [-10.5, -1, 0, 0]", {{"IN.AMOUNT", "0"}});
+	DoTest("IN.AMOUNT IN RANGES [-10.5, -1, 0, 0]", {{"IN.AMOUNT", "-0.5"}}, true, false);
+	DoTest("SUBSTR{IN.PAN, 0, 6} IN RANGES [400000, 499999] || IN.MT == 1", {{"IN.PAN", "4111111111111111"}});
+	DoTest("IN.BIN IN RANGES [400000, 499999]", {{"IN.BIN", "4000OO"}}, false, false); // not a number
+	DoTest("IN.BIN IN RANGES [400000, 499999]", {{"IN.MT", "1"}}, false, false);
+	DoTest("IN.BIN == 1 || IN.BIN IN RANGES [400000, 499999]", {{"IN.BIN", "1"}}); // not parsed, as the right operand is skipped
+}
+
+TEST(ExpressionCompiler, TableOperatorErrorTest)
+{
+	ExpressionEvaluator e;
+	CompiledExpression compiled;
+	EXPECT_FALSE(e.Compile("IN.PAN PREFIX \"4\"", compiled));
+	EXPECT_FALSE(e.Compile("IN.PAN PREFIX IN.TID", compiled));
+	EXPECT_FALSE(e.Compile("[\"4\"] PREFIX [\"4\"]", compiled));
+	EXPECT_FALSE(e.Compile("IN.BIN IN RANGES [1, 2, 3]", compiled));    // odd number of bounds
+	EXPECT_FALSE(e.Compile("IN.BIN IN RANGES [2, 1]", compiled));       // lower bound is greater than the upper one
+	EXPECT_FALSE(e.Compile("IN.BIN IN RANGES [\"1\", \"2\"]", compiled)); // bounds must be numbers
+	EXPECT_FALSE(e.Compile("IN.BIN IN [1, 2]", compiled));
+	EXPECT_FALSE(e.Compile("(IN.MT == 1) IN RANGES [1, 2]", compiled));
+
+	// keywords of the operators might be parts of variable names
+	EXPECT_TRUE(e.Compile("PREFIXES == 1 && IN.RANGES == 1 && INRANGES == 1 && IN == 1", compiled));
+
+	// the keywords are operators only after an operand, so variables named by them are still variables
+	DoTest("PREFIX == \"1\" && IN == \"2\"", {{"PREFIX", "1"}, {"IN", "2"}});
+	DoTest("PREFIX PREFIX [\"12\"] && (IN) IN RANGES [1, 3]", {{"PREFIX", "123"}, {"IN", "2"}});
+	DoTest("IN.MT == 1 || IN PREFIX [\"x\"]", {{"IN.MT", "2"}, {"IN", "xy"}});
+	EXPECT_FALSE(e.Compile("PREFIX [\"4\"] == 1", compiled));
+	EXPECT_FALSE(e.Compile("IN RANGES [1, 2]", compiled));
+}
+
+TEST(ExpressionCompiler, TableOperatorDifferentialTest)
+{
+	VariableSchema schema;
+	schema.AddVariable("IN.AMOUNT", VariableType::Number);
+
+	std::vector<VariableValues> variables;
+	for (const auto& pan : {"4111111111111111", "5100000000000000", "510", "", "x"})
+		for (const auto& amount : {"5", "150.25", "x", ""})
+		{
+			VariableValues values;
+			if (*pan != '\0')
+				values["IN.PAN"] = pan;
+			if (*amount != '\0')
+				values["IN.AMOUNT"] = amount;
+			variables.push_back(values);
+		}
+
+	DoDifferentialTest({"IN.PAN PREFIX [\"4\", \"51\", \"510000\"]",
+	                    "SUBSTR{IN.PAN, 0, 6} IN RANGES [400000, 411111, 510000, 510000]",
+	                    "IN.AMOUNT IN RANGES [0, 10, 100, 200.5] && IN.PAN PREFIX [\"5\"]",
+	                    "IN.PAN PREFIX [\"x\"] || IN.AMOUNT IN RANGES [150.25, 150.25]",
+	                    "IN.PAN IN RANGES [0, 999]"},
+	                   variables, schema);
+}
+
+TEST(ExpressionCompiler, LargeRangeTableTest)
+{
+	// 100000 ranges of 10 numbers with gaps of 10 numbers between them
+	std::string ranges = "IN.BIN IN RANGES [";
+	std::string prefixes = "IN.PAN PREFIX [";
+	for (int i = 0; i < 100000; i++)
+	{
+		ranges += (i ? ", " : "") + std::to_string(10000000 + i * 20) + ", " + std::to_string(10000000 + i * 20 + 9);
+		prefixes += (i ? ", \"" : "\"") + std::to_string(10000000 + i * 20) + "\"";
+	}
+	ranges += "]";
+	prefixes += "]";
+
+	ExpressionEvaluator e;
+	CompiledExpression compiled_ranges;
+	CompiledExpression compiled_prefixes;
+	ASSERT_TRUE(e.Compile(ranges, compiled_ranges));
+	ASSERT_TRUE(e.Compile(prefixes, compiled_prefixes));
+	for (int bin = 9999990; bin < 12000010; bin += 29)
+	{
+		const bool expected = (bin >= 10000000 && bin < 12000000 && (bin - 10000000) % 20 < 10);
+		bool result = !expected;
+		EXPECT_TRUE(e.Evaluate(compiled_ranges, VariableValues{{"IN.BIN", std::to_string(bin)}}, result));
+		EXPECT_EQ(result, expected) << bin;
+
+		const bool expected_prefix = (bin >= 10000000 && bin < 12000000 && (bin - 10000000) % 20 == 0);
+		result = !expected_prefix;
+		EXPECT_TRUE(e.Evaluate(compiled_prefixes, VariableValues{{"IN.PAN", std::to_string(bin) + "123456"}}, result));
+		EXPECT_EQ(result, expected_prefix) << bin;
+	}
+}
@@ -0,0 +1,45 @@
+#include "gtest/gtest.h"
+#include "../prefix_set.h"
+
+using namespace Renaissance;
+
+TEST(PrefixSet, ContainsTest)
+{
+	PrefixSet set({"51", "4000", "4", "512", "55", "51", "6011"});
+	EXPECT_EQ(set.Items(), std::vector<std::string>({"4", "51", "55", "6011"})); // items starting with other items are removed
+
+	EXPECT_TRUE(set.Contains("4"));
+	EXPECT_TRUE(set.Contains("4999999999999999"));
+	EXPECT_TRUE(set.Contains("5100"));
+	EXPECT_TRUE(set.Contains("6011000000000000"));
+	EXPECT_FALSE(set.Contains("5"));
+	EXPECT_FALSE(set.Contains("52"));
+	EXPECT_FALSE(set.Contains("601"));
+	EXPECT_FALSE(set.Contains("3"));
+	EXPECT_FALSE(set.Contains("7"));
+	EXPECT_FALSE(set.Contains(""));
+	EXPECT_FALSE(PrefixSet().Contains("4"));
+
+	PrefixSet empty_prefix_set({"", "4"});
+	EXPECT_EQ(empty_prefix_set.Size(), 1u);
+	EXPECT_TRUE(empty_prefix_set.Contains(""));
+	EXPECT_TRUE(empty_prefix_set.Contains("x"));
+}
+
+TEST(PrefixSet, LargeSetTest)
+{
+	// prefixes of 6 and 5 digits
+	std::vector<std::string> items;
+	for (int i = 0; i < 100000; i++)
+		items.push_back(std::to_string(100000 + i * 7));
+	for (int i = 0; i < 1000; i++)
+		items.push_back(std::to_string(20000 + i * 3));
+	PrefixSet set(items);
+
+	for (int i = 100000; i < 800000; i += 3)
+	{
+		const int first_digits = i / 10;
+		const bool expected = (i - 100000) % 7 == 0 || (first_digits >= 20000 && first_digits < 23000 && (first_digits - 20000) % 3 == 0);
+		EXPECT_EQ(set.Contains(std::to_string(i) + "1234567890"), expected) << i;
+	}
+}
@@ -0,0 +1,29 @@
+#include "gtest/gtest.h"
+#include "../range_set.h"
+
+using namespace Renaissance;
+
+TEST(RangeSet, ContainsTest)
+{
+	RangeSet set({{510000, 559999}, {400000, 499999}, {450000, 505000}, {700000, 700000}, {-20, -10}});
+	EXPECT_EQ(set.Bounds(), std::vector<int64_t>({-20, -10, 400000, 505000, 510000, 559999, 700000, 700000})); // overlapping ranges are merged
+
+	for (const int64_t number : {-20, -15, -10, 400000, 450000, 505000, 510000, 559999, 700000})
+		EXPECT_TRUE(set.Contains(number)) << number;
+	for (const int64_t number : {-21, -9, 0, 399999, 505001, 509999, 560000, 699999, 700001})
+		EXPECT_FALSE(set.Contains(number)) << number;
+	EXPECT_FALSE(RangeSet().Contains(0));
+}
+
+TEST(RangeSet, LargeSetTest)
+{
+	// 100000 ranges of 10 numbers with gaps of 10 numbers between them
+	std::vector<std::pair<int64_t, int64_t>> ranges;
+	for (int64_t i = 100000; i-- > 0;)
+		ranges.emplace_back(i * 20, i * 20 + 9);
+	RangeSet set(ranges);
+	EXPECT_EQ(set.Size(), 100000u);
+
+	for (int64_t number = -5; number < 2000005; number++)
+		ASSERT_EQ(set.Contains(number), number >= 0 && number < 2000000 && number % 20 < 10) << number;
+}
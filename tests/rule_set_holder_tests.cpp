@@ -0,0 +1,129 @@
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "gtest/gtest.h"
+#include "../rule_set.h"
+#include "../rule_set_holder.h"
+
+using namespace Renaissance;
+
+namespace
+{
+// a version which counts living versions and is checked by readers while they use it
+struct TestVersion
+{
+	static std::atomic<int> _alive;
+	const int _number;
+	std::atomic<bool> _is_alive{true};
+
+	explicit TestVersion(const int number) : _number(number) { ++_alive; }
+	~TestVersion() { _is_alive = false; --_alive; }
+};
+
+std::atomic<int> TestVersion::_alive{0};
+}
+
+TEST(RuleSetHolder, PublishTest)
+{
+	{
+		RuleSetHolder<TestVersion> holder;
+		RuleSetHolder<TestVersion>::Reader reader(holder);
+		{
+			RuleSetHolder<TestVersion>::ReadLock lock(reader);
+			EXPECT_FALSE(lock);
+		}
+
+		holder.Publish(std::unique_ptr<const TestVersion>(new TestVersion(1)));
+		RuleSetHolder<TestVersion>::ReadLock lock(reader);
+		ASSERT_TRUE(lock);
+		EXPECT_EQ(lock->_number, 1);
+
+		// the version in use outlives the publication of the next one
+		holder.Publish(std::unique_ptr<const TestVersion>(new TestVersion(2)));
+		EXPECT_EQ(TestVersion::_alive, 2);
+		EXPECT_EQ(holder.Reclaim(), 1u);
+		{
+			// nested locks keep the version the reader started with
+			RuleSetHolder<TestVersion>::ReadLock nested_lock(reader);
+			EXPECT_EQ(nested_lock->_number, 1);
+		}
+		EXPECT_EQ(lock->_number, 1);
+	}
+	EXPECT_EQ(TestVersion::_alive, 0);
+
+	RuleSetHolder<TestVersion> holder(std::unique_ptr<const TestVersion>(new TestVersion(1)));
+	RuleSetHolder<TestVersion>::Reader reader(holder);
+	{
+		RuleSetHolder<TestVersion>::ReadLock lock(reader);
+		EXPECT_EQ(lock->_number, 1);
+	}
+	holder.Publish(std::unique_ptr<const TestVersion>(new TestVersion(2)));
+	EXPECT_EQ(TestVersion::_alive, 1); // there are no readers of the first version
+	EXPECT_EQ(holder.Reclaim(), 0u);
+}
+
+TEST(RuleSetHolder, ConcurrentPublishTest)
+{
+	RuleSetHolder<TestVersion> holder(std::unique_ptr<const TestVersion>(new TestVersion(0)));
+	std::atomic<bool> stop{false};
+	std::atomic<int> errors{0};
+	std::vector<std::thread> readers;
+	for (int i = 0; i < 4; i++)
+	{
+		readers.emplace_back([&holder, &stop, &errors]()
+		{
+			RuleSetHolder<TestVersion>::Reader reader(holder);
+			int last_number = 0;
+			while (!stop)
+			{
+				RuleSetHolder<TestVersion>::ReadLock lock(reader);
+				// versions are never seen destroyed nor older than the ones seen before
+				if (!lock || !lock->_is_alive || lock->_number < last_number)
+					++errors;
+				else
+					last_number = lock->_number;
+			}
+		});
+	}
+
+	for (int i = 1; i <= 1000; i++)
+		holder.Publish(std::unique_ptr<const TestVersion>(new TestVersion(i)));
+	stop = true;
+	for (auto& reader : readers)
+		reader.join();
+
+	EXPECT_EQ(errors, 0);
+	EXPECT_EQ(holder.Reclaim(), 0u);
+	EXPECT_EQ(TestVersion::_alive, 1);
+}
+
+TEST(RuleSetHolder, RuleSetReloadTest)
+{
+	const auto compile = [](const std::string& expression)
+	{
+		std::unique_ptr<RuleSet> rule_set(new RuleSet());
+		size_t rule_index = 0;
+		EXPECT_TRUE(rule_set->AddRule(expression, rule_index));
+		return std::unique_ptr<const RuleSet>(std::move(rule_set));
+	};
+
+	RuleSetHolder<RuleSet> holder(compile("IN.MT == 1"));
+	RuleSetHolder<RuleSet>::Reader reader(holder);
+	RuleSetContext context;
+	const VariableValues variables = {{"IN.MT", "2"}};
+	{
+		RuleSetHolder<RuleSet>::ReadLock lock(reader);
+		EXPECT_TRUE(lock->Evaluate(variables, context));
+		EXPECT_FALSE(context.Matches().test(0));
+	}
+
+	// the new version is compiled off the reader thread
+	std::thread writer([&holder, &compile]() { holder.Publish(compile("IN.MT == 2")); });
+	writer.join();
+
+	// the context evaluated by the previous version is evaluated fully by the new one
+	RuleSetHolder<RuleSet>::ReadLock lock(reader);
+	EXPECT_TRUE(lock->Reevaluate(variables, {}, context));
+	EXPECT_TRUE(context.Matches().test(0));
+}
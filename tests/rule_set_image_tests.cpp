@@ -0,0 +1,160 @@
+#include <cstdio>
+#include <string>
+#include <unistd.h>
+#include "gtest/gtest.h"
+#include "../rule_set.h"
+#include "../rule_set_image.h"
+
+using namespace Renaissance;
+
+const std::vector<std::string> RuleSetImageTestRules = {
+	"IN.MT == 1 && IN.BIN_ISSUEING_COUNTRY == \"616\"",
+	"IN.MT == 1 && SUBSTR{IN.TID, 3, 1} == [\"9\", \"2\", \"L\"]",
+	"IN.MT == 2 || SUBSTR{IN.TID, 0, 2} == [\"a0\", \"a1\", \"a2\", \"a3\", \"a4\", \"a5\", \"a6\", \"a7\", \"a8\", \"ab\"]",
+	"IN.CURRENCY != \"985\" || IN.MISSING == 1",
+	"IN.AMOUNT > 150.5 && IN.CURRENCY == [\"978\", \"840\"]",
+	"IN.AMOUNT == [100, 200, 300] || SUBSTR{IN.TID, IN.MT, 1} == \"b\"",
+	"",
+	"IN.MISSING == 1 && IN.MT == 1",
+	"IN.TID PREFIX [\"ab\", \"a7\", \"abc\"] && IN.AMOUNT IN RANGES [100, 150, 199.5, 300] || SUBSTR{IN.TID, 1, 3} IN RANGES [0, 9]"};
+
+class RuleSetImageTest : public ::testing::Test
+{
+protected:
+	void SetUp() override
+	{
+		VariableSchema schema;
+		schema.AddVariable("IN.AMOUNT", VariableType::Number);
+		_rule_set.reset(new RuleSet(schema));
+		for (const auto& rule : RuleSetImageTestRules)
+		{
+			size_t rule_index = 0;
+			ASSERT_TRUE(_rule_set->AddRule(rule, rule_index)) << rule;
+		}
+	}
+
+	// record of the variables by the image slots and by the rule set slots
+	void MakeRecords(const VariableValues& variables, const RuleSetImage& image, VariableRecord& image_record, VariableRecord& record)
+	{
+		image_record.assign(image.VariablesNumber(), StringView());
+		record.assign(_rule_set->Schema().Size(), StringView());
+		for (const auto& variable : variables)
+		{
+			uint32_t slot = 0;
+			if (image.FindVariable(variable.first, slot))
+				image_record[slot] = variable.second;
+			if (_rule_set->Schema().FindVariable(variable.first, slot))
+				record[slot] = variable.second;
+		}
+	}
+
+	void CheckSameResults(const RuleSetImage& image)
+	{
+		ASSERT_TRUE(image.IsLoaded());
+		EXPECT_EQ(image.RulesNumber(), _rule_set->RulesNumber());
+		EXPECT_EQ(image.PredicatesNumber(), _rule_set->PredicatesNumber());
+
+		RuleSetContext image_context;
+		RuleSetContext context;
+		VariableRecord image_record;
+		VariableRecord record;
+		for (const auto& mt : {"1", "2", ""})
+			for (const auto& tid : {"abc9", "a7cL", "abbd", ""})
+				for (const auto& currency : {"985", "978", ""})
+					for (const auto& amount : {"100.00", "200", "151", "1OO", ""})
+					{
+						VariableValues variables = {{"IN.BIN_ISSUEING_COUNTRY", "616"}, {"IN.TID", tid}};
+						if (*mt)
+							variables[std::string("IN.MT")] = mt;
+						if (*currency)
+							variables[std::string("IN.CURRENCY")] = currency;
+						if (*amount)
+							variables[std::string("IN.AMOUNT")] = amount;
+						MakeRecords(variables, image, image_record, record);
+
+						EXPECT_EQ(image.Evaluate(image_record, image_context), _rule_set->Evaluate(record, context));
+						EXPECT_EQ(image_context.Matches(), context.Matches());
+						EXPECT_EQ(image_context.Failures(), context.Failures());
+						EXPECT_EQ(image_context.PredicateEvaluations(), context.PredicateEvaluations());
+
+						EXPECT_EQ(image.FindAllMatches(image_record, image_context), _rule_set->FindAllMatches(record, context));
+						EXPECT_EQ(image_context.Matches(), context.Matches());
+						EXPECT_EQ(image_context.RuleEvaluations(), context.RuleEvaluations());
+
+						size_t image_rule_index = 0;
+						size_t rule_index = 0;
+						EXPECT_EQ(image.FindFirstMatch(image_record, image_context, image_rule_index), _rule_set->FindFirstMatch(record, context, rule_index));
+						EXPECT_EQ(image_rule_index, rule_index);
+					}
+	}
+
+	std::unique_ptr<RuleSet> _rule_set;
+};
+
+TEST_F(RuleSetImageTest, SameResultsAsRuleSetTest)
+{
+	std::string buffer;
+	RuleSetImage::Build(*_rule_set, buffer);
+
+	RuleSetImage image;
+	ASSERT_TRUE(image.Attach(buffer.data(), buffer.size()));
+	CheckSameResults(image);
+
+	// variables keep their slots and types
+	ASSERT_EQ(image.VariablesNumber(), _rule_set->Schema().Size());
+	for (uint32_t slot = 0; slot < image.VariablesNumber(); slot++)
+	{
+		EXPECT_EQ(image.VariableName(slot), _rule_set->Schema().VariableName(slot));
+		EXPECT_EQ(image.GetVariableType(slot), _rule_set->Schema().GetVariableType(slot));
+		uint32_t found_slot = 0;
+		EXPECT_TRUE(image.FindVariable(image.VariableName(slot), found_slot));
+		EXPECT_EQ(found_slot, slot);
+	}
+	uint32_t slot = 0;
+	EXPECT_FALSE(image.FindVariable("IN.UNKNOWN", slot));
+
+	// images of equal rule sets are equal
+	std::string other_buffer;
+	RuleSetImage::Build(*_rule_set, other_buffer);
+	EXPECT_EQ(buffer, other_buffer);
+}
+
+TEST_F(RuleSetImageTest, LoadFileTest)
+{
+	char path[] = "/tmp/rule_set_image_XXXXXX";
+	const int file = mkstemp(path);
+	ASSERT_GE(file, 0);
+	close(file);
+
+	ASSERT_TRUE(RuleSetImage::Save(*_rule_set, path));
+	{
+		RuleSetImage image;
+		ASSERT_TRUE(image.Load(path));
+		CheckSameResults(image);
+	}
+	std::remove(path);
+
+	RuleSetImage image;
+	EXPECT_FALSE(image.Load(path));
+	EXPECT_FALSE(image.IsLoaded());
+}
+
+TEST_F(RuleSetImageTest, InvalidImageTest)
+{
+	std::string buffer;
+	RuleSetImage::Build(*_rule_set, buffer);
+
+	RuleSetImage image;
+	EXPECT_FALSE(image.Attach(buffer.data(), buffer.size() - 1)); // truncated
+
+	std::string other_version = buffer;
+	other_version[8] ^= 0x7F;
+	EXPECT_FALSE(image.Attach(other_version.data(), other_version.size()));
+
+	std::string garbage(buffer.size(), 'x');
+	EXPECT_FALSE(image.Attach(garbage.data(), garbage.size()));
+	EXPECT_FALSE(image.IsLoaded());
+
+	ASSERT_TRUE(image.Attach(buffer.data(), buffer.size()));
+	EXPECT_EQ(image.RulesNumber(), RuleSetImageTestRules.size());
+}
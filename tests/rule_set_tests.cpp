@@ -0,0 +1,488 @@
+#include <numeric>
+#include <random>
+#include <thread>
+#include "gtest/gtest.h"
+#include "../expression_evaluator.h"
+#include "../rule_set.h"
+
+using namespace Renaissance;
+
+const std::vector<std::string> RuleSetTestRules = {
+	"IN.MT == 1 && IN.BIN_ISSUEING_COUNTRY == \"616\"",
+	"IN.MT == 1 && SUBSTR{IN.TID, 3, 1} == [\"9\", \"2\", \"L\"]",
+	"(IN.MT==1) && (IN.CURRENCY != \"985\") && (IN.BIN_ISSUEING_COUNTRY == \"616\")",
+	"IN.MT == 2 || SUBSTR{IN.TID, 3, 1} == [\"9\", \"2\", \"L\"]",
+	"IN.CURRENCY != \"985\" || IN.MISSING == 1",
+	"",
+	"IN.MISSING == 1 && IN.MT == 1"};
+
+TEST(RuleSet, SharedPredicatesTest)
+{
+	RuleSet rule_set;
+	for (size_t i = 0; i < RuleSetTestRules.size(); i++)
+	{
+		size_t rule_index = 0;
+		ASSERT_TRUE(rule_set.AddRule(RuleSetTestRules[i], rule_index)) << RuleSetTestRules[i];
+		EXPECT_EQ(rule_index, i);
+	}
+
+	// IN.MT == 1, IN.BIN_ISSUEING_COUNTRY == "616", SUBSTR == [...], IN.CURRENCY != "985", IN.MT == 2, IN.MISSING == 1
+	EXPECT_EQ(rule_set.RulesNumber(), RuleSetTestRules.size());
+	EXPECT_EQ(rule_set.PredicatesNumber(), 6u);
+
+	RuleSetContext context;
+	EXPECT_FALSE(rule_set.Evaluate(VariableValues{{"IN.MT", "1"}, {"IN.BIN_ISSUEING_COUNTRY", "616"}, {"IN.TID", "abcL"}, {"IN.CURRENCY", "978"}}, context));
+	EXPECT_EQ(context.PredicateEvaluations(), 6u); // every predicate is evaluated once, although rules refer to them 13 times
+
+
+	const std::vector<bool> expected_matches = {true, true, true, true, true, true, false};
+	const std::vector<bool> expected_failures = {false, false, false, false, false, false, true};
+	for (size_t i = 0; i < RuleSetTestRules.size(); i++)
+	{
+		EXPECT_EQ(context.Matches().test(i), expected_matches[i]) << RuleSetTestRules[i];
+		EXPECT_EQ(context.Failures().test(i), expected_failures[i]) << RuleSetTestRules[i];
+	}
+
+	// IN.BIN_ISSUEING_COUNTRY == "616" is not needed when IN.MT is not 1, IN.MISSING == 1 is not needed when the currency is not 985
+	EXPECT_FALSE(rule_set.Evaluate(VariableValues{{"IN.MT", "3"}, {"IN.TID", "abcd"}, {"IN.CURRENCY", "978"}}, context));
+	EXPECT_EQ(context.PredicateEvaluations(), 5u);
+}
+
+TEST(RuleSet, SameResultsAsEvaluatorTest)
+{
+	RuleSet rule_set;
+	std::vector<CompiledExpression> compiled(RuleSetTestRules.size());
+	ExpressionEvaluator e;
+	for (size_t i = 0; i < RuleSetTestRules.size(); i++)
+	{
+		size_t rule_index = 0;
+		ASSERT_TRUE(rule_set.AddRule(RuleSetTestRules[i], rule_index));
+		ASSERT_TRUE(e.Compile(RuleSetTestRules[i], compiled[i]));
+	}
+
+	RuleSetContext context;
+	for (const auto& mt : {"1", "2"})
+		for (const auto& tid : {"abc9", "abcd", ""})
+			for (const auto& currency : {"985", "978"})
+			{
+				VariableValues variables = {{"IN.MT", mt}, {"IN.TID", tid}, {"IN.CURRENCY", currency}, {"IN.BIN_ISSUEING_COUNTRY", "616"}};
+
+				// the same variables passed as a record
+				VariableRecord record(rule_set.Schema().Size());
+				for (const auto& variable : variables)
+				{
+					uint32_t slot = 0;
+					ASSERT_TRUE(rule_set.Schema().FindVariable(variable.first, slot));
+					record[slot] = variable.second;
+				}
+
+				for (int pass = 0; pass < 2; pass++)
+				{
+					if (pass == 0)
+						rule_set.Evaluate(variables, context);
+					else
+						rule_set.Evaluate(record, context);
+
+					for (size_t i = 0; i < RuleSetTestRules.size(); i++)
+					{
+						bool result = false;
+						EXPECT_EQ(e.Evaluate(compiled[i], variables, result), !context.Failures().test(i)) << RuleSetTestRules[i];
+						EXPECT_EQ(result, context.Matches().test(i)) << RuleSetTestRules[i];
+					}
+				}
+			}
+}
+
+TEST(RuleSet, InvalidRuleTest)
+{
+	RuleSet rule_set;
+	size_t rule_index = 0;
+	EXPECT_FALSE(rule_set.AddRule("(IN.MT == 1", rule_index));
+	EXPECT_FALSE(rule_set.AddRule("IN.MT == 1 && IN.TID", rule_index));
+	EXPECT_EQ(rule_set.RulesNumber(), 0u);
+	EXPECT_EQ(rule_set.PredicatesNumber(), 0u);
+}
+
+TEST(RuleSet, InvalidLargeRuleTest)
+{
+	// the partial tree of the failed rule doesn't fit into the first block of the arena, it's released before the next rule is parsed
+	std::string expression = "IN.TID == [";
+	for (int i = 0; i < 2000; i++)
+		expression += (i == 0 ? "\"" : ", \"") + std::to_string(i) + "\"";
+	expression += "] && #";
+
+	RuleSet rule_set;
+	size_t rule_index = 0;
+	EXPECT_FALSE(rule_set.AddRule(expression, rule_index));
+	ASSERT_TRUE(rule_set.AddRule("IN.MT == 1", rule_index));
+	EXPECT_EQ(rule_set.RulesNumber(), 1u);
+	RuleSetContext context;
+	EXPECT_TRUE(rule_set.Evaluate(VariableValues{{"IN.MT", "1"}}, context));
+	EXPECT_TRUE(context.Matches().test(rule_index));
+}
+
+TEST(RuleSet, IndexedFindMatchesTest)
+{
+	const std::vector<std::string> rules = {
+		"IN.MT == 1 && IN.CURRENCY == \"985\"",
+		"IN.MT == [1, 2] && IN.CURRENCY == [\"978\", \"840\"]",
+		"IN.MT == 2 && SUBSTR{IN.TID, 3, 1} == \"L\"",
+		"IN.CURRENCY != \"985\" || IN.MT == 3",
+		"IN.MT == 3 && IN.CURRENCY == \"985\"",
+		"IN.CURRENCY == \"840\""};
+
+	RuleSet rule_set;
+	for (const auto& rule : rules)
+	{
+		size_t rule_index = 0;
+		ASSERT_TRUE(rule_set.AddRule(rule, rule_index));
+	}
+	EXPECT_EQ(rule_set.IndexedVariablesNumber(), 2u);
+
+	RuleSetContext context;
+	RuleSetContext full_context;
+	for (const auto& mt : {"1", "2", "3", "4"})
+		for (const auto& currency : {"985", "978", "840"})
+			for (const auto& tid : {"abcL", "abcd"})
+			{
+				const VariableValues variables = {{"IN.MT", mt}, {"IN.CURRENCY", currency}, {"IN.TID", tid}};
+				EXPECT_TRUE(rule_set.Evaluate(variables, full_context));
+
+				// all matches are found with less evaluations
+				EXPECT_TRUE(rule_set.FindAllMatches(variables, context));
+				EXPECT_EQ(context.Matches(), full_context.Matches());
+				EXPECT_LT(context.RuleEvaluations(), rules.size());
+
+				size_t rule_index = 0;
+				const bool found = rule_set.FindFirstMatch(variables, context, rule_index);
+				EXPECT_EQ(found, full_context.Matches().any());
+				if (found)
+				{
+					EXPECT_EQ(rule_index, full_context.Matches().find_first());
+				}
+			}
+}
+
+TEST(RuleSet, IndexedRecordTest)
+{
+	RuleSet rule_set;
+	size_t rule_index = 0;
+	ASSERT_TRUE(rule_set.AddRule("IN.MT == 1 && IN.TID == \"x\"", rule_index));
+	ASSERT_TRUE(rule_set.AddRule("IN.MT == 2", rule_index));
+	ASSERT_TRUE(rule_set.AddRule("IN.MT != 2", rule_index));
+
+	uint32_t mt = 0;
+	ASSERT_TRUE(rule_set.Schema().FindVariable("IN.MT", mt));
+	VariableRecord record(rule_set.Schema().Size());
+	record[mt] = "2";
+
+	RuleSetContext context;
+	EXPECT_TRUE(rule_set.FindFirstMatch(record, context, rule_index));
+	EXPECT_EQ(rule_index, 1u);
+	EXPECT_EQ(context.RuleEvaluations(), 1u);
+
+	// the missing variable makes indexed rules impossible, the unindexed one fails
+	record[mt] = StringView();
+	EXPECT_FALSE(rule_set.FindAllMatches(record, context));
+	EXPECT_TRUE(context.Matches().none());
+	EXPECT_EQ(context.RuleEvaluations(), 1u);
+	EXPECT_TRUE(context.Failures().test(2));
+}
+
+TEST(RuleSet, NumberVariableTest)
+{
+	VariableSchema schema;
+	schema.AddVariable("IN.AMOUNT", VariableType::Number);
+	RuleSet rule_set(schema);
+	size_t rule_index = 0;
+	ASSERT_TRUE(rule_set.AddRule("IN.AMOUNT == 100 && IN.MT == 1", rule_index));
+	ASSERT_TRUE(rule_set.AddRule("IN.AMOUNT == [100, 200]", rule_index));
+	ASSERT_TRUE(rule_set.AddRule("IN.AMOUNT > 150.5", rule_index));
+	EXPECT_FALSE(rule_set.AddRule("IN.AMOUNT == \"100\"", rule_index));
+
+	// numbers are equal by value, so they are not indexed by their text
+	EXPECT_EQ(rule_set.IndexedVariablesNumber(), 1u);
+
+	RuleSetContext context;
+	EXPECT_TRUE(rule_set.FindAllMatches(VariableValues{{"IN.AMOUNT", "100.00"}, {"IN.MT", "1"}}, context));
+	EXPECT_TRUE(context.Matches().test(0));
+	EXPECT_TRUE(context.Matches().test(1));
+	EXPECT_FALSE(context.Matches().test(2));
+
+	EXPECT_TRUE(rule_set.FindAllMatches(VariableValues{{"IN.AMOUNT", "200.0"}, {"IN.MT", "1"}}, context));
+	EXPECT_FALSE(context.Matches().test(0));
+	EXPECT_TRUE(context.Matches().test(1));
+	EXPECT_TRUE(context.Matches().test(2));
+
+	// a value which is not a number fails the rules it's evaluated by
+	EXPECT_FALSE(rule_set.FindAllMatches(VariableValues{{"IN.AMOUNT", "1OO"}, {"IN.MT", "2"}}, context));
+	EXPECT_TRUE(context.Matches().none());
+	EXPECT_TRUE(context.Failures().test(1));
+	EXPECT_TRUE(context.Failures().test(2));
+}
+
+TEST(RuleSet, ProfilingTest)
+{
+	RuleSet rule_set;
+	for (const auto& rule : RuleSetTestRules)
+	{
+		size_t rule_index = 0;
+		ASSERT_TRUE(rule_set.AddRule(rule, rule_index)) << rule;
+	}
+
+	RuleSetContext context;
+	RuleSetStatistics statistics;
+	EXPECT_FALSE(rule_set.GetStatistics(context, statistics));
+
+	// every record is sampled
+	rule_set.EnableProfiling(context, 1);
+	EXPECT_TRUE(context.IsProfiling());
+	for (int i = 0; i < 10; i++)
+	{
+		rule_set.Evaluate(VariableValues{{"IN.MT", "1"}, {"IN.BIN_ISSUEING_COUNTRY", "616"}, {"IN.TID", "abcL"}, {"IN.CURRENCY", "978"}}, context);
+		rule_set.Evaluate(VariableValues{{"IN.MT", "3"}, {"IN.TID", "abcd"}, {"IN.CURRENCY", "978"}}, context);
+	}
+	ASSERT_TRUE(rule_set.GetStatistics(context, statistics));
+	EXPECT_EQ(statistics._records, 20u);
+	EXPECT_EQ(statistics._sampled_records, 20u);
+	ASSERT_EQ(statistics._rules.size(), RuleSetTestRules.size());
+	ASSERT_EQ(statistics._predicates.size(), 6u);
+
+	const auto& rule = statistics._rules[0];
+	EXPECT_EQ(rule._evaluations, 20u);
+	EXPECT_EQ(rule._true_results, 10u);
+	EXPECT_EQ(rule._false_results, 10u);
+	EXPECT_EQ(rule._failures, 0u);
+	EXPECT_EQ(std::accumulate(rule._latency_histogram.cbegin(), rule._latency_histogram.cend(), uint64_t(0)), 20u);
+	EXPECT_EQ(statistics._rules[6]._failures, 20u);
+
+	// IN.BIN_ISSUEING_COUNTRY == "616" is evaluated only when IN.MT is 1
+	const auto& predicate = statistics._predicates[1];
+	EXPECT_EQ(predicate._evaluations, 10u);
+	EXPECT_EQ(predicate._true_results, 10u);
+	EXPECT_EQ(statistics._predicates[5]._failures, 20u);
+
+	// predicates are mapped back to the rule expressions
+	const auto source = [&rule_set](const size_t predicate_index)
+	{
+		const SourceSpan& span = rule_set.PredicateSpan(predicate_index);
+		return RuleSetTestRules[span._rule_index].substr(span._offset, span._length);
+	};
+	EXPECT_EQ(source(0), "IN.MT == 1");
+	EXPECT_EQ(source(1), "IN.BIN_ISSUEING_COUNTRY == \"616\"");
+	EXPECT_EQ(source(2), "SUBSTR{IN.TID, 3, 1} == [\"9\", \"2\", \"L\"]");
+	EXPECT_EQ(source(3), "IN.CURRENCY != \"985\"");
+
+	// statistics of many contexts are summed up, they might be taken while the context evaluates records
+	RuleSetContext other_context;
+	rule_set.EnableProfiling(other_context, 0);
+	std::thread thread([&rule_set, &other_context]()
+	{
+		for (int i = 0; i < 1000; i++)
+			rule_set.Evaluate(VariableValues{{"IN.MT", "2"}}, other_context);
+	});
+	RuleSetStatistics concurrent_statistics;
+	EXPECT_TRUE(rule_set.GetStatistics(other_context, concurrent_statistics));
+	thread.join();
+
+	ASSERT_TRUE(rule_set.GetStatistics(other_context, statistics));
+	EXPECT_EQ(statistics._records, 1020u);
+	EXPECT_EQ(statistics._sampled_records, 20u);
+	EXPECT_EQ(statistics._rules[3]._true_results, 1010u);
+	EXPECT_LE(concurrent_statistics._records, 1000u);
+}
+
+TEST(RuleSet, ReorderingTest)
+{
+	RuleSet rule_set;
+	size_t rule_index = 0;
+	ASSERT_TRUE(rule_set.AddRule("IN.A == \"1\" && IN.B == \"2\"", rule_index));
+	EXPECT_FALSE(rule_set.IsReordered(rule_index));
+
+	// IN.B == "2" is never true, so it decides the result
+	RuleSetContext context;
+	rule_set.EnableProfiling(context, 1);
+	for (int i = 0; i < 10; i++)
+		rule_set.Evaluate(VariableValues{{"IN.A", "1"}, {"IN.B", "3"}}, context);
+	EXPECT_EQ(context.PredicateEvaluations(), 2u);
+	RuleSetStatistics statistics;
+	ASSERT_TRUE(rule_set.GetStatistics(context, statistics));
+	rule_set.Replan(statistics);
+	EXPECT_TRUE(rule_set.IsReordered(rule_index));
+
+	EXPECT_TRUE(rule_set.Evaluate(VariableValues{{"IN.A", "1"}, {"IN.B", "3"}}, context));
+	EXPECT_EQ(context.PredicateEvaluations(), 1u);
+	EXPECT_TRUE(context.Matches().none());
+
+	// the missing variable still fails the rule, as IN.A == "1" is written first
+	EXPECT_FALSE(rule_set.Evaluate(VariableValues{{"IN.B", "3"}}, context));
+	EXPECT_TRUE(context.Failures().test(rule_index));
+
+	EXPECT_TRUE(rule_set.Evaluate(VariableValues{{"IN.A", "1"}, {"IN.B", "2"}}, context));
+	EXPECT_TRUE(context.Matches().test(rule_index));
+	EXPECT_EQ(context.PredicateEvaluations(), 2u);
+
+	// the source order is restored by the statistics which favour it
+	for (auto& predicate : statistics._predicates)
+		predicate = EvaluationStatistics();
+	statistics._predicates[0]._evaluations = 10;
+	statistics._predicates[1]._evaluations = 10;
+	statistics._predicates[1]._true_results = 10;
+	rule_set.Replan(statistics);
+	EXPECT_FALSE(rule_set.IsReordered(rule_index));
+}
+
+TEST(RuleSet, ReorderedSameResultsAsEvaluatorTest)
+{
+	std::vector<std::string> rules = RuleSetTestRules;
+	rules.push_back("IN.MT == 1 && (IN.TID == \"abc9\" || IN.MISSING == 1 || IN.CURRENCY == \"985\") && IN.CURRENCY != \"978\"");
+	rules.push_back("IN.MISSING == 1 || IN.MT == 2 || SUBSTR{IN.TID, 3, 1} == \"d\" && IN.MT != 3");
+	rules.push_back("(IN.MT == 1 || IN.MISSING == 2) && (IN.TID == \"\" || IN.CURRENCY == \"985\")");
+
+	RuleSet rule_set;
+	std::vector<CompiledExpression> compiled(rules.size());
+	ExpressionEvaluator e;
+	for (size_t i = 0; i < rules.size(); i++)
+	{
+		size_t rule_index = 0;
+		ASSERT_TRUE(rule_set.AddRule(rules[i], rule_index)) << rules[i];
+		ASSERT_TRUE(e.Compile(rules[i], compiled[i]));
+	}
+
+	std::mt19937 generator(7);
+	RuleSetContext context;
+	for (int plan = 0; plan < 50; plan++)
+	{
+		// random statistics give random orders of the chains
+		RuleSetStatistics statistics;
+		statistics._predicates.resize(rule_set.PredicatesNumber());
+		for (auto& predicate : statistics._predicates)
+		{
+			predicate._evaluations = 100;
+			predicate._true_results = generator() % 101;
+			predicate._latency_histogram[generator() % 8] = 1;
+		}
+		rule_set.Replan(statistics);
+
+		for (const auto& mt : {"1", "2", "3", ""})
+			for (const auto& tid : {"abc9", "abcd", "", "-"})
+				for (const auto& currency : {"985", "978", ""})
+				{
+					VariableValues variables = {{"IN.BIN_ISSUEING_COUNTRY", "616"}};
+					if (*mt)
+						variables[std::string("IN.MT")] = mt;
+					if (*tid != '-')
+						variables[std::string("IN.TID")] = tid;
+					if (*currency)
+						variables[std::string("IN.CURRENCY")] = currency;
+
+					rule_set.Evaluate(variables, context);
+					for (size_t i = 0; i < rules.size(); i++)
+					{
+						bool result = false;
+						EXPECT_EQ(e.Evaluate(compiled[i], variables, result), !context.Failures().test(i)) << rules[i];
+						EXPECT_EQ(result, context.Matches().test(i)) << rules[i];
+					}
+				}
+	}
+}
+
+TEST(RuleSet, ReevaluateTest)
+{
+	RuleSet rule_set;
+	for (const auto& rule : RuleSetTestRules)
+	{
+		size_t rule_index = 0;
+		ASSERT_TRUE(rule_set.AddRule(rule, rule_index)) << rule;
+	}
+
+	// the transaction is enriched in stages, every stage changes a few variables
+	const std::vector<VariableValues> stages = {
+		{{"IN.MT", "1"}, {"IN.TID", "abcd"}},
+		{{"IN.CURRENCY", "985"}},
+		{{"IN.BIN_ISSUEING_COUNTRY", "616"}, {"IN.TID", "abcL"}},
+		{{"IN.MISSING", "1"}},
+		{{"IN.MT", "2"}, {"IN.CURRENCY", "978"}}};
+
+	RuleSetContext context;
+	RuleSetContext full_context;
+	VariableValues variables;
+	for (size_t i = 0; i < stages.size(); i++)
+	{
+		std::vector<std::string> changed_variables;
+		for (const auto& variable : stages[i])
+		{
+			variables[variable.first] = variable.second;
+			changed_variables.push_back(variable.first);
+		}
+
+		// the first stage is evaluated fully, as the context has no results yet
+		EXPECT_EQ(rule_set.Reevaluate(variables, changed_variables, context), rule_set.Evaluate(variables, full_context));
+		EXPECT_EQ(context.Matches(), full_context.Matches()) << "stage " << i;
+		EXPECT_EQ(context.Failures(), full_context.Failures()) << "stage " << i;
+		if (i == 0)
+			EXPECT_EQ(context.RuleEvaluations(), RuleSetTestRules.size());
+		else
+			EXPECT_LT(context.PredicateEvaluations(), full_context.PredicateEvaluations()) << "stage " << i;
+	}
+
+	// IN.MISSING == 1 is the only predicate of the variable, it's used by rules 4 and 6
+	uint32_t slot = 0;
+	ASSERT_TRUE(rule_set.Schema().FindVariable("IN.MISSING", slot));
+	VariableRecord record(rule_set.Schema().Size());
+	for (const auto& variable : variables)
+	{
+		uint32_t variable_slot = 0;
+		ASSERT_TRUE(rule_set.Schema().FindVariable(variable.first, variable_slot));
+		record[variable_slot] = variable.second;
+	}
+	EXPECT_TRUE(rule_set.Evaluate(record, context));
+	record[slot] = "2";
+	EXPECT_TRUE(rule_set.Reevaluate(record, {slot}, context));
+	EXPECT_EQ(context.PredicateEvaluations(), 1u);
+	EXPECT_EQ(context.RuleEvaluations(), 2u);
+	EXPECT_FALSE(context.Matches().test(6));
+
+	// results of a search are not complete, so the next reevaluation evaluates all rules
+	size_t rule_index = 0;
+	rule_set.FindFirstMatch(record, context, rule_index);
+	EXPECT_TRUE(rule_set.Reevaluate(record, {slot}, context));
+	EXPECT_EQ(context.RuleEvaluations(), RuleSetTestRules.size());
+}
+
+TEST(RuleSet, ReorderedReevaluateTest)
+{
+	RuleSet rule_set;
+	size_t rule_index = 0;
+	ASSERT_TRUE(rule_set.AddRule("IN.A == \"a\" && IN.B == \"b\"", rule_index));
+
+	// IN.B == "b" is never true, so it's evaluated first
+	RuleSetStatistics statistics;
+	statistics._predicates.resize(rule_set.PredicatesNumber());
+	statistics._predicates[0]._evaluations = 10;
+	statistics._predicates[0]._true_results = 10;
+	statistics._predicates[1]._evaluations = 10;
+	rule_set.Replan(statistics);
+	ASSERT_TRUE(rule_set.IsReordered(rule_index));
+
+	uint32_t a = 0;
+	uint32_t b = 0;
+	ASSERT_TRUE(rule_set.Schema().FindVariable("IN.A", a));
+	ASSERT_TRUE(rule_set.Schema().FindVariable("IN.B", b));
+	VariableRecord record(rule_set.Schema().Size());
+	record[a] = "a";
+	record[b] = "x";
+	RuleSetContext context;
+	EXPECT_TRUE(rule_set.Evaluate(record, context));
+	EXPECT_EQ(context.PredicateEvaluations(), 1u);
+	EXPECT_TRUE(context.Matches().none());
+
+	// IN.A == "a" wasn't evaluated, but the missing variable fails the rule, as the predicate is written first
+	record[a] = StringView();
+	RuleSetContext full_context;
+	EXPECT_FALSE(rule_set.Evaluate(record, full_context));
+	EXPECT_FALSE(rule_set.Reevaluate(record, {a}, context));
+	EXPECT_EQ(context.RuleEvaluations(), 1u);
+	EXPECT_EQ(context.Matches(), full_context.Matches());
+	EXPECT_EQ(context.Failures(), full_context.Failures());
+}
@@ -0,0 +1,132 @@
+#include "gtest/gtest.h"
+#include "../expression_evaluator.h"
+#include "../static_expression.h"
+
+using namespace Renaissance;
+
+RENAISSANCE_STATIC_EXPRESSION(MtRule, "IN.MT == 1");
+RENAISSANCE_STATIC_EXPRESSION(PrecedenceRule, "IN.MT == 1 || IN.MT == 2 && IN.CURRENCY != \"985\"");
+RENAISSANCE_STATIC_EXPRESSION(BracketsRule, "((IN.CURRENCY != \"985\") && (IN.MT==1) && (SUBSTR{IN.TID,3,1} == [\"9\", \"2\", \"L\", \"V\", \"U\"]))");
+RENAISSANCE_STATIC_EXPRESSION(NotInArrayRule, "SUBSTR{IN.TID, 1, 2} != [\"bc\", (\"b9\"), \"x\", \"12\"] || IN.MISSING == 1");
+RENAISSANCE_STATIC_EXPRESSION(BooleansRule, "(IN.MT == 1) < (IN.CURRENCY == \"985\") || (IN.MT == 2) >= (IN.TID == \"abcd\") && (IN.MT == 3) != (IN.TID == \"x\")");
+RENAISSANCE_STATIC_EXPRESSION(DynamicSubstrRule, "SUBSTR{IN.TID, IN.MT, 1} == \"b\" || SUBSTR{IN.TID, \"x\", 1} == \"a\"");
+RENAISSANCE_STATIC_EXPRESSION(SubstrBoundsRule, "SUBSTR{IN.TID, 99999999999, 1} == \"\" && SUBSTR{IN.TID, \" -1\", 2} == SUBSTR{IN.TID, 0, 0}");
+RENAISSANCE_STATIC_EXPRESSION(LiteralsRule, "\"a\" == \"a\" && 12 != IN.MT");
+RENAISSANCE_STATIC_EXPRESSION(NumbersRule, "1.50 == 1.5 && -2 < 1 && 7 == [1, 7.0] && IN.MT != 01 && IN.MT == [1, 12, 2.0]");
+RENAISSANCE_STATIC_EXPRESSION(PrefixRule, "IN.TID PREFIX [\"ab\", \"x\", 1] || SUBSTR{IN.TID, 1, 2} PREFIX [\"1\"] && IN.MT IN RANGES [1, 2, 10, 12.5]");
+RENAISSANCE_STATIC_EXPRESSION(RangesRule, "SUBSTR{IN.TID, 2, 2} IN  RANGES [-1, 5, 9, 9] || 5 IN RANGES [1, 10] && IN.CURRENCY PREFIX [\"98\"]");
+RENAISSANCE_STATIC_EXPRESSION(KeywordsRule, "IN.MT == 1 || IN PREFIX [\"1\"] || PREFIX IN RANGES [0, 1]");
+RENAISSANCE_STATIC_EXPRESSION(EmptyRule, " ( ) ");
+
+template <const auto& Expression>
+void CheckStaticExpression(const std::string& text)
+{
+	// the schema gets variables in the order of their slots in the static expression
+	VariableSchema schema;
+	for (size_t slot = 0; slot < Expression.VariablesNumber(); slot++)
+		ASSERT_EQ(schema.AddVariable(std::string(Expression.VariableName(slot))), slot);
+
+	ExpressionEvaluator evaluator;
+	CompiledExpression compiled_expression;
+	ASSERT_TRUE(evaluator.Compile(text, schema, compiled_expression)) << text;
+	ASSERT_EQ(schema.Size(), Expression.VariablesNumber()) << text;
+
+	const std::vector<std::string> mts = {"1", "2", "3", "12", "x"};
+	const std::vector<std::string> currencies = {"985", "978"};
+	const std::vector<std::string> tids = {"abc9", "abcd", "ab10", "b9", "x", "", "a12"};
+	for (size_t record_index = 0; record_index < 6 * 3 * 8; record_index++)
+	{
+		// every value might also be missing
+		std::map<std::string, std::string> values;
+		if (record_index % 6 != 5)
+			values["IN.MT"] = mts[record_index % 6];
+		if ((record_index / 6) % 3 != 2)
+			values["IN.CURRENCY"] = currencies[(record_index / 6) % 3];
+		if (record_index / 18 != 7)
+			values["IN.TID"] = tids[record_index / 18];
+
+		VariableRecord record(schema.Size());
+		for (const auto& value : values)
+		{
+			uint32_t slot = 0;
+			if (schema.FindVariable(value.first, slot))
+				record[slot] = value.second;
+		}
+
+		bool expected = false;
+		const bool expected_success = evaluator.Evaluate(compiled_expression, record, expected);
+		bool result = false;
+		EXPECT_EQ(EvaluateStatic<Expression>(record, result), expected_success) << text << ", record " << record_index;
+		EXPECT_EQ(result, expected) << text << ", record " << record_index;
+	}
+}
+
+TEST(StaticExpression, SameResultsAsEvaluatorTest)
+{
+	CheckStaticExpression<MtRule>("IN.MT == 1");
+	CheckStaticExpression<PrecedenceRule>("IN.MT == 1 || IN.MT == 2 && IN.CURRENCY != \"985\"");
+	CheckStaticExpression<BracketsRule>("((IN.CURRENCY != \"985\") && (IN.MT==1) && (SUBSTR{IN.TID,3,1} == [\"9\", \"2\", \"L\", \"V\", \"U\"]))");
+	CheckStaticExpression<NotInArrayRule>("SUBSTR{IN.TID, 1, 2} != [\"bc\", (\"b9\"), \"x\", \"12\"] || IN.MISSING == 1");
+	CheckStaticExpression<BooleansRule>("(IN.MT == 1) < (IN.CURRENCY == \"985\") || (IN.MT == 2) >= (IN.TID == \"abcd\") && (IN.MT == 3) != (IN.TID == \"x\")");
+	CheckStaticExpression<DynamicSubstrRule>("SUBSTR{IN.TID, IN.MT, 1} == \"b\" || SUBSTR{IN.TID, \"x\", 1} == \"a\"");
+	CheckStaticExpression<SubstrBoundsRule>("SUBSTR{IN.TID, 99999999999, 1} == \"\" && SUBSTR{IN.TID, \" -1\", 2} == SUBSTR{IN.TID, 0, 0}");
+	CheckStaticExpression<LiteralsRule>("\"a\" == \"a\" && 12 != IN.MT");
+	CheckStaticExpression<NumbersRule>("1.50 == 1.5 && -2 < 1 && 7 == [1, 7.0] && IN.MT != 01 && IN.MT == [1, 12, 2.0]");
+	CheckStaticExpression<PrefixRule>("IN.TID PREFIX [\"ab\", \"x\", 1] || SUBSTR{IN.TID, 1, 2} PREFIX [\"1\"] && IN.MT IN RANGES [1, 2, 10, 12.5]");
+	CheckStaticExpression<RangesRule>("SUBSTR{IN.TID, 2, 2} IN  RANGES [-1, 5, 9, 9] || 5 IN RANGES [1, 10] && IN.CURRENCY PREFIX [\"98\"]");
+	CheckStaticExpression<KeywordsRule>("IN.MT == 1 || IN PREFIX [\"1\"] || PREFIX IN RANGES [0, 1]");
+	CheckStaticExpression<EmptyRule>(" ( ) ");
+}
+
+TEST(StaticExpression, VariablesTest)
+{
+	static_assert(BracketsRule.VariablesNumber() == 3, "variables are counted once");
+	static_assert(BracketsRule.VariableName(0) == "IN.CURRENCY", "slots are given by the first occurrence");
+	static_assert(BracketsRule.VariableName(2) == "IN.TID", "slots are given by the first occurrence");
+	static_assert(EmptyRule.IsEmpty(), "expression without operands is empty");
+	static_assert(KeywordsRule.VariableName(1) == "IN" && KeywordsRule.VariableName(2) == "PREFIX", "operator keywords are names of variables before an operator");
+}
+
+// invalid expressions are rejected at compile time and by the runtime evaluator
+#define CHECK_INVALID(text) \
+	static_assert(!StaticExpression<sizeof(text)>(text).IsValid(), text); \
+	EXPECT_FALSE(evaluator.Compile(text, compiled_expression)) << text
+
+TEST(StaticExpression, InvalidExpressionTest)
+{
+	ExpressionEvaluator evaluator;
+	CompiledExpression compiled_expression;
+	CHECK_INVALID("IN.MT == ");
+	CHECK_INVALID("IN.MT");
+	CHECK_INVALID("(IN.MT == 1");
+	CHECK_INVALID("IN.MT == 1)");
+	CHECK_INVALID("IN.MT < \"1\"");
+	CHECK_INVALID("IN.MT == \"1");
+	CHECK_INVALID("[\"1\"] == IN.MT");
+	CHECK_INVALID("IN.MT == [IN.A]");
+	CHECK_INVALID("IN.MT == [\"1\"] && [\"2\"]");
+	CHECK_INVALID("IN.MT == (IN.A == 1)");
+	CHECK_INVALID("IN.MT == 1 && IN.A");
+	CHECK_INVALID("SUBSTR{IN.TID, 1} == \"1\"");
+	CHECK_INVALID("SUBSTR{IN.TID, 1, 1, 1} == \"1\"");
+	CHECK_INVALID("SUBSTR {IN.TID, 1, 1} == \"1\"");
+	CHECK_INVALID("LEFT{IN.TID, 1, 1} == \"1\"");
+	CHECK_INVALID("SUBSTR{IN.MT == 1, 1, 1} == \"1\"");
+	CHECK_INVALID("IN.MT = 1");
+	CHECK_INVALID("IN.MT == 1 # 2");
+	// the runtime evaluator infers a variable compared with a number as a number, the static parser has no number variables
+	static_assert(!StaticExpression<sizeof("IN.MT < 1")>("IN.MT < 1").IsValid(), "IN.MT < 1");
+	CHECK_INVALID("1 < \"2\"");
+	CHECK_INVALID("1 < [1, 2]");
+	CHECK_INVALID("1.00001 == 1");
+	CHECK_INVALID("IN.MT == 1.");
+	CHECK_INVALID("IN.TID PREFIX \"1\"");
+	CHECK_INVALID("IN.TID PREFIX IN.MT");
+	CHECK_INVALID("(IN.MT == 1) PREFIX [\"1\"]");
+	CHECK_INVALID("PREFIX [\"1\"] == IN.MT");
+	CHECK_INVALID("IN.TID IN RANGES [1, 2, 3]");
+	CHECK_INVALID("IN.TID IN RANGES [2, 1]");
+	CHECK_INVALID("IN.TID IN RANGES [\"1\", \"2\"]");
+	CHECK_INVALID("IN.TID IN RANGES [1, 1.00001]");
+	CHECK_INVALID("IN.TID IN [1, 2]");
+}
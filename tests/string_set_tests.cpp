@@ -0,0 +1,42 @@
+#include "gtest/gtest.h"
+#include "../string_set.h"
+
+using namespace Renaissance;
+
+// check membership of every item and of values around them
+void DoStringSetTest(const size_t size)
+{
+	std::vector<std::string> items;
+	for (size_t i = 0; i < size; i++)
+		items.push_back(std::to_string(i * 2));
+	items.push_back("0"); // duplicate
+
+	StringSet set(items);
+	EXPECT_EQ(set.Size(), size);
+
+	for (size_t i = 0; i < size; i++)
+	{
+		EXPECT_TRUE(set.Contains(std::to_string(i * 2))) << i * 2;
+		EXPECT_FALSE(set.Contains(std::to_string(i * 2 + 1))) << i * 2 + 1;
+	}
+	EXPECT_FALSE(set.Contains(""));
+	EXPECT_FALSE(set.Contains("a very long value which is longer than sixty three characters for sure"));
+}
+
+TEST(StringSet, SmallSetTest)
+{
+	DoStringSetTest(5);
+}
+
+TEST(StringSet, LargeSetTest)
+{
+	DoStringSetTest(5000);
+}
+
+TEST(StringSet, EmptyStringTest)
+{
+	StringSet set({"", "a", "bb"});
+	EXPECT_TRUE(set.Contains(""));
+	EXPECT_TRUE(set.Contains("bb"));
+	EXPECT_FALSE(set.Contains("b"));
+}
@@ -0,0 +1,88 @@
+#include <atomic>
+#include <thread>
+#include "gtest/gtest.h"
+#include "../expression_evaluator.h"
+#include "../thread_pool.h"
+
+using namespace Renaissance;
+
+TEST(ThreadPool, RunsEveryTaskOnceTest)
+{
+	ThreadPool pool(4);
+	EXPECT_EQ(pool.ThreadsNumber(), 4u);
+
+	for (const size_t tasks_number : {0, 1, 3, 1000})
+	{
+		std::vector<std::atomic<int>> runs(tasks_number);
+		for (auto& run : runs)
+			run = 0;
+		pool.Run(tasks_number, [&](const size_t task) { runs[task]++; });
+		for (size_t i = 0; i < tasks_number; i++)
+			EXPECT_EQ(runs[i], 1) << "task " << i << " of " << tasks_number;
+	}
+}
+
+TEST(ThreadPool, EvaluateParallelTest)
+{
+	ExpressionEvaluator evaluator;
+	VariableSchema schema;
+	CompiledExpression compiled_expression;
+	ASSERT_TRUE(evaluator.Compile("IN.MT == 1 && SUBSTR{IN.TID, 1, 1} == [\"a\", \"c\"]", schema, compiled_expression));
+
+	uint32_t mt_slot = 0;
+	uint32_t tid_slot = 0;
+	ASSERT_TRUE(schema.FindVariable("IN.MT", mt_slot));
+	ASSERT_TRUE(schema.FindVariable("IN.TID", tid_slot));
+
+	const std::vector<std::string> mts = {"1", "2"};
+	const std::vector<std::string> tids = {"xa", "xb", "xc"};
+	std::vector<VariableRecord> records(5000, VariableRecord(schema.Size()));
+	for (size_t i = 0; i < records.size(); i++)
+	{
+		records[i][mt_slot] = mts[i % mts.size()];
+		if (i % 11 != 0)
+			records[i][tid_slot] = tids[i % tids.size()];
+	}
+
+	ThreadPool pool(3);
+	SelectionMask selection;
+	SelectionMask failures;
+	ASSERT_TRUE(evaluator.EvaluateParallel(compiled_expression, records, pool, selection, failures));
+	ASSERT_EQ(selection.size(), (records.size() + 63) / 64);
+	for (size_t i = 0; i < records.size(); i++)
+	{
+		bool result = false;
+		const bool success = evaluator.Evaluate(compiled_expression, records[i], result);
+		EXPECT_EQ(((failures[i / 64] >> (i % 64)) & 1) != 0, !success) << "record " << i;
+		EXPECT_EQ(((selection[i / 64] >> (i % 64)) & 1) != 0, success && result) << "record " << i;
+	}
+
+	EXPECT_FALSE(evaluator.EvaluateParallel(CompiledExpression(), records, pool, selection, failures));
+}
+
+TEST(ThreadPool, SharedEvaluatorTest)
+{
+	// one evaluator compiles and evaluates from many threads at once
+	const ExpressionEvaluator evaluator;
+	std::atomic<int> errors(0);
+	std::vector<std::thread> threads;
+	for (int t = 0; t < 4; t++)
+	{
+		threads.emplace_back([&evaluator, &errors, t]()
+		{
+			for (int i = 0; i < 200; i++)
+			{
+				const std::string mt = std::to_string((t + i) % 3);
+				bool result = false;
+				if (!evaluator.Evaluate("IN.MT == " + mt + " && IN.CURRENCY != \"985\"", VariableValues{{"IN.MT", "1"}, {"IN.CURRENCY", "978"}}, result) ||
+				    result != (mt == "1"))
+				{
+					errors++;
+				}
+			}
+		});
+	}
+	for (auto& thread : threads)
+		thread.join();
+	EXPECT_EQ(errors, 0);
+}
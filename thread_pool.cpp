@@ -0,0 +1,114 @@
+#include "thread_pool.h"
+
+namespace Renaissance
+{
+ThreadPool::ThreadPool(const size_t threads_number)
+{
+   // hardware_concurrency might be unknown
+   const size_t workers_number = (threads_number == 0 ? 1 : threads_number);
+   for (size_t i = 0; i < workers_number; i++)
+      _workers.emplace_back(new Worker());
+   for (size_t i = 0; i < workers_number; i++)
+      _threads.emplace_back(&ThreadPool::WorkerLoop, this, i);
+}
+
+ThreadPool::~ThreadPool()
+{
+   {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _stop = true;
+   }
+   _work_available.notify_all();
+   for (auto& thread : _threads)
+      thread.join();
+}
+
+// run the 'task' for every index from 0 to 'tasks_number' - 1 on the pool threads, the method returns when all of them are done
+// the task must not call Run of the same pool
+void ThreadPool::Run(const size_t tasks_number, const std::function<void(size_t task)>& task)
+{
+   if (tasks_number == 0)
+      return;
+
+   std::lock_guard<std::mutex> run_lock(_run_mutex);
+   {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _task = &task;
+      _remaining_tasks = tasks_number;
+   }
+
+   // every worker gets a contiguous range of tasks
+   for (size_t i = 0; i < _workers.size(); i++)
+   {
+      Worker& worker = *_workers[i];
+      std::lock_guard<std::mutex> lock(worker._mutex);
+      for (size_t task_index = i * tasks_number / _workers.size(); task_index < (i + 1) * tasks_number / _workers.size(); task_index++)
+         worker._tasks.push_back(task_index);
+   }
+
+   std::unique_lock<std::mutex> lock(_mutex);
+   _generation++;
+   _work_available.notify_all();
+   _work_done.wait(lock, [this]() { return _remaining_tasks == 0; });
+   _task = nullptr;
+}
+
+void ThreadPool::WorkerLoop(const size_t worker_index)
+{
+   size_t generation = 0;
+   while (true)
+   {
+      {
+         std::unique_lock<std::mutex> lock(_mutex);
+         _work_available.wait(lock, [this, generation]() { return _stop || _generation != generation; });
+         if (_stop)
+            return;
+         generation = _generation;
+      }
+
+      size_t task = 0;
+      size_t done_tasks = 0;
+      while (PopTask(worker_index, task))
+      {
+         (*_task)(task);
+         done_tasks++;
+      }
+
+      if (done_tasks != 0)
+      {
+         std::lock_guard<std::mutex> lock(_mutex);
+         _remaining_tasks -= done_tasks;
+         if (_remaining_tasks == 0)
+            _work_done.notify_all();
+      }
+   }
+}
+
+// take the next task from the front of the own queue or steal one from the back of another worker queue
+bool ThreadPool::PopTask(const size_t worker_index, size_t& task)
+{
+   {
+      Worker& worker = *_workers[worker_index];
+      std::lock_guard<std::mutex> lock(worker._mutex);
+      if (!worker._tasks.empty())
+      {
+         task = worker._tasks.front();
+         worker._tasks.pop_front();
+         return true;
+      }
+   }
+
+   for (size_t i = 1; i < _workers.size(); i++)
+   {
+      Worker& victim = *_workers[(worker_index + i) % _workers.size()];
+      std::lock_guard<std::mutex> lock(victim._mutex);
+      if (!victim._tasks.empty())
+      {
+         task = victim._tasks.back();
+         victim._tasks.pop_back();
+         return true;
+      }
+   }
+   return false;
+}
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// This is a pool of worker threads to run many small independent tasks, e.g. evaluation of a large record set split into chunks.
+// Every worker has its own queue of tasks, initially each one gets a contiguous range of tasks, so neighbouring chunks stay on the same core.
+// A worker which has run out of its own tasks steals them from the back of queues of other workers, so a slow chunk doesn't hold the whole run.
+namespace Renaissance
+{
+class ThreadPool
+{
+public:
+   explicit ThreadPool(const size_t threads_number = std::thread::hardware_concurrency());
+   ThreadPool(const ThreadPool&) = delete;
+   ThreadPool(ThreadPool&&) = delete;
+   ThreadPool& operator =(const ThreadPool&) = delete;
+   ThreadPool& operator =(ThreadPool&&) = delete;
+   ~ThreadPool();
+
+   void Run(const size_t tasks_number, const std::function<void(size_t task)>& task);
+
+   inline size_t ThreadsNumber() const noexcept { return _threads.size(); }
+
+private:
+   struct Worker
+   {
+      std::mutex _mutex;
+      std::deque<size_t> _tasks;
+   };
+
+   std::vector<std::unique_ptr<Worker>> _workers;
+   std::vector<std::thread> _threads;
+   std::mutex _run_mutex; // only one Run at a time
+   std::mutex _mutex;     // guards the fields below
+   std::condition_variable _work_available;
+   std::condition_variable _work_done;
+   const std::function<void(size_t)>* _task = nullptr;
+   size_t _generation = 0;
+   size_t _remaining_tasks = 0;
+   bool _stop = false;
+
+   void WorkerLoop(const size_t worker_index);
+   bool PopTask(const size_t worker_index, size_t& task);
+};
+}
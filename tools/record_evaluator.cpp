@@ -0,0 +1,451 @@
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <future>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "../rule_set.h"
+#include "../rule_set_image.h"
+#include "../string_set.h"
+#include "../thread_pool.h"
+#include "rule_file.h"
+
+// Evaluates rules over a file of records, one record per line, and writes '<record offset>\t<rule id>[,<rule id>...]' for every matching record.
+// Usage: record_evaluator [-f kv|csv] [-d <delimiter>] [-t <threads>] [-c <chunk size in MB>] [-m all|first] [-o <output>]
+//                         (-r <rules file> | -e <expression> | -i <rule set image>)... <records file>
+// Fields of 'kv' records are 'name=value', the first line of a 'csv' file has the variable names of the columns, quotes are not supported.
+// The file is mapped and split into chunks at line boundaries, chunks are parsed and evaluated by the pool threads
+// while the results of the previous chunks are written, values of the variables are views into the mapped file.
+// Processed chunks are dropped from the mapping, so files larger than memory are read at the sequential read speed.
+// Throughput is reported to the standard error.
+
+using namespace Renaissance;
+
+namespace
+{
+enum class RecordFormat
+{
+   KeyValue,
+   Delimited
+};
+
+struct Options
+{
+   RecordFormat _format = RecordFormat::KeyValue;
+   char _delimiter = ',';
+   size_t _threads_number = std::thread::hardware_concurrency();
+   size_t _chunk_size = 4 * 1024 * 1024;
+   bool _first_match = false;
+   std::string _output;
+   std::vector<std::string> _rule_files;
+   std::vector<std::string> _expressions;
+   std::string _image;
+   std::string _input;
+};
+
+struct ViewHash
+{
+   inline size_t operator ()(const StringView& value) const noexcept { return static_cast<size_t>(StringSet::Hash(value)); }
+};
+
+// the rules are either compiled into a rule set or mapped from an image
+class Rules
+{
+public:
+   bool Read(const Options& options)
+   {
+      if (!options._image.empty())
+      {
+         if (!_image.Load(options._image))
+         {
+            std::cerr << options._image << ": can't load the rule set image" << std::endl;
+            return false;
+         }
+         for (size_t i = 0; i < _image.RulesNumber(); i++)
+            _ids.push_back(std::to_string(i));
+         for (uint32_t slot = 0; slot < _image.VariablesNumber(); slot++)
+            _slots.emplace(_image.VariableName(slot), slot);
+         return true;
+      }
+
+      std::unordered_set<std::string> ids;
+      const auto add_rule = [this, &ids](const std::string& rule_id, const std::string& expression)
+      {
+         size_t rule_index = 0;
+         if (!ids.insert(rule_id).second || !_rule_set.AddRule(expression, rule_index))
+            return false;
+         _ids.push_back(rule_id);
+         return true;
+      };
+      for (const auto& rule_file : options._rule_files)
+      {
+         if (!ReadRuleFile(rule_file, add_rule))
+            return false;
+      }
+      for (size_t i = 0; i < options._expressions.size(); i++)
+      {
+         if (!add_rule("e" + std::to_string(i), options._expressions[i]))
+         {
+            std::cerr << "expression '" << options._expressions[i] << "' is invalid" << std::endl;
+            return false;
+         }
+      }
+      for (uint32_t slot = 0; slot < _rule_set.Schema().Size(); slot++)
+         _slots.emplace(_rule_set.Schema().VariableName(slot), slot);
+      return true;
+   }
+
+   inline size_t VariablesNumber() const { return _slots.size(); }
+   inline const std::string& RuleId(const size_t rule_index) const { return _ids[rule_index]; }
+
+   // returns the slot of the variable or UINT32_MAX if no rule takes the variable
+   inline uint32_t FindVariable(const StringView& name) const
+   {
+      const auto it = _slots.find(name);
+      return (it != _slots.end() ? it->second : std::numeric_limits<uint32_t>::max());
+   }
+
+   inline void FindMatches(const VariableRecord& record, RuleSetContext& context, const bool first_match) const
+   {
+      size_t rule_index = 0;
+      if (_image.IsLoaded() && first_match)
+         _image.FindFirstMatch(record, context, rule_index);
+      else if (_image.IsLoaded())
+         _image.FindAllMatches(record, context);
+      else if (first_match)
+         _rule_set.FindFirstMatch(record, context, rule_index);
+      else
+         _rule_set.FindAllMatches(record, context);
+   }
+
+private:
+   RuleSet _rule_set;
+   RuleSetImage _image;
+   std::vector<std::string> _ids;
+   std::unordered_map<StringView, uint32_t, ViewHash> _slots; // names point into the rule set schema or into the image
+};
+
+// state of a chunk slot of a batch, it's reused by the chunks of all batches, so chunks are processed without allocations
+struct Chunk
+{
+   const char* _begin = nullptr;
+   const char* _end = nullptr;
+   VariableRecord _record;
+   RuleSetContext _context;
+   std::string _output;
+   size_t _records = 0;
+   size_t _matches = 0;
+   size_t _failures = 0; // records for which some rules couldn't be evaluated
+};
+
+class RecordEvaluator
+{
+public:
+   RecordEvaluator(const Options& options, const Rules& rules) : _options(options), _rules(rules) {}
+
+   // map the column names of the header line of a delimited file to the variable slots
+   void ReadHeader(const StringView& line)
+   {
+      ForEachField(line, [this](const StringView& field) { _column_slots.push_back(_rules.FindVariable(field)); });
+   }
+
+   void ProcessChunk(const char* const file_begin, Chunk& chunk) const
+   {
+      chunk._output.clear();
+      chunk._records = 0;
+      chunk._matches = 0;
+      chunk._failures = 0;
+      for (const char* line_begin = chunk._begin; line_begin < chunk._end; )
+      {
+         const char* line_end = static_cast<const char*>(std::memchr(line_begin, '\n', chunk._end - line_begin));
+         if (line_end == nullptr)
+            line_end = chunk._end;
+         StringView line(line_begin, line_end - line_begin);
+         if (!line.empty() && line.back() == '\r')
+            line.remove_suffix(1);
+
+         if (!line.empty())
+         {
+            ParseRecord(line, chunk._record);
+            _rules.FindMatches(chunk._record, chunk._context, _options._first_match);
+            ++chunk._records;
+            chunk._failures += chunk._context.Failures().any();
+            WriteMatches(static_cast<size_t>(line_begin - file_begin), chunk);
+         }
+         line_begin = line_end + 1;
+      }
+   }
+
+private:
+   const Options& _options;
+   const Rules& _rules;
+   std::vector<uint32_t> _column_slots;
+
+   template <typename FieldHandler>
+   void ForEachField(const StringView& line, const FieldHandler& handler) const
+   {
+      size_t begin = 0;
+      while (true)
+      {
+         const size_t end = line.find(_options._delimiter, begin);
+         handler(line.substr(begin, end == StringView::npos ? StringView::npos : end - begin));
+         if (end == StringView::npos)
+            return;
+         begin = end + 1;
+      }
+   }
+
+   void ParseRecord(const StringView& line, VariableRecord& record) const
+   {
+      record.assign(_rules.VariablesNumber(), StringView());
+      if (_options._format == RecordFormat::Delimited)
+      {
+         size_t column = 0;
+         ForEachField(line, [this, &record, &column](const StringView& field)
+         {
+            if (column < _column_slots.size() && _column_slots[column] < record.size())
+               record[_column_slots[column]] = field;
+            ++column;
+         });
+         return;
+      }
+
+      ForEachField(line, [this, &record](const StringView& field)
+      {
+         const size_t separator = field.find('=');
+         if (separator == StringView::npos)
+            return;
+         const uint32_t slot = _rules.FindVariable(field.substr(0, separator));
+         if (slot < record.size())
+            record[slot] = field.substr(separator + 1);
+      });
+   }
+
+   void WriteMatches(const size_t offset, Chunk& chunk) const
+   {
+      const RuleBitmap& matches = chunk._context.Matches();
+      size_t rule_index = matches.find_first();
+      if (rule_index == RuleBitmap::npos)
+         return;
+
+      ++chunk._matches;
+      char number[24];
+      chunk._output.append(number, std::to_chars(number, number + sizeof(number), offset).ptr);
+      char separator = '\t';
+      for (; rule_index != RuleBitmap::npos; rule_index = matches.find_next(rule_index))
+      {
+         chunk._output += separator;
+         chunk._output += _rules.RuleId(rule_index);
+         separator = ',';
+      }
+      chunk._output += '\n';
+   }
+};
+
+void PrintUsage()
+{
+   std::cerr << "usage: record_evaluator [-f kv|csv] [-d <delimiter>] [-t <threads>] [-c <chunk size in MB>] [-m all|first] [-o <output>]" << std::endl
+             << "                        (-r <rules file> | -e <expression> | -i <rule set image>)... <records file>" << std::endl;
+}
+
+bool ParseOptions(int argc, char* argv[], Options& options)
+{
+   for (int i = 1; i < argc; i++)
+   {
+      const std::string argument = argv[i];
+      if (argument.size() != 2 || argument[0] != '-')
+      {
+         if (!options._input.empty())
+            return false;
+         options._input = argument;
+         continue;
+      }
+      if (i + 1 >= argc)
+         return false;
+
+      const std::string value = argv[++i];
+      switch (argument[1])
+      {
+         case 'f':
+            if (value != "kv" && value != "csv")
+               return false;
+            options._format = (value == "kv" ? RecordFormat::KeyValue : RecordFormat::Delimited);
+            break;
+         case 'd':
+            if (value.size() != 1)
+               return false;
+            options._delimiter = value[0];
+            break;
+         case 't':
+            options._threads_number = std::stoul(value);
+            break;
+         case 'c':
+            options._chunk_size = std::max<size_t>(std::stoul(value), 1) * 1024 * 1024;
+            break;
+         case 'm':
+            if (value != "all" && value != "first")
+               return false;
+            options._first_match = (value == "first");
+            break;
+         case 'o':
+            options._output = value;
+            break;
+         case 'r':
+            options._rule_files.push_back(value);
+            break;
+         case 'e':
+            options._expressions.push_back(value);
+            break;
+         case 'i':
+            options._image = value;
+            break;
+         default:
+            return false;
+      }
+   }
+
+   // rules of an image can't be mixed with other rules, as they are indexed by their order
+   const bool has_rules = !options._rule_files.empty() || !options._expressions.empty();
+   return !options._input.empty() && (has_rules != !options._image.empty());
+}
+}
+
+int main(int argc, char* argv[])
+{
+   Options options;
+   try
+   {
+      if (!ParseOptions(argc, argv, options))
+      {
+         PrintUsage();
+         return 2;
+      }
+   }
+   catch (const std::exception&)
+   {
+      PrintUsage();
+      return 2;
+   }
+
+   Rules rules;
+   if (!rules.Read(options))
+      return 1;
+
+   std::ofstream output_file;
+   if (!options._output.empty())
+   {
+      output_file.open(options._output, std::ios::binary | std::ios::trunc);
+      if (!output_file)
+      {
+         std::cerr << options._output << ": can't open the file" << std::endl;
+         return 1;
+      }
+   }
+   std::ostream& output = (options._output.empty() ? std::cout : output_file);
+
+   const int file = open(options._input.c_str(), O_RDONLY | O_CLOEXEC);
+   struct stat file_status;
+   if (file < 0 || fstat(file, &file_status) != 0)
+   {
+      std::cerr << options._input << ": can't open the file" << std::endl;
+      return 1;
+   }
+   const size_t file_size = static_cast<size_t>(file_status.st_size);
+   const char* const file_begin = static_cast<const char*>(file_size > 0 ? mmap(nullptr, file_size, PROT_READ, MAP_SHARED, file, 0) : nullptr);
+   close(file); // the mapping keeps the file
+   if (file_begin == MAP_FAILED)
+   {
+      std::cerr << options._input << ": can't map the file" << std::endl;
+      return 1;
+   }
+   const char* const file_end = file_begin + file_size;
+   if (file_size > 0)
+      madvise(const_cast<char*>(file_begin), file_size, MADV_SEQUENTIAL);
+
+   const auto start = std::chrono::steady_clock::now();
+   RecordEvaluator evaluator(options, rules);
+   const char* position = file_begin;
+   if (options._format == RecordFormat::Delimited && position != file_end)
+   {
+      const char* header_end = static_cast<const char*>(std::memchr(position, '\n', file_end - position));
+      header_end = (header_end != nullptr ? header_end : file_end);
+      StringView header(position, header_end - position);
+      if (!header.empty() && header.back() == '\r')
+         header.remove_suffix(1);
+      evaluator.ReadHeader(header);
+      position = std::min(header_end + 1, file_end);
+   }
+
+   // while the pool processes a batch, the results of the previous one are written, so the chunk slots are doubled
+   ThreadPool pool(options._threads_number);
+   const size_t batch_size = pool.ThreadsNumber() * 4;
+   std::vector<Chunk> chunks(batch_size * 2);
+   std::future<void> writing;
+   size_t records = 0;
+   size_t matches = 0;
+   size_t failures = 0;
+   for (size_t batch = 0; position != file_end; batch++)
+   {
+      Chunk* const batch_chunks = &chunks[(batch % 2) * batch_size];
+      size_t chunks_number = 0;
+      for (; chunks_number < batch_size && position != file_end; chunks_number++)
+      {
+         // a chunk ends after the end of the line its size ends in
+         const char* chunk_end = position + std::min<size_t>(options._chunk_size, file_end - position);
+         const char* line_end = (chunk_end != file_end ? static_cast<const char*>(std::memchr(chunk_end, '\n', file_end - chunk_end)) : nullptr);
+         chunk_end = (line_end != nullptr ? line_end + 1 : file_end);
+         batch_chunks[chunks_number]._begin = position;
+         batch_chunks[chunks_number]._end = chunk_end;
+         position = chunk_end;
+      }
+
+      pool.Run(chunks_number, [&evaluator, file_begin, batch_chunks](const size_t task) { evaluator.ProcessChunk(file_begin, batch_chunks[task]); });
+
+      if (writing.valid())
+         writing.get();
+      writing = std::async(std::launch::async, [&output, batch_chunks, chunks_number, file_begin]()
+      {
+         for (size_t i = 0; i < chunks_number; i++)
+            output.write(batch_chunks[i]._output.data(), batch_chunks[i]._output.size());
+
+         // pages of the processed chunks are dropped, so they don't push other data out of memory
+         const uintptr_t page_size = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+         const uintptr_t begin = reinterpret_cast<uintptr_t>(batch_chunks[0]._begin) & ~(page_size - 1);
+         const uintptr_t end = reinterpret_cast<uintptr_t>(batch_chunks[chunks_number - 1]._end) & ~(page_size - 1);
+         if (end > begin && begin >= reinterpret_cast<uintptr_t>(file_begin))
+            madvise(reinterpret_cast<void*>(begin), end - begin, MADV_DONTNEED);
+      });
+      for (size_t i = 0; i < chunks_number; i++)
+      {
+         records += batch_chunks[i]._records;
+         matches += batch_chunks[i]._matches;
+         failures += batch_chunks[i]._failures;
+      }
+   }
+   if (writing.valid())
+      writing.get();
+   output.flush();
+
+   const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+   std::cerr << records << " records, " << matches << " matching, " << failures << " with failed rules in " << seconds << " s: "
+             << (seconds > 0 ? records / seconds : 0) << " records/s, " << (seconds > 0 ? file_size / seconds / 1e9 : 0) << " GB/s" << std::endl;
+
+   if (file_size > 0)
+      munmap(const_cast<char*>(file_begin), file_size);
+   if (!output)
+   {
+      std::cerr << (options._output.empty() ? "output" : options._output) << ": can't write the results" << std::endl;
+      return 1;
+   }
+   return 0;
+}
@@ -0,0 +1,69 @@
+#include <fstream>
+#include <iostream>
+#include <string>
+#include "../generated_rules.h"
+#include "../rule_code_generator.h"
+#include "../rule_set_image.h"
+#include "rule_file.h"
+
+// Compiles rule files into C++ source code of a GeneratedRuleSet and/or into a RuleSetImage.
+// Usage: rule_compiler [-s <symbol>] [-o <output.cpp>] [-i <output image>] <rules file>...
+// Rule files are read by ReadRuleFile, rules of the image are indexed by the order of their lines.
+
+using namespace Renaissance;
+
+int main(int argc, char* argv[])
+{
+   std::string symbol = DefaultGeneratedRuleSetSymbol;
+   std::string output;
+   std::string image_output;
+   std::vector<std::string> inputs;
+   for (int i = 1; i < argc; i++)
+   {
+      const std::string argument = argv[i];
+      if ((argument == "-s" || argument == "-o") && i + 1 < argc)
+         (argument == "-s" ? symbol : output) = argv[++i];
+      else if (argument == "-i" && i + 1 < argc)
+         image_output = argv[++i];
+      else
+         inputs.push_back(argument);
+   }
+
+   if ((output.empty() && image_output.empty()) || inputs.empty())
+   {
+      std::cerr << "usage: rule_compiler [-s <symbol>] [-o <output.cpp>] [-i <output image>] <rules file>..." << std::endl;
+      return 2;
+   }
+
+   RuleCodeGenerator generator;
+   RuleSet rule_set;
+   for (const auto& input : inputs)
+   {
+      const bool is_read = ReadRuleFile(input, [&generator, &rule_set](const std::string& rule_id, const std::string& expression)
+      {
+         size_t rule_index = 0;
+         return generator.AddRule(rule_id, expression) && rule_set.AddRule(expression, rule_index);
+      });
+      if (!is_read)
+         return 1;
+   }
+
+   if (!image_output.empty() && !RuleSetImage::Save(rule_set, image_output))
+   {
+      std::cerr << image_output << ": can't write the file" << std::endl;
+      return 1;
+   }
+   if (output.empty())
+      return 0;
+
+   std::string code;
+   generator.Generate(symbol, code);
+   std::ofstream file(output);
+   file << code;
+   if (!file)
+   {
+      std::cerr << output << ": can't write the file" << std::endl;
+      return 1;
+   }
+   return 0;
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <cctype>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+// Rule files are read by the tools: every line of a rule file is '<rule id> <expression>',
+// empty lines and lines starting with '#' are skipped.
+namespace Renaissance
+{
+// read the rules of the file, 'add_rule' is called with the id and the expression of every rule and returns false if the rule is rejected
+// errors are reported to the standard error, returns true if all rules are added
+template <typename AddRule>
+bool ReadRuleFile(const std::string& path, const AddRule& add_rule)
+{
+   std::ifstream file(path);
+   if (!file)
+   {
+      std::cerr << path << ": can't open the file" << std::endl;
+      return false;
+   }
+
+   std::string line;
+   for (size_t line_number = 1; std::getline(file, line); line_number++)
+   {
+      const size_t id_begin = line.find_first_not_of(" \t\r");
+      if (id_begin == std::string::npos || line[id_begin] == '#')
+         continue;
+
+      size_t id_end = id_begin;
+      while (id_end < line.size() && !std::isspace(static_cast<unsigned char>(line[id_end])))
+         id_end++;
+
+      const std::string rule_id = line.substr(id_begin, id_end - id_begin);
+      std::string expression = (id_end < line.size() ? line.substr(id_end + 1) : std::string());
+      if (!expression.empty() && expression.back() == '\r')
+         expression.pop_back();
+      if (!add_rule(rule_id, expression))
+      {
+         std::cerr << path << ":" << line_number << ": rule '" << rule_id << "' is invalid or defined twice" << std::endl;
+         return false;
+      }
+   }
+   return true;
+}
+}
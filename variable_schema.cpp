@@ -0,0 +1,46 @@
+#include "variable_schema.h"
+
+namespace Renaissance
+{
+// register a variable and return its slot, a variable which is already registered keeps its slot
+uint32_t VariableSchema::AddVariable(const std::string& name)
+{
+   auto it = _slots.find(name);
+   if (it != _slots.end())
+      return it->second;
+
+   const uint32_t slot = static_cast<uint32_t>(_names.size());
+   _slots.emplace(name, slot);
+   _names.push_back(name);
+   _types.push_back(VariableType::String);
+   return slot;
+}
+
+// register a variable of the specified type and return its slot, a variable which is already registered keeps its slot and gets the type
+// expressions compiled before the type is changed keep the type they were compiled with
+uint32_t VariableSchema::AddVariable(const std::string& name, const VariableType type)
+{
+   const uint32_t slot = AddVariable(name);
+   _types[slot] = type;
+   return slot;
+}
+
+// search for a registered variable, its slot is returned in the 'slot' output parameter
+// returns true if the variable is found
+bool VariableSchema::FindVariable(const std::string& name, uint32_t& slot) const
+{
+   auto it = _slots.find(name);
+   if (it == _slots.end())
+      return false;
+
+   slot = it->second;
+   return true;
+}
+
+// returns true if the variable is registered and tagged as a number
+bool VariableSchema::IsNumber(const std::string& name) const
+{
+   auto it = _slots.find(name);
+   return it != _slots.end() && _types[it->second] == VariableType::Number;
+}
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "common.h"
+
+namespace Renaissance
+{
+enum class VariableType : uint8_t
+{
+   String, // values are compared as strings, this is the type of all variables which are not tagged otherwise
+   Number  // values are decimal numbers (see ParseNumber), they are compared as numbers, a value which is not a number fails the evaluation
+};
+
+// This is a registry of variable names, every variable gets a dense slot index.
+// Expressions compiled with a schema refer to variables by their slots, so they can be evaluated over a VariableRecord,
+// where the value of every variable is stored at its slot, without any name lookups.
+// Variables might be tagged as numbers, it must be done before compiling expressions which use them.
+class VariableSchema
+{
+public:
+   VariableSchema() = default;
+   VariableSchema(const VariableSchema&) = default;
+   VariableSchema(VariableSchema&&) = default;
+   VariableSchema& operator =(const VariableSchema&) = default;
+   VariableSchema& operator =(VariableSchema&&) = default;
+   ~VariableSchema() = default;
+
+   uint32_t AddVariable(const std::string& name);
+   uint32_t AddVariable(const std::string& name, const VariableType type);
+   bool FindVariable(const std::string& name, uint32_t& slot) const;
+   bool IsNumber(const std::string& name) const;
+
+   inline size_t Size() const noexcept { return _names.size(); }
+   inline const std::string& VariableName(const uint32_t slot) const { return _names[slot]; }
+   inline VariableType GetVariableType(const uint32_t slot) const { return _types[slot]; }
+
+private:
+   std::unordered_map<std::string, uint32_t> _slots;
+   std::vector<std::string> _names;
+   std::vector<VariableType> _types;
+};
+}